@@ -14,6 +14,7 @@ extern "C" {
 //various constants
 #define AD9361_TRANSACTION_VERSION       0x4
 #define AD9361_DISPATCH_PACKET_SIZE      64
+#define AD9361_BATCH_MAX_ACTIONS         4
 
 //action types
 #define AD9361_ACTION_ECHO 0
@@ -27,6 +28,7 @@ extern "C" {
 #define AD9361_ACTION_SET_CODEC_LOOP 8
 #define AD9361_ACTION_SET_CLOCK_RATE 9
 #define AD9361_ACTION_SET_ACTIVE_CHAINS 10
+#define AD9361_ACTION_BATCH 11
 
 static inline void ad9361_double_pack(const double input, uint32_t output[2])
 {
@@ -83,6 +85,28 @@ typedef struct
 
 #define AD9361_TRANSACTION_MAX_ERROR_MSG (AD9361_DISPATCH_PACKET_SIZE - (sizeof(ad9361_transaction_t)-4)-1)	// -4 for 'error_msg' alignment padding, -1 for terminating \0
 
+//one action of a batch, value has the same meaning as in ad9361_transaction_t
+typedef struct
+{
+    uint32_t action;
+    uint32_t value[2];
+} ad9361_batch_item_t;
+
+//A batch carries several actions in one dispatch packet.
+//The actions execute in order and each item's value is replaced by its result.
+//On reply, num_actions holds the number of actions that completed;
+//when it is less than requested, error_msg of the reply (read as an
+//ad9361_transaction_t) holds the error of the action that failed.
+typedef struct
+{
+    uint32_t version;
+    uint32_t sequence;
+    uint32_t action; //AD9361_ACTION_BATCH
+    uint32_t num_actions;
+    ad9361_batch_item_t items[AD9361_BATCH_MAX_ACTIONS];
+
+} ad9361_batch_transaction_t;
+
 #ifdef __cplusplus
 }
 #endif
@@ -1852,63 +1852,54 @@ double set_gain(int which, int n, const double value) {
     }
 }
 
-/* This function is responsible to dispatch the vendor request call
- * to the proper handler
+/* Execute a single action. The value holds the request argument
+ * and is replaced by the result of the action (gain, freq, rate).
  */
-void ad9361_dispatch(const char* vrb, char* vrb_out) {
-    memcpy(vrb_out, vrb, AD9361_DISPATCH_PACKET_SIZE);  // Copy request to response memory
-    tmp_req_buffer = vrb_out;                           // Set this to enable 'post_err_msg'
-    
-    //////////////////////////////////////////////
-    
+static void ad9361_dispatch_action(const uint32_t action, uint32_t value[2]) {
     double ret_val = 0.0;
     int mask = 0;
-    
-    const ad9361_transaction_t *request = (const ad9361_transaction_t *)vrb;
-    ad9361_transaction_t *response = (ad9361_transaction_t *)vrb_out;
-    response->error_msg[0] = '\0';  // Ensure error is cleared
-    
-    //msg("[ad9361_dispatch] action=%d", request->action);
-    
-    switch (request->action) {
+
+    //msg("[ad9361_dispatch] action=%d", action);
+
+    switch (action) {
         case AD9361_ACTION_ECHO:
             break; // nothing to do
         case AD9361_ACTION_INIT:
             init_ad9361();
             break;
         case AD9361_ACTION_SET_RX1_GAIN:
-            ret_val = set_gain(RX_TYPE,1,double_unpack(request->value.gain));
-            double_pack(ret_val, response->value.gain);
+            ret_val = set_gain(RX_TYPE,1,double_unpack(value));
+            double_pack(ret_val, value);
             break;
         case AD9361_ACTION_SET_TX1_GAIN:
-            ret_val = set_gain(TX_TYPE,1,double_unpack(request->value.gain));
-            double_pack(ret_val, response->value.gain);
+            ret_val = set_gain(TX_TYPE,1,double_unpack(value));
+            double_pack(ret_val, value);
             break;
         case AD9361_ACTION_SET_RX2_GAIN:
-            ret_val = set_gain(RX_TYPE,2,double_unpack(request->value.gain));
-            double_pack(ret_val, response->value.gain);
+            ret_val = set_gain(RX_TYPE,2,double_unpack(value));
+            double_pack(ret_val, value);
             break;
         case AD9361_ACTION_SET_TX2_GAIN:
-            ret_val = set_gain(TX_TYPE,2,double_unpack(request->value.gain));
-            double_pack(ret_val, response->value.gain);
+            ret_val = set_gain(TX_TYPE,2,double_unpack(value));
+            double_pack(ret_val, value);
             break;
         case AD9361_ACTION_SET_RX_FREQ:
-            ret_val = tune(RX_TYPE, double_unpack(request->value.freq));
-            double_pack(ret_val, response->value.freq);
+            ret_val = tune(RX_TYPE, double_unpack(value));
+            double_pack(ret_val, value);
             break;
         case AD9361_ACTION_SET_TX_FREQ:
-            ret_val = tune(TX_TYPE, double_unpack(request->value.freq));
-            double_pack(ret_val, response->value.freq);
+            ret_val = tune(TX_TYPE, double_unpack(value));
+            double_pack(ret_val, value);
             break;
         case AD9361_ACTION_SET_CODEC_LOOP:
-            data_port_loopback(request->value.codec_loop != 0);
+            data_port_loopback(value[0] != 0);
             break;
         case AD9361_ACTION_SET_CLOCK_RATE:
-            ret_val = set_clock_rate(double_unpack(request->value.rate));
-            double_pack(ret_val, response->value.rate);
+            ret_val = set_clock_rate(double_unpack(value));
+            double_pack(ret_val, value);
             break;
         case AD9361_ACTION_SET_ACTIVE_CHAINS:
-            mask = request->value.enable_mask;
+            mask = value[0];
             set_active_chains(mask & 1, mask & 2, mask & 4, mask & 8);
             break;
         default:
@@ -1916,3 +1907,59 @@ void ad9361_dispatch(const char* vrb, char* vrb_out) {
             break;
     }
 }
+
+/* Execute the actions of a batch in order, stopping at the first error.
+ * Errors are collected in a scratch transaction so that they do not
+ * overwrite the items, then reported in the usual error_msg location.
+ */
+static void ad9361_dispatch_batch(char* vrb_out) {
+    ad9361_batch_transaction_t *batch = (ad9361_batch_transaction_t *)vrb_out;
+    char scratch[AD9361_DISPATCH_PACKET_SIZE];
+    ad9361_transaction_t *scratch_xact = (ad9361_transaction_t *)scratch;
+    uint32_t num_requested = batch->num_actions;
+    uint32_t i = 0;
+
+    if (num_requested > AD9361_BATCH_MAX_ACTIONS)
+        num_requested = AD9361_BATCH_MAX_ACTIONS;
+
+    scratch_xact->error_msg[0] = '\0';
+    tmp_req_buffer = scratch;
+
+    for (i = 0; i < num_requested; i++) {
+        if (batch->items[i].action == AD9361_ACTION_BATCH) {
+            post_err_msg("[ad9361_dispatch] nested batch");
+        } else {
+            ad9361_dispatch_action(batch->items[i].action, batch->items[i].value);
+        }
+        if (scratch_xact->error_msg[0] != '\0')
+            break;
+    }
+
+    tmp_req_buffer = vrb_out;
+    batch->num_actions = i;
+
+    // error_msg overlaps the items, so only write it when there is an error
+    if (scratch_xact->error_msg[0] != '\0') {
+        ad9361_transaction_t *response = (ad9361_transaction_t *)vrb_out;
+        strcpy(response->error_msg, scratch_xact->error_msg);
+    }
+}
+
+/* This function is responsible to dispatch the vendor request call
+ * to the proper handler
+ */
+void ad9361_dispatch(const char* vrb, char* vrb_out) {
+    memcpy(vrb_out, vrb, AD9361_DISPATCH_PACKET_SIZE);  // Copy request to response memory
+    tmp_req_buffer = vrb_out;                           // Set this to enable 'post_err_msg'
+    
+    //////////////////////////////////////////////
+    
+    ad9361_transaction_t *response = (ad9361_transaction_t *)vrb_out;
+    
+    if (response->action == AD9361_ACTION_BATCH) {
+        ad9361_dispatch_batch(vrb_out);
+    } else {
+        response->error_msg[0] = '\0';  // Ensure error is cleared
+        ad9361_dispatch_action(response->action, response->value.freq);
+    }
+}
@@ -27,6 +27,7 @@
 #include <iostream>
 #include <complex>
 #include <cstdlib>
+#include <cmath>
 
 namespace po = boost::program_options;
 
@@ -168,6 +169,53 @@ void benchmark_tx_rate_async_helper(uhd::tx_streamer::sptr tx_stream){
     }
 }
 
+/***********************************************************************
+ * TX timing report
+ **********************************************************************/
+//! Get the bin of a histogram that holds the given fraction of the counts
+size_t get_percentile_bin(const boost::uint64_t *bins, const size_t num_bins, const double fraction){
+    boost::uint64_t total = 0, count = 0;
+    for (size_t i = 0; i < num_bins; i++) total += bins[i];
+    for (size_t i = 0; i < num_bins; i++){
+        count += bins[i];
+        if (count > 0 and count >= fraction*total) return i;
+    }
+    return 0;
+}
+
+//! Get the upper bound of a latency bin in microseconds
+double get_latency_bin_us(const size_t bin){
+    return std::ldexp(1.0, int(bin+1))/1e3;
+}
+
+void print_tx_timing_report(uhd::tx_streamer::sptr tx_stream){
+    for (size_t ch = 0; ch < tx_stream->get_num_channels(); ch++){
+        const uhd::stream_stats_t stats = tx_stream->get_stats(ch);
+        const size_t num_bins = uhd::stream_stats_t::NUM_LATENCY_BINS;
+        const size_t num_occ_bins = uhd::stream_stats_t::NUM_OCCUPANCY_BINS;
+        boost::uint64_t num_acked = 0;
+        for (size_t i = 0; i < num_bins; i++) num_acked += stats.ack_latency[i];
+        if (num_acked == 0) continue; //the device does not acknowledge packets
+
+        std::cout << boost::format(
+            "TX channel %u timing (%u packets acknowledged, bin upper bounds):\n"
+            "  Commit to ack:    median %.0f us, 99%% %.0f us, max %.0f us\n"
+            "  send() to ack:    median %.0f us, 99%% %.0f us, max %.0f us\n"
+            "  Buffer occupancy: median %.0f%%, 99%% %.0f%%, max %.0f%% of the window\n"
+        ) % ch % num_acked
+            % get_latency_bin_us(get_percentile_bin(stats.ack_latency, num_bins, 0.5))
+            % get_latency_bin_us(get_percentile_bin(stats.ack_latency, num_bins, 0.99))
+            % get_latency_bin_us(get_percentile_bin(stats.ack_latency, num_bins, 1.0))
+            % get_latency_bin_us(get_percentile_bin(stats.send_ack_latency, num_bins, 0.5))
+            % get_latency_bin_us(get_percentile_bin(stats.send_ack_latency, num_bins, 0.99))
+            % get_latency_bin_us(get_percentile_bin(stats.send_ack_latency, num_bins, 1.0))
+            % (100.0*(get_percentile_bin(stats.buffer_occupancy, num_occ_bins, 0.5)+1)/num_occ_bins)
+            % (100.0*(get_percentile_bin(stats.buffer_occupancy, num_occ_bins, 0.99)+1)/num_occ_bins)
+            % (100.0*(get_percentile_bin(stats.buffer_occupancy, num_occ_bins, 1.0)+1)/num_occ_bins)
+        << std::endl;
+    }
+}
+
 /***********************************************************************
  * Main code + dispatcher
  **********************************************************************/
@@ -255,12 +303,13 @@ int UHD_SAFE_MAIN(int argc, char *argv[]){
     }
 
     //spawn the transmit test thread
+    uhd::tx_streamer::sptr tx_stream;
     if (vm.count("tx_rate")){
         usrp->set_tx_rate(tx_rate);
         //create a transmit streamer
         uhd::stream_args_t stream_args(tx_cpu, tx_otw);
         stream_args.channels = channel_nums;
-        uhd::tx_streamer::sptr tx_stream = usrp->get_tx_stream(stream_args);
+        tx_stream = usrp->get_tx_stream(stream_args);
         thread_group.create_thread(boost::bind(&benchmark_tx_rate, usrp, tx_cpu, tx_stream));
         thread_group.create_thread(boost::bind(&benchmark_tx_rate_async_helper, tx_stream));
     }
@@ -284,6 +333,7 @@ int UHD_SAFE_MAIN(int argc, char *argv[]){
         "  Num sequence errors:     %u\n"
         "  Num underflows detected: %u\n"
     ) % num_rx_samps % num_dropped_samps % num_overflows % num_tx_samps % num_seq_errors % num_underflows << std::endl;
+    if (tx_stream) print_tx_timing_report(tx_stream);
 
     //finished
     std::cout << std::endl << "Done!" << std::endl << std::endl;
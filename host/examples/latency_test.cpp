@@ -22,9 +22,17 @@
 #include <boost/format.hpp>
 #include <iostream>
 #include <complex>
+#include <algorithm>
+#include <vector>
 
 namespace po = boost::program_options;
 
+//the value below which a fraction of the sorted samples lie
+static double percentile(const std::vector<double> &sorted, const double fraction){
+    if (sorted.empty()) return 0.0;
+    return sorted[size_t(fraction*(sorted.size()-1) + 0.5)];
+}
+
 int UHD_SAFE_MAIN(int argc, char *argv[]){
     uhd::set_thread_priority_safe();
 
@@ -58,6 +66,11 @@ int UHD_SAFE_MAIN(int argc, char *argv[]){
         "    and tries to send a packet at time t + rtt,\n"
         "    where rtt is the round trip time sample time\n"
         "    from device to host and back to the device.\n"
+        "\n"
+        "    The test also reports percentiles of the measured round trip\n"
+        "    time: from the time of the received packet until send() returns,\n"
+        "    in device time (estimated from the host clock). Compare transport\n"
+        "    modes by changing the args, ex: --args=\"recv_busy_poll=100\".\n"
         << std::endl;
         return ~0;
     }
@@ -93,6 +106,7 @@ int UHD_SAFE_MAIN(int argc, char *argv[]){
     int ack = 0;
     int underflow = 0;
     int other = 0;
+    std::vector<double> round_trips;
 
     for(size_t nrun = 0; nrun < nruns; nrun++){
 
@@ -102,7 +116,9 @@ int UHD_SAFE_MAIN(int argc, char *argv[]){
         uhd::stream_cmd_t stream_cmd(uhd::stream_cmd_t::STREAM_MODE_NUM_SAMPS_AND_DONE);
         stream_cmd.num_samps = buffer.size();
         stream_cmd.stream_now = false;
-        stream_cmd.time_spec = usrp->get_time_now() + uhd::time_spec_t(0.01);
+        const uhd::time_spec_t host_time = uhd::time_spec_t::get_system_time();
+        const uhd::time_spec_t device_time = usrp->get_time_now();
+        stream_cmd.time_spec = device_time + uhd::time_spec_t(0.01);
         rx_stream->issue_stream_cmd(stream_cmd);
 
         /***************************************************************
@@ -127,6 +143,8 @@ int UHD_SAFE_MAIN(int argc, char *argv[]){
         size_t num_tx_samps = tx_stream->send(
             &buffer.front(), buffer.size(), tx_md
         );
+        const uhd::time_spec_t send_done = uhd::time_spec_t::get_system_time() - host_time + device_time;
+        round_trips.push_back((send_done - rx_md.time_spec).get_real_secs());
         if(verbose) std::cout << boost::format("Sent %d samples") % num_tx_samps << std::endl;
 
         /***************************************************************
@@ -164,5 +182,10 @@ int UHD_SAFE_MAIN(int argc, char *argv[]){
      **************************************************************/
     std::cout << boost::format("\nACK %d, UNDERFLOW %d, TIME_ERR %d, other %d")
         % ack % underflow % time_error % other << std::endl;
+
+    std::sort(round_trips.begin(), round_trips.end());
+    std::cout << boost::format("Round trip time (us): p50 %.1f, p99 %.1f, p99.9 %.1f, max %.1f")
+        % (percentile(round_trips, 0.5)*1e6) % (percentile(round_trips, 0.99)*1e6)
+        % (percentile(round_trips, 0.999)*1e6) % (percentile(round_trips, 1.0)*1e6) << std::endl;
     return EXIT_SUCCESS;
 }
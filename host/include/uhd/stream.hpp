@@ -25,6 +25,7 @@
 #include <uhd/types/ref_vector.hpp>
 #include <boost/utility.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
 #include <vector>
 #include <string>
 
@@ -101,6 +102,10 @@ struct UHD_API stream_args_t{
      * Users should specify this option to request smaller than default
      * packets, probably with the intention of reducing packet latency.
      *
+     * - fc_adapt: (RX, X300 and sim) set to 0 to keep the flow control
+     * window and the update rate fixed at their configured values.
+     * By default, they are tuned while streaming, see rx_streamer::get_stats().
+     *
      * The following are not implemented, but are listed for conceptual purposes:
      * - function: magnitude or phase/magnitude
      * - units: numeric units like counts or dBm
@@ -116,6 +121,93 @@ struct UHD_API stream_args_t{
     std::vector<size_t> channels;
 };
 
+/*!
+ * A snapshot of the statistics of one channel of a streamer.
+ * The counters start at zero when the streamer is made.
+ * Streamers that do not keep statistics leave every field at zero.
+ */
+struct UHD_API stream_stats_t{
+
+    //! The number of bins in the latency histograms
+    static const size_t NUM_LATENCY_BINS = 32;
+
+    //! The number of bins in the TX buffer occupancy histogram
+    static const size_t NUM_OCCUPANCY_BINS = 16;
+
+    //! Make zeroed statistics
+    stream_stats_t(void);
+
+    //! The number of data packets received or sent
+    boost::uint64_t num_packets;
+
+    //! The number of payload bytes received or sent
+    boost::uint64_t num_bytes;
+
+    //! RX: the packets lost before the host, TX: the device saw a sequence error
+    boost::uint64_t num_seq_errors;
+
+    //! RX: the number of packets with a timestamp out of order
+    boost::uint64_t num_time_errors;
+
+    //! RX: the number of overflows reported by the device
+    boost::uint64_t num_overflows;
+
+    //! TX: the number of underflows reported by the device
+    boost::uint64_t num_underflows;
+
+    //! RX: the late stream commands, TX: the packets that arrived late
+    boost::uint64_t num_late_packets;
+
+    //! TX: the number of times a send waited for flow control credit
+    boost::uint64_t num_fc_stalls;
+
+    //! The time spent converting samples in seconds
+    double convert_time;
+
+    /*!
+     * A histogram of the duration of the recv() or send() calls.
+     * Bin N counts the calls that took from 2^N to 2^(N+1) nanoseconds.
+     * The last bin also counts all longer calls.
+     * The histogram covers the streamer and is the same for every channel.
+     */
+    boost::uint64_t call_latency[NUM_LATENCY_BINS];
+
+    //! The flow control window in packets advertised to the device
+    size_t fc_window;
+
+    //! The number of packets between two flow control updates
+    size_t fc_update_interval;
+
+    //! The estimated fill of the window by unread packets, from 0.0 to 1.0
+    double fc_window_fill;
+
+    //! The number of changes the flow control tuner made
+    size_t fc_adjustments;
+
+    /*!
+     * TX: a histogram of the time from the commit of a packet to the
+     * flow control acknowledgement of the device that consumed it,
+     * in the bins of call_latency. The device acknowledges a group of
+     * packets at a time, so a packet may be counted late by up to
+     * one flow control update interval.
+     */
+    boost::uint64_t ack_latency[NUM_LATENCY_BINS];
+
+    /*!
+     * TX: as ack_latency, from the start of the send() call of the packet.
+     * The lead time of a timed burst must cover this latency.
+     */
+    boost::uint64_t send_ack_latency[NUM_LATENCY_BINS];
+
+    /*!
+     * TX: a histogram of the device buffer occupancy when a packet is sent.
+     * Bin N counts the packets sent while the packets in flight filled
+     * N/NUM_OCCUPANCY_BINS to (N+1)/NUM_OCCUPANCY_BINS of the flow control
+     * window; the last bin also counts a full window.
+     */
+    boost::uint64_t buffer_occupancy[NUM_OCCUPANCY_BINS];
+};
+
 /*!
  * The RX streamer is the host interface to receiving samples.
  * It represents the layer between the samples on the host
@@ -186,6 +278,15 @@ public:
      * \param stream_cmd the stream command to issue
      */
     virtual void issue_stream_cmd(const stream_cmd_t &stream_cmd) = 0;
+
+    /*!
+     * Get the statistics of one channel of this streamer.
+     * This call is thread safe and may be made while another
+     * thread is receiving.
+     * \param chan the channel index within this streamer
+     * \return a snapshot of the statistics
+     */
+    virtual stream_stats_t get_stats(const size_t chan = 0) const;
 };
 
 /*!
@@ -245,6 +346,15 @@ public:
     virtual bool recv_async_msg(
         async_metadata_t &async_metadata, double timeout = 0.1
     ) = 0;
+
+    /*!
+     * Get the statistics of one channel of this streamer.
+     * This call is thread safe and may be made while another
+     * thread is sending.
+     * \param chan the channel index within this streamer
+     * \return a snapshot of the statistics
+     */
+    virtual stream_stats_t get_stats(const size_t chan = 0) const;
 };
 
 } //namespace uhd
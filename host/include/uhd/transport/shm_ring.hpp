@@ -0,0 +1,58 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_UHD_TRANSPORT_SHM_RING_HPP
+#define INCLUDED_UHD_TRANSPORT_SHM_RING_HPP
+
+#include <uhd/config.hpp>
+#include <uhd/stream.hpp>
+#include <string>
+
+namespace uhd{ namespace transport{
+
+/*!
+ * Shared memory rings for receive samples.
+ *
+ * A process that owns a device publishes an RX stream when it makes
+ * the streamer with the stream arg shm_name=<name>. Every packet of
+ * channel N is copied into the ring uhd.<name>.N in shared memory.
+ * The publisher never waits for the consumers of a ring.
+ *
+ * Other processes open the rings as read-only RX streamers with their
+ * own CPU format. A consumer that falls behind the publisher by more
+ * than the ring gets an overflow and continues with the newest packet.
+ */
+struct UHD_API shm_ring{
+
+    /*!
+     * Make a read-only RX streamer for a published stream.
+     * The streamer ignores stream commands, the publisher controls
+     * the device. A recv() times out when the publisher is gone.
+     * \param name the shm_name of the publisher
+     * \param args the stream args, the channels select the rings
+     * \return a new receive streamer
+     * \throws uhd::io_error if a ring is not published
+     */
+    static rx_streamer::sptr make_rx_stream(
+        const std::string &name,
+        const stream_args_t &args = stream_args_t("fc32")
+    );
+};
+
+}} //namespace
+
+#endif /* INCLUDED_UHD_TRANSPORT_SHM_RING_HPP */
@@ -29,6 +29,12 @@ namespace uhd{ namespace transport{
  * The zero copy TCP transport.
  * This transport provides the uhd zero copy interface
  * on top of a standard tcp socket from boost asio.
+ *
+ * Frames on the byte stream are CHDR packets back to back,
+ * each packet is delimited by the length field of its header.
+ * Committed send frames are queued and written by a sender thread,
+ * consecutive frames go out together in one gathered write.
+ * Received bytes are read in large chunks and sliced into frames.
  */
 struct UHD_API tcp_zero_copy : public virtual zero_copy_if
 {
@@ -50,6 +56,23 @@ struct UHD_API tcp_zero_copy : public virtual zero_copy_if
         const std::string &port,
         const device_addr_t &hints = device_addr_t()
     );
+
+    /*!
+     * Make a new zero copy TCP transport with default parameters:
+     * The hints override the default parameters, see the
+     * transport application notes for the supported keys.
+     *
+     * \param addr a string representing the destination address
+     * \param port a string representing the destination port
+     * \param default_buff_args default frame, socket buffer and delay options
+     * \param hints optional parameters to pass to the underlying transport
+     */
+    static zero_copy_if::sptr make(
+        const std::string &addr,
+        const std::string &port,
+        const zero_copy_xport_params &default_buff_args,
+        const device_addr_t &hints = device_addr_t()
+    );
 };
 
 }} //namespace
@@ -29,14 +29,7 @@ namespace uhd{ namespace transport{
     //! Simple managed buffer with release interface
     class UHD_API managed_buffer{
     public:
-        managed_buffer(void):_ref_count(0),_buffer(NULL),_length(0)
-		{
-#ifdef UHD_TXRX_DEBUG_PRINTS
-            _mb_num = s_buffer_count;
-            // From Boost website: atomic_count seems only to have precrement operator.
-            ++s_buffer_count;
-#endif
-        }
+        managed_buffer(void):_ref_count(0),_buffer(NULL),_length(0){}
 
         virtual ~managed_buffer(void) {}
 
@@ -87,23 +80,9 @@ namespace uhd{ namespace transport{
         	return (int) _ref_count;
         }
 
-#ifdef UHD_TXRX_DEBUG_PRINTS
-        int num() const{
-        	return _mb_num;
-        }
-#endif
-
     protected:
         void *_buffer;
         size_t _length;
-#ifdef UHD_TXRX_DEBUG_PRINTS
-        int _mb_num;
-#endif
-
-    private:
-#ifdef UHD_TXRX_DEBUG_PRINTS
-        static boost::detail::atomic_count s_buffer_count;
-#endif
     };
 
     UHD_INLINE void intrusive_ptr_add_ref(managed_buffer *p){
@@ -142,6 +121,21 @@ namespace uhd{ namespace transport{
         size_t send_frame_size;
         size_t num_recv_frames;
         size_t num_send_frames;
+        //! socket receive buffer size in bytes (0 for the system default)
+        size_t recv_buff_size;
+        //! socket send buffer size in bytes (0 for the system default)
+        size_t send_buff_size;
+        //! disable Nagle's algorithm on stream sockets
+        bool no_delay;
+
+        zero_copy_xport_params(void):
+            recv_frame_size(0), send_frame_size(0),
+            num_recv_frames(0), num_send_frames(0),
+            recv_buff_size(0), send_buff_size(0),
+            no_delay(true)
+        {
+            /* NOP */
+        }
     };
 
     /*!
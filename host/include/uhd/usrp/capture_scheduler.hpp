@@ -0,0 +1,142 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_UHD_USRP_CAPTURE_SCHEDULER_HPP
+#define INCLUDED_UHD_USRP_CAPTURE_SCHEDULER_HPP
+
+#include <uhd/config.hpp>
+#include <uhd/stream.hpp>
+#include <uhd/types/metadata.hpp>
+#include <uhd/types/time_spec.hpp>
+#include <uhd/usrp/multi_usrp.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+#include <boost/cstdint.hpp>
+#include <vector>
+
+namespace uhd{ namespace usrp{
+
+/*!
+ * The capture scheduler receives many short timed captures.
+ *
+ * A capture is a number of samples at a time on a set of channels.
+ * The scheduler issues the stream commands of the captures ahead of
+ * their time, as many as the command queues of the device take, and
+ * receives the samples of every channel into preallocated buffers.
+ * Completed captures, and captures that failed, are delivered through
+ * a completion queue; the application returns their buffers with release().
+ *
+ * The scheduler owns one single-channel RX streamer per channel,
+ * so the application must not stream on these channels meanwhile.
+ */
+class UHD_API capture_scheduler : boost::noncopyable{
+public:
+    typedef boost::shared_ptr<capture_scheduler> sptr;
+
+    //! A capture to schedule
+    struct request_t{
+        //! The device time of the first sample
+        time_spec_t time;
+
+        //! The number of samples per channel, up to the max_nsamps of the scheduler
+        size_t nsamps;
+
+        //! Bit N selects channel N of the stream args of the scheduler
+        boost::uint32_t channel_mask;
+
+        request_t(const time_spec_t &time = time_spec_t(0.0), const size_t nsamps = 0, const boost::uint32_t channel_mask = 1):
+            time(time), nsamps(nsamps), channel_mask(channel_mask){}
+    };
+
+    //! A completed capture
+    struct capture_t{
+        //! The request, and its number in the order of scheduling
+        request_t request;
+        size_t id;
+
+        /*!
+         * The samples of every channel of the stream args,
+         * NULL for the channels that are not in the channel mask.
+         * The buffers are valid until the capture is released.
+         */
+        std::vector<void *> buffs;
+
+        //! The number of samples received, the least of all channels
+        size_t nsamps;
+
+        //! The time of the first sample received
+        time_spec_t time;
+
+        //! The first error of any channel, ERROR_CODE_NONE on success
+        rx_metadata_t::error_code_t error_code;
+
+        //! The buffer set of the capture, for release()
+        size_t buffer_index;
+    };
+
+    virtual ~capture_scheduler(void);
+
+    /*!
+     * Make a new capture scheduler.
+     * The stream args may hold these args:
+     * - capture_lead_time: issue the stream commands this many seconds
+     *   before the capture (default 0.1)
+     * - capture_queue_depth: the most captures in flight per channel
+     *   (default 8)
+     *
+     * \param usrp the device
+     * \param args the stream args of the channels to capture
+     * \param max_nsamps the largest capture in samples per channel
+     * \param num_buffers the number of captures that can be in flight or
+     *        held by the application
+     * \return a new capture scheduler
+     */
+    static sptr make(
+        multi_usrp::sptr usrp,
+        const stream_args_t &args,
+        const size_t max_nsamps,
+        const size_t num_buffers
+    );
+
+    /*!
+     * Schedule captures.
+     * Every capture takes a buffer set until it is released;
+     * the requests that find no free buffer set are not scheduled.
+     * \param requests the captures, in any order
+     * \return the number of requests scheduled, from the front
+     * \throws uhd::value_error for an invalid request
+     */
+    virtual size_t schedule(const std::vector<request_t> &requests) = 0;
+
+    /*!
+     * Get the next completed capture.
+     * \param capture the completed capture
+     * \param timeout the timeout in seconds
+     * \return false on timeout
+     */
+    virtual bool get_completed(capture_t &capture, const double timeout = 0.1) = 0;
+
+    //! Return the buffers of a completed capture
+    virtual void release(const capture_t &capture) = 0;
+
+    //! Get the number of captures scheduled and not completed yet
+    virtual size_t get_num_in_flight(void) = 0;
+};
+
+}} //namespace uhd::usrp
+
+#endif /* INCLUDED_UHD_USRP_CAPTURE_SCHEDULER_HPP */
@@ -473,6 +473,16 @@ public:
      */
     virtual freq_range_t get_fe_rx_freq_range(size_t chan = 0) = 0;
 
+    /*!
+     * Precompute the RX frontend synthesizer settings for a list of frequencies.
+     * A later set_rx_freq() to one of these frequencies only replays the
+     * cached register writes, which makes frequency hopping faster.
+     * Frontends without a synthesizer cache ignore this call.
+     * \param freqs the frontend (LO) frequencies in Hz
+     * \param chan the channel index 0 to N-1
+     */
+    virtual void pretune_rx_freqs(const std::vector<double> &freqs, size_t chan = 0) = 0;
+
     /*!
      * Set the RX gain value for the specified gain element.
      * For an empty name, distribute across all gain elements.
@@ -730,6 +740,16 @@ public:
      */
     virtual freq_range_t get_fe_tx_freq_range(size_t chan = 0) = 0;
 
+    /*!
+     * Precompute the TX frontend synthesizer settings for a list of frequencies.
+     * A later set_tx_freq() to one of these frequencies only replays the
+     * cached register writes, which makes frequency hopping faster.
+     * Frontends without a synthesizer cache ignore this call.
+     * \param freqs the frontend (LO) frequencies in Hz
+     * \param chan the channel index 0 to N-1
+     */
+    virtual void pretune_tx_freqs(const std::vector<double> &freqs, size_t chan = 0) = 0;
+
     /*!
      * Set the TX gain value for the specified gain element.
      * For an empty name, distribute across all gain elements.
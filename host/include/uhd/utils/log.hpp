@@ -29,7 +29,10 @@
  *
  * The logger enables UHD library code to easily log events into a file.
  * Log entries are time-stamped and stored with file, line, and function.
- * Each call to the UHD_LOG macros is synchronous and thread-safe.
+ * Each call to the UHD_LOG macros is thread-safe and does not block:
+ * the entry is queued and a background thread writes it into the file.
+ * The entries still queued are written when the process exits.
+ * An entry below the log level is not even formatted.
  *
  * The log file can be found in the path <temp-directory>/uhd.log,
  * where <temp-directory> is the user or system's temporary directory.
@@ -77,19 +80,21 @@ namespace uhd{ namespace _log{
         never       = 6,
     };
 
+    class record_buffer;
+
     //! Internal logging object (called by UHD_LOG macros)
     class UHD_API log{
     public:
         log(
             const verbosity_t verbosity,
-            const std::string &file,
+            const char *file,
             const unsigned int line,
-            const std::string &function
+            const char *function
         );
         ~log(void);
         std::ostream &operator()(void);
     private:
-        UHD_PIMPL_DECL(impl) _impl;
+        record_buffer *_buff;
     };
 
 }} //namespace uhd::_log
@@ -43,6 +43,10 @@
 #define UHD_HEX(var) \
     UHD_MSG(status) << #var << " = 0x" << std::hex << std::setfill('0') << std::setw(8) << var << std::dec << std::endl;
 
+namespace uhd{ namespace _log{
+    class record_buffer;
+}} //namespace uhd::_log
+
 namespace uhd{ namespace msg{
 
     //! Possible message types
@@ -60,6 +64,9 @@ namespace uhd{ namespace msg{
      * Register the handler for uhd system messages.
      * Only one handler can be registered at once.
      * This replaces the default std::cout/cerr handler.
+     * Status, warning, and error messages are handled by the thread
+     * that makes them. Fastpath messages are queued by the streaming
+     * thread and handled by a background thread.
      * \param handler a new handler callback function
      */
     UHD_API void register_handler(const handler_t &handler);
@@ -71,7 +78,7 @@ namespace uhd{ namespace msg{
         ~_msg(void);
         std::ostream &operator()(void);
     private:
-        UHD_PIMPL_DECL(impl) _impl;
+        uhd::_log::record_buffer *_buff;
     };
 
 }} //namespace uhd::msg
@@ -25,6 +25,7 @@
 #include <boost/utility.hpp>
 #include <boost/optional/optional.hpp>
 #include <boost/cstdint.hpp>
+#include <string>
 #include <vector>
 
 namespace uhd{
@@ -68,6 +69,15 @@ namespace uhd{
              * \return a new task object
              */
             static sptr make(const task_fcn_type &task_fcn);
+
+            /*!
+             * Create a new task object with function callback,
+             * running on a thread pinned to a set of CPUs.
+             * \param task_fcn the task callback function
+             * \param cpus the CPU set, see uhd::set_thread_affinity
+             * \return a new task object
+             */
+            static sptr make(const task_fcn_type &task_fcn, const std::string &cpus);
     };
 } //namespace uhd
 
@@ -22,6 +22,7 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/function.hpp>
 #include <boost/utility.hpp>
+#include <string>
 
 namespace uhd{
 
@@ -45,6 +46,17 @@ namespace uhd{
          */
         static sptr make(const task_fcn_type &task_fcn);
 
+        /*!
+         * Create a new task object with function callback,
+         * running on a thread pinned to a set of CPUs.
+         * Failing to set the affinity prints a warning.
+         *
+         * \param task_fcn the task callback function
+         * \param cpus the CPU set, see uhd::set_thread_affinity
+         * \return a new task object
+         */
+        static sptr make(const task_fcn_type &task_fcn, const std::string &cpus);
+
     };
 } //namespace uhd
 
@@ -19,6 +19,8 @@
 #define INCLUDED_UHD_UTILS_THREAD_PRIORITY_HPP
 
 #include <uhd/config.hpp>
+#include <string>
+#include <vector>
 
 namespace uhd{
 
@@ -53,6 +55,50 @@ namespace uhd{
         bool realtime = true
     );
 
+    /*!
+     * Set the scheduling priority and the CPU affinity on the current thread.
+     * Same as set_thread_priority_safe, and also pins the thread
+     * to the CPUs given by a CPU set (see set_thread_affinity).
+     * \param priority a value between -1 and 1
+     * \param realtime true to use realtime mode
+     * \param cpus the CPU set, empty to leave the affinity unchanged
+     * \return true on success, false on failure
+     */
+    UHD_API bool set_thread_priority_safe(
+        float priority,
+        bool realtime,
+        const std::string &cpus
+    );
+
+    /*!
+     * Pin the current thread to a set of CPUs.
+     *
+     * The CPU set is a list of CPU numbers (ex: 3), CPU ranges (ex: 2-5),
+     * and NUMA nodes (ex: node1, all CPUs of the node) separated by colons.
+     * Example: "2-3:6" or "node0".
+     *
+     * \param cpus the CPU set
+     * \throw exception on a bad CPU set or set affinity failure
+     */
+    UHD_API void set_thread_affinity(const std::string &cpus);
+
+    /*!
+     * Pin the current thread to a set of CPUs.
+     * Same as set_thread_affinity but does not throw on failure.
+     * \return true on success, false on failure
+     */
+    UHD_API bool set_thread_affinity_safe(const std::string &cpus);
+
+    /*!
+     * Parse a CPU set into a list of CPU numbers.
+     * See set_thread_affinity for the syntax.
+     * \param cpus the CPU set
+     * \return the CPU numbers in the order given
+     * \throw uhd::value_error on a bad token, a range that ends
+     * before it starts, a CPU beyond the CPU set size, or an empty set
+     */
+    UHD_API std::vector<size_t> parse_cpu_set(const std::string &cpus);
+
 } //namespace uhd
 
 #endif /* INCLUDED_UHD_UTILS_THREAD_PRIORITY_HPP */
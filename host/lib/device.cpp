@@ -22,17 +22,35 @@
 #include <uhd/utils/msg.hpp>
 #include <uhd/utils/static.hpp>
 #include <uhd/utils/algorithm.hpp>
+#include <uhd/utils/paths.hpp>
+#include <uhd/utils/platform.hpp>
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
 #include <boost/weak_ptr.hpp>
 #include <boost/functional/hash.hpp>
+#include <boost/thread/thread_time.hpp>
 #include <boost/tuple/tuple.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/bind.hpp>
+#include <fstream>
+#include <map>
+#include <cstdlib> //getenv
+#include <cstdio> //rename
 
 using namespace uhd;
+namespace fs = boost::filesystem;
 
 static boost::mutex _device_mutex;
 
+//! Overall discovery deadline in seconds, override with hint key find_timeout
+static const double DEFAULT_FIND_TIMEOUT = 10.0;
+
 /***********************************************************************
  * Helper Functions
  **********************************************************************/
@@ -48,6 +66,7 @@ static size_t hash_device_addr(
     //combine the hashes of sorted keys/value pairs
     size_t hash = 0;
     BOOST_FOREACH(const std::string &key, uhd::sorted(dev_addr.keys())){
+        if (key == "find_timeout") continue; //discovery option, not an identity
         boost::hash_combine(hash, key);
         boost::hash_combine(hash, dev_addr[key]);
     }
@@ -70,6 +89,281 @@ void device::register_device(
     get_dev_fcn_regs().push_back(dev_fcn_reg_t(find, make));
 }
 
+/***********************************************************************
+ * Parallel discovery
+ **********************************************************************/
+//! Discovered addresses, indexed like the device function registry
+typedef std::vector<device_addrs_t> find_results_t;
+
+//! Discovery errors, indexed like the device function registry
+typedef std::vector<boost::shared_ptr<uhd::exception> > find_errors_t;
+
+//! One call of a find function: the registry index and the hint
+typedef std::pair<size_t, device_addr_t> find_job_t;
+
+/*!
+ * State shared between the caller and the discovery threads.
+ * A thread that misses the deadline keeps its own reference,
+ * so it may finish late without touching freed memory.
+ */
+struct find_state_t{
+    find_state_t(size_t num_fcns): results(num_fcns), errors(num_fcns), num_done(0){}
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    find_results_t results;
+    find_errors_t errors;
+    size_t num_done;
+};
+
+static void find_task(
+    boost::shared_ptr<find_state_t> state,
+    const device::find_t &find,
+    const device_addr_t &hint,
+    const size_t index
+){
+    device_addrs_t discovered_addrs;
+    boost::shared_ptr<uhd::exception> error;
+    try{
+        discovered_addrs = find(hint);
+    }
+    catch(const uhd::exception &e){
+        error.reset(e.dynamic_clone());
+    }
+    catch(const std::exception &e){
+        error.reset(new uhd::runtime_error(e.what()));
+    }
+    boost::mutex::scoped_lock lock(state->mutex);
+    state->results[index].insert(state->results[index].end(), discovered_addrs.begin(), discovered_addrs.end());
+    if (error and not state->errors[index]) state->errors[index] = error;
+    state->num_done++;
+    state->cond.notify_one();
+}
+
+/*!
+ * The threads that missed a deadline, per registry index, under the device mutex.
+ * They are not interrupted, which could abort an image load partway.
+ * A backend does not run again until its late threads are joined,
+ * so two probes never load firmware into the same device at once.
+ */
+typedef std::vector<boost::shared_ptr<boost::thread> > find_threads_t;
+static std::map<size_t, find_threads_t> late_find_threads;
+
+static void join_late_find_threads(const size_t index){
+    if (late_find_threads[index].empty()) return;
+    UHD_LOG << "Waiting for a late discovery of backend " << index << std::endl;
+    BOOST_FOREACH(boost::shared_ptr<boost::thread> thread, late_find_threads[index]){
+        thread->join();
+    }
+    late_find_threads[index].clear();
+}
+
+/*!
+ * Run find functions, each in its own thread.
+ * The caller waits for all of them or until the overall deadline,
+ * whichever comes first. Late discovery results are dropped,
+ * the late threads run to completion and are joined before their backend runs again.
+ * \param jobs the registry index and hint of each call
+ * \param timeout the overall deadline in seconds
+ * \param errors the first error of each backend
+ * \return the discovered addresses for each registry entry
+ */
+static find_results_t find_parallel(
+    const std::vector<find_job_t> &jobs, const double timeout, find_errors_t &errors
+){
+    const std::vector<dev_fcn_reg_t> &regs = get_dev_fcn_regs();
+    boost::shared_ptr<find_state_t> state = boost::make_shared<find_state_t>(regs.size());
+
+    std::vector<boost::shared_ptr<boost::thread> > threads;
+    BOOST_FOREACH(const find_job_t &job, jobs){
+        join_late_find_threads(job.first);
+        threads.push_back(boost::make_shared<boost::thread>(boost::bind(
+            &find_task, state, regs[job.first].get<0>(), job.second, job.first
+        )));
+    }
+
+    const boost::system_time exit_time = boost::get_system_time() +
+        boost::posix_time::microseconds(long(timeout*1e6));
+
+    boost::mutex::scoped_lock lock(state->mutex);
+    while (state->num_done < jobs.size()){
+        if (not state->cond.timed_wait(lock, exit_time)){
+            UHD_MSG(warning) << boost::format(
+                "Device discovery timed out after %f seconds, %u of %u backends responded"
+            ) % timeout % state->num_done % jobs.size() << std::endl;
+            break;
+        }
+    }
+    const find_results_t results = state->results;
+    errors = state->errors;
+    lock.unlock();
+
+    for (size_t i = 0; i < threads.size(); i++){
+        if (threads[i]->timed_join(boost::posix_time::seconds(0))) continue;
+        late_find_threads[jobs[i].first].push_back(threads[i]);
+    }
+    return results;
+}
+
+//! Search every backend with the hint
+static find_results_t find_all(const device_addr_t &hint, find_errors_t &errors){
+    std::vector<find_job_t> jobs;
+    for (size_t i = 0; i < get_dev_fcn_regs().size(); i++){
+        jobs.push_back(find_job_t(i, hint));
+    }
+    return find_parallel(jobs, hint.cast<double>("find_timeout", DEFAULT_FIND_TIMEOUT), errors);
+}
+
+/***********************************************************************
+ * Discovery cache
+ **********************************************************************/
+/*!
+ * The discovery cache is enabled by setting UHD_DISCOVERY_CACHE
+ * to the path of a cache file. Each line is the hint, the index of
+ * the backend that found the device and the device address,
+ * separated by tabs.
+ */
+static std::string get_discovery_cache_path(void){
+    const char *cache_path = std::getenv("UHD_DISCOVERY_CACHE");
+    return (cache_path == NULL)? "" : cache_path;
+}
+
+/*!
+ * Get the cache key of a hint: the sorted key/value pairs,
+ * which is the same for every build and process.
+ */
+static std::string get_discovery_cache_key(const device_addr_t &hint){
+    std::string key;
+    BOOST_FOREACH(const std::string &name, uhd::sorted(hint.keys())){
+        if (name == "find_timeout") continue; //discovery option, not an identity
+        if (not key.empty()) key += ",";
+        key += name + "=" + hint[name];
+    }
+    return key;
+}
+
+struct cache_entry_t{
+    std::string key;
+    size_t index;
+    std::string addr;
+};
+
+typedef std::vector<cache_entry_t> cache_entries_t;
+
+static cache_entries_t load_discovery_cache(const std::string &path){
+    cache_entries_t entries;
+    std::ifstream cache_file(path.c_str());
+    std::string line;
+    while (std::getline(cache_file, line)){
+        const size_t sep0 = line.find('\t');
+        const size_t sep1 = (sep0 == std::string::npos)? sep0 : line.find('\t', sep0+1);
+        if (sep1 == std::string::npos) continue;
+        try{
+            cache_entry_t entry;
+            entry.key = line.substr(0, sep0);
+            entry.index = boost::lexical_cast<size_t>(line.substr(sep0+1, sep1-sep0-1));
+            entry.addr = line.substr(sep1+1);
+            if (entry.index < get_dev_fcn_regs().size()) entries.push_back(entry);
+        }
+        catch(const boost::bad_lexical_cast &){
+            continue; //skip corrupt lines
+        }
+    }
+    return entries;
+}
+
+static void store_discovery_cache(
+    const std::string &path, const std::string &key, const find_results_t &results
+){
+    //keep the entries for other hints and replace the entries for this one
+    cache_entries_t entries;
+    BOOST_FOREACH(const cache_entry_t &entry, load_discovery_cache(path)){
+        if (entry.key != key) entries.push_back(entry);
+    }
+    for (size_t i = 0; i < results.size(); i++){
+        BOOST_FOREACH(const device_addr_t &addr, results[i]){
+            cache_entry_t entry;
+            entry.key = key;
+            entry.index = i;
+            entry.addr = addr.to_string();
+            entries.push_back(entry);
+        }
+    }
+
+    //write to a temporary file and rename so readers never see a partial file,
+    //the file name is unique to the host and process so writers never share it
+    const std::string tmp_path = str(boost::format("%s.%08x.%d.tmp")
+        % path % uhd::get_host_id() % uhd::get_process_id()
+    );
+    try{
+        {
+            std::ofstream cache_file(tmp_path.c_str(), std::ofstream::trunc);
+            BOOST_FOREACH(const cache_entry_t &entry, entries){
+                cache_file << entry.key << "\t" << entry.index << "\t" << entry.addr << std::endl;
+            }
+            if (not cache_file) throw uhd::os_error("cannot write " + tmp_path);
+        }
+        fs::rename(tmp_path, path);
+    }
+    catch(const std::exception &e){
+        UHD_MSG(warning) << "Cannot update the discovery cache: " << e.what() << std::endl;
+        std::remove(tmp_path.c_str());
+    }
+}
+
+/*!
+ * Check that a discovered address is the cached device:
+ * the serial and the address keys must match where the cache has them.
+ */
+static bool is_cached_device(const device_addr_t &cached, const device_addr_t &found){
+    static const char *id_keys[] = {"serial", "addr", "resource"};
+    BOOST_FOREACH(const char *id_key, id_keys){
+        if (not cached.has_key(id_key)) continue;
+        if (not found.has_key(id_key) or found[id_key] != cached[id_key]) return false;
+    }
+    return true;
+}
+
+/*!
+ * Discover devices, using the discovery cache when enabled.
+ * A cached entry is re-validated by calling only the backend that
+ * found it, with the cached device address as the hint, which is a
+ * unicast probe for network devices and a serial match for USB devices.
+ * When any cached device fails to answer, a full discovery replaces
+ * the cache entry.
+ */
+static find_results_t find_with_cache(const device_addr_t &hint, find_errors_t &errors){
+    const std::string cache_path = get_discovery_cache_path();
+    if (cache_path.empty()) return find_all(hint, errors);
+
+    const std::string key = get_discovery_cache_key(hint);
+    std::vector<find_job_t> jobs;
+    BOOST_FOREACH(const cache_entry_t &entry, load_discovery_cache(cache_path)){
+        if (entry.key == key) jobs.push_back(find_job_t(entry.index, device_addr_t(entry.addr)));
+    }
+    if (not jobs.empty()){
+        const find_results_t results = find_parallel(
+            jobs, hint.cast<double>("find_timeout", DEFAULT_FIND_TIMEOUT), errors
+        );
+        //every cached device must answer its own backend, with its own identity
+        bool cache_hit = true;
+        BOOST_FOREACH(const find_job_t &job, jobs){
+            bool found = false;
+            BOOST_FOREACH(const device_addr_t &addr, results[job.first]){
+                if (is_cached_device(job.second, addr)) found = true;
+            }
+            if (not found) cache_hit = false;
+        }
+        if (cache_hit){
+            UHD_LOG << "Discovery cache hit for " << key << std::endl;
+            return results;
+        }
+    }
+
+    const find_results_t results = find_all(hint, errors);
+    store_discovery_cache(cache_path, key, results);
+    return results;
+}
+
 /***********************************************************************
  * Discover
  **********************************************************************/
@@ -78,18 +372,16 @@ device_addrs_t device::find(const device_addr_t &hint){
 
     device_addrs_t device_addrs;
 
-    BOOST_FOREACH(const dev_fcn_reg_t &fcn, get_dev_fcn_regs()){
-        try{
-            device_addrs_t discovered_addrs = fcn.get<0>()(hint);
-            device_addrs.insert(
-                device_addrs.begin(),
-                discovered_addrs.begin(),
-                discovered_addrs.end()
-            );
-        }
-        catch(const std::exception &e){
-            UHD_MSG(error) << "Device discovery error: " << e.what() << std::endl;
-        }
+    find_errors_t errors;
+    BOOST_FOREACH(const device_addrs_t &discovered_addrs, find_with_cache(hint, errors)){
+        device_addrs.insert(
+            device_addrs.begin(),
+            discovered_addrs.begin(),
+            discovered_addrs.end()
+        );
+    }
+    BOOST_FOREACH(const boost::shared_ptr<uhd::exception> &error, errors){
+        if (error) UHD_MSG(error) << "Device discovery error: " << error->what() << std::endl;
     }
 
     return device_addrs;
@@ -101,13 +393,21 @@ device_addrs_t device::find(const device_addr_t &hint){
 device::sptr device::make(const device_addr_t &hint, size_t which){
     boost::mutex::scoped_lock lock(_device_mutex);
 
-    typedef boost::tuple<device_addr_t, make_t> dev_addr_make_t;
+    typedef boost::tuple<device_addr_t, make_t, size_t> dev_addr_make_t;
     std::vector<dev_addr_make_t> dev_addr_makers;
 
-    BOOST_FOREACH(const dev_fcn_reg_t &fcn, get_dev_fcn_regs()){
-        BOOST_FOREACH(device_addr_t dev_addr, fcn.get<0>()(hint)){
+    find_errors_t errors;
+    const find_results_t results = find_with_cache(hint, errors);
+
+    //a discovery error is the error of make, like a find function called here
+    BOOST_FOREACH(const boost::shared_ptr<uhd::exception> &error, errors){
+        if (error) error->dynamic_throw();
+    }
+
+    for (size_t i = 0; i < results.size(); i++){
+        BOOST_FOREACH(device_addr_t dev_addr, results[i]){
             //append the discovered address and its factory function
-            dev_addr_makers.push_back(dev_addr_make_t(dev_addr, fcn.get<1>()));
+            dev_addr_makers.push_back(dev_addr_make_t(dev_addr, get_dev_fcn_regs()[i].get<1>(), i));
         }
     }
 
@@ -126,8 +426,8 @@ device::sptr device::make(const device_addr_t &hint, size_t which){
     }
 
     //create a unique hash for the device address
-    device_addr_t dev_addr; make_t maker;
-    boost::tie(dev_addr, maker) = dev_addr_makers.at(which);
+    device_addr_t dev_addr; make_t maker; size_t fcn_index;
+    boost::tie(dev_addr, maker, fcn_index) = dev_addr_makers.at(which);
     size_t dev_hash = hash_device_addr(dev_addr);
     UHD_LOG << boost::format("Device hash: %u") % dev_hash << std::endl;
 
@@ -148,6 +448,8 @@ device::sptr device::make(const device_addr_t &hint, size_t which){
     }
     //create and register a new device
     catch(const uhd::assertion_error &){
+        //the backend may still probe from a late discovery
+        join_late_find_threads(fcn_index);
         device::sptr dev = maker(dev_addr);
         hash_to_device[dev_hash] = dev;
         return dev;
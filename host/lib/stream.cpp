@@ -16,9 +16,44 @@
 //
 
 #include <uhd/stream.hpp>
+#include <algorithm>
 
 using namespace uhd;
 
+const size_t stream_stats_t::NUM_LATENCY_BINS;
+const size_t stream_stats_t::NUM_OCCUPANCY_BINS;
+
+stream_stats_t::stream_stats_t(void):
+    num_packets(0),
+    num_bytes(0),
+    num_seq_errors(0),
+    num_time_errors(0),
+    num_overflows(0),
+    num_underflows(0),
+    num_late_packets(0),
+    num_fc_stalls(0),
+    convert_time(0.0),
+    fc_window(0),
+    fc_update_interval(0),
+    fc_window_fill(0.0),
+    fc_adjustments(0)
+{
+    std::fill(call_latency, call_latency+NUM_LATENCY_BINS, 0);
+    std::fill(ack_latency, ack_latency+NUM_LATENCY_BINS, 0);
+    std::fill(send_ack_latency, send_ack_latency+NUM_LATENCY_BINS, 0);
+    std::fill(buffer_occupancy, buffer_occupancy+NUM_OCCUPANCY_BINS, 0);
+}
+
+stream_stats_t rx_streamer::get_stats(const size_t) const
+{
+    return stream_stats_t();
+}
+
+stream_stats_t tx_streamer::get_stats(const size_t) const
+{
+    return stream_stats_t();
+}
+
 rx_streamer::~rx_streamer(void)
 {
     //empty
@@ -0,0 +1,301 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "async_reactor.hpp"
+#include <uhd/exception.hpp>
+#include <uhd/utils/msg.hpp>
+#include <uhd/utils/log.hpp>
+#include <uhd/utils/tasks.hpp>
+#include <uhd/utils/thread_priority.hpp>
+#include <uhd/utils/static.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <list>
+#include <map>
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#endif /*HAVE_SYS_EPOLL_H*/
+
+using namespace uhd;
+using namespace uhd::transport;
+
+static const double HANDLER_RETRY_DELAY = 0.001; //secs, when the transport is busy
+static const double THREAD_POLL_TIMEOUT = 0.1; //secs, for the transports that are not pollable
+static const size_t MAX_EVENTS = 16;
+
+/***********************************************************************
+ * The transport of a registration
+ **********************************************************************/
+struct reactor_source{
+    size_t id;
+    zero_copy_if::sptr xport;
+    async_reactor::handler_type handler;
+    int fd; //-1 when the source has a thread of its own
+    task::sptr thread;
+    bool priority_raised; //set by its thread on the first pass
+};
+
+/*!
+ * Raise the priority of a reactor thread on its first pass:
+ * the handlers carry TX flow control (USRP2), so the reactor threads
+ * get the priority of the loops they replace.
+ */
+static void raise_priority_once(bool &raised){
+    if (raised) return;
+    set_thread_priority_safe();
+    raised = true;
+}
+
+//! The loop of a source that has a thread of its own
+static void reactor_source_thread(reactor_source *source){
+    raise_priority_once(source->priority_raised);
+    if (not source->handler(THREAD_POLL_TIMEOUT)){
+        boost::this_thread::sleep(boost::posix_time::microseconds(long(HANDLER_RETRY_DELAY*1e6)));
+    }
+}
+
+/***********************************************************************
+ * Reactor implementation:
+ * The epoll thread dispatches with the mutex held,
+ * so holding the mutex excludes the handlers of the polled sources.
+ * A polled source is armed for one event (EPOLLONESHOT): a handler
+ * that finds the transport busy would otherwise see the descriptor
+ * readable again immediately, and the thread would spin until the
+ * other thread read the message.
+ **********************************************************************/
+class async_reactor_impl :
+    public async_reactor, public boost::enable_shared_from_this<async_reactor_impl>
+{
+public:
+    async_reactor_impl(const std::string &cpus):
+        _cpus(cpus), _next_id(0)
+    {
+        #ifdef HAVE_SYS_EPOLL_H
+        _epoll_fd = ::epoll_create(1);
+        if (_epoll_fd < 0) throw uhd::os_error(std::string("epoll_create: ") + std::strerror(errno));
+        if (::pipe(_wake_fds) != 0) throw uhd::os_error(std::string("pipe: ") + std::strerror(errno));
+        ::fcntl(_wake_fds[0], F_SETFL, O_NONBLOCK);
+        ::fcntl(_wake_fds[1], F_SETFL, O_NONBLOCK);
+        epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.u64 = WAKE_ID;
+        ::epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _wake_fds[0], &event);
+        _polling = true;
+        _epoll_priority_raised = false;
+        _epoll_task = task::make(boost::bind(&async_reactor_impl::epoll_task, this), _cpus);
+        #endif /*HAVE_SYS_EPOLL_H*/
+    }
+
+    ~async_reactor_impl(void){
+        #ifdef HAVE_SYS_EPOLL_H
+        //the registrations hold the reactor, so all sources are gone
+        _polling = false;
+        this->wake();
+        _epoll_task.reset();
+        ::close(_wake_fds[0]);
+        ::close(_wake_fds[1]);
+        ::close(_epoll_fd);
+        #endif /*HAVE_SYS_EPOLL_H*/
+    }
+
+    registration::sptr add(zero_copy_if::sptr xport, const handler_type &handler);
+
+    void remove(const size_t id){
+        boost::shared_ptr<reactor_source> source;
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            source_map_type::iterator it = _sources.find(id);
+            if (it == _sources.end()) return;
+            #ifdef HAVE_SYS_EPOLL_H
+            if (it->second->fd >= 0){
+                epoll_event event; //non-null for old kernels
+                ::epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, it->second->fd, &event);
+                _retries.remove(id);
+            }
+            #endif /*HAVE_SYS_EPOLL_H*/
+            source = it->second;
+            _sources.erase(it);
+        }
+        //join the thread without the mutex, its handler may be running
+        source->thread.reset();
+    }
+
+private:
+    typedef std::map<size_t, boost::shared_ptr<reactor_source> > source_map_type;
+
+    #ifdef HAVE_SYS_EPOLL_H
+    static const boost::uint64_t WAKE_ID = ~boost::uint64_t(0);
+
+    void wake(void){
+        const char byte = 0;
+        if (::write(_wake_fds[1], &byte, 1) < 0){/* full, a wake is pending */}
+    }
+
+    void arm(const reactor_source &source, const int op){
+        epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLONESHOT;
+        event.data.u64 = source.id;
+        if (::epoll_ctl(_epoll_fd, op, source.fd, &event) != 0){
+            UHD_MSG(error) << "async reactor: epoll_ctl: " << std::strerror(errno) << std::endl;
+        }
+    }
+
+    //! Call the handler of a polled source, re-arm it or retry it later
+    void dispatch(const size_t id){
+        source_map_type::iterator it = _sources.find(id);
+        if (it == _sources.end()) return; //removed after the event
+        const reactor_source &source = *it->second;
+        bool serviced = true;
+        try{
+            serviced = source.handler(0.0);
+        }
+        catch(const std::exception &e){
+            UHD_MSG(error) << "async reactor: " << e.what() << std::endl;
+        }
+        if (serviced) this->arm(source, EPOLL_CTL_MOD);
+        else _retries.push_back(id);
+    }
+
+    void epoll_task(void){
+        raise_priority_once(_epoll_priority_raised);
+
+        //wait forever unless a busy source waits for a retry
+        bool retry;
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            retry = not _retries.empty();
+        }
+        epoll_event events[MAX_EVENTS];
+        const int num_events = ::epoll_wait(
+            _epoll_fd, events, MAX_EVENTS, retry? int(HANDLER_RETRY_DELAY*1000) : -1
+        );
+        if (not _polling) return;
+        if (num_events < 0 and errno != EINTR){
+            UHD_MSG(error) << "async reactor: epoll_wait: " << std::strerror(errno) << std::endl;
+            boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+            return;
+        }
+
+        boost::mutex::scoped_lock lock(_mutex);
+        std::list<size_t> retries;
+        if (retry) retries.swap(_retries);
+        for (int i = 0; i < num_events; i++){
+            if (events[i].data.u64 == WAKE_ID){
+                char bytes[64];
+                while (::read(_wake_fds[0], bytes, sizeof(bytes)) > 0){}
+                continue;
+            }
+            this->dispatch(size_t(events[i].data.u64));
+        }
+        BOOST_FOREACH(const size_t id, retries) this->dispatch(id);
+    }
+
+    int _epoll_fd, _wake_fds[2];
+    volatile bool _polling;
+    bool _epoll_priority_raised;
+    std::list<size_t> _retries;
+    task::sptr _epoll_task;
+    #endif /*HAVE_SYS_EPOLL_H*/
+
+    const std::string _cpus;
+    boost::mutex _mutex;
+    size_t _next_id;
+    source_map_type _sources;
+};
+
+/***********************************************************************
+ * Registration
+ **********************************************************************/
+class reactor_registration : public async_reactor::registration{
+public:
+    reactor_registration(boost::shared_ptr<async_reactor_impl> reactor, const size_t id, const bool polled):
+        _reactor(reactor), _id(id), _polled(polled)
+    {
+        /* NOP */
+    }
+
+    ~reactor_registration(void){
+        _reactor->remove(_id);
+    }
+
+    bool is_polled(void) const{
+        return _polled;
+    }
+
+private:
+    boost::shared_ptr<async_reactor_impl> _reactor;
+    const size_t _id;
+    const bool _polled;
+};
+
+async_reactor::registration::sptr async_reactor_impl::add(
+    zero_copy_if::sptr xport, const handler_type &handler
+){
+    boost::shared_ptr<reactor_source> source(new reactor_source());
+    source->xport = xport;
+    source->handler = handler;
+    source->fd = -1;
+    source->priority_raised = false;
+    #ifdef HAVE_SYS_EPOLL_H
+    recv_pollable *pollable = dynamic_cast<recv_pollable *>(xport.get());
+    if (pollable != NULL) source->fd = pollable->get_recv_fd();
+    #endif /*HAVE_SYS_EPOLL_H*/
+
+    boost::mutex::scoped_lock lock(_mutex);
+    source->id = _next_id++;
+    _sources[source->id] = source;
+    #ifdef HAVE_SYS_EPOLL_H
+    if (source->fd >= 0) this->arm(*source, EPOLL_CTL_ADD);
+    #endif /*HAVE_SYS_EPOLL_H*/
+    if (source->fd < 0){
+        source->thread = task::make(boost::bind(&reactor_source_thread, source.get()), _cpus);
+    }
+    UHD_LOG << "async reactor: added a transport, " << ((source->fd >= 0)? "polled" : "with a thread") << std::endl;
+    return registration::sptr(new reactor_registration(shared_from_this(), source->id, source->fd >= 0));
+}
+
+/***********************************************************************
+ * One reactor per CPU set
+ **********************************************************************/
+struct reactor_cache{
+    boost::mutex mutex;
+    std::map<std::string, boost::weak_ptr<async_reactor_impl> > reactors;
+};
+
+UHD_SINGLETON_FCN(reactor_cache, get_reactor_cache);
+
+async_reactor::sptr async_reactor::get(const std::string &cpus){
+    reactor_cache &cache = get_reactor_cache();
+    boost::mutex::scoped_lock lock(cache.mutex);
+    boost::shared_ptr<async_reactor_impl> reactor = cache.reactors[cpus].lock();
+    if (not reactor){
+        reactor.reset(new async_reactor_impl(cpus));
+        cache.reactors[cpus] = reactor;
+    }
+    return reactor;
+}
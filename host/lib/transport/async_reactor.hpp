@@ -0,0 +1,99 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_TRANSPORT_ASYNC_REACTOR_HPP
+#define INCLUDED_LIBUHD_TRANSPORT_ASYNC_REACTOR_HPP
+
+#include <uhd/config.hpp>
+#include <uhd/transport/zero_copy.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/utility.hpp>
+#include <string>
+
+namespace uhd{ namespace transport{
+
+/*!
+ * A transport that the reactor can wait on:
+ * implemented by the transports that receive from a file descriptor.
+ */
+class recv_pollable{
+public:
+    virtual ~recv_pollable(void){}
+
+    //! Get a descriptor that polls readable while a receive buffer is ready
+    virtual int get_recv_fd(void) = 0;
+};
+
+/*!
+ * The async reactor services the transports of async messages
+ * and control responses, which are mostly idle.
+ *
+ * The transports that are recv_pollable are waited on by one thread
+ * with epoll, which calls the handler of a transport when it is readable.
+ * Every other transport gets a thread of the reactor that calls its
+ * handler in a loop, the handler waits in get_recv_buff().
+ * The handler demuxes the messages of a transport by SID.
+ * The reactor threads run at the default realtime priority
+ * (see uhd::set_thread_priority_safe), like the loops they replace.
+ *
+ * There is one reactor per CPU set, shared by all devices.
+ */
+class UHD_API async_reactor : boost::noncopyable{
+public:
+    typedef boost::shared_ptr<async_reactor> sptr;
+
+    /*!
+     * Service a transport: handle at most one message,
+     * waiting up to the timeout for it (0.0 when it is readable).
+     * \return false when another thread holds the transport,
+     *         the reactor calls the handler again after a short delay
+     */
+    typedef boost::function<bool(const double)> handler_type;
+
+    //! The transport is serviced until the registration is destroyed
+    class registration : boost::noncopyable{
+    public:
+        typedef boost::shared_ptr<registration> sptr;
+        virtual ~registration(void){}
+
+        //! True when the epoll thread waits on the transport
+        virtual bool is_polled(void) const = 0;
+    };
+
+    virtual ~async_reactor(void){}
+
+    /*!
+     * Get the reactor of a CPU set, make it on first use.
+     * The reactor lives while a registration or a caller holds it.
+     * \param cpus the CPU set of the reactor threads, see uhd::set_thread_affinity
+     */
+    static sptr get(const std::string &cpus = "");
+
+    /*!
+     * Service a transport with a handler.
+     * The handler is never called after the registration is destroyed.
+     * \param xport the transport, held by the registration
+     * \param handler called from a reactor thread
+     * \return the registration, which holds the reactor
+     */
+    virtual registration::sptr add(zero_copy_if::sptr xport, const handler_type &handler) = 0;
+};
+
+}} //namespace uhd::transport
+
+#endif /* INCLUDED_LIBUHD_TRANSPORT_ASYNC_REACTOR_HPP */
@@ -22,15 +22,6 @@
 
 using namespace uhd::transport;
 
-#ifdef UHD_TXRX_DEBUG_PRINTS
-/*
- * This is the implementation for the static variable 's_buffer_count'
- * located in uhd/transport/zero_copy.hpp.
- * It is used in the managed_buffer class.
- */
-boost::detail::atomic_count managed_buffer::s_buffer_count(0);
-#endif // UHD_TXRX_DEBUG_PRINTS
-
 //! pad the byte count to a multiple of alignment
 static size_t pad_to_boundary(const size_t bytes, const size_t alignment){
     return bytes + (alignment - bytes)%alignment;
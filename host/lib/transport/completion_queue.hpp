@@ -0,0 +1,120 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_TRANSPORT_COMPLETION_QUEUE_HPP
+#define INCLUDED_LIBUHD_TRANSPORT_COMPLETION_QUEUE_HPP
+
+#include <uhd/config.hpp>
+#include <uhd/utils/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/thread_time.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <vector>
+
+namespace uhd{ namespace transport{
+
+/***********************************************************************
+ * Completion queue:
+ *  - A single-producer single-consumer ring of completed transfers.
+ *  - The producer is the event thread (one per libusb context),
+ *    the consumer is the thread in get_recv_buff or get_send_buff.
+ *  - The producer only takes the lock to wake a waiting consumer,
+ *    and the first completion of a batch clears the wait flag,
+ *    so there is one wakeup per batch of completions.
+ *  - Both sides store one variable and then read the other
+ *    (tail then wait flag, wait flag then tail), so both use a
+ *    compare-and-swap on the wait flag, which is a full barrier.
+ **********************************************************************/
+template <typename T> class completion_queue : boost::noncopyable{
+public:
+    completion_queue(const size_t capacity):
+        _ring(capacity + 1), _head(0), _cached_tail(0)
+    {
+        _tail.write(0);
+        _waiting.write(0);
+    }
+
+    //! Push a completed transfer (producer only), the ring must not be full
+    UHD_INLINE void push(T *item)
+    {
+        const boost::uint32_t tail = _tail.read();
+        _ring[tail] = item;
+        _tail.write(boost::uint32_t((tail + 1) % _ring.size()));
+        if (_waiting.cas(0, 1) == 1)
+        {
+            boost::lock_guard<boost::mutex> lock(_mutex);
+            _cond.notify_one();
+        }
+    }
+
+    /*!
+     * Pop the oldest completed transfer (consumer only).
+     * \param timeout the wait timeout in seconds, negative waits forever
+     * \return the transfer or NULL on timeout
+     */
+    UHD_INLINE T *pop(const double timeout)
+    {
+        if (this->empty() and not this->wait(timeout)) return NULL;
+        T *item = _ring[_head];
+        _head = (_head + 1) % _ring.size();
+        return item;
+    }
+
+    //! Get the number of completed transfers not popped yet (consumer only)
+    UHD_INLINE size_t size(void)
+    {
+        _cached_tail = _tail.read();
+        return (_cached_tail + _ring.size() - _head) % _ring.size();
+    }
+
+private:
+    //! Check for completions, the tail is read once per batch
+    UHD_INLINE bool empty(void)
+    {
+        if (_head == _cached_tail) _cached_tail = _tail.read();
+        return _head == _cached_tail;
+    }
+
+    bool wait(const double timeout)
+    {
+        const boost::system_time exit_time = boost::get_system_time() +
+            boost::posix_time::microseconds(long(timeout*1e6));
+        boost::mutex::scoped_lock lock(_mutex);
+        while (true)
+        {
+            //set the flag before checking again so a push cannot be missed,
+            //the swap orders the flag before the read of the tail
+            _waiting.cas(1, 0);
+            if (not this->empty()) break;
+            if (timeout < 0.0) _cond.wait(lock);
+            else if (not _cond.timed_wait(lock, exit_time)) break;
+        }
+        _waiting.write(0);
+        return not this->empty();
+    }
+
+    std::vector<T *> _ring;
+    size_t _head, _cached_tail;
+    uhd::atomic_uint32_t _tail, _waiting;
+    boost::mutex _mutex;
+    boost::condition_variable _cond;
+};
+
+}} //namespace uhd::transport
+
+#endif /* INCLUDED_LIBUHD_TRANSPORT_COMPLETION_QUEUE_HPP */
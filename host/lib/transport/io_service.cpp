@@ -0,0 +1,228 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "io_service.hpp"
+#include "completion_queue.hpp"
+#include <uhd/utils/log.hpp>
+#include <uhd/utils/tasks.hpp>
+#include <uhd/utils/thread_priority.hpp>
+#include <uhd/utils/static.hpp>
+#include <uhd/utils/atomic.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+using namespace uhd;
+using namespace uhd::transport;
+
+static const double SERVICE_IDLE_TIMEOUT = 0.01;    //secs, the wait of a service with one transport
+static const double SERVICE_POLL_TIMEOUT = 0.0001;  //secs, the wait per transport of a service with several
+static const long SERVICE_FULL_DELAY_US = 100;      //usecs, the nap when every ring is full
+
+class io_service_impl;
+
+/***********************************************************************
+ * Serviced transport:
+ * The service thread receives into the ring, the streamer pops it.
+ * A buffer in the ring holds its own reference, so it goes back to
+ * the transport when the streamer releases it.
+ **********************************************************************/
+class io_serviced_xport : public zero_copy_if{
+public:
+    io_serviced_xport(boost::shared_ptr<io_service_impl> service, zero_copy_if::sptr xport):
+        _service(service), _xport(xport),
+        _capacity(std::max<size_t>(1, xport->get_num_recv_frames())),
+        _ring(_capacity)
+    {
+        _num_queued.write(0);
+    }
+
+    ~io_serviced_xport(void);
+
+    //! Room in the ring (service thread)
+    UHD_INLINE bool has_room(void)
+    {
+        return _num_queued.read() < _capacity;
+    }
+
+    /*!
+     * Receive one buffer into the ring (service thread).
+     * \param timeout the wait for a buffer in seconds
+     * \return true when a buffer was received
+     */
+    UHD_INLINE bool service(const double timeout)
+    {
+        if (not this->has_room()) return false;
+        managed_recv_buffer::sptr buff = _xport->get_recv_buff(timeout);
+        if (not buff) return false;
+        managed_recv_buffer *mb = buff.get();
+        intrusive_ptr_add_ref(mb); //the ring holds the reference
+        buff.reset();
+        _num_queued.inc();
+        _ring.push(mb);
+        return true;
+    }
+
+    managed_recv_buffer::sptr get_recv_buff(double timeout)
+    {
+        managed_recv_buffer *mb = _ring.pop(timeout);
+        if (mb == NULL) return managed_recv_buffer::sptr();
+        _num_queued.dec();
+        return managed_recv_buffer::sptr(mb, false); //take over the reference of the ring
+    }
+
+    size_t get_num_recv_frames(void) const {return _xport->get_num_recv_frames();}
+    size_t get_recv_frame_size(void) const {return _xport->get_recv_frame_size();}
+
+    managed_send_buffer::sptr get_send_buff(double timeout)
+    {
+        return _xport->get_send_buff(timeout);
+    }
+
+    size_t get_num_send_frames(void) const {return _xport->get_num_send_frames();}
+    size_t get_send_frame_size(void) const {return _xport->get_send_frame_size();}
+
+private:
+    boost::shared_ptr<io_service_impl> _service;
+    zero_copy_if::sptr _xport;
+    const size_t _capacity;
+    uhd::atomic_uint32_t _num_queued;
+    completion_queue<managed_recv_buffer> _ring;
+};
+
+/***********************************************************************
+ * Service implementation:
+ * The service thread polls with the mutex held,
+ * so holding the mutex excludes it from the transports.
+ * A pass polls every transport without waiting; when nothing arrived,
+ * the thread waits on one transport, in turn, for a short time.
+ **********************************************************************/
+class io_service_impl :
+    public io_service, public boost::enable_shared_from_this<io_service_impl>
+{
+public:
+    io_service_impl(const std::string &context, const std::string &cpus):
+        _context(context), _next(0), _priority_raised(false)
+    {
+        _task = task::make(boost::bind(&io_service_impl::service_task, this), cpus);
+    }
+
+    ~io_service_impl(void)
+    {
+        //the serviced transports hold the service, so all are gone
+        _task.reset();
+    }
+
+    zero_copy_if::sptr attach(zero_copy_if::sptr xport)
+    {
+        boost::shared_ptr<io_serviced_xport> serviced(new io_serviced_xport(shared_from_this(), xport));
+        boost::mutex::scoped_lock lock(_mutex);
+        _xports.push_back(serviced.get());
+        _cond.notify_one();
+        UHD_LOG << "io service " << _context << ": attached a transport, " << _xports.size() << " in total" << std::endl;
+        return serviced;
+    }
+
+    void detach(io_serviced_xport *xport)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _xports.erase(std::remove(_xports.begin(), _xports.end(), xport), _xports.end());
+    }
+
+private:
+    void service_task(void)
+    {
+        //the thread receives for the streamers, give it their priority
+        if (not _priority_raised)
+        {
+            set_thread_priority_safe();
+            _priority_raised = true;
+        }
+
+        boost::mutex::scoped_lock lock(_mutex);
+        if (_xports.empty())
+        {
+            _cond.timed_wait(lock, boost::posix_time::milliseconds(100));
+            return;
+        }
+
+        bool idle = true;
+        for (size_t i = 0; i < _xports.size(); i++)
+        {
+            if (_xports[i]->service(0.0)) idle = false;
+        }
+        if (not idle) return;
+
+        _next = (_next + 1) % _xports.size();
+        if (_xports[_next]->has_room())
+        {
+            _xports[_next]->service((_xports.size() == 1)? SERVICE_IDLE_TIMEOUT : SERVICE_POLL_TIMEOUT);
+        }
+        else
+        {
+            //the streamers are behind, leave the packets in the transports
+            lock.unlock();
+            boost::this_thread::sleep(boost::posix_time::microseconds(SERVICE_FULL_DELAY_US));
+        }
+    }
+
+    const std::string _context;
+    boost::mutex _mutex;
+    boost::condition_variable _cond;
+    std::vector<io_serviced_xport *> _xports;
+    size_t _next;
+    bool _priority_raised;
+    task::sptr _task;
+};
+
+io_serviced_xport::~io_serviced_xport(void)
+{
+    //after the detach, the service thread no longer pushes
+    _service->detach(this);
+    while (managed_recv_buffer *mb = _ring.pop(0.0))
+    {
+        intrusive_ptr_release(mb);
+    }
+}
+
+/***********************************************************************
+ * One service per context and CPU set
+ **********************************************************************/
+struct io_service_cache{
+    boost::mutex mutex;
+    std::map<std::string, boost::weak_ptr<io_service_impl> > services;
+};
+
+UHD_SINGLETON_FCN(io_service_cache, get_io_service_cache);
+
+io_service::sptr io_service::get(const std::string &context, const std::string &cpus){
+    io_service_cache &cache = get_io_service_cache();
+    boost::mutex::scoped_lock lock(cache.mutex);
+    const std::string key = context + "@" + cpus;
+    boost::shared_ptr<io_service_impl> service = cache.services[key].lock();
+    if (not service){
+        service.reset(new io_service_impl(context, cpus));
+        cache.services[key] = service;
+    }
+    return service;
+}
@@ -0,0 +1,65 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_TRANSPORT_IO_SERVICE_HPP
+#define INCLUDED_LIBUHD_TRANSPORT_IO_SERVICE_HPP
+
+#include <uhd/config.hpp>
+#include <uhd/transport/zero_copy.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+#include <string>
+
+namespace uhd{ namespace transport{
+
+/*!
+ * The I/O service receives for the data transports of a context
+ * (a NIC or a USB context) in a thread of its own, pinned to a CPU set.
+ *
+ * The service thread polls every attached transport and fills a ring
+ * of received buffers per transport; the streamer pops its ring.
+ * When every ring is full, the service leaves the packets in the
+ * transport, so nothing is dropped. Sends go straight to the transport.
+ *
+ * There is one service per context and CPU set, shared by all devices.
+ */
+class UHD_API io_service : boost::noncopyable{
+public:
+    typedef boost::shared_ptr<io_service> sptr;
+
+    virtual ~io_service(void){}
+
+    /*!
+     * Get the service of a context, make it on first use.
+     * The service lives while an attached transport or a caller holds it.
+     * \param context names the NIC or USB context
+     * \param cpus the CPU set of the service thread, see uhd::set_thread_affinity
+     */
+    static sptr get(const std::string &context, const std::string &cpus = "");
+
+    /*!
+     * Attach a transport to the service.
+     * The service receives for the transport until the returned one is destroyed.
+     * \param xport the transport, held by the returned one
+     * \return a transport whose receive buffers come from the service thread
+     */
+    virtual zero_copy_if::sptr attach(zero_copy_if::sptr xport) = 0;
+};
+
+}} //namespace uhd::transport
+
+#endif /* INCLUDED_LIBUHD_TRANSPORT_IO_SERVICE_HPP */
@@ -52,9 +52,20 @@ public:
         return _context;
     }
 
+    void set_event_thread_cpus(const std::string &cpus){
+        boost::mutex::scoped_lock lock(_cpus_mutex);
+        if (cpus == _event_thread_cpus) return;
+        _event_thread_cpus = cpus;
+        //restart the event thread on the new cpus, pending transfers stay submitted
+        task_handler.reset();
+        task_handler = task::make(boost::bind(&libusb_session_impl::libusb_event_handler_task, this, _context), cpus);
+    }
+
 private:
     libusb_context *_context;
     task::sptr task_handler;
+    boost::mutex _cpus_mutex;
+    std::string _event_thread_cpus;
 
     /*
      * Task to handle libusb events.  There should only be one thread per libusb_context handling events.
@@ -74,6 +85,10 @@ private:
 libusb::session::sptr libusb::session::get_global_session(void){
     static boost::weak_ptr<session> global_session;
 
+    //USB discovery backends may run concurrently, see device::find
+    static boost::mutex global_session_mutex;
+    boost::mutex::scoped_lock lock(global_session_mutex);
+
     //not expired -> get existing session
     if (not global_session.expired()) return global_session.lock();
 
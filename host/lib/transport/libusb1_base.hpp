@@ -58,6 +58,13 @@ namespace libusb {
 
         //! get the underlying libusb context pointer
         virtual libusb_context *get_context(void) const = 0;
+
+        /*!
+         * Pin the thread that handles the events of this context.
+         * The session is shared, so the last call wins.
+         * \param cpus the CPU set, see uhd::set_thread_affinity
+         */
+        virtual void set_event_thread_cpus(const std::string &cpus) = 0;
     };
 
     /*!
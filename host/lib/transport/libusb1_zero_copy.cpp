@@ -16,26 +16,31 @@
 //
 
 #include "libusb1_base.hpp"
+#include "packet_trace.hpp"
+#include "completion_queue.hpp"
+#include "usb_xfer_tuner.hpp"
 #include <uhd/transport/usb_zero_copy.hpp>
 #include <uhd/transport/buffer_pool.hpp>
 #include <uhd/transport/bounded_buffer.hpp>
 #include <uhd/utils/msg.hpp>
+#include <uhd/utils/log.hpp>
+#include <uhd/utils/atomic.hpp>
+#include <uhd/utils/byteswap.hpp>
+#include <uhd/types/time_spec.hpp>
 #include <uhd/exception.hpp>
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
 #include <boost/function.hpp>
 #include <boost/bind.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/circular_buffer.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition_variable.hpp>
+#include <algorithm>
 #include <list>
-
-#ifdef UHD_TXRX_DEBUG_PRINTS
 #include <vector>
-#include <fstream>
-#include <boost/format.hpp>
-#endif
+
 
 using namespace uhd;
 using namespace uhd::transport;
@@ -62,6 +67,7 @@ static const size_t DEFAULT_XFER_SIZE = 32*512; //bytes
 
 //! type for sharing the release queue with managed buffers
 class libusb_zero_copy_mb;
+class libusb_zero_copy_packet_mb;
 typedef boost::shared_ptr<bounded_buffer<libusb_zero_copy_mb *> > mb_queue_sptr;
 
 /*!
@@ -72,42 +78,18 @@ struct lut_result_t
 {
     lut_result_t(void)
     {
-        completed = 0;
         status = LIBUSB_TRANSFER_COMPLETED;
         actual_length = 0;
-#ifdef UHD_TXRX_DEBUG_PRINTS
-        start_time = 0;
-        buff_num = -1;
-#endif
+        latency_secs = 0.0;
+        complete_secs = 0.0;
     }
-    int completed;
     libusb_transfer_status status;
     int actual_length;
-    boost::mutex mut;
-    boost::condition_variable usb_transfer_complete;
-
-#ifdef UHD_TXRX_DEBUG_PRINTS
-    // These are fore debugging
-    long start_time;
-    int buff_num;
-    bool is_recv;
-#endif
+    double latency_secs, complete_secs; //receive transfers: submit to completion, completion time
 };
 
-// Created to be used as an argument to boost::condition_variable::timed_wait() function
-struct lut_result_completed {
-    const lut_result_t& _result;
-    lut_result_completed(const lut_result_t& result):_result(result) {}
-    bool operator()() const {return (_result.completed ? true : false);}
-};
-
-#ifdef UHD_TXRX_DEBUG_PRINTS
-static std::string dbg_prefix("libusb1_zero_copy,");
-static void libusb1_zerocopy_dbg_print_err(std::string msg){
-	msg = dbg_prefix + msg;
-	fprintf(stderr, "%s\n", msg.c_str());
-}
-#endif
+//! completed transfers, popped by the thread that gets buffers
+typedef completion_queue<libusb_zero_copy_mb> libusb_completion_queue;
 
 /*!
  * All libusb callback functions should be marked with the LIBUSB_CALL macro
@@ -115,19 +97,7 @@ static void libusb1_zerocopy_dbg_print_err(std::string msg){
  */
 
 //! helper function: handles all async callbacks
-static void LIBUSB_CALL libusb_async_cb(libusb_transfer *lut)
-{
-    lut_result_t *r = (lut_result_t *)lut->user_data;
-    boost::lock_guard<boost::mutex> lock(r->mut);
-    r->status = lut->status;
-    r->actual_length = lut->actual_length;
-    r->completed = 1;
-    r->usb_transfer_complete.notify_one();  // wake up thread waiting in wait_for_completion() member function below
-#ifdef UHD_TXRX_DEBUG_PRINTS
-    long end_time = boost::get_system_time().time_of_day().total_microseconds();
-    libusb1_zerocopy_dbg_print_err( (boost::format("libusb_async_cb,%s,%i,%i,%i,%ld,%ld") % (r->is_recv ? "rx":"tx") % r->buff_num % r->actual_length % r->status % end_time % r->start_time).str() );
-#endif
-}
+static void LIBUSB_CALL libusb_async_cb(libusb_transfer *lut);
 
 /***********************************************************************
  * Reusable managed buffer:
@@ -137,10 +107,10 @@ static void LIBUSB_CALL libusb_async_cb(libusb_transfer *lut)
 class libusb_zero_copy_mb : public managed_buffer
 {
 public:
-    libusb_zero_copy_mb(libusb_transfer *lut, const size_t frame_size, boost::function<void(libusb_zero_copy_mb *)> release_cb, const bool is_recv, const std::string &name):
-        _release_cb(release_cb), _is_recv(is_recv), _name(name),
+    libusb_zero_copy_mb(libusb_transfer *lut, const size_t frame_size, boost::function<void(libusb_zero_copy_mb *)> release_cb, libusb_completion_queue &completions, const bool is_recv, const std::string &name, const size_t index):
+        _release_cb(release_cb), _completions(completions), _is_recv(is_recv), _name(name), _index(index),
         _ctx(libusb::session::get_global_session()->get_context()),
-        _lut(lut), _frame_size(frame_size) { /* NOP */ }
+        _lut(lut), _frame_size(frame_size), _submit_secs(0.0), _num_packets(0) { /* NOP */ }
 
     void release(void){
     	_release_cb(this);
@@ -149,61 +119,145 @@ public:
     UHD_INLINE void submit(void)
     {
     	_lut->length = (_is_recv)? _frame_size : size(); //always set length
-#ifdef UHD_TXRX_DEBUG_PRINTS
-        result.start_time = boost::get_system_time().time_of_day().total_microseconds();
-        result.buff_num = num();
-        result.is_recv = _is_recv;
-#endif
+        packet_trace(TRACE_XFER_SUBMIT, _is_recv, boost::uint32_t(_index), boost::uint64_t(_lut->length));
+        if (_is_recv) _submit_secs = time_spec_t::get_system_time().get_real_secs();
         const int ret = libusb_submit_transfer(_lut);
         if (ret != 0) throw uhd::runtime_error(str(boost::format(
             "usb %s submit failed: %s") % _name % libusb_error_name(ret)));
     }
 
+    //! Get a buffer for a transfer popped from the completion queue
     template <typename buffer_type>
-    UHD_INLINE typename buffer_type::sptr get_new(const double timeout)
+    UHD_INLINE typename buffer_type::sptr get_new(void)
     {
-        if (wait_for_completion(timeout))
+        if (result.status != LIBUSB_TRANSFER_COMPLETED) throw uhd::runtime_error(str(boost::format(
+            "usb %s transfer status: %d") % _name % int(result.status)));
+        return make(reinterpret_cast<buffer_type *>(this), _lut->buffer, (_is_recv)? result.actual_length : _frame_size);
+    }
+
+    //! Called from the libusb event thread when the transfer completes
+    UHD_INLINE void complete(void)
+    {
+        result.status = _lut->status;
+        result.actual_length = _lut->actual_length;
+        if (_is_recv)
         {
-            if (result.status != LIBUSB_TRANSFER_COMPLETED) throw uhd::runtime_error(str(boost::format(
-                "usb %s transfer status: %d") % _name % int(result.status)));
-            result.completed = 0;
-            return make(reinterpret_cast<buffer_type *>(this), _lut->buffer, (_is_recv)? result.actual_length : _frame_size);
+            result.complete_secs = time_spec_t::get_system_time().get_real_secs();
+            result.latency_secs = result.complete_secs - _submit_secs;
         }
-        return typename buffer_type::sptr();
+        packet_trace(TRACE_XFER_COMPLETE, _is_recv, boost::uint32_t(_index),
+            (boost::uint64_t(boost::uint32_t(result.status)) << 32) | boost::uint32_t(result.actual_length));
+        _completions.push(this);
     }
 
     // This is public because it is accessed from the libusb_zero_copy_single constructor
     lut_result_t result;
 
     /*!
-     * Wait for a managed buffer to become complete.
-     *
-     * \param timeout the wait timeout in seconds.  A negative value will wait forever.
-     * \return true for completion, false for timeout
+     * Split a completed receive transfer into its packets.
+     * The transfer is resubmitted when all packet buffers are released.
+     * \return the number of packets in the transfer
      */
-    UHD_INLINE bool wait_for_completion(const double timeout)
+    size_t split_packets(void);
+
+    //! Get a buffer for a packet of the split transfer
+    managed_recv_buffer::sptr get_packet(const size_t index);
+
+    //! Called by a packet buffer on release
+    UHD_INLINE void release_packet(void)
     {
-        boost::unique_lock<boost::mutex> lock(result.mut);
-        if (!result.completed) {
-            if (timeout < 0.0) {
-                result.usb_transfer_complete.wait(lock);
-            } else {
-                const boost::system_time timeout_time = boost::get_system_time() + boost::posix_time::microseconds(long(timeout*1000000));
-                result.usb_transfer_complete.timed_wait(lock, timeout_time, lut_result_completed(result));
-            }
-        }
-        return result.completed;
+        if (_num_packets_out.dec() == 1) this->release();
     }
 
 private:
     boost::function<void(libusb_zero_copy_mb *)> _release_cb;
+    libusb_completion_queue &_completions;
     const bool _is_recv;
     const std::string _name;
+    const size_t _index; //for the packet trace
     libusb_context *_ctx;
     libusb_transfer *_lut;
     const size_t _frame_size;
+    double _submit_secs; //written before the submit, read by the event thread after it
+
+    //! packet buffers, grown to the largest number of packets seen in a transfer
+    std::vector<boost::shared_ptr<libusb_zero_copy_packet_mb> > _packets;
+    size_t _num_packets;
+    uhd::atomic_uint32_t _num_packets_out;
 };
 
+/***********************************************************************
+ * Packet buffer:
+ *  - One packet of a receive transfer that carries several packets.
+ *  - Releases its transfer when the last packet is released.
+ **********************************************************************/
+class libusb_zero_copy_packet_mb : public managed_recv_buffer
+{
+public:
+    libusb_zero_copy_packet_mb(libusb_zero_copy_mb *xfer):
+        _xfer(xfer), _mem(NULL), _len(0) { /* NOP */ }
+
+    void release(void){
+        _xfer->release_packet();
+    }
+
+    UHD_INLINE void set(void *mem, const size_t len)
+    {
+        _mem = mem;
+        _len = len;
+    }
+
+    UHD_INLINE sptr get_new(void)
+    {
+        return make(this, _mem, _len);
+    }
+
+private:
+    libusb_zero_copy_mb *_xfer;
+    void *_mem;
+    size_t _len;
+};
+
+size_t libusb_zero_copy_mb::split_packets(void)
+{
+    if (result.status != LIBUSB_TRANSFER_COMPLETED) throw uhd::runtime_error(str(boost::format(
+        "usb %s transfer status: %d") % _name % int(result.status)));
+
+    //packets are CHDR (little endian) and padded to 64 bits on the bus,
+    //a packet with a bad length takes the rest of the transfer
+    boost::uint8_t *mem = _lut->buffer;
+    const size_t length = size_t(result.actual_length);
+    size_t offset = 0;
+    _num_packets = 0;
+    while (offset < length)
+    {
+        size_t packet_len = length - offset;
+        if (packet_len >= sizeof(boost::uint32_t))
+        {
+            const size_t chdr_len = uhd::wtohx(*reinterpret_cast<const boost::uint32_t *>(mem + offset)) & 0xffff;
+            if (chdr_len != 0 and chdr_len < packet_len) packet_len = chdr_len;
+        }
+        if (_num_packets == _packets.size())
+        {
+            _packets.push_back(boost::make_shared<libusb_zero_copy_packet_mb>(this));
+        }
+        _packets[_num_packets++]->set(mem + offset, packet_len);
+        offset += (packet_len + 7) & ~size_t(7);
+    }
+    _num_packets_out.write(boost::uint32_t(_num_packets));
+    return _num_packets;
+}
+
+managed_recv_buffer::sptr libusb_zero_copy_mb::get_packet(const size_t index)
+{
+    return _packets[index]->get_new();
+}
+
+static void LIBUSB_CALL libusb_async_cb(libusb_transfer *lut)
+{
+    static_cast<libusb_zero_copy_mb *>(lut->user_data)->complete();
+}
+
 /***********************************************************************
  * USB zero_copy device class
  **********************************************************************/
@@ -213,16 +267,23 @@ public:
     libusb_zero_copy_single(
         libusb::device_handle::sptr handle,
         const size_t interface, const size_t endpoint,
-        const size_t num_frames, const size_t frame_size
+        const size_t num_frames, const size_t frame_size,
+        const size_t xfer_size, const bool packet_mode
     ):
         _handle(handle),
         _num_frames(num_frames),
         _frame_size(frame_size),
-        _buffer_pool(buffer_pool::make(_num_frames, _frame_size)),
-        _enqueued(_num_frames), _released(_num_frames)
+        _xfer_size(xfer_size),
+        _packet_mode(packet_mode),
+        _buffer_pool(buffer_pool::make(_num_frames, _xfer_size)),
+        _enqueued(_num_frames), _released(_num_frames),
+        _completions(_num_frames),
+        _split_xfer(NULL), _split_index(0), _split_count(0)
     {
         const bool is_recv = (endpoint & 0x80) != 0;
         const std::string name = str(boost::format("%s%d") % ((is_recv)? "rx" : "tx") % int(endpoint & 0x7f));
+        _name = name;
+        if (_packet_mode) _tuner.reset(new usb_xfer_tuner(_num_frames));
         _handle->claim_interface(interface);
 
         //flush the buffers out of the recv endpoint
@@ -249,7 +310,7 @@ public:
             UHD_ASSERT_THROW(lut != NULL);
 
             _mb_pool.push_back(boost::make_shared<libusb_zero_copy_mb>(
-                lut, this->get_frame_size(), boost::bind(&libusb_zero_copy_single::enqueue_buffer, this, _1), is_recv, name
+                lut, _xfer_size, boost::bind(&libusb_zero_copy_single::enqueue_buffer, this, _1), _completions, is_recv, name, i
             ));
 
             libusb_fill_bulk_transfer(
@@ -257,9 +318,9 @@ public:
                 _handle->get(),                                         // dev_handle
                 endpoint,                                               // endpoint
                 static_cast<unsigned char *>(_buffer_pool->at(i)),      // buffer
-                this->get_frame_size(),                                 // length
+                _xfer_size,                                             // length
                 libusb_transfer_cb_fn(&libusb_async_cb),                // callback
-                static_cast<void *>(&_mb_pool.back()->result),          // user_data
+                static_cast<void *>(_mb_pool.back().get()),             // user_data
                 0                                                       // timeout (ms)
             );
 
@@ -273,8 +334,8 @@ public:
             if (is_recv) mb.release();
             else
             {
-                mb.result.completed = 1;
                 _enqueued.push_back(&mb);
+                _completions.push(&mb);
             }
         }
     }
@@ -288,9 +349,9 @@ public:
         }
 
         //process all transfers until timeout occurs
-        BOOST_FOREACH(libusb_zero_copy_mb *mb, _enqueued)
+        for (size_t i = 0; i < _num_frames and not _enqueued.empty(); i++)
         {
-            mb->wait_for_completion(0.01);
+            if (this->pop_completed(0.01) == NULL) break;
         }
 
         //free all transfers
@@ -303,54 +364,98 @@ public:
     template <typename buffer_type>
     UHD_INLINE typename buffer_type::sptr get_buff(double timeout)
     {
-        typename buffer_type::sptr buff;
-        libusb_zero_copy_mb *front = NULL;
-        boost::mutex::scoped_lock lock(_mutex);
-        if (_enqueued.empty())
+        libusb_zero_copy_mb *mb = this->pop_completed(timeout);
+        if (mb == NULL) return typename buffer_type::sptr();
+        return mb->get_new<buffer_type>();
+    }
+
+    /*!
+     * Get the next packet in packet mode:
+     * a completed transfer is split into one buffer per packet,
+     * and the transfer is resubmitted when all of them are released.
+     */
+    managed_recv_buffer::sptr get_packet_buff(double timeout)
+    {
+        if (_split_index < _split_count) return _split_xfer->get_packet(_split_index++);
+
+        while (true)
         {
-            _cond.timed_wait(lock, boost::posix_time::microseconds(long(timeout*1e6)));
-        }
-        if (_enqueued.empty()) return buff;
-        front = _enqueued.front();
+            libusb_zero_copy_mb *mb = this->pop_completed(timeout);
+            if (mb == NULL) return managed_recv_buffer::sptr();
 
-        lock.unlock();
-        buff = front->get_new<buffer_type>(timeout);
-        lock.lock();
+            _split_count = mb->split_packets();
+            if (_split_count != 0)
+            {
+                _split_xfer = mb;
+                _split_index = 1;
+                return mb->get_packet(0);
+            }
 
-        if (buff) _enqueued.pop_front();
-        this->submit_what_we_can();
-        return buff;
+            //an empty transfer goes straight back to libusb
+            mb->release();
+        }
     }
 
     UHD_INLINE size_t get_num_frames(void) const { return _num_frames; }
     UHD_INLINE size_t get_frame_size(void) const { return _frame_size; }
+    UHD_INLINE bool is_packet_mode(void) const { return _packet_mode; }
 
 private:
     libusb::device_handle::sptr _handle;
-    const size_t _num_frames, _frame_size;
+    const size_t _num_frames, _frame_size, _xfer_size;
+    const bool _packet_mode;
+    std::string _name;
 
     //! Storage for transfer related objects
     buffer_pool::sptr _buffer_pool;
     std::vector<boost::shared_ptr<libusb_zero_copy_mb> > _mb_pool;
 
     boost::mutex _mutex;
-    boost::condition_variable _cond;
 
     //! why 2 queues? there is room in the future to have > N buffers but only N in flight
     boost::circular_buffer<libusb_zero_copy_mb *> _enqueued, _released;
 
+    //! transfers completed by libusb, in completion order
+    libusb_completion_queue _completions;
+
     void enqueue_buffer(libusb_zero_copy_mb *mb)
     {
         boost::mutex::scoped_lock l(_mutex);
         _released.push_back(mb);
         this->submit_what_we_can();
-        l.unlock();
-        _cond.notify_one();
+    }
+
+    /*!
+     * Pop the next completed transfer and submit what we can in its place.
+     * \param timeout the wait timeout in seconds
+     * \return the transfer or NULL on timeout
+     */
+    libusb_zero_copy_mb *pop_completed(const double timeout)
+    {
+        libusb_zero_copy_mb *mb = _completions.pop(timeout);
+        if (mb == NULL) return NULL;
+
+        boost::mutex::scoped_lock l(_mutex);
+        if (_tuner and _tuner->update(mb->result.latency_secs, mb->result.complete_secs))
+        {
+            UHD_LOG << boost::format("usb %s transfers in flight: %u (completion interval %f ms)")
+                % _name % _tuner->get_num_in_flight() % (_tuner->get_interval()*1e3) << std::endl;
+        }
+        //bulk transfers complete in order, so this is almost always the front
+        if (_enqueued.front() == mb) _enqueued.pop_front();
+        else
+        {
+            boost::circular_buffer<libusb_zero_copy_mb *>::iterator it = std::find(_enqueued.begin(), _enqueued.end(), mb);
+            if (it != _enqueued.end()) _enqueued.erase(it);
+        }
+        this->submit_what_we_can();
+        return mb;
     }
 
     void submit_what_we_can(void)
     {
-        while (not _released.empty() and not _enqueued.full())
+        const size_t num_in_flight = (_tuner)? _tuner->get_num_in_flight() : _num_frames;
+        while (not _released.empty() and _enqueued.size() < num_in_flight)
         {
             _released.front()->submit();
             _enqueued.push_back(_released.front());
@@ -360,6 +465,13 @@ private:
 
     //! a list of all transfer structs we allocated
     std::list<libusb_transfer *> _all_luts;
+
+    //! packet mode: adapts the transfers in flight to their completion latency
+    boost::scoped_ptr<usb_xfer_tuner> _tuner;
+
+    //! packet mode: the transfer being split
+    libusb_zero_copy_mb *_split_xfer;
+    size_t _split_index, _split_count;
 };
 
 /***********************************************************************
@@ -375,19 +487,31 @@ struct libusb_zero_copy_impl : usb_zero_copy
         const size_t send_endpoint,
         const device_addr_t &hints
     ){
+        //packet mode: a receive transfer of recv_xfer_size bytes carries several packets
+        const size_t recv_frame_size = size_t(hints.cast<double>("recv_frame_size", DEFAULT_XFER_SIZE));
+        const size_t send_frame_size = size_t(hints.cast<double>("send_frame_size", DEFAULT_XFER_SIZE));
+        const bool packet_mode = hints.has_key("recv_xfer_size");
+        const size_t recv_xfer_size = std::max(recv_frame_size, size_t(hints.cast<double>("recv_xfer_size", 0.0)));
+
         _recv_impl.reset(new libusb_zero_copy_single(
             handle, recv_interface, (recv_endpoint & 0x7f) | 0x80,
             size_t(hints.cast<double>("num_recv_frames", DEFAULT_NUM_XFERS)),
-            size_t(hints.cast<double>("recv_frame_size", DEFAULT_XFER_SIZE))));
+            recv_frame_size, recv_xfer_size, packet_mode));
         _send_impl.reset(new libusb_zero_copy_single(
             handle, send_interface, (send_endpoint & 0x7f) | 0x00,
             size_t(hints.cast<double>("num_send_frames", DEFAULT_NUM_XFERS)),
-            size_t(hints.cast<double>("send_frame_size", DEFAULT_XFER_SIZE))));
+            send_frame_size, send_frame_size, false));
+
+        //the event thread completes the transfers of this context
+        if (hints.has_key("io_cpus")){
+            libusb::session::get_global_session()->set_event_thread_cpus(hints["io_cpus"]);
+        }
     }
 
     managed_recv_buffer::sptr get_recv_buff(double timeout)
     {
         boost::mutex::scoped_lock l(_recv_mutex);
+        if (_recv_impl->is_packet_mode()) return _recv_impl->get_packet_buff(timeout);
         return _recv_impl->get_buff<managed_recv_buffer>(timeout);
     }
 
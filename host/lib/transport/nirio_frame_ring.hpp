@@ -0,0 +1,162 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_TRANSPORT_NIRIO_FRAME_RING_HPP
+#define INCLUDED_LIBUHD_TRANSPORT_NIRIO_FRAME_RING_HPP
+
+#include <uhd/config.hpp>
+#include <uhd/transport/nirio/status.h>
+#include <uhd/utils/atomic.hpp>
+#include <uhd/utils/byteswap.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/utility.hpp>
+#include <algorithm>
+
+namespace uhd{ namespace transport{
+
+/*!
+ * Get the length of the CHDR packet in a DMA frame.
+ * The first 32-bit word of a frame is the little-endian CHDR header,
+ * its lower 16 bits are the packet length in bytes.
+ * \param frame the frame memory
+ * \param frame_size the frame size in bytes
+ * \return the packet length rounded up to 64 bits, or the frame size if invalid
+ */
+UHD_INLINE size_t get_chdr_frame_length(const void *frame, const size_t frame_size){
+    const boost::uint32_t header = uhd::wtohx(*reinterpret_cast<const boost::uint32_t *>(frame));
+    const size_t length = ((header & 0xffff) + 7) & ~size_t(7);
+    return (length == 0 or length > frame_size)? frame_size : length;
+}
+
+/*!
+ * A ring of fixed size frames on an NI-RIO DMA FIFO.
+ *
+ * Each frame is one packet, padded by the DMA engine to the frame size.
+ * Acquiring a frame from the FIFO is a call into the kernel, so the ring
+ * acquires all frames the last call reported ready (up to a batch limit)
+ * in one call, and hands them out one at a time. A batch never crosses
+ * the end of the FIFO buffer, so its frames are contiguous in memory.
+ *
+ * With bulk release, released frames are counted and given back to the
+ * FIFO in one call before the next batch is acquired (receive).
+ * Otherwise each release gives back its frame at once (send, to commit).
+ * The FIFO releases the oldest acquired elements, so frames must be
+ * released in the order they were handed out.
+ *
+ * The FIFO type is an nirio_fifo or a simulation with the same
+ * acquire and release calls.
+ */
+template <typename fifo_t, typename data_t>
+class nirio_frame_ring : boost::noncopyable{
+public:
+    nirio_frame_ring(
+        fifo_t &fifo,
+        const size_t frame_size,
+        const size_t num_frames,
+        const size_t max_batch,
+        const bool bulk_release
+    ):
+        _fifo(fifo),
+        _frame_elems(frame_size/sizeof(data_t)),
+        _num_frames(num_frames),
+        _max_batch(std::max<size_t>(1, max_batch)),
+        _bulk_release(bulk_release),
+        _index(0), _batch(NULL), _batch_left(0), _frames_ready(0),
+        _num_acquire_calls(0)
+    {
+        _num_released.write(0);
+        _num_release_calls.write(0);
+    }
+
+    /*!
+     * Get the next frame, acquire a new batch when the batch is used up.
+     * \param timeout_ms the acquire timeout in milliseconds
+     * \param frame set to the frame memory on success
+     * \return the status of the acquire call
+     */
+    nirio_status get_frame(const boost::uint32_t timeout_ms, data_t *&frame){
+        if (_batch_left == 0){
+            this->flush();
+            const size_t frames_to_wrap = _num_frames - _index;
+            const size_t batch = std::max<size_t>(1,
+                std::min(std::min(_frames_ready, _max_batch), frames_to_wrap));
+
+            size_t elems_acquired = 0, elems_remaining = 0;
+            const nirio_status status = _fifo.acquire(
+                _batch, batch*_frame_elems, timeout_ms, elems_acquired, elems_remaining);
+            _num_acquire_calls++;
+            if (nirio_status_fatal(status)) return status;
+
+            _batch_left = elems_acquired/_frame_elems;
+            _frames_ready = elems_remaining/_frame_elems;
+            if (_batch_left == 0) return NiRio_Status_FifoTimeout;
+        }
+
+        frame = _batch;
+        _batch += _frame_elems;
+        _batch_left--;
+        if (++_index == _num_frames) _index = 0;
+        return NiRio_Status_Success;
+    }
+
+    //! Release the oldest frame handed out (may be called from any thread)
+    void release_frame(void){
+        if (_bulk_release) _num_released.inc();
+        else{
+            _fifo.release(_frame_elems);
+            _num_release_calls.inc();
+        }
+    }
+
+    //! Give the counted released frames back to the FIFO
+    void flush(void){
+        size_t num_released;
+        do{
+            num_released = _num_released.read();
+        } while (_num_released.cas(0, boost::uint32_t(num_released)) != num_released);
+        if (num_released == 0) return;
+        _fifo.release(num_released*_frame_elems);
+        _num_release_calls.inc();
+    }
+
+    //! Get the number of acquire calls into the FIFO
+    size_t get_num_acquire_calls(void) const{
+        return _num_acquire_calls;
+    }
+
+    //! Get the number of release calls into the FIFO
+    size_t get_num_release_calls(void){
+        return _num_release_calls.read();
+    }
+
+private:
+    fifo_t &_fifo;
+    const size_t _frame_elems, _num_frames, _max_batch;
+    const bool _bulk_release;
+
+    //ring position and the frames left of the current batch
+    size_t _index;
+    data_t *_batch;
+    size_t _batch_left, _frames_ready;
+
+    atomic_uint32_t _num_released, _num_release_calls;
+    size_t _num_acquire_calls;
+};
+
+}} //namespace uhd::transport
+
+#endif /* INCLUDED_LIBUHD_TRANSPORT_NIRIO_FRAME_RING_HPP */
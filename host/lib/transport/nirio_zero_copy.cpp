@@ -24,10 +24,12 @@
 #include <uhd/utils/atomic.hpp>
 #include <boost/format.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/thread/thread.hpp> //sleep
 #include <vector>
 #include <algorithm>    // std::max
+#include "nirio_frame_ring.hpp"
 //@TODO: Move the register defs required by the class to a common location
 #include "../usrp/x300/x300_regs.hpp"
 
@@ -36,30 +38,30 @@ using namespace uhd::transport;
 using namespace uhd::niusrprio;
 
 typedef uint64_t fifo_data_t;
+typedef nirio_frame_ring<nirio_fifo<fifo_data_t>, fifo_data_t> frame_ring_t;
+
+//Limit a batch to a fraction of the frames, so released frames get back to the DMA engine soon
+static const size_t FRAMES_PER_BATCH_DIVISOR = 4;
 
 class nirio_zero_copy_mrb : public managed_recv_buffer
 {
 public:
-    nirio_zero_copy_mrb(nirio_fifo<fifo_data_t>& fifo, const size_t frame_size):
-        _fifo(fifo), _frame_size(frame_size) { }
+    nirio_zero_copy_mrb(frame_ring_t& ring, const size_t frame_size):
+        _ring(ring), _frame_size(frame_size) { }
 
     void release(void)
     {
-        _fifo.release(_frame_size / sizeof(fifo_data_t));
+        _ring.release_frame();
     }
 
     UHD_INLINE sptr get_new(const double timeout, size_t &index)
     {
-        nirio_status status = 0;
-        size_t elems_acquired, elems_remaining;
-        nirio_status_chain(_fifo.acquire(
-            _typed_buffer, _frame_size / sizeof(fifo_data_t),
-            static_cast<uint32_t>(timeout*1000),
-            elems_acquired, elems_remaining), status);
-        _length = elems_acquired * sizeof(fifo_data_t);
-        _buffer = static_cast<void*>(_typed_buffer);
+        nirio_status status = _ring.get_frame(
+            static_cast<uint32_t>(timeout*1000), _typed_buffer);
 
         if (nirio_status_not_fatal(status)) {
+            _buffer = static_cast<void*>(_typed_buffer);
+            _length = get_chdr_frame_length(_buffer, _frame_size);
             index++;        //Advances the caller's buffer
             return make(this, _buffer, _length);
         } else if (status == NiRio_Status_CommunicationTimeout) {
@@ -71,35 +73,30 @@ public:
     }
 
 private:
-    nirio_fifo<fifo_data_t>&    _fifo;
+    frame_ring_t&               _ring;
     fifo_data_t*                _typed_buffer;
     const size_t                _frame_size;
-    size_t                      _num_frames;
 };
 
 class nirio_zero_copy_msb : public managed_send_buffer
 {
 public:
-    nirio_zero_copy_msb(nirio_fifo<fifo_data_t>& fifo, const size_t frame_size):
-        _fifo(fifo), _frame_size(frame_size) { }
+    nirio_zero_copy_msb(frame_ring_t& ring, const size_t frame_size):
+        _ring(ring), _frame_size(frame_size) { }
 
     void release(void)
     {
-        _fifo.release(_frame_size / sizeof(fifo_data_t));
+        _ring.release_frame();
     }
 
     UHD_INLINE sptr get_new(const double timeout, size_t &index)
     {
-        nirio_status status = 0;
-        size_t elems_acquired, elems_remaining;
-        nirio_status_chain(_fifo.acquire(
-            _typed_buffer, _frame_size / sizeof(fifo_data_t),
-            static_cast<uint32_t>(timeout*1000),
-            elems_acquired, elems_remaining), status);
-        _length = elems_acquired * sizeof(fifo_data_t);
-        _buffer = static_cast<void*>(_typed_buffer);
+        nirio_status status = _ring.get_frame(
+            static_cast<uint32_t>(timeout*1000), _typed_buffer);
 
         if (nirio_status_not_fatal(status)) {
+            _buffer = static_cast<void*>(_typed_buffer);
+            _length = _frame_size;
             index++;        //Advances the caller's buffer
             return make(this, _buffer, _length);
         } else if (status == NiRio_Status_CommunicationTimeout) {
@@ -111,10 +108,9 @@ public:
     }
 
 private:
-    nirio_fifo<fifo_data_t>&    _fifo;
+    frame_ring_t&               _ring;
     fifo_data_t*                _typed_buffer;
     const size_t                _frame_size;
-    size_t                      _num_frames;
 };
 
 class nirio_zero_copy_impl : public nirio_zero_copy {
@@ -196,16 +192,23 @@ public:
             nirio_status_chain(_send_fifo->start(), status);
 
             if (nirio_status_not_fatal(status)) {
+                //receive frames are acquired in batches and released in bulk,
+                //send frames are acquired in batches and committed one by one
+                _recv_ring.reset(new frame_ring_t(*_recv_fifo, get_recv_frame_size(), get_num_recv_frames(),
+                    get_num_recv_frames()/FRAMES_PER_BATCH_DIVISOR, true));
+                _send_ring.reset(new frame_ring_t(*_send_fifo, get_send_frame_size(), get_num_send_frames(),
+                    get_num_send_frames()/FRAMES_PER_BATCH_DIVISOR, false));
+
                 //allocate re-usable managed receive buffers
                 for (size_t i = 0; i < get_num_recv_frames(); i++){
                     _mrb_pool.push_back(boost::shared_ptr<nirio_zero_copy_mrb>(new nirio_zero_copy_mrb(
-                        *_recv_fifo, get_recv_frame_size())));
+                        *_recv_ring, get_recv_frame_size())));
                 }
 
                 //allocate re-usable managed send buffers
                 for (size_t i = 0; i < get_num_send_frames(); i++){
                     _msb_pool.push_back(boost::shared_ptr<nirio_zero_copy_msb>(new nirio_zero_copy_msb(
-                        *_send_fifo, get_send_frame_size())));
+                        *_send_ring, get_send_frame_size())));
                 }
             }
         } else {
@@ -223,6 +226,7 @@ public:
         _proxy().poke(PCIE_TX_DMA_REG(DMA_CTRL_STATUS_REG, _fifo_instance), DMA_CTRL_DISABLED);
         _proxy().poke(PCIE_RX_DMA_REG(DMA_CTRL_STATUS_REG, _fifo_instance), DMA_CTRL_DISABLED);
 
+        if (_recv_ring) _recv_ring->flush();
         _flush_rx_buff();
 
         //Stop DMA channels. Stop is called in the fifo dtor but
@@ -332,6 +336,7 @@ private:
     niusrprio::niusrprio_session::sptr _fpga_session;
     uint32_t _fifo_instance;
     nirio_fifo<fifo_data_t>::sptr _recv_fifo, _send_fifo;
+    boost::scoped_ptr<frame_ring_t> _recv_ring, _send_ring;
     const zero_copy_xport_params _xport_params;
     buffer_pool::sptr _recv_buffer_pool, _send_buffer_pool;
     std::vector<boost::shared_ptr<nirio_zero_copy_msb> > _msb_pool;
@@ -0,0 +1,222 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "packet_trace.hpp"
+#include <uhd/exception.hpp>
+#include <uhd/types/time_spec.hpp>
+#include <uhd/utils/msg.hpp>
+#include <uhd/utils/static.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define HAVE_TRACE_TSC
+#endif
+
+using namespace uhd;
+using namespace uhd::transport;
+
+static const size_t DEFAULT_TRACE_SIZE = 65536; //events per thread
+
+bool uhd::transport::packet_trace_enabled = false;
+
+//! Get a time stamp: the time stamp counter, or else nanoseconds
+static UHD_INLINE boost::uint64_t trace_ticks(void){
+#ifdef HAVE_TRACE_TSC
+    return __rdtsc();
+#else
+    const time_spec_t now = time_spec_t::get_system_time();
+    return boost::uint64_t(now.get_full_secs())*1000000000 + boost::uint64_t(now.get_frac_secs()*1e9);
+#endif
+}
+
+/***********************************************************************
+ * Trace ring:
+ * The events of one thread. Only the owning thread writes,
+ * the dump reads whatever was written before the count.
+ **********************************************************************/
+class trace_ring : boost::noncopyable{
+public:
+    typedef boost::shared_ptr<trace_ring> sptr;
+
+    trace_ring(const size_t index, const size_t size):
+        _index(index), _records(size), _mask(size-1), _count(0)
+    {
+        /* NOP */
+    }
+
+    UHD_INLINE packet_trace_record_t &next(void){
+        return _records[size_t(_count) & _mask];
+    }
+
+    UHD_INLINE void commit(void){
+        _count = _count + 1;
+    }
+
+    void write(std::ostream &out) const{
+        const boost::uint64_t count = _count;
+        const boost::uint64_t num = std::min<boost::uint64_t>(count, _records.size());
+        packet_trace_thread_header_t header;
+        header.thread_index = _index;
+        header.num_records = num;
+        header.num_overwritten = count - num;
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (boost::uint64_t i = count - num; i < count; i++){
+            out.write(reinterpret_cast<const char *>(&_records[size_t(i) & _mask]), sizeof(packet_trace_record_t));
+        }
+    }
+
+private:
+    const size_t _index;
+    std::vector<packet_trace_record_t> _records;
+    const size_t _mask;
+    volatile boost::uint64_t _count;
+};
+
+/***********************************************************************
+ * Tracer:
+ * Owns the rings of all threads, so the events of a thread
+ * that has exited are still in the dump.
+ **********************************************************************/
+static void trace_ring_no_cleanup(trace_ring *){}
+
+class packet_tracer : boost::noncopyable{
+public:
+    packet_tracer(void):
+        thread_ring(&trace_ring_no_cleanup),
+        _ring_size(DEFAULT_TRACE_SIZE),
+        _start_ticks(0), _start_secs(0.0)
+    {
+        /* NOP */
+    }
+
+    /*!
+     * Dump at exit. The tracer is made when the library loads,
+     * so the message facility may be gone by now: use std::cerr.
+     */
+    ~packet_tracer(void){
+        if (not packet_trace_enabled) return;
+        packet_trace_enabled = false;
+        try{
+            this->dump("");
+        }
+        catch(const std::exception &e){
+            std::cerr << "Writing the packet trace failed: " << e.what() << std::endl;
+        }
+    }
+
+    void enable(const std::string &path, const size_t ring_size){
+        boost::mutex::scoped_lock lock(_mutex);
+        _path = path;
+        //round up to a power of two for the ring index mask
+        _ring_size = 1;
+        while (_ring_size < ring_size) _ring_size *= 2;
+        _start_ticks = trace_ticks();
+        _start_secs = time_spec_t::get_system_time().get_real_secs();
+    }
+
+    trace_ring *make_ring(void){
+        boost::mutex::scoped_lock lock(_mutex);
+        _rings.push_back(trace_ring::sptr(new trace_ring(_rings.size(), _ring_size)));
+        thread_ring.reset(_rings.back().get());
+        return _rings.back().get();
+    }
+
+    //! Dump all rings, return the number of threads
+    size_t dump(const std::string &path){
+        boost::mutex::scoped_lock lock(_mutex);
+        const std::string file_path = path.empty()? _path : path;
+        std::ofstream out(file_path.c_str(), std::ios::binary | std::ios::trunc);
+        if (not out) throw uhd::io_error("cannot open the packet trace file " + file_path);
+
+        packet_trace_file_header_t header;
+        std::memcpy(header.magic, PACKET_TRACE_MAGIC, sizeof(header.magic));
+        header.version = PACKET_TRACE_VERSION;
+        header.num_threads = boost::uint32_t(_rings.size());
+        header.start_ticks = _start_ticks;
+        header.ticks_per_sec = 1e9;
+        #ifdef HAVE_TRACE_TSC
+        //calibrate the time stamp counter against the system time
+        const double elapsed = time_spec_t::get_system_time().get_real_secs() - _start_secs;
+        if (elapsed > 0.0) header.ticks_per_sec = double(trace_ticks() - _start_ticks)/elapsed;
+        #endif
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+        for (size_t i = 0; i < _rings.size(); i++){
+            _rings[i]->write(out);
+        }
+        if (not out) throw uhd::io_error("cannot write the packet trace file " + file_path);
+        return _rings.size();
+    }
+
+    boost::thread_specific_ptr<trace_ring> thread_ring;
+
+private:
+    boost::mutex _mutex;
+    std::string _path;
+    size_t _ring_size;
+    boost::uint64_t _start_ticks;
+    double _start_secs;
+    std::vector<trace_ring::sptr> _rings;
+};
+
+UHD_SINGLETON_FCN(packet_tracer, get_tracer);
+
+UHD_STATIC_BLOCK(packet_trace_enable){
+    const char *path = std::getenv("UHD_TRACE_FILE");
+    if (path == NULL or path[0] == '\0') return;
+    const char *size = std::getenv("UHD_TRACE_SIZE");
+    get_tracer().enable(path, (size == NULL)? DEFAULT_TRACE_SIZE : boost::lexical_cast<size_t>(size));
+    packet_trace_enabled = true;
+}
+
+/***********************************************************************
+ * Public calls
+ **********************************************************************/
+void uhd::transport::packet_trace_record(
+    const packet_trace_event_t event,
+    const size_t chan,
+    const boost::uint32_t arg0,
+    const boost::uint64_t arg1
+){
+    packet_tracer &tracer = get_tracer();
+    trace_ring *ring = tracer.thread_ring.get();
+    if (ring == NULL) ring = tracer.make_ring();
+    packet_trace_record_t &record = ring->next();
+    record.ticks = trace_ticks();
+    record.event = boost::uint16_t(event);
+    record.chan = boost::uint16_t(chan);
+    record.arg0 = arg0;
+    record.arg1 = arg1;
+    ring->commit();
+}
+
+void uhd::transport::packet_trace_dump(const std::string &path){
+    if (not packet_trace_enabled) return;
+    const size_t num_threads = get_tracer().dump(path);
+    UHD_MSG(status) << boost::format("Wrote the packet trace of %u threads") % num_threads << std::endl;
+}
@@ -0,0 +1,140 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_TRANSPORT_PACKET_TRACE_HPP
+#define INCLUDED_LIBUHD_TRANSPORT_PACKET_TRACE_HPP
+
+#include <uhd/config.hpp>
+#include <boost/cstdint.hpp>
+#include <string>
+
+/***********************************************************************
+ * Packet tracer:
+ * A flight recorder for the streaming paths.
+ *
+ * Every thread records fixed-size binary events into its own ring,
+ * with a time stamp from the CPU time stamp counter. A full ring
+ * overwrites its oldest events, so the rings hold the last events
+ * before the dump. Recording an event is a few stores; when tracing
+ * is off, it is a test of a flag.
+ *
+ * Tracing is enabled at runtime by setting the environment variable
+ * UHD_TRACE_FILE to the path of the dump file. The rings are dumped
+ * into the file when the process exits or on packet_trace_dump().
+ * UHD_TRACE_SIZE sets the number of events per thread (default 65536).
+ * The uhd_trace_dump utility converts a dump to a Chrome trace or CSV.
+ **********************************************************************/
+namespace uhd{ namespace transport{
+
+//! The events of the tracer, the numbers are part of the file format
+enum packet_trace_event_t{
+    TRACE_RECV_ENTER        = 1,  //arg0: samples requested
+    TRACE_RECV_EXIT         = 2,  //arg0: samples received, arg1: error code
+    TRACE_RECV_PACKET       = 3,  //arg0: sequence number, arg1: time in ticks
+    TRACE_RECV_SEQ_ERROR    = 4,  //arg0: expected sequence, arg1: received sequence
+    TRACE_RECV_OVERFLOW     = 5,  //arg0: sequence number, arg1: time in ticks
+    TRACE_RECV_FC_UPDATE    = 6,  //arg0: sequence number, arg1: packets to the next update
+    TRACE_SEND_ENTER        = 7,  //arg0: samples to send
+    TRACE_SEND_EXIT         = 8,  //arg0: samples sent
+    TRACE_SEND_PACKET       = 9,  //arg0: sequence number, arg1: time in ticks
+    TRACE_XFER_SUBMIT       = 10, //chan: 1 for receive, arg0: transfer index, arg1: length
+    TRACE_XFER_COMPLETE     = 11  //chan: 1 for receive, arg0: transfer index, arg1: status << 32 | actual length
+};
+
+//! Get the name of a trace event
+static inline const char *packet_trace_event_name(const unsigned event){
+    switch(event){
+    case TRACE_RECV_ENTER:     return "recv_enter";
+    case TRACE_RECV_EXIT:      return "recv_exit";
+    case TRACE_RECV_PACKET:    return "recv_packet";
+    case TRACE_RECV_SEQ_ERROR: return "recv_seq_error";
+    case TRACE_RECV_OVERFLOW:  return "recv_overflow";
+    case TRACE_RECV_FC_UPDATE: return "recv_fc_update";
+    case TRACE_SEND_ENTER:     return "send_enter";
+    case TRACE_SEND_EXIT:      return "send_exit";
+    case TRACE_SEND_PACKET:    return "send_packet";
+    case TRACE_XFER_SUBMIT:    return "xfer_submit";
+    case TRACE_XFER_COMPLETE:  return "xfer_complete";
+    default:                   return "unknown";
+    }
+}
+
+/***********************************************************************
+ * Dump file format, in the byte order of the host that made it:
+ * the file header, then for every thread a thread header
+ * followed by its events, oldest first.
+ **********************************************************************/
+static const char PACKET_TRACE_MAGIC[8] = {'U','H','D','T','R','A','C','E'};
+static const boost::uint32_t PACKET_TRACE_VERSION = 1;
+
+struct packet_trace_file_header_t{
+    char magic[8];
+    boost::uint32_t version;
+    boost::uint32_t num_threads;
+    double ticks_per_sec;       //rate of the time stamps
+    boost::uint64_t start_ticks;//time stamp when tracing was enabled
+};
+
+struct packet_trace_thread_header_t{
+    boost::uint64_t thread_index;   //in the order the threads first recorded
+    boost::uint64_t num_records;
+    boost::uint64_t num_overwritten;//events lost to the ring wrapping
+};
+
+struct packet_trace_record_t{
+    boost::uint64_t ticks;
+    boost::uint16_t event;
+    boost::uint16_t chan;
+    boost::uint32_t arg0;
+    boost::uint64_t arg1;
+};
+
+/***********************************************************************
+ * Recording
+ **********************************************************************/
+//! True when tracing is enabled, set once when the library loads
+UHD_API extern bool packet_trace_enabled;
+
+//! Record an event into the ring of the calling thread
+UHD_API void packet_trace_record(
+    const packet_trace_event_t event,
+    const size_t chan,
+    const boost::uint32_t arg0,
+    const boost::uint64_t arg1
+);
+
+//! Record an event when tracing is enabled
+UHD_INLINE void packet_trace(
+    const packet_trace_event_t event,
+    const size_t chan,
+    const boost::uint32_t arg0 = 0,
+    const boost::uint64_t arg1 = 0
+){
+    if (packet_trace_enabled) packet_trace_record(event, chan, arg0, arg1);
+}
+
+/*!
+ * Dump the rings of all threads into a file.
+ * The threads keep recording; an event being recorded during the dump
+ * may be torn. Does nothing when tracing is disabled.
+ * \param path the dump file, empty for the UHD_TRACE_FILE path
+ */
+UHD_API void packet_trace_dump(const std::string &path = "");
+
+}} //namespace uhd::transport
+
+#endif /* INCLUDED_LIBUHD_TRANSPORT_PACKET_TRACE_HPP */
@@ -0,0 +1,274 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_TRANSPORT_RX_FC_TUNER_HPP
+#define INCLUDED_LIBUHD_TRANSPORT_RX_FC_TUNER_HPP
+
+#include <uhd/config.hpp>
+#include <uhd/stream.hpp>
+#include <uhd/utils/atomic.hpp>
+#include <uhd/utils/tasks.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <algorithm>
+
+namespace uhd{ namespace transport{ namespace sph{
+
+static const size_t RX_FC_MIN_UPDATES_PER_WINDOW    = 4;
+static const size_t RX_FC_MAX_UPDATES_PER_WINDOW    = 128;
+static const size_t RX_FC_QUIET_UPDATES             = 32;  //updates before growing the window
+static const size_t RX_FC_CEILING_QUIET_PERIODS     = 8;   //quiet periods at the cap before raising it
+
+/***********************************************************************
+ * RX flow control tuner
+ *
+ * The device may have at most one window of packets in flight
+ * to the host. The tuner adapts the window and the number of updates
+ * per window to what the host actually does with the packets:
+ *
+ *  - A dropped packet (sequence error) means the window is larger than
+ *    the buffers between device and host. Halve the window and cap
+ *    its growth at 7/8 of the window that dropped.
+ *  - An overflow means the device stalled on the window. Send updates
+ *    twice as often and grow the window by 1/8.
+ *  - The unread packets (the backlog) are estimated from the age of
+ *    each packet at an update: the host time minus the packet time,
+ *    less the smallest age seen, which absorbs the clock offset.
+ *    When the backlog fills over 3/4 of the window, the device is
+ *    about to stall: send updates more often.
+ *  - After a quiet period with the backlog under 1/4 of the window,
+ *    grow the window by 1/16 and send updates less often.
+ *    After several quiet periods at the cap, raise the cap by 1/16
+ *    toward the max window, so a burst of losses does not pin
+ *    the window to its floor for good.
+ *
+ * update() and the event calls are made by the receiving thread.
+ * The state is kept in atomics so get_stats() may be called by any thread.
+ **********************************************************************/
+class rx_fc_tuner : boost::noncopyable{
+public:
+    typedef boost::shared_ptr<rx_fc_tuner> sptr;
+    typedef boost::function<void(const size_t)> set_window_type;
+
+    /*!
+     * Make a new tuner.
+     * The caller advertises the initial window to the device.
+     * \param window the initial window in packets
+     * \param max_window the window that fills the host buffers
+     * \param updates_per_window the initial number of updates per window
+     * \param set_window a callback to advertise a new window to the device
+     */
+    rx_fc_tuner(
+        const size_t window,
+        const size_t max_window,
+        const size_t updates_per_window,
+        const set_window_type &set_window
+    ):
+        _min_window(std::max<size_t>(1, window/8)),
+        _max_window(std::max(window, max_window)),
+        _set_window(set_window),
+        _window(window),
+        _ceiling(_max_window),
+        _updates_per_window(std::min(std::max(updates_per_window, RX_FC_MIN_UPDATES_PER_WINDOW), RX_FC_MAX_UPDATES_PER_WINDOW)),
+        _have_baseline(false),
+        _baseline(0.0),
+        _quiet_updates(0),
+        _ceiling_quiet_periods(0),
+        _pending_overflow(false),
+        _pending_drop(false)
+    {
+        _stat_window.write(boost::uint32_t(_window));
+        _stat_interval.write(boost::uint32_t(this->get_update_interval()));
+        _stat_fill_ppm.write(0);
+        _stat_adjustments.write(0);
+    }
+
+    //! The number of packets between updates for the current state
+    size_t get_update_interval(void) const
+    {
+        //the interval must fit the 12 bit sequence number
+        return std::min<size_t>(std::max<size_t>(1, _window/_updates_per_window), 0xfff);
+    }
+
+    //! Note a dropped packet
+    void on_drop(void)
+    {
+        _pending_drop = true;
+    }
+
+    //! Note an overflow reported by the device
+    void on_overflow(void)
+    {
+        _pending_overflow = true;
+    }
+
+    /*!
+     * Run the controller at a flow control update.
+     * \param age_secs host time minus the time of the packet
+     * \param packet_secs the time span of one packet
+     * \return the number of packets until the next update
+     */
+    size_t update(const double age_secs, const double packet_secs)
+    {
+        //track the smallest age, let it drift up slowly for clock drift
+        if (not _have_baseline or age_secs < _baseline){
+            _baseline = age_secs;
+            _have_baseline = true;
+        }
+        else _baseline += (age_secs - _baseline)/1024;
+
+        double fill = 0.0;
+        if (packet_secs > 0.0){
+            fill = (age_secs - _baseline)/packet_secs/_window;
+            //a jump of the device time looks like a huge backlog
+            if (fill > 4.0){
+                _baseline = age_secs;
+                fill = 0.0;
+            }
+        }
+        _stat_fill_ppm.write(boost::uint32_t(std::min(fill, 1.0)*1e6));
+
+        const size_t old_window = _window;
+        const size_t old_updates = _updates_per_window;
+
+        if (_pending_drop){
+            _ceiling = std::max(_min_window, _window - _window/8);
+            _window = std::max(_min_window, _window/2);
+            _quiet_updates = 0;
+            _ceiling_quiet_periods = 0;
+        }
+        else if (_pending_overflow){
+            _updates_per_window = std::min(_updates_per_window*2, RX_FC_MAX_UPDATES_PER_WINDOW);
+            _window = std::min(_ceiling, _window + std::max<size_t>(1, _window/8));
+            _quiet_updates = 0;
+        }
+        else if (fill > 0.75){
+            _updates_per_window = std::min(_updates_per_window + _updates_per_window/4, RX_FC_MAX_UPDATES_PER_WINDOW);
+            _quiet_updates = 0;
+        }
+        else if (fill < 0.25 and ++_quiet_updates >= RX_FC_QUIET_UPDATES){
+            _updates_per_window = std::max(_updates_per_window - _updates_per_window/8, RX_FC_MIN_UPDATES_PER_WINDOW);
+            if (_window == _ceiling and _ceiling < _max_window and ++_ceiling_quiet_periods >= RX_FC_CEILING_QUIET_PERIODS){
+                _ceiling = std::min(_max_window, _ceiling + std::max<size_t>(1, _ceiling/16));
+                _ceiling_quiet_periods = 0;
+            }
+            _window = std::min(_ceiling, _window + std::max<size_t>(1, _window/16));
+            _quiet_updates = 0;
+        }
+        _pending_drop = false;
+        _pending_overflow = false;
+
+        if (_window != old_window){
+            _set_window(_window);
+            _stat_window.write(boost::uint32_t(_window));
+        }
+        if (_window != old_window or _updates_per_window != old_updates){
+            _stat_adjustments.inc();
+        }
+        const size_t interval = this->get_update_interval();
+        _stat_interval.write(boost::uint32_t(interval));
+        return interval;
+    }
+
+    //! Fill the flow control fields of the statistics
+    void get_stats(stream_stats_t &stats) const
+    {
+        stats.fc_window = _stat_window.read();
+        stats.fc_update_interval = _stat_interval.read();
+        stats.fc_window_fill = _stat_fill_ppm.read()/1e6;
+        stats.fc_adjustments = _stat_adjustments.read();
+    }
+
+private:
+    const size_t _min_window, _max_window;
+    const set_window_type _set_window;
+
+    //state of the receiving thread
+    size_t _window, _ceiling, _updates_per_window;
+    bool _have_baseline;
+    double _baseline;
+    size_t _quiet_updates, _ceiling_quiet_periods;
+    bool _pending_overflow, _pending_drop;
+
+    //snapshot for other threads
+    mutable atomic_uint32_t _stat_window, _stat_interval, _stat_fill_ppm, _stat_adjustments;
+};
+
+/***********************************************************************
+ * RX flow control window applier
+ *
+ * The tuner runs in the receiving thread, which must not write the
+ * device: a register write waits for its ack, and for the timed
+ * commands queued ahead of it in the command FIFO.
+ * The applier keeps the latest window, and a thread of its own
+ * advertises it to the device. Windows that change faster than
+ * the writes complete are skipped, only the latest one is written.
+ **********************************************************************/
+class rx_fc_window_applier : boost::noncopyable{
+public:
+    typedef boost::shared_ptr<rx_fc_window_applier> sptr;
+    typedef rx_fc_tuner::set_window_type set_window_type;
+
+    /*!
+     * Make a new applier.
+     * \param set_window a callback to advertise a new window to the device
+     */
+    rx_fc_window_applier(const set_window_type &set_window):
+        _set_window(set_window), _window(0), _applied(0)
+    {
+        _task = task::make(boost::bind(&rx_fc_window_applier::apply_loop, this));
+    }
+
+    ~rx_fc_window_applier(void)
+    {
+        _task.reset();
+    }
+
+    //! Note a new window, the write happens in the applier thread
+    void set_window(const size_t window)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _window = window;
+        _cond.notify_one();
+    }
+
+private:
+    void apply_loop(void)
+    {
+        size_t window = 0;
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            while (_window == _applied) _cond.wait(lock);
+            window = _applied = _window;
+        }
+        _set_window(window);
+    }
+
+    const set_window_type _set_window;
+    boost::mutex _mutex;
+    boost::condition_variable _cond;
+    size_t _window, _applied;
+    task::sptr _task;
+};
+
+}}} //namespace uhd::transport::sph
+
+#endif /* INCLUDED_LIBUHD_TRANSPORT_RX_FC_TUNER_HPP */
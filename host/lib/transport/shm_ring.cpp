@@ -0,0 +1,580 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "shm_ring_publisher.hpp"
+#include "super_recv_packet_handler.hpp"
+#include <uhd/transport/shm_ring.hpp>
+#include <uhd/transport/buffer_pool.hpp>
+#include <uhd/utils/atomic.hpp>
+#include <uhd/utils/msg.hpp>
+#include <uhd/exception.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/detail/os_thread_functions.hpp>
+#include <boost/format.hpp>
+#include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/thread.hpp> //sleep
+#include <cstring>
+#include <vector>
+
+#ifdef UHD_PLATFORM_WIN32
+#include <windows.h>
+#else
+#include <signal.h>
+#include <cerrno>
+#endif
+
+using namespace uhd;
+using namespace uhd::transport;
+namespace ip = boost::interprocess;
+
+static const boost::uint32_t SHM_RING_MAGIC = 0x75686402; //"uhd" + version
+static const size_t SHM_DEFAULT_NUM_SLOTS = 1024;
+static const size_t SHM_NUM_READER_FRAMES = 16;
+static const size_t SHM_HDR_ALIGN = 64;
+
+//! How long a reader sleeps when the ring has no new packet
+static const boost::posix_time::time_duration SHM_POLL_INTERVAL = boost::posix_time::microseconds(50);
+
+/***********************************************************************
+ * Shared memory layout:
+ *  - the ring header, padded to SHM_HDR_ALIGN bytes
+ *  - num_slots slots of slot_stride bytes each
+ * A slot holds its sequence number, a packet header and the payload.
+ **********************************************************************/
+struct shm_ring_header_t
+{
+    boost::uint32_t magic; //written last by the publisher
+    boost::uint32_t num_slots; //a power of two
+    boost::uint32_t slot_size; //bytes of packet header and payload
+    boost::uint32_t slot_stride;
+    char otw_format[32];
+    double tick_rate;
+    double samp_rate;
+    uhd::atomic_uint32_t write_seq; //sequence number of the next packet
+    uhd::atomic_uint32_t closed;
+    boost::uint32_t owner_pid; //the process of the publisher
+};
+
+static const size_t SHM_SLOTS_OFFSET =
+    ((sizeof(shm_ring_header_t) + SHM_HDR_ALIGN - 1)/SHM_HDR_ALIGN)*SHM_HDR_ALIGN;
+
+//! The packet header of a slot, also the header of the reader packets
+struct shm_packet_hdr_t
+{
+    boost::uint32_t packet_type;
+    boost::uint32_t packet_count;
+    boost::uint32_t flags;
+    boost::uint32_t num_payload_words32;
+    boost::uint64_t tsf;
+    double tick_rate;
+};
+
+static const boost::uint32_t SHM_FLAG_SOB = (1 << 0);
+static const boost::uint32_t SHM_FLAG_EOB = (1 << 1);
+static const boost::uint32_t SHM_FLAG_HAS_TSF = (1 << 2);
+
+static const size_t SHM_HDR_WORDS32 = sizeof(shm_packet_hdr_t)/sizeof(boost::uint32_t);
+
+//! The slot sequence number precedes the packet
+static const size_t SHM_SLOT_PKT_OFFSET = 8;
+
+//! The slot sequence number of a packet: odd while it is written
+static UHD_INLINE boost::uint32_t shm_slot_seq(const boost::uint32_t seq)
+{
+    return seq*2;
+}
+
+//! A full memory barrier: a read-modify-write is one on every platform
+static UHD_INLINE void shm_full_barrier(void)
+{
+    uhd::atomic_uint32_t barrier;
+    barrier.inc();
+}
+
+//! Check if a process still runs
+static bool shm_process_alive(const boost::uint32_t pid)
+{
+#ifdef UHD_PLATFORM_WIN32
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, DWORD(pid));
+    if (process == NULL) return false;
+    const bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+    CloseHandle(process);
+    return alive;
+#else
+    return ::kill(pid_t(pid), 0) == 0 or errno == EPERM;
+#endif
+}
+
+static std::string shm_ring_name(const std::string &name, const size_t chan)
+{
+    return str(boost::format("uhd.%s.%u") % name % chan);
+}
+
+/***********************************************************************
+ * Publisher: writes every packet into the next slot
+ *
+ * A seqlock per slot: the slot sequence number is made odd, then the
+ * packet is written, then the sequence number is published even, and
+ * the ring sequence number after it. Full barriers separate the steps,
+ * so a reader that finds the published sequence number unchanged
+ * around its copy has a whole packet.
+ **********************************************************************/
+class shm_ring_writer : boost::noncopyable
+{
+public:
+    typedef boost::shared_ptr<shm_ring_writer> sptr;
+
+    shm_ring_writer(
+        const std::string &name,
+        const size_t num_slots,
+        const size_t slot_size,
+        const std::string &otw_format,
+        const double tick_rate,
+        const double samp_rate
+    ):
+        _name(name), _seq(0), _warned(false)
+    {
+        size_t slots = 1;
+        while (slots < num_slots) slots *= 2;
+        const size_t stride = ((SHM_SLOT_PKT_OFFSET + slot_size + SHM_HDR_ALIGN - 1)/SHM_HDR_ALIGN)*SHM_HDR_ALIGN;
+
+        //a stale ring of a publisher that crashed is replaced,
+        //the ring of a running publisher is not
+        this->remove_stale_ring();
+        try
+        {
+            ip::shared_memory_object shm(ip::create_only, _name.c_str(), ip::read_write);
+            shm.truncate(SHM_SLOTS_OFFSET + slots*stride);
+            _region = ip::mapped_region(shm, ip::read_write);
+        }
+        catch(const ip::interprocess_exception &ex)
+        {
+            throw uhd::io_error(str(boost::format(
+                "Cannot create shared memory ring %s: %s") % _name % ex.what()));
+        }
+        std::memset(_region.get_address(), 0, _region.get_size());
+
+        _hdr = reinterpret_cast<shm_ring_header_t *>(_region.get_address());
+        _slots = reinterpret_cast<char *>(_region.get_address()) + SHM_SLOTS_OFFSET;
+        _mask = slots - 1;
+        _stride = stride;
+        _slot_size = slot_size;
+        _hdr->num_slots = boost::uint32_t(slots);
+        _hdr->slot_size = boost::uint32_t(slot_size);
+        _hdr->slot_stride = boost::uint32_t(stride);
+        std::strncpy(_hdr->otw_format, otw_format.c_str(), sizeof(_hdr->otw_format) - 1);
+        _hdr->tick_rate = tick_rate;
+        _hdr->samp_rate = samp_rate;
+        _hdr->write_seq.write(0);
+        _hdr->closed.write(0);
+        _hdr->owner_pid = boost::uint32_t(ip::ipcdetail::get_current_process_id());
+        _hdr->magic = SHM_RING_MAGIC;
+    }
+
+    ~shm_ring_writer(void)
+    {
+        _hdr->closed.write(1);
+        //readers keep their mapping, new readers cannot open the ring
+        ip::shared_memory_object::remove(_name.c_str());
+    }
+
+    void publish(const vrt::if_packet_info_t &ifpi, const boost::uint32_t *vrt_hdr, const double tick_rate)
+    {
+        const size_t payload_bytes = ifpi.num_payload_words32*sizeof(boost::uint32_t);
+        if (sizeof(shm_packet_hdr_t) + payload_bytes > _slot_size)
+        {
+            if (not _warned) UHD_MSG(warning) << boost::format(
+                "Shared memory ring %s: dropping a packet larger than a slot") % _name << std::endl;
+            _warned = true;
+            return;
+        }
+
+        char *slot = _slots + (_seq & _mask)*_stride;
+        uhd::atomic_uint32_t *slot_seq = reinterpret_cast<uhd::atomic_uint32_t *>(slot);
+        slot_seq->write(shm_slot_seq(_seq) + 1);
+        shm_full_barrier(); //the odd mark before the packet
+
+        shm_packet_hdr_t *hdr = reinterpret_cast<shm_packet_hdr_t *>(slot + SHM_SLOT_PKT_OFFSET);
+        hdr->packet_type = boost::uint32_t(ifpi.packet_type);
+        hdr->packet_count = ifpi.packet_count;
+        hdr->flags = (ifpi.sob? SHM_FLAG_SOB : 0) | (ifpi.eob? SHM_FLAG_EOB : 0) | (ifpi.has_tsf? SHM_FLAG_HAS_TSF : 0);
+        hdr->num_payload_words32 = boost::uint32_t(ifpi.num_payload_words32);
+        hdr->tsf = ifpi.tsf;
+        hdr->tick_rate = tick_rate;
+        std::memcpy(hdr + 1, vrt_hdr + ifpi.num_header_words32, payload_bytes);
+
+        //the write has a barrier before the store: the packet before the publish
+        slot_seq->write(shm_slot_seq(_seq));
+        _seq++;
+        _hdr->write_seq.write(_seq);
+    }
+
+private:
+    //! Remove a ring left by a publisher that is gone, throw if the publisher runs
+    void remove_stale_ring(void)
+    {
+        try
+        {
+            ip::shared_memory_object shm(ip::open_only, _name.c_str(), ip::read_only);
+            ip::mapped_region region(shm, ip::read_only);
+            shm_ring_header_t *hdr = reinterpret_cast<shm_ring_header_t *>(region.get_address());
+            if (region.get_size() >= sizeof(shm_ring_header_t) and hdr->magic == SHM_RING_MAGIC and
+                hdr->closed.read() == 0 and shm_process_alive(hdr->owner_pid)
+            ){
+                throw uhd::io_error(str(boost::format(
+                    "Shared memory ring %s is in use by process %u") % _name % hdr->owner_pid));
+            }
+        }
+        catch(const ip::interprocess_exception &)
+        {
+            //no ring or not readable: nothing to keep
+        }
+        ip::shared_memory_object::remove(_name.c_str());
+    }
+
+    const std::string _name;
+    ip::mapped_region _region;
+    shm_ring_header_t *_hdr;
+    char *_slots;
+    size_t _mask, _stride, _slot_size;
+    boost::uint32_t _seq;
+    bool _warned;
+};
+
+void uhd::transport::shm_ring_publish_rx_stream(
+    rx_streamer::sptr streamer,
+    const stream_args_t &args,
+    const double samp_rate
+){
+    if (not args.args.has_key("shm_name")) return;
+    boost::shared_ptr<sph::recv_packet_streamer> my_streamer =
+        boost::dynamic_pointer_cast<sph::recv_packet_streamer>(streamer);
+    if (not my_streamer)
+    {
+        throw uhd::not_implemented_error("shm_name: the RX streamer of this device cannot be published");
+    }
+
+    const size_t num_slots = args.args.cast<size_t>("shm_num_slots", SHM_DEFAULT_NUM_SLOTS);
+    const size_t bpi = convert::get_bytes_per_item(my_streamer->get_otw_format());
+    const size_t slot_size = sizeof(shm_packet_hdr_t) + my_streamer->get_max_num_samps()*bpi;
+
+    for (size_t chan = 0; chan < my_streamer->get_num_channels(); chan++)
+    {
+        const std::string name = shm_ring_name(args.args["shm_name"], chan);
+        shm_ring_writer::sptr writer(new shm_ring_writer(
+            name, num_slots, slot_size, my_streamer->get_otw_format(),
+            my_streamer->get_tick_rate(), samp_rate
+        ));
+        //the streamer owns the writer, the ring goes away with the streamer
+        my_streamer->set_xport_chan_publish(chan, boost::bind(&shm_ring_writer::publish, writer, _1, _2, _3));
+        UHD_MSG(status) << "Publishing RX channel " << chan << " to shared memory " << name << std::endl;
+    }
+}
+
+/***********************************************************************
+ * Reader packets:
+ * The reader copies a packet out of its slot into a local frame,
+ * numbers the data packets itself, and makes an overflow message
+ * when the publisher overwrote packets it did not read.
+ **********************************************************************/
+static void shm_if_hdr_unpack(
+    const boost::uint32_t *packet_buff,
+    vrt::if_packet_info_t &if_packet_info
+){
+    const shm_packet_hdr_t *hdr = reinterpret_cast<const shm_packet_hdr_t *>(packet_buff);
+    //CHDR for the 12 bit sequence numbers
+    if_packet_info.link_type = vrt::if_packet_info_t::LINK_TYPE_CHDR;
+    if_packet_info.packet_type = vrt::if_packet_info_t::packet_type_t(hdr->packet_type);
+    if_packet_info.packet_count = hdr->packet_count;
+    if_packet_info.sob = (hdr->flags & SHM_FLAG_SOB) != 0;
+    if_packet_info.eob = (hdr->flags & SHM_FLAG_EOB) != 0;
+    if_packet_info.has_tsf = (hdr->flags & SHM_FLAG_HAS_TSF) != 0;
+    if_packet_info.tsf = hdr->tsf;
+    if_packet_info.has_sid = false;
+    if_packet_info.has_cid = false;
+    if_packet_info.has_tsi = false;
+    if_packet_info.has_tlr = false;
+    if_packet_info.num_header_words32 = SHM_HDR_WORDS32;
+    if_packet_info.num_payload_words32 = hdr->num_payload_words32;
+    if_packet_info.num_payload_bytes = hdr->num_payload_words32*sizeof(boost::uint32_t);
+    if (if_packet_info.num_packet_words32 < SHM_HDR_WORDS32 + hdr->num_payload_words32)
+    {
+        throw uhd::value_error("bad shared memory packet: bad packet length");
+    }
+    if_packet_info.num_packet_words32 = SHM_HDR_WORDS32 + hdr->num_payload_words32;
+}
+
+class shm_ring_mrb : public managed_recv_buffer
+{
+public:
+    shm_ring_mrb(void *mem):
+        _mem(mem)
+    {
+        /* NOP */
+    }
+
+    void release(void)
+    {
+        _claimer.release();
+    }
+
+    UHD_INLINE bool claim(const double timeout)
+    {
+        return _claimer.claim_with_wait(timeout);
+    }
+
+    UHD_INLINE sptr get_new(const size_t len)
+    {
+        return make(this, _mem, len);
+    }
+
+    void *mem(void)
+    {
+        return _mem;
+    }
+
+private:
+    void *_mem;
+    simple_claimer _claimer;
+};
+
+class shm_ring_reader : public virtual zero_copy_if
+{
+public:
+    typedef boost::shared_ptr<shm_ring_reader> sptr;
+
+    shm_ring_reader(const std::string &name):
+        _name(name), _count(0), _next_recv_buff_index(0)
+    {
+        try
+        {
+            ip::shared_memory_object shm(ip::open_only, _name.c_str(), ip::read_only);
+            _region = ip::mapped_region(shm, ip::read_only);
+        }
+        catch(const ip::interprocess_exception &ex)
+        {
+            throw uhd::io_error(str(boost::format(
+                "Cannot open shared memory ring %s: %s") % _name % ex.what()));
+        }
+        _hdr = reinterpret_cast<shm_ring_header_t *>(_region.get_address());
+        if (_region.get_size() < SHM_SLOTS_OFFSET or _hdr->magic != SHM_RING_MAGIC or
+            _region.get_size() < SHM_SLOTS_OFFSET + size_t(_hdr->num_slots)*_hdr->slot_stride
+        ){
+            throw uhd::io_error(str(boost::format(
+                "Shared memory ring %s is not a UHD ring of this version") % _name));
+        }
+        _slots = reinterpret_cast<char *>(_region.get_address()) + SHM_SLOTS_OFFSET;
+        _num_slots = _hdr->num_slots;
+        _mask = _num_slots - 1;
+        _stride = _hdr->slot_stride;
+        _frame_size = _hdr->slot_size;
+        _tick_rate = _hdr->tick_rate;
+
+        //start with the newest packet
+        _seq = _hdr->write_seq.read();
+
+        _buffer_pool = buffer_pool::make(SHM_NUM_READER_FRAMES, _frame_size);
+        for (size_t i = 0; i < SHM_NUM_READER_FRAMES; i++)
+        {
+            _mrbs.push_back(boost::make_shared<shm_ring_mrb>(_buffer_pool->at(i)));
+        }
+    }
+
+    std::string get_otw_format(void) const
+    {
+        return std::string(_hdr->otw_format); //zero terminated by the publisher
+    }
+
+    double get_tick_rate(void) const
+    {
+        return _tick_rate;
+    }
+
+    double get_samp_rate(void) const
+    {
+        return _hdr->samp_rate;
+    }
+
+    size_t get_max_num_samps(void) const
+    {
+        return (_frame_size - sizeof(shm_packet_hdr_t))/
+            convert::get_bytes_per_item(this->get_otw_format());
+    }
+
+    managed_recv_buffer::sptr get_recv_buff(double timeout)
+    {
+        const time_spec_t exit_time = time_spec_t::get_system_time() + time_spec_t(timeout);
+        shm_ring_mrb &mrb = *_mrbs[_next_recv_buff_index];
+        if (not mrb.claim(timeout)) return managed_recv_buffer::sptr();
+        shm_packet_hdr_t *out = reinterpret_cast<shm_packet_hdr_t *>(mrb.mem());
+
+        while (true)
+        {
+            const boost::uint32_t write_seq = _hdr->write_seq.read();
+            if (write_seq == _seq)
+            {
+                if (time_spec_t::get_system_time() >= exit_time) break;
+                boost::this_thread::sleep(SHM_POLL_INTERVAL);
+                continue;
+            }
+
+            //copy the packet out, then check that it was not overwritten
+            char *slot = _slots + (_seq & _mask)*_stride;
+            uhd::atomic_uint32_t *slot_seq = reinterpret_cast<uhd::atomic_uint32_t *>(slot);
+            const shm_packet_hdr_t *hdr = reinterpret_cast<const shm_packet_hdr_t *>(slot + SHM_SLOT_PKT_OFFSET);
+            //the read has a barrier after the load: the check before the copy
+            bool ok = boost::uint32_t(write_seq - _seq) <= _num_slots and slot_seq->read() == shm_slot_seq(_seq);
+            size_t len = 0;
+            if (ok)
+            {
+                len = sizeof(shm_packet_hdr_t) + std::min<size_t>(
+                    hdr->num_payload_words32*sizeof(boost::uint32_t), _frame_size - sizeof(shm_packet_hdr_t));
+                std::memcpy(out, hdr, len);
+                shm_full_barrier(); //the copy before the check
+                ok = slot_seq->read() == shm_slot_seq(_seq);
+            }
+
+            //the publisher lapped this reader: continue with the newest packet
+            if (not ok)
+            {
+                _seq = _hdr->write_seq.read();
+                out->packet_type = boost::uint32_t(vrt::if_packet_info_t::PACKET_TYPE_CONTEXT);
+                out->packet_count = 0;
+                out->flags = 0;
+                out->num_payload_words32 = 1;
+                out->tsf = 0;
+                reinterpret_cast<boost::uint32_t *>(out + 1)[0] = boost::uint32_t(rx_metadata_t::ERROR_CODE_OVERFLOW);
+                return this->next_buff(mrb, sizeof(shm_packet_hdr_t) + sizeof(boost::uint32_t));
+            }
+            _seq++;
+
+            if (out->packet_type == boost::uint32_t(vrt::if_packet_info_t::PACKET_TYPE_DATA))
+            {
+                out->packet_count = _count++ & 0xfff;
+            }
+            if (out->tick_rate != _tick_rate)
+            {
+                out->tsf = time_spec_t::from_ticks(out->tsf, out->tick_rate).to_ticks(_tick_rate);
+            }
+            return this->next_buff(mrb, len);
+        }
+
+        mrb.release(); //undo claim
+        return managed_recv_buffer::sptr(); //null for timeout
+    }
+
+    size_t get_num_recv_frames(void) const
+    {
+        return SHM_NUM_READER_FRAMES;
+    }
+
+    size_t get_recv_frame_size(void) const
+    {
+        return _frame_size;
+    }
+
+    //read-only: nothing to send
+    managed_send_buffer::sptr get_send_buff(double)
+    {
+        return managed_send_buffer::sptr();
+    }
+
+    size_t get_num_send_frames(void) const
+    {
+        return 0;
+    }
+
+    size_t get_send_frame_size(void) const
+    {
+        return 0;
+    }
+
+private:
+    UHD_INLINE managed_recv_buffer::sptr next_buff(shm_ring_mrb &mrb, const size_t len)
+    {
+        if (++_next_recv_buff_index == SHM_NUM_READER_FRAMES) _next_recv_buff_index = 0;
+        return mrb.get_new(len);
+    }
+
+    const std::string _name;
+    ip::mapped_region _region;
+    shm_ring_header_t *_hdr; //mapped read-only
+    char *_slots;
+    boost::uint32_t _num_slots, _mask;
+    size_t _stride, _frame_size;
+    double _tick_rate;
+    boost::uint32_t _seq, _count;
+
+    buffer_pool::sptr _buffer_pool;
+    std::vector<boost::shared_ptr<shm_ring_mrb> > _mrbs;
+    size_t _next_recv_buff_index;
+};
+
+/***********************************************************************
+ * Read-only receive streamer
+ **********************************************************************/
+rx_streamer::sptr shm_ring::make_rx_stream(
+    const std::string &name,
+    const stream_args_t &args_
+){
+    stream_args_t args = args_;
+    args.channels = args.channels.empty()? std::vector<size_t>(1, 0) : args.channels;
+
+    std::vector<shm_ring_reader::sptr> readers;
+    BOOST_FOREACH(const size_t chan, args.channels)
+    {
+        readers.push_back(boost::make_shared<shm_ring_reader>(shm_ring_name(name, chan)));
+        if (readers.back()->get_otw_format() != readers.front()->get_otw_format() or
+            readers.back()->get_tick_rate() != readers.front()->get_tick_rate()
+        ){
+            throw uhd::value_error(str(boost::format(
+                "Shared memory rings of %s have different formats") % name));
+        }
+    }
+    const std::string otw_format = readers.front()->get_otw_format();
+    if (not args.otw_format.empty() and otw_format.find(args.otw_format + "_") != 0)
+    {
+        throw uhd::value_error(str(boost::format(
+            "Shared memory ring %s has otw format %s") % name % otw_format));
+    }
+
+    boost::shared_ptr<sph::recv_packet_streamer> my_streamer =
+        boost::make_shared<sph::recv_packet_streamer>(readers.front()->get_max_num_samps());
+    my_streamer->resize(readers.size());
+    my_streamer->set_vrt_unpacker(&shm_if_hdr_unpack);
+    my_streamer->set_tick_rate(readers.front()->get_tick_rate());
+    my_streamer->set_samp_rate(readers.front()->get_samp_rate());
+
+    //set the converter
+    uhd::convert::id_type id;
+    id.input_format = otw_format;
+    id.num_inputs = 1;
+    id.output_format = args.cpu_format;
+    id.num_outputs = 1;
+    my_streamer->set_converter(id);
+
+    //no stream commands: the publisher controls the device
+    for (size_t i = 0; i < readers.size(); i++)
+    {
+        my_streamer->set_xport_chan_get_buff(i, boost::bind(&shm_ring_reader::get_recv_buff, readers[i], _1));
+    }
+
+    return my_streamer;
+}
@@ -0,0 +1,43 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_TRANSPORT_SHM_RING_PUBLISHER_HPP
+#define INCLUDED_LIBUHD_TRANSPORT_SHM_RING_PUBLISHER_HPP
+
+#include <uhd/config.hpp>
+#include <uhd/stream.hpp>
+
+namespace uhd{ namespace transport{
+
+/*!
+ * Publish the packets of an RX streamer to shared memory rings,
+ * one ring per channel, see uhd::transport::shm_ring.
+ * Nothing happens unless the stream args have shm_name.
+ * The stream arg shm_num_slots sets the packets per ring.
+ * \param streamer the RX streamer of a device
+ * \param args the stream args used to make the streamer
+ * \param samp_rate the sample rate of the stream
+ */
+UHD_API void shm_ring_publish_rx_stream(
+    rx_streamer::sptr streamer,
+    const stream_args_t &args,
+    const double samp_rate
+);
+
+}} //namespace
+
+#endif /* INCLUDED_LIBUHD_TRANSPORT_SHM_RING_PUBLISHER_HPP */
@@ -0,0 +1,254 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_TRANSPORT_STREAM_STATS_COUNTERS_HPP
+#define INCLUDED_LIBUHD_TRANSPORT_STREAM_STATS_COUNTERS_HPP
+
+#include <uhd/config.hpp>
+#include <uhd/stream.hpp>
+#include <uhd/types/metadata.hpp>
+#include <uhd/types/time_spec.hpp>
+#include <uhd/utils/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+
+namespace uhd{ namespace transport{ namespace sph{
+
+/***********************************************************************
+ * Statistics counter:
+ * A counter with a single writing thread at a time.
+ * Other threads may read the counter at any time.
+ *
+ * On the 64-bit targets, the 64-bit loads and stores are single
+ * instructions: adding is a plain load and store.
+ * On the 32-bit targets (E300), a 64-bit store is two stores and a
+ * reader could see half of it. The writer brackets the store with a
+ * sequence number that is odd while writing, and the reader retries
+ * until it sees the same even number before and after the value.
+ **********************************************************************/
+#if defined(__LP64__) || defined(_WIN64)
+
+class stats_counter{
+public:
+    stats_counter(void): _value(0){}
+
+    UHD_INLINE void add(const boost::uint64_t n){
+        _value = _value + n;
+    }
+
+    UHD_INLINE void inc(void){
+        _value = _value + 1;
+    }
+
+    UHD_INLINE boost::uint64_t read(void) const{
+        return _value;
+    }
+
+private:
+    volatile boost::uint64_t _value;
+};
+
+#else
+
+class stats_counter{
+public:
+    stats_counter(void): _value(0){}
+
+    UHD_INLINE void add(const boost::uint64_t n){
+        const boost::uint32_t seq = _seq.read();
+        //the swap orders the odd number before the value
+        _seq.cas(seq + 1, seq);
+        _value = _value + n;
+        //the write orders the value before the even number
+        _seq.write(seq + 2);
+    }
+
+    UHD_INLINE void inc(void){
+        this->add(1);
+    }
+
+    UHD_INLINE boost::uint64_t read(void) const{
+        while (true){
+            const boost::uint32_t seq = _seq.read();
+            if ((seq & 1) != 0) continue;
+            const boost::uint64_t value = _value;
+            //the swap never changes the number, it orders the value before the check
+            if (_seq.cas(0, 0) == seq) return value;
+        }
+    }
+
+private:
+    mutable atomic_uint32_t _seq;
+    volatile boost::uint64_t _value;
+};
+
+#endif
+
+//! Get a monotonic time in nanoseconds for the statistics
+static UHD_INLINE boost::uint64_t stats_time_nsecs(void){
+    const time_spec_t now = time_spec_t::get_system_time();
+    return boost::uint64_t(now.get_full_secs())*1000000000 + boost::uint64_t(now.get_frac_secs()*1e9);
+}
+
+/***********************************************************************
+ * Latency histogram:
+ * Bin N counts the calls that took 2^N to 2^(N+1) nanoseconds,
+ * the last bin counts all longer calls.
+ **********************************************************************/
+class stats_histogram : boost::noncopyable{
+public:
+    UHD_INLINE void add(boost::uint64_t nsecs){
+        size_t bin = 0;
+        while (nsecs >>= 1) bin++;
+        if (bin >= stream_stats_t::NUM_LATENCY_BINS) bin = stream_stats_t::NUM_LATENCY_BINS-1;
+        _bins[bin].inc();
+    }
+
+    void read(boost::uint64_t *bins) const{
+        for (size_t i = 0; i < stream_stats_t::NUM_LATENCY_BINS; i++){
+            bins[i] = _bins[i].read();
+        }
+    }
+
+private:
+    stats_counter _bins[stream_stats_t::NUM_LATENCY_BINS];
+};
+
+/***********************************************************************
+ * TX ack tracker:
+ * Times the packets of a TX channel from the send() call and the commit
+ * to the flow control acknowledgement of the device. The thread that
+ * commits the packets records them, the thread that holds the flow
+ * control matches the acks; a packet is recorded before it is sent,
+ * so its record is written before its ack can arrive.
+ * Each thread reads the count of the other one, so the counts are
+ * statistics counters, which cannot tear on the 32-bit targets.
+ **********************************************************************/
+class tx_ack_tracker : boost::noncopyable{
+public:
+    //! The acks carry the 12-bit sequence number of the packet header
+    static const size_t SEQ_MASK = 0xfff;
+
+    tx_ack_tracker(void): _window(0){}
+
+    //! Set the flow control window in packets, enables the occupancy
+    void set_window(const size_t window){
+        _window = window;
+    }
+
+    //! Record a packet, before it is committed
+    UHD_INLINE void sent(const boost::uint64_t send_nsecs, const boost::uint64_t commit_nsecs){
+        const boost::uint64_t num_sent = _num_sent.read();
+        record_type &record = _records[size_t(num_sent) & SEQ_MASK];
+        record.send_nsecs = send_nsecs;
+        record.commit_nsecs = commit_nsecs;
+        if (_window != 0){
+            const boost::uint64_t in_flight = num_sent - _num_acked.read();
+            size_t bin = size_t(in_flight*stream_stats_t::NUM_OCCUPANCY_BINS/_window);
+            if (bin >= stream_stats_t::NUM_OCCUPANCY_BINS) bin = stream_stats_t::NUM_OCCUPANCY_BINS-1;
+            _occupancy[bin].inc();
+        }
+        _num_sent.inc();
+    }
+
+    //! The device consumed the packets up to the sequence number
+    void acked(const boost::uint32_t seq){
+        const boost::uint64_t now = stats_time_nsecs();
+        const boost::uint64_t num_sent = _num_sent.read();
+        const boost::uint64_t old_num_acked = _num_acked.read();
+        //the newest sent packet with this sequence number
+        const boost::uint64_t num_acked = num_sent - ((num_sent - 1 - seq) & SEQ_MASK);
+        if (num_sent == 0 or num_acked <= old_num_acked) return; //repeated ack
+        for (boost::uint64_t i = old_num_acked; i < num_acked; i++){
+            const record_type &record = _records[size_t(i) & SEQ_MASK];
+            _ack_latency.add(now - record.commit_nsecs);
+            _send_ack_latency.add(now - record.send_nsecs);
+        }
+        _num_acked.add(num_acked - old_num_acked);
+    }
+
+    void get_stats(stream_stats_t &stats) const{
+        _ack_latency.read(stats.ack_latency);
+        _send_ack_latency.read(stats.send_ack_latency);
+        for (size_t i = 0; i < stream_stats_t::NUM_OCCUPANCY_BINS; i++){
+            stats.buffer_occupancy[i] = _occupancy[i].read();
+        }
+    }
+
+private:
+    struct record_type{
+        boost::uint64_t send_nsecs, commit_nsecs;
+    };
+    record_type _records[SEQ_MASK+1];
+    size_t _window;
+    stats_counter _num_sent, _num_acked;
+    stats_histogram _ack_latency, _send_ack_latency;
+    stats_counter _occupancy[stream_stats_t::NUM_OCCUPANCY_BINS];
+};
+
+/***********************************************************************
+ * Stream statistics counters of one channel.
+ * The packet counters are written by the streaming thread,
+ * the conversion time and the sent packets by the converter thread
+ * of the channel, the async events, stalls and acks by whoever
+ * holds the flow control.
+ **********************************************************************/
+struct stream_stats_counters : boost::noncopyable{
+    typedef boost::shared_ptr<stream_stats_counters> sptr;
+
+    stats_counter packets;
+    stats_counter bytes;
+    stats_counter seq_errors;
+    stats_counter time_errors;
+    stats_counter overflows;
+    stats_counter underflows;
+    stats_counter late_packets;
+    stats_counter fc_stalls;
+    stats_counter convert_nsecs;
+    tx_ack_tracker tx_acks;
+
+    //! Count the errors reported in a TX async message
+    void count_async_msg(const async_metadata_t &metadata){
+        if (metadata.event_code &
+            ( async_metadata_t::EVENT_CODE_UNDERFLOW
+            | async_metadata_t::EVENT_CODE_UNDERFLOW_IN_PACKET)
+        ) underflows.inc();
+        if (metadata.event_code &
+            ( async_metadata_t::EVENT_CODE_SEQ_ERROR
+            | async_metadata_t::EVENT_CODE_SEQ_ERROR_IN_BURST)
+        ) seq_errors.inc();
+        if (metadata.event_code & async_metadata_t::EVENT_CODE_TIME_ERROR) late_packets.inc();
+    }
+
+    void get_stats(stream_stats_t &stats) const{
+        stats.num_packets = packets.read();
+        stats.num_bytes = bytes.read();
+        stats.num_seq_errors = seq_errors.read();
+        stats.num_time_errors = time_errors.read();
+        stats.num_overflows = overflows.read();
+        stats.num_underflows = underflows.read();
+        stats.num_late_packets = late_packets.read();
+        stats.num_fc_stalls = fc_stalls.read();
+        stats.convert_time = convert_nsecs.read()/1e9;
+        tx_acks.get_stats(stats);
+    }
+};
+
+}}} //namespace uhd::transport::sph
+
+#endif /* INCLUDED_LIBUHD_TRANSPORT_STREAM_STATS_COUNTERS_HPP */
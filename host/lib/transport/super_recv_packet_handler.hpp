@@ -29,6 +29,9 @@
 #include <uhd/types/metadata.hpp>
 #include <uhd/transport/vrt_if_packet.hpp>
 #include <uhd/transport/zero_copy.hpp>
+#include "packet_trace.hpp"
+#include "rx_fc_tuner.hpp"
+#include "stream_stats_counters.hpp"
 #include <boost/dynamic_bitset.hpp>
 #include <boost/foreach.hpp>
 #include <boost/function.hpp>
@@ -39,13 +42,6 @@
 #include <iostream>
 #include <vector>
 
-// Included for debugging
-#ifdef UHD_TXRX_DEBUG_PRINTS
-#include <boost/format.hpp>
-#include <boost/thread/thread.hpp>
-#include "boost/date_time/posix_time/posix_time.hpp"
-#endif
-
 namespace uhd{ namespace transport{ namespace sph{
 
 UHD_INLINE boost::uint32_t get_context_code(
@@ -72,6 +68,7 @@ public:
     typedef boost::function<managed_recv_buffer::sptr(double)> get_buff_type;
     typedef boost::function<void(const size_t)> handle_flowctrl_type;
     typedef boost::function<void(const stream_cmd_t&)> issue_stream_cmd_type;
+    typedef boost::function<void(const vrt::if_packet_info_t &, const boost::uint32_t *, const double)> publish_type;
     typedef void(*vrt_unpacker_type)(const boost::uint32_t *, vrt::if_packet_info_t &);
     //typedef boost::function<void(const boost::uint32_t *, vrt::if_packet_info_t &)> vrt_unpacker_type;
 
@@ -80,6 +77,7 @@ public:
      * \param size the number of transport channels
      */
     recv_packet_handler(const size_t size = 1):
+        _samp_rate(0.0),
         _queue_error_for_next_call(false),
         _buffers_infos_index(0)
     {
@@ -101,15 +99,28 @@ public:
         if (this->size() == size) return;
         _task_handlers.clear();
         _props.resize(size);
+        for (size_t i = 0; i < size; i++){
+            if (not _props[i].stats) _props[i].stats.reset(new stream_stats_counters());
+        }
         //re-initialize all buffers infos by re-creating the vector
         _buffers_infos = std::vector<buffers_info_type>(4, buffers_info_type(size));
         _task_barrier.resize(size);
         _task_handlers.resize(size);
         for (size_t i = 1/*skip 0*/; i < size; i++){
-            _task_handlers[i] = task::make(boost::bind(&recv_packet_handler::converter_thread_task, this, i));
+            _task_handlers[i] = task::make(boost::bind(&recv_packet_handler::converter_thread_task, this, i), _convert_cpus);
         };
     }
 
+    /*!
+     * Pin the converter threads to a set of CPUs.
+     * Channel 0 is converted in the calling thread, the other channels
+     * in their own threads, which are made by the next resize.
+     * \param cpus the CPU set, see uhd::set_thread_affinity
+     */
+    void set_convert_cpus(const std::string &cpus){
+        _convert_cpus = cpus;
+    }
+
     //! Get the channel width of this handler
     size_t size(void) const{
         return _props.size();
@@ -135,6 +146,11 @@ public:
         _tick_rate = rate;
     }
 
+    //! Get the rate of ticks per second
+    double get_tick_rate(void) const{
+        return _tick_rate;
+    }
+
     //! Set the rate of samples per second
     void set_samp_rate(const double rate){
         _samp_rate = rate;
@@ -175,8 +191,33 @@ public:
         if (do_init) handle_flowctrl(0);
     }
 
+    /*!
+     * Set the tuner that adapts the flow control of a channel.
+     * The tuner sets the update window from then on.
+     * \param xport_chan which transport channel
+     * \param tuner the tuner or a null pointer
+     */
+    void set_xport_fc_tuner(const size_t xport_chan, rx_fc_tuner::sptr tuner)
+    {
+        _props.at(xport_chan).fc_tuner = tuner;
+        if (tuner) _props.at(xport_chan).fc_update_window = tuner->get_update_interval();
+    }
+
+    //! Get the statistics of a transport channel
+    stream_stats_t get_stats(const size_t xport_chan) const
+    {
+        stream_stats_t stats;
+        const xport_chan_props_type &props = _props.at(xport_chan);
+        props.stats->get_stats(stats);
+        _call_latency.read(stats.call_latency);
+        if (props.fc_tuner) props.fc_tuner->get_stats(stats);
+        else if (props.handle_flowctrl) stats.fc_update_interval = props.fc_update_window;
+        return stats;
+    }
+
     //! Set the conversion routine for all channels
     void set_converter(const uhd::convert::id_type &id){
+        _otw_format = id.input_format;
         _num_outputs = id.num_outputs;
         _converter = uhd::convert::get_converter(id)();
         this->set_scale_factor(1/32767.); //update after setting converter
@@ -184,6 +225,22 @@ public:
         _bytes_per_cpu_item = uhd::convert::get_bytes_per_item(id.output_format);
     }
 
+    //! Get the over-the-wire item format of the converter (ex: sc16_item32_le)
+    const std::string &get_otw_format(void) const{
+        return _otw_format;
+    }
+
+    /*!
+     * Set a function to publish every received packet.
+     * It is called with the unpacked header info, the packet header,
+     * and the tick rate, before the packet is processed.
+     * \param xport_chan which transport channel
+     * \param publish the publisher function
+     */
+    void set_xport_chan_publish(const size_t xport_chan, const publish_type &publish){
+        _props.at(xport_chan).publish = publish;
+    }
+
     //! Set the transport channel's overflow handler
     void set_overflow_handler(const size_t xport_chan, const handle_overflow_type &handle_overflow){
         _props.at(xport_chan).handle_overflow = handle_overflow;
@@ -235,9 +292,6 @@ public:
         );
 
         if (one_packet){
-#ifdef UHD_TXRX_DEBUG_PRINTS
-            dbg_gather_data(nsamps_per_buff, accum_num_samps, metadata, timeout, one_packet);
-#endif
             return accum_num_samps;
         }
 
@@ -258,12 +312,13 @@ public:
             }
             accum_num_samps += num_samps;
         }
-#ifdef UHD_TXRX_DEBUG_PRINTS
-		dbg_gather_data(nsamps_per_buff, accum_num_samps, metadata, timeout, one_packet);
-#endif
         return accum_num_samps;
     }
 
+protected:
+    //! The duration of the recv() calls, written by the streamer
+    stats_histogram _call_latency;
+
 private:
     vrt_unpacker_type _vrt_unpacker;
     size_t _header_offset_words32;
@@ -283,12 +338,16 @@ private:
         handle_overflow_type handle_overflow;
         handle_flowctrl_type handle_flowctrl;
         size_t fc_update_window;
+        rx_fc_tuner::sptr fc_tuner;
+        stream_stats_counters::sptr stats;
+        publish_type publish;
     };
     std::vector<xport_chan_props_type> _props;
     size_t _num_outputs;
     size_t _bytes_per_otw_item; //used in conversion
     size_t _bytes_per_cpu_item; //used in conversion
     uhd::convert::converter::sptr _converter; //used in conversion
+    std::string _otw_format;
 
     //! information stored for a received buffer
     struct per_buffer_info_type{
@@ -296,13 +355,13 @@ private:
         {
             buff.reset();
             vrt_hdr = NULL;
-            time = time_spec_t(0.0);
+            tsf = 0;
             copy_buff = NULL;
         }
         managed_recv_buffer::sptr buff;
         const boost::uint32_t *vrt_hdr;
         vrt::if_packet_info_t ifpi;
-        time_spec_t time;
+        boost::uint64_t tsf; //the packet time in ticks
         const char *copy_buff;
     };
 
@@ -311,15 +370,15 @@ private:
         buffers_info_type(const size_t size):
             std::vector<per_buffer_info_type>(size),
             indexes_todo(size, true),
-            alignment_time_valid(false),
+            alignment_tsf_valid(false),
             data_bytes_to_copy(0),
             fragment_offset_in_samps(0)
         {/* NOP */}
         void reset()
         {
             indexes_todo.set();
-            alignment_time = time_spec_t(0.0);
-            alignment_time_valid = false;
+            alignment_tsf = 0;
+            alignment_tsf_valid = false;
             data_bytes_to_copy = 0;
             fragment_offset_in_samps = 0;
             metadata.reset();
@@ -327,8 +386,8 @@ private:
                 at(i).reset();
         }
         boost::dynamic_bitset<> indexes_todo; //used in alignment logic
-        time_spec_t alignment_time; //used in alignment logic
-        bool alignment_time_valid; //used in alignment logic
+        boost::uint64_t alignment_tsf; //used in alignment logic
+        bool alignment_tsf_valid; //used in alignment logic
         size_t data_bytes_to_copy; //keeps track of state
         size_t fragment_offset_in_samps; //keeps track of state
         rx_metadata_t metadata; //packet description
@@ -393,8 +452,12 @@ private:
         info.ifpi.num_packet_words32 = num_packet_words32 - _header_offset_words32;
         info.vrt_hdr = buff->cast<const boost::uint32_t *>() + _header_offset_words32;
         _vrt_unpacker(info.vrt_hdr, info.ifpi);
-        info.time = time_spec_t::from_ticks(info.ifpi.tsf, _tick_rate); //assumes has_tsf is true
+        info.tsf = info.ifpi.tsf; //assumes has_tsf is true
         info.copy_buff = reinterpret_cast<const char *>(info.vrt_hdr + info.ifpi.num_header_words32);
+        packet_trace(TRACE_RECV_PACKET, index, boost::uint32_t(info.ifpi.packet_count), info.tsf);
+
+        //publish to other consumers of this stream
+        if (_props[index].publish) _props[index].publish(info.ifpi, info.vrt_hdr, _tick_rate);
 
         //handle flow control
         if (_props[index].handle_flowctrl)
@@ -402,6 +465,12 @@ private:
             if ((info.ifpi.packet_count % _props[index].fc_update_window) == 0)
             {
                 _props[index].handle_flowctrl(info.ifpi.packet_count);
+                if (_props[index].fc_tuner and _samp_rate > 0.0) _props[index].fc_update_window =
+                    _props[index].fc_tuner->update(
+                        (time_spec_t::get_system_time() - time_spec_t::from_ticks(info.tsf, _tick_rate)).get_real_secs(),
+                        info.ifpi.num_payload_bytes/_bytes_per_otw_item/_samp_rate
+                    );
+                packet_trace(TRACE_RECV_FC_UPDATE, index, boost::uint32_t(info.ifpi.packet_count), _props[index].fc_update_window);
             }
         }
 
@@ -414,6 +483,8 @@ private:
         if (info.ifpi.packet_type != vrt::if_packet_info_t::PACKET_TYPE_DATA){
             return PACKET_INLINE_MESSAGE;
         }
+        _props[index].stats->packets.inc();
+        _props[index].stats->bytes.add(info.ifpi.num_payload_bytes);
 
         //2) check for sequence errors
         #ifndef SRPH_DONT_CHECK_SEQUENCE
@@ -421,12 +492,13 @@ private:
         const size_t expected_packet_count = _props[index].packet_count;
         _props[index].packet_count = (info.ifpi.packet_count + 1) & seq_mask;
         if (expected_packet_count != info.ifpi.packet_count){
+            packet_trace(TRACE_RECV_SEQ_ERROR, index, boost::uint32_t(expected_packet_count), info.ifpi.packet_count);
             return PACKET_SEQUENCE_ERROR;
         }
         #endif
 
         //3) check for out of order timestamps
-        if (info.ifpi.has_tsf and prev_buffer_info.time > info.time){
+        if (info.ifpi.has_tsf and prev_buffer_info.tsf > info.tsf){
             return PACKET_TIMESTAMP_ERROR;
         }
 
@@ -471,9 +543,9 @@ private:
         //if alignment time was not valid or if the sequence id is newer:
         //  use this index's time as the alignment time
         //  reset the indexes list and remove this index
-        if (not info.alignment_time_valid or info[index].time > info.alignment_time){
-            info.alignment_time_valid = true;
-            info.alignment_time = info[index].time;
+        if (not info.alignment_tsf_valid or info[index].tsf > info.alignment_tsf){
+            info.alignment_tsf_valid = true;
+            info.alignment_tsf = info[index].tsf;
             info.indexes_todo.set();
             info.indexes_todo.reset(index);
             info.data_bytes_to_copy = info[index].ifpi.num_payload_bytes;
@@ -481,13 +553,13 @@ private:
 
         //if the sequence id matches:
         //  remove this index from the list and continue
-        else if (info[index].time == info.alignment_time){
+        else if (info[index].tsf == info.alignment_tsf){
             info.indexes_todo.reset(index);
         }
 
         //if the sequence id is older:
         //  continue with the same index to try again
-        //else if (info[index].time < info.alignment_time)...
+        //else if (info[index].tsf < info.alignment_tsf)...
     }
 
     /*******************************************************************
@@ -544,23 +616,30 @@ private:
                 //we can receive a packet that comes before the previous packet in time.
                 //This could cause the alignment logic to discard future received packets.
                 //Therefore, when this occurs, we reset the info to restart from scratch.
-                if (curr_info.alignment_time_valid and curr_info.alignment_time != curr_info[index].time){
-                    curr_info.alignment_time_valid = false;
+                if (curr_info.alignment_tsf_valid and curr_info.alignment_tsf != curr_info[index].tsf){
+                    curr_info.alignment_tsf_valid = false;
                 }
                 alignment_check(index, curr_info);
+                _props[index].stats->time_errors.inc();
                 break;
 
             case PACKET_INLINE_MESSAGE:
                 std::swap(curr_info, next_info); //save progress from curr -> next
                 curr_info.metadata.has_time_spec = next_info[index].ifpi.has_tsf;
-                curr_info.metadata.time_spec = next_info[index].time;
+                curr_info.metadata.time_spec = time_spec_t::from_ticks(next_info[index].tsf, _tick_rate);
                 curr_info.metadata.error_code = rx_metadata_t::error_code_t(get_context_code(next_info[index].vrt_hdr, next_info[index].ifpi));
                 if (curr_info.metadata.error_code == rx_metadata_t::ERROR_CODE_OVERFLOW){
                     rx_metadata_t metadata = curr_info.metadata;
+                    packet_trace(TRACE_RECV_OVERFLOW, index, boost::uint32_t(next_info[index].ifpi.packet_count), next_info[index].tsf);
+                    if (_props[index].fc_tuner) _props[index].fc_tuner->on_overflow();
+                    _props[index].stats->overflows.inc();
                     _props[index].handle_overflow();
                     curr_info.metadata = metadata;
                     UHD_MSG(fastpath) << "O";
                 }
+                else if (curr_info.metadata.error_code == rx_metadata_t::ERROR_CODE_LATE_COMMAND){
+                    _props[index].stats->late_packets.inc();
+                }
                 return;
 
             case PACKET_TIMEOUT_ERROR:
@@ -576,6 +655,8 @@ private:
                     prev_info[index].ifpi.num_payload_words32*sizeof(boost::uint32_t)/_bytes_per_otw_item, _samp_rate);
                 curr_info.metadata.out_of_sequence = true;
                 curr_info.metadata.error_code = rx_metadata_t::ERROR_CODE_OVERFLOW;
+                if (_props[index].fc_tuner) _props[index].fc_tuner->on_drop();
+                _props[index].stats->seq_errors.inc();
                 UHD_MSG(fastpath) << "D";
                 return;
 
@@ -598,7 +679,7 @@ private:
 
         //set the metadata from the buffer information at index zero
         curr_info.metadata.has_time_spec = curr_info[0].ifpi.has_tsf;
-        curr_info.metadata.time_spec = curr_info[0].time;
+        curr_info.metadata.time_spec = time_spec_t::from_ticks(curr_info[0].tsf, _tick_rate);
         curr_info.metadata.more_fragments = false;
         curr_info.metadata.fragment_offset = 0;
         curr_info.metadata.start_of_burst = curr_info[0].ifpi.sob;
@@ -631,7 +712,9 @@ private:
         metadata = info.metadata;
 
         //interpolate the time spec (useful when this is a fragment)
-        metadata.time_spec += time_spec_t::from_ticks(info.fragment_offset_in_samps, _samp_rate);
+        if (info.fragment_offset_in_samps != 0){
+            metadata.time_spec += time_spec_t::from_ticks(info.fragment_offset_in_samps, _samp_rate);
+        }
 
         //extract the number of samples available to copy
         const size_t nsamps_available = info.data_bytes_to_copy/_bytes_per_otw_item;
@@ -682,7 +765,9 @@ private:
         const ref_vector<void *> out_buffs(io_buffs, _num_outputs);
 
         //perform the conversion operation
+        const boost::uint64_t convert_start = stats_time_nsecs();
         _converter->conv(info.copy_buff, out_buffs, _convert_nsamps);
+        _props[index].stats->convert_nsecs.add(stats_time_nsecs() - convert_start);
 
         //advance the pointer for the source buffer
         info.copy_buff += _convert_bytes_to_copy;
@@ -698,70 +783,11 @@ private:
     //! Shared variables for the worker threads
     reusable_barrier _task_barrier;
     std::vector<task::sptr> _task_handlers;
+    std::string _convert_cpus;
     size_t _convert_nsamps;
     const rx_streamer::buffs_type *_convert_buffs;
     size_t _convert_buffer_offset_bytes;
     size_t _convert_bytes_to_copy;
-
-    /*
-     * This last section is only for debugging purposes.
-     * It causes a lot of prints to stderr which can be piped to a file.
-     * Gathered data can be used to post process it with external tools.
-     */
-#ifdef UHD_TXRX_DEBUG_PRINTS
-    struct dbg_recv_stat_t {
-        dbg_recv_stat_t(long wc, size_t nspb, size_t nsr, uhd::rx_metadata_t md, double to, bool op, double rate):
-        wallclock(wc), nsamps_per_buff(nspb), nsamps_recv(nsr), metadata(md), timeout(to), one_packet(op), samp_rate(rate)
-        {}
-        long wallclock;
-        size_t nsamps_per_buff;
-        size_t nsamps_recv;
-        uhd::rx_metadata_t metadata;
-        double timeout;
-        bool one_packet;
-        double samp_rate;
-        // Create a formatted print line for all the info gathered in this struct.
-        std::string print_line() {
-            boost::format fmt("recv,%ld,%f,%i,%i,%s,%i,%s,%s,%s,%i,%s,%ld");
-            fmt % wallclock;
-            fmt % timeout % (int)nsamps_per_buff % (int) nsamps_recv;
-            fmt % (one_packet ? "true":"false");
-            fmt % metadata.error_code;
-            fmt % (metadata.start_of_burst ? "true":"false") % (metadata.end_of_burst ? "true":"false");
-            fmt % (metadata.more_fragments ? "true":"false") % (int)metadata.fragment_offset;
-            fmt % (metadata.has_time_spec ? "true":"false") % metadata.time_spec.to_ticks(samp_rate);
-            return fmt.str();
-        }
-    };
-
-    void dbg_gather_data(const size_t nsamps_per_buff, const size_t nsamps_recv,
-            uhd::rx_metadata_t &metadata, const double timeout,
-            const bool one_packet,
-            bool dbg_print_directly = true
-        )
-    {
-        // Initialize a struct with all available data. It can return a formatted string with all infos if wanted.
-        dbg_recv_stat_t data(boost::get_system_time().time_of_day().total_microseconds(),
-                nsamps_per_buff,
-                nsamps_recv,
-                metadata,
-                timeout,
-                one_packet,
-                _samp_rate
-            );
-        if(dbg_print_directly) {
-            dbg_print_err(data.print_line());
-        }
-    }
-
-
-
-    void dbg_print_err(std::string msg) {
-        std::string dbg_prefix("super_recv_packet_handler,");
-        msg = dbg_prefix + msg;
-        fprintf(stderr, "%s\n", msg.c_str());
-    }
-#endif
 };
 
 class recv_packet_streamer : public recv_packet_handler, public rx_streamer{
@@ -785,7 +811,12 @@ public:
         const double timeout,
         const bool one_packet
     ){
-        return recv_packet_handler::recv(buffs, nsamps_per_buff, metadata, timeout, one_packet);
+        packet_trace(TRACE_RECV_ENTER, 0, boost::uint32_t(nsamps_per_buff));
+        const boost::uint64_t start = stats_time_nsecs();
+        const size_t num_samps = recv_packet_handler::recv(buffs, nsamps_per_buff, metadata, timeout, one_packet);
+        _call_latency.add(stats_time_nsecs() - start);
+        packet_trace(TRACE_RECV_EXIT, 0, boost::uint32_t(num_samps), metadata.error_code);
+        return num_samps;
     }
 
     void issue_stream_cmd(const stream_cmd_t &stream_cmd)
@@ -793,6 +824,11 @@ public:
         return recv_packet_handler::issue_stream_cmd(stream_cmd);
     }
 
+    stream_stats_t get_stats(const size_t chan) const
+    {
+        return recv_packet_handler::get_stats(chan);
+    }
+
 private:
     size_t _max_num_samps;
 };
@@ -29,21 +29,14 @@
 #include <uhd/types/metadata.hpp>
 #include <uhd/transport/vrt_if_packet.hpp>
 #include <uhd/transport/zero_copy.hpp>
+#include "packet_trace.hpp"
+#include "stream_stats_counters.hpp"
 #include <boost/thread/thread_time.hpp>
 #include <boost/foreach.hpp>
 #include <boost/function.hpp>
 #include <iostream>
 #include <vector>
 
-#ifdef UHD_TXRX_DEBUG_PRINTS
-// Included for debugging
-#include <boost/format.hpp>
-#include <boost/thread/thread.hpp>
-#include "boost/date_time/posix_time/posix_time.hpp"
-#include <map>
-#include <fstream>
-#endif
-
 namespace uhd {
 namespace transport {
 namespace sph {
@@ -67,6 +60,7 @@ public:
      * \param size the number of transport channels
      */
     send_packet_handler(const size_t size = 1):
+        _send_start_nsecs(0), _tick_rate(1.0), _samp_rate(1.0), _ticks_per_samp(1.0),
         _next_packet_seq(0), _cached_metadata(false)
     {
         this->set_enable_trailer(true);
@@ -83,15 +77,28 @@ public:
         if (this->size() == size) return;
         _task_handlers.clear();
         _props.resize(size);
+        for (size_t i = 0; i < size; i++){
+            if (not _props[i].stats) _props[i].stats.reset(new stream_stats_counters());
+        }
         static const boost::uint64_t zero = 0;
         _zero_buffs.resize(size, &zero);
         _task_barrier.resize(size);
         _task_handlers.resize(size);
         for (size_t i = 1/*skip 0*/; i < size; i++){
-            _task_handlers[i] = task::make(boost::bind(&send_packet_handler::converter_thread_task, this, i));
+            _task_handlers[i] = task::make(boost::bind(&send_packet_handler::converter_thread_task, this, i), _convert_cpus);
         };
     }
 
+    /*!
+     * Pin the converter threads to a set of CPUs.
+     * Channel 0 is converted in the calling thread, the other channels
+     * in their own threads, which are made by the next resize.
+     * \param cpus the CPU set, see uhd::set_thread_affinity
+     */
+    void set_convert_cpus(const std::string &cpus){
+        _convert_cpus = cpus;
+    }
+
     //! Get the channel width of this handler
     size_t size(void) const{
         return _props.size();
@@ -117,11 +124,13 @@ public:
     //! Set the rate of ticks per second
     void set_tick_rate(const double rate){
         _tick_rate = rate;
+        _ticks_per_samp = _tick_rate/_samp_rate;
     }
 
     //! Set the rate of samples per second
     void set_samp_rate(const double rate){
         _samp_rate = rate;
+        _ticks_per_samp = _tick_rate/_samp_rate;
     }
 
     /*!
@@ -133,6 +142,25 @@ public:
         _props.at(xport_chan).get_buff = get_buff;
     }
 
+    /*!
+     * Get the statistics counters of a transport channel.
+     * The device counts the async messages and the flow control stalls.
+     * \param xport_chan which transport channel
+     * \return the counters, shared with the streamer
+     */
+    stream_stats_counters::sptr get_xport_chan_stats(const size_t xport_chan){
+        return _props.at(xport_chan).stats;
+    }
+
+    //! Get the statistics of a transport channel
+    stream_stats_t get_stats(const size_t xport_chan) const
+    {
+        stream_stats_t stats;
+        _props.at(xport_chan).stats->get_stats(stats);
+        _call_latency.read(stats.call_latency);
+        return stats;
+    }
+
     //! Set the conversion routine for all channels
     void set_converter(const uhd::convert::id_type &id){
         _num_inputs = id.num_inputs;
@@ -190,7 +218,7 @@ public:
         if_packet_info.has_tlr = _has_tlr;
         if_packet_info.has_tsi = false;
         if_packet_info.has_tsf = metadata.has_time_spec;
-        if_packet_info.tsf     = metadata.time_spec.to_ticks(_tick_rate);
+        if_packet_info.tsf     = metadata.has_time_spec? metadata.time_spec.to_ticks(_tick_rate) : 0;
         if_packet_info.sob     = metadata.start_of_burst;
         if_packet_info.eob     = metadata.end_of_burst;
 
@@ -234,12 +262,10 @@ public:
                 }
             #endif
 
-			size_t nsamps_sent = send_one_packet(buffs, nsamps_per_buff, if_packet_info, timeout);
-#ifdef UHD_TXRX_DEBUG_PRINTS
-			dbg_print_send(nsamps_per_buff, nsamps_sent, metadata, timeout);
-#endif
-			return nsamps_sent;        }
+            return send_one_packet(buffs, nsamps_per_buff, if_packet_info, timeout);
+        }
         size_t total_num_samps_sent = 0;
+        const boost::uint64_t first_tsf = if_packet_info.tsf;
 
         //false until final fragment
         if_packet_info.eob = false;
@@ -259,36 +285,41 @@ public:
             total_num_samps_sent += num_samps_sent;
             if (num_samps_sent == 0) return total_num_samps_sent;
 
-            //setup metadata for the next fragment
-            const time_spec_t time_spec = metadata.time_spec + time_spec_t::from_ticks(total_num_samps_sent, _samp_rate);
-            if_packet_info.tsf = time_spec.to_ticks(_tick_rate);
+            //setup metadata for the next fragment,
+            //offset from the first fragment so rounding does not accumulate
+            if_packet_info.tsf = first_tsf + boost::uint64_t(total_num_samps_sent*_ticks_per_samp + 0.5);
             if_packet_info.sob = false;
 
         }
 
         //send the final fragment with the helper function
         if_packet_info.eob = metadata.end_of_burst;
-		size_t nsamps_sent = total_num_samps_sent
-				+ send_one_packet(buffs, final_length, if_packet_info, timeout,
-					total_num_samps_sent * _bytes_per_cpu_item);
-#ifdef UHD_TXRX_DEBUG_PRINTS
-		dbg_print_send(nsamps_per_buff, nsamps_sent, metadata, timeout);
-
-#endif
-		return nsamps_sent;
+        return total_num_samps_sent + send_one_packet(
+            buffs, final_length, if_packet_info, timeout,
+            total_num_samps_sent*_bytes_per_cpu_item
+        );
     }
 
+protected:
+    //! The duration of the send() calls, written by the streamer
+    stats_histogram _call_latency;
+
+    //! The start of the current send() call, written by the streamer
+    boost::uint64_t _send_start_nsecs;
+
 private:
 
     vrt_packer_type _vrt_packer;
     size_t _header_offset_words32;
     double _tick_rate, _samp_rate;
+    double _ticks_per_samp; //used in fragmentation
     struct xport_chan_props_type{
         xport_chan_props_type(void):has_sid(false),sid(0){}
         get_buff_type get_buff;
         bool has_sid;
         boost::uint32_t sid;
         managed_send_buffer::sptr buff;
+        stream_stats_counters::sptr stats;
     };
     std::vector<xport_chan_props_type> _props;
     size_t _num_inputs;
@@ -303,51 +334,6 @@ private:
     bool _cached_metadata;
     uhd::tx_metadata_t _metadata_cache;
 
-#ifdef UHD_TXRX_DEBUG_PRINTS
-    struct dbg_send_stat_t {
-        dbg_send_stat_t(long wc, size_t nspb, size_t nss, uhd::tx_metadata_t md, double to, double rate):
-            wallclock(wc), nsamps_per_buff(nspb), nsamps_sent(nss), metadata(md), timeout(to), samp_rate(rate)
-        {}
-        long wallclock;
-        size_t nsamps_per_buff;
-        size_t nsamps_sent;
-        uhd::tx_metadata_t metadata;
-        double timeout;
-        double samp_rate;
-        // Create a formatted print line for all the info gathered in this struct.
-        std::string print_line() {
-            boost::format fmt("send,%ld,%f,%i,%i,%s,%s,%s,%ld");
-            fmt % wallclock;
-            fmt % timeout % (int)nsamps_per_buff % (int) nsamps_sent;
-            fmt % (metadata.start_of_burst ? "true":"false") % (metadata.end_of_burst ? "true":"false");
-            fmt % (metadata.has_time_spec ? "true":"false") % metadata.time_spec.to_ticks(samp_rate);
-            return fmt.str();
-        }
-    };
-
-    void dbg_print_send(size_t nsamps_per_buff, size_t nsamps_sent,
-            const uhd::tx_metadata_t &metadata, const double timeout,
-            bool dbg_print_directly = true)
-    {
-        dbg_send_stat_t data(boost::get_system_time().time_of_day().total_microseconds(),
-            nsamps_per_buff,
-            nsamps_sent,
-            metadata,
-            timeout,
-            _samp_rate
-        );
-        if(dbg_print_directly){
-            dbg_print_err(data.print_line());
-        }
-    }
-    void dbg_print_err(std::string msg) {
-        msg = "super_send_packet_handler," + msg;
-        fprintf(stderr, "%s\n", msg.c_str());
-    }
-
-
-#endif
-
     /*******************************************************************
      * Send a single packet:
      ******************************************************************/
@@ -413,12 +399,19 @@ private:
         otw_mem += if_packet_info.num_header_words32;
 
         //perform the conversion operation
+        const boost::uint64_t convert_start = stats_time_nsecs();
         _converter->conv(in_buffs, otw_mem, _convert_nsamps);
+        const boost::uint64_t convert_end = stats_time_nsecs();
+        _props[index].stats->convert_nsecs.add(convert_end - convert_start);
 
         //commit the samples to the zero-copy interface
         const size_t num_vita_words32 = _header_offset_words32+if_packet_info.num_packet_words32;
+        _props[index].stats->tx_acks.sent(_send_start_nsecs, convert_end);
         buff->commit(num_vita_words32*sizeof(boost::uint32_t));
         buff.reset(); //effectively a release
+        _props[index].stats->packets.inc();
+        _props[index].stats->bytes.add(if_packet_info.num_payload_bytes);
+        packet_trace(TRACE_SEND_PACKET, index, boost::uint32_t(if_packet_info.packet_count), if_packet_info.tsf);
 
         if (index == 0) _task_barrier.wait_others();
     }
@@ -426,6 +419,7 @@ private:
     //! Shared variables for the worker threads
     reusable_barrier _task_barrier;
     std::vector<task::sptr> _task_handlers;
+    std::string _convert_cpus;
     size_t _convert_nsamps;
     const tx_streamer::buffs_type *_convert_buffs;
     size_t _convert_buffer_offset_bytes;
@@ -454,7 +448,13 @@ public:
         const uhd::tx_metadata_t &metadata,
         const double timeout
     ){
-        return send_packet_handler::send(buffs, nsamps_per_buff, metadata, timeout);
+        packet_trace(TRACE_SEND_ENTER, 0, boost::uint32_t(nsamps_per_buff));
+        const boost::uint64_t start = stats_time_nsecs();
+        _send_start_nsecs = start;
+        const size_t num_samps = send_packet_handler::send(buffs, nsamps_per_buff, metadata, timeout);
+        _call_latency.add(stats_time_nsecs() - start);
+        packet_trace(TRACE_SEND_EXIT, 0, boost::uint32_t(num_samps));
+        return num_samps;
     }
 
     bool recv_async_msg(
@@ -463,6 +463,11 @@ public:
         return send_packet_handler::recv_async_msg(async_metadata, timeout);
     }
 
+    stream_stats_t get_stats(const size_t chan) const
+    {
+        return send_packet_handler::get_stats(chan);
+    }
+
 private:
     size_t _max_num_samps;
 };
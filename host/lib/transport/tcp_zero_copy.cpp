@@ -18,12 +18,19 @@
 #include "udp_common.hpp"
 #include <uhd/transport/tcp_zero_copy.hpp>
 #include <uhd/transport/buffer_pool.hpp>
+#include <uhd/transport/bounded_buffer.hpp>
 #include <uhd/utils/msg.hpp>
 #include <uhd/utils/log.hpp>
 #include <uhd/utils/atomic.hpp>
+#include <uhd/utils/tasks.hpp>
+#include <uhd/exception.hpp>
 #include <boost/format.hpp>
+#include <boost/bind.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/thread/thread.hpp> //sleep
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread_time.hpp>
+#include <cstring>
 #include <vector>
 
 using namespace uhd;
@@ -32,75 +39,61 @@ namespace asio = boost::asio;
 
 static const size_t DEFAULT_NUM_FRAMES = 32;
 static const size_t DEFAULT_FRAME_SIZE = 2048;
+static const size_t DEFAULT_RECV_CHUNK_SIZE = 65536;
+static const size_t MAX_SEND_BATCH = 64; //frames per gathered write
+static const size_t CHDR_MIN_LEN = 8; //header and SID
+static const double CLOSE_FLUSH_TIMEOUT = 1.0; //seconds to write the queued frames at close
 
 /***********************************************************************
  * Reusable managed receiver buffer:
- *  - get_new performs the recv operation
+ *  - the transport slices a frame into the buffer memory
  **********************************************************************/
 class tcp_zero_copy_asio_mrb : public managed_recv_buffer{
 public:
-    tcp_zero_copy_asio_mrb(void *mem, int sock_fd, const size_t frame_size):
-        _mem(mem), _sock_fd(sock_fd), _frame_size(frame_size) { /*NOP*/ }
+    tcp_zero_copy_asio_mrb(void *mem): _mem(mem) { /*NOP*/ }
 
     void release(void){
         _claimer.release();
     }
 
-    UHD_INLINE sptr get_new(const double timeout, size_t &index){
-        if (not _claimer.claim_with_wait(timeout)) return sptr();
-
-        #ifdef MSG_DONTWAIT //try a non-blocking recv() if supported
-        _len = ::recv(_sock_fd, (char *)_mem, _frame_size, MSG_DONTWAIT);
-        if (_len > 0){
-            index++; //advances the caller's buffer
-            return make(this, _mem, size_t(_len));
-        }
-        #endif
+    UHD_INLINE bool claim(const double timeout){
+        return _claimer.claim_with_wait(timeout);
+    }
 
-        if (wait_for_recv_ready(_sock_fd, timeout)){
-            _len = ::recv(_sock_fd, (char *)_mem, _frame_size, 0);
-            index++; //advances the caller's buffer
-            return make(this, _mem, size_t(_len));
-        }
+    UHD_INLINE sptr get_new(const void *frame, const size_t len, size_t &index){
+        std::memcpy(_mem, frame, len);
+        index++; //advances the caller's buffer
+        return make(this, _mem, len);
+    }
 
-        _claimer.release(); //undo claim
-        return sptr(); //null for timeout
+    UHD_INLINE void unclaim(void){
+        _claimer.release();
     }
 
 private:
     void *_mem;
-    int _sock_fd;
-    size_t _frame_size;
-    ssize_t _len;
     simple_claimer _claimer;
 };
 
 /***********************************************************************
  * Reusable managed send buffer:
- *  - commit performs the send operation
+ *  - commit queues the frame for the sender thread
+ *  - the sender thread releases the buffer after the write
+ *  - the queued counter tells the transport what is left to write
  **********************************************************************/
 class tcp_zero_copy_asio_msb : public managed_send_buffer{
 public:
-    tcp_zero_copy_asio_msb(void *mem, int sock_fd, const size_t frame_size):
-        _mem(mem), _sock_fd(sock_fd), _frame_size(frame_size) { /*NOP*/ }
+    typedef bounded_buffer<tcp_zero_copy_asio_msb *> queue_type;
+
+    tcp_zero_copy_asio_msb(void *mem, queue_type &queue, atomic_uint32_t &num_queued, const size_t frame_size):
+        _mem(mem), _queue(queue), _num_queued(num_queued), _frame_size(frame_size) { /*NOP*/ }
 
     void release(void){
-        //Retry logic because send may fail with ENOBUFS.
-        //This is known to occur at least on some OSX systems.
-        //But it should be safe to always check for the error.
-        while (true)
-        {
-            this->commit(_frame_size); //always full size frames to avoid pkt coalescing
-            const ssize_t ret = ::send(_sock_fd, (const char *)_mem, size(), 0);
-            if (ret == ssize_t(size())) break;
-            if (ret == -1 and errno == ENOBUFS)
-            {
-                boost::this_thread::sleep(boost::posix_time::microseconds(1));
-                continue; //try to send again
-            }
-            UHD_ASSERT_THROW(ret == ssize_t(size()));
+        if (size() == 0) _claimer.release(); //nothing committed
+        else{
+            _num_queued.inc();
+            _queue.push_with_wait(this);
         }
-        _claimer.release();
     }
 
     UHD_INLINE sptr get_new(const double timeout, size_t &index){
@@ -109,9 +102,20 @@ public:
         return make(this, _mem, _frame_size);
     }
 
+    UHD_INLINE asio::const_buffer frame(void) const{
+        return asio::const_buffer(_mem, size());
+    }
+
+    //! Called by the sender thread when the frame was written or dropped
+    UHD_INLINE void sent(void){
+        _num_queued.dec();
+        _claimer.release();
+    }
+
 private:
     void *_mem;
-    int _sock_fd;
+    queue_type &_queue;
+    atomic_uint32_t &_num_queued;
     size_t _frame_size;
     simple_claimer _claimer;
 };
@@ -122,6 +126,15 @@ private:
  *   where a faster, platform specific solution is not available.
  *   However, it is not a true zero copy implementation as each
  *   send and recv requires a copy operation to/from userspace.
+ *
+ *   The receive side reads as many bytes as the socket has into a
+ *   chunk buffer and slices CHDR frames out of it, one recv() call
+ *   serves many frames. The send side hands committed frames to a
+ *   sender thread, which writes all queued frames with one gathered
+ *   write (sendmsg/WSASend), so a caller that gets ahead of the socket
+ *   is batched instead of paying a system call per frame.
+ *   A write error is kept and thrown by the next get_send_buff(),
+ *   the sender thread then drops the frames committed after it.
  **********************************************************************/
 class tcp_zero_copy_asio_impl : public tcp_zero_copy{
 public:
@@ -130,15 +143,21 @@ public:
     tcp_zero_copy_asio_impl(
         const std::string &addr,
         const std::string &port,
-        const device_addr_t &hints
+        const zero_copy_xport_params &xport_params,
+        const size_t recv_chunk_size,
+        const bool little_endian
     ):
-        _recv_frame_size(size_t(hints.cast<double>("recv_frame_size", DEFAULT_FRAME_SIZE))),
-        _num_recv_frames(size_t(hints.cast<double>("num_recv_frames", DEFAULT_NUM_FRAMES))),
-        _send_frame_size(size_t(hints.cast<double>("send_frame_size", DEFAULT_FRAME_SIZE))),
-        _num_send_frames(size_t(hints.cast<double>("num_send_frames", DEFAULT_NUM_FRAMES))),
+        _recv_frame_size(xport_params.recv_frame_size),
+        _num_recv_frames(xport_params.num_recv_frames),
+        _send_frame_size(xport_params.send_frame_size),
+        _num_send_frames(xport_params.num_send_frames),
         _recv_buffer_pool(buffer_pool::make(_num_recv_frames, _recv_frame_size)),
         _send_buffer_pool(buffer_pool::make(_num_send_frames, _send_frame_size)),
-        _next_recv_buff_index(0), _next_send_buff_index(0)
+        _next_recv_buff_index(0), _next_send_buff_index(0),
+        _send_queue(_num_send_frames),
+        _chunk(std::max(recv_chunk_size, 2*_recv_frame_size)),
+        _chunk_begin(0), _chunk_end(0),
+        _little_endian(little_endian)
     {
         UHD_LOG << boost::format("Creating tcp transport for %s %s") % addr % port << std::endl;
 
@@ -147,37 +166,88 @@ public:
         asio::ip::tcp::resolver::query query(asio::ip::tcp::v4(), addr, port);
         asio::ip::tcp::endpoint receiver_endpoint = *resolver.resolve(query);
 
-        //create, open, and connect the socket
+        //create and open the socket,
+        //the buffer sizes must be set before connect to get a large window
         _socket.reset(new asio::ip::tcp::socket(_io_service));
+        _socket->open(asio::ip::tcp::v4());
+        if (xport_params.recv_buff_size != 0){
+            _socket->set_option(asio::socket_base::receive_buffer_size(int(xport_params.recv_buff_size)));
+        }
+        if (xport_params.send_buff_size != 0){
+            _socket->set_option(asio::socket_base::send_buffer_size(int(xport_params.send_buff_size)));
+        }
         _socket->connect(receiver_endpoint);
         _sock_fd = _socket->native();
 
-        //packets go out ASAP
-        asio::ip::tcp::no_delay option(true);
+        //packets go out ASAP unless the user asks for coalescing
+        asio::ip::tcp::no_delay option(xport_params.no_delay);
         _socket->set_option(option);
 
+        asio::socket_base::receive_buffer_size recv_buff_size;
+        asio::socket_base::send_buffer_size send_buff_size;
+        _socket->get_option(recv_buff_size);
+        _socket->get_option(send_buff_size);
+        UHD_LOG << boost::format("tcp transport socket buffers: recv %d bytes, send %d bytes, nodelay %s")
+            % recv_buff_size.value() % send_buff_size.value() % (xport_params.no_delay? "on" : "off") << std::endl;
+
         //allocate re-usable managed receive buffers
         for (size_t i = 0; i < get_num_recv_frames(); i++){
             _mrb_pool.push_back(boost::make_shared<tcp_zero_copy_asio_mrb>(
-                _recv_buffer_pool->at(i), _sock_fd, get_recv_frame_size()
+                _recv_buffer_pool->at(i)
             ));
         }
 
         //allocate re-usable managed send buffers
         for (size_t i = 0; i < get_num_send_frames(); i++){
             _msb_pool.push_back(boost::make_shared<tcp_zero_copy_asio_msb>(
-                _send_buffer_pool->at(i), _sock_fd, get_send_frame_size()
+                _send_buffer_pool->at(i), boost::ref(_send_queue), boost::ref(_num_queued), get_send_frame_size()
             ));
         }
+
+        _send_batch.reserve(MAX_SEND_BATCH);
+        _send_task = task::make(boost::bind(&tcp_zero_copy_asio_impl::send_loop, this));
+    }
+
+    ~tcp_zero_copy_asio_impl(void){
+        //let the sender write the queued frames, then stop it before the socket goes
+        const boost::system_time exit_time = boost::get_system_time() +
+            boost::posix_time::microseconds(long(CLOSE_FLUSH_TIMEOUT*1e6));
+        while (_num_queued.read() != 0 and _send_failed.read() == 0 and boost::get_system_time() < exit_time){
+            boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+        }
+
+        //the sender blocks in its write while the peer does not read,
+        //shut the socket down so the write fails and the sender can be joined
+        if (_num_queued.read() != 0){
+            boost::system::error_code ec;
+            _socket->shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+        }
+        _send_task.reset();
+
+        const size_t num_lost = _num_queued.read() + _num_dropped.read();
+        if (_send_failed.read() != 0) UHD_MSG(error) << boost::format(
+            "tcp transport: %u frames were not sent: %s") % num_lost % _send_error->what() << std::endl;
+        else if (num_lost != 0) UHD_MSG(warning) << boost::format(
+            "tcp transport: %u queued frames were not sent before close") % num_lost << std::endl;
     }
 
     /*******************************************************************
      * Receive implementation:
-     * Block on the managed buffer's get call and advance the index.
+     * Claim the next managed buffer, slice the next frame into it,
+     * and advance the index.
      ******************************************************************/
     managed_recv_buffer::sptr get_recv_buff(double timeout){
         if (_next_recv_buff_index == _num_recv_frames) _next_recv_buff_index = 0;
-        return _mrb_pool[_next_recv_buff_index]->get_new(timeout, _next_recv_buff_index);
+        tcp_zero_copy_asio_mrb &mrb = *_mrb_pool[_next_recv_buff_index];
+        if (not mrb.claim(timeout)) return managed_recv_buffer::sptr();
+
+        size_t len = 0;
+        const void *frame = this->get_frame(timeout, len);
+        if (frame == NULL){
+            mrb.unclaim(); //undo claim
+            return managed_recv_buffer::sptr(); //null for timeout
+        }
+        return mrb.get_new(frame, len, _next_recv_buff_index);
     }
 
     size_t get_num_recv_frames(void) const {return _num_recv_frames;}
@@ -185,9 +255,14 @@ public:
 
     /*******************************************************************
      * Send implementation:
-     * Block on the managed buffer's get call and advance the index.
+     * Throw the error of a failed write, otherwise
+     * block on the managed buffer's get call and advance the index.
      ******************************************************************/
     managed_send_buffer::sptr get_send_buff(double timeout){
+        if (_send_failed.read() != 0){
+            boost::mutex::scoped_lock lock(_send_error_mutex);
+            _send_error->dynamic_throw();
+        }
         if (_next_send_buff_index == _num_send_frames) _next_send_buff_index = 0;
         return _msb_pool[_next_send_buff_index]->get_new(timeout, _next_send_buff_index);
     }
@@ -196,6 +271,134 @@ public:
     size_t get_send_frame_size(void) const {return _send_frame_size;}
 
 private:
+    /*******************************************************************
+     * Get the length of the frame at the front of the chunk buffer,
+     * from the 16-bit packet length in bytes of the CHDR header.
+     ******************************************************************/
+    UHD_INLINE size_t frame_len(const boost::uint8_t *hdr) const{
+        return _little_endian?
+            (size_t(hdr[1]) << 8) | hdr[0] :
+            (size_t(hdr[2]) << 8) | hdr[3];
+    }
+
+    /*******************************************************************
+     * Get the next complete frame from the chunk buffer,
+     * receive more bytes from the socket when it has none.
+     * The frame is valid until the next call.
+     * \return a pointer to the frame, or NULL on timeout
+     ******************************************************************/
+    const void *get_frame(const double timeout, size_t &len){
+        const boost::system_time exit_time = boost::get_system_time() +
+            boost::posix_time::microseconds(long(timeout*1e6));
+        while (true){
+            const size_t avail = _chunk_end - _chunk_begin;
+            if (avail >= sizeof(boost::uint32_t)){
+                len = frame_len(&_chunk[_chunk_begin]);
+                if (len < CHDR_MIN_LEN or len > _recv_frame_size) throw uhd::io_error(str(
+                    boost::format("tcp transport: bad frame length %u (max %u), the stream is out of sync")
+                    % len % _recv_frame_size));
+                if (avail >= len){
+                    const void *frame = &_chunk[_chunk_begin];
+                    _chunk_begin += len;
+                    return frame;
+                }
+            }
+
+            //move the partial frame to the front when the tail cannot hold a frame
+            if (_chunk_begin == _chunk_end) _chunk_begin = _chunk_end = 0;
+            else if (_chunk.size() - _chunk_begin < _recv_frame_size){
+                std::memmove(&_chunk[0], &_chunk[_chunk_begin], avail);
+                _chunk_begin = 0;
+                _chunk_end = avail;
+            }
+
+            ssize_t ret = -1;
+            #ifdef MSG_DONTWAIT //try a non-blocking recv() if supported
+            ret = ::recv(_sock_fd, (char *)&_chunk[_chunk_end], _chunk.size() - _chunk_end, MSG_DONTWAIT);
+            #endif
+            if (ret < 0){
+                const boost::posix_time::time_duration remaining = exit_time - boost::get_system_time();
+                const double wait = std::max<double>(remaining.total_microseconds(), 0)/1e6;
+                if (not wait_for_recv_ready(_sock_fd, wait)) return NULL;
+                ret = ::recv(_sock_fd, (char *)&_chunk[_chunk_end], _chunk.size() - _chunk_end, 0);
+            }
+            if (ret < 0 and errno == EINTR) continue;
+            if (ret == 0) throw uhd::io_error("tcp transport: connection closed by the peer");
+            if (ret < 0) throw uhd::io_error(str(boost::format("tcp transport: recv failed (errno %d)") % errno));
+            _chunk_end += size_t(ret);
+        }
+    }
+
+    /*******************************************************************
+     * Sender thread:
+     * Wait for a committed frame, take every other frame that is
+     * queued behind it, and write them with one gathered write.
+     * After a failed write, the frames are released without writing.
+     ******************************************************************/
+    void send_loop(void){
+        tcp_zero_copy_asio_msb *msb = NULL;
+        if (not _send_queue.pop_with_timed_wait(msb, 0.1)) return;
+        _send_batch.clear();
+        _send_batch.push_back(msb);
+        while (_send_batch.size() < MAX_SEND_BATCH and _send_queue.pop_with_haste(msb)){
+            _send_batch.push_back(msb);
+        }
+
+        if (_send_failed.read() == 0){
+            try{
+                this->send_batch();
+            }
+            catch(const uhd::exception &e){
+                boost::mutex::scoped_lock lock(_send_error_mutex);
+                _send_error.reset(e.dynamic_clone());
+                _send_failed.write(1);
+            }
+        }
+        if (_send_failed.read() != 0){
+            for (size_t i = 0; i < _send_batch.size(); i++) _num_dropped.inc();
+        }
+
+        for (size_t i = 0; i < _send_batch.size(); i++) _send_batch[i]->sent();
+    }
+
+    //! Write the frames of the batch with one gathered write
+    void send_batch(void){
+        _send_buffs.clear();
+        size_t total = 0;
+        for (size_t i = 0; i < _send_batch.size(); i++){
+            _send_buffs.push_back(_send_batch[i]->frame());
+            total += asio::buffer_size(_send_buffs.back());
+        }
+
+        //Retry logic because send may fail with ENOBUFS.
+        //This is known to occur at least on some OSX systems.
+        //But it should be safe to always check for the error.
+        size_t sent = 0;
+        while (sent < total){
+            boost::system::error_code ec;
+            sent += asio::write(*_socket, consume(_send_buffs, sent), asio::transfer_all(), ec);
+            if (ec == asio::error::no_buffer_space){
+                boost::this_thread::sleep(boost::posix_time::microseconds(1));
+                continue; //try to send again
+            }
+            if (ec) throw uhd::io_error("tcp transport: send failed: " + ec.message());
+        }
+    }
+
+    //! The buffers that remain after skipping the first n bytes
+    static std::vector<asio::const_buffer> consume(
+        const std::vector<asio::const_buffer> &buffs, size_t n
+    ){
+        std::vector<asio::const_buffer> rest;
+        for (size_t i = 0; i < buffs.size(); i++){
+            const size_t len = asio::buffer_size(buffs[i]);
+            if (n >= len){n -= len; continue;}
+            rest.push_back(buffs[i] + n);
+            n = 0;
+        }
+        return rest;
+    }
+
     //memory management -> buffers and fifos
     const size_t _recv_frame_size, _num_recv_frames;
     const size_t _send_frame_size, _num_send_frames;
@@ -204,6 +407,23 @@ private:
     std::vector<boost::shared_ptr<tcp_zero_copy_asio_mrb> > _mrb_pool;
     size_t _next_recv_buff_index, _next_send_buff_index;
 
+    //sender thread -> committed frames in order
+    tcp_zero_copy_asio_msb::queue_type _send_queue;
+    std::vector<tcp_zero_copy_asio_msb *> _send_batch;
+    std::vector<asio::const_buffer> _send_buffs;
+    atomic_uint32_t _num_queued, _num_dropped;
+    task::sptr _send_task;
+
+    //the first write error, thrown to the caller
+    atomic_uint32_t _send_failed;
+    boost::mutex _send_error_mutex;
+    boost::shared_ptr<uhd::exception> _send_error;
+
+    //receive chunk -> bytes from the socket not yet sliced into frames
+    std::vector<boost::uint8_t> _chunk;
+    size_t _chunk_begin, _chunk_end;
+    const bool _little_endian;
+
     //asio guts -> socket and service
     asio::io_service        _io_service;
     boost::shared_ptr<asio::ip::tcp::socket> _socket;
@@ -211,15 +431,46 @@ private:
 };
 
 /***********************************************************************
- * TCP zero copy make function
+ * TCP zero copy make functions
  **********************************************************************/
 zero_copy_if::sptr tcp_zero_copy::make(
     const std::string &addr,
     const std::string &port,
     const device_addr_t &hints
 ){
+    zero_copy_xport_params default_buff_args;
+    default_buff_args.recv_frame_size = DEFAULT_FRAME_SIZE;
+    default_buff_args.num_recv_frames = DEFAULT_NUM_FRAMES;
+    default_buff_args.send_frame_size = DEFAULT_FRAME_SIZE;
+    default_buff_args.num_send_frames = DEFAULT_NUM_FRAMES;
+    return tcp_zero_copy::make(addr, port, default_buff_args, hints);
+}
+
+zero_copy_if::sptr tcp_zero_copy::make(
+    const std::string &addr,
+    const std::string &port,
+    const zero_copy_xport_params &default_buff_args,
+    const device_addr_t &hints
+){
+    zero_copy_xport_params xport_params = default_buff_args;
+
+    xport_params.recv_frame_size = size_t(hints.cast<double>("recv_frame_size", default_buff_args.recv_frame_size));
+    xport_params.num_recv_frames = size_t(hints.cast<double>("num_recv_frames", default_buff_args.num_recv_frames));
+    xport_params.send_frame_size = size_t(hints.cast<double>("send_frame_size", default_buff_args.send_frame_size));
+    xport_params.num_send_frames = size_t(hints.cast<double>("num_send_frames", default_buff_args.num_send_frames));
+    xport_params.recv_buff_size = size_t(hints.cast<double>("recv_buff_size", default_buff_args.recv_buff_size));
+    xport_params.send_buff_size = size_t(hints.cast<double>("send_buff_size", default_buff_args.send_buff_size));
+    xport_params.no_delay = hints.cast<int>("tcp_nodelay", default_buff_args.no_delay? 1 : 0) != 0;
+
+    const size_t recv_chunk_size = size_t(hints.cast<double>("recv_chunk_size", DEFAULT_RECV_CHUNK_SIZE));
+    const std::string endianness = hints.get("frame_endianness", "big");
+    if (endianness != "big" and endianness != "little") throw uhd::value_error(
+        "tcp transport: frame_endianness must be big or little, not " + endianness);
+
     zero_copy_if::sptr xport;
-    xport.reset(new tcp_zero_copy_asio_impl(addr, port, hints));
+    xport.reset(new tcp_zero_copy_asio_impl(
+        addr, port, xport_params, recv_chunk_size, endianness == "little"
+    ));
     while (xport->get_recv_buff(0.0)){} //flush
     return xport;
 }
@@ -0,0 +1,661 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "udp_uring_zero_copy.hpp"
+#include <uhd/transport/buffer_pool.hpp>
+#include <uhd/utils/msg.hpp>
+#include <uhd/utils/log.hpp>
+#include <uhd/utils/atomic.hpp>
+#include <uhd/utils/safe_call.hpp>
+#include <uhd/utils/tasks.hpp>
+#include <uhd/exception.hpp>
+#include <boost/format.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/utility.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/thread_time.hpp>
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <sched.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+using namespace uhd;
+using namespace uhd::transport;
+namespace asio = boost::asio;
+
+static const unsigned SQPOLL_IDLE_MS = 10;
+static const long SEND_FLUSH_DELAY_US = 100; //a deferred write is submitted within this time
+static const boost::uint64_t CANCEL_USER_DATA = ~boost::uint64_t(0);
+
+/***********************************************************************
+ * The ring:
+ *  - one submission queue and one completion queue mapped from the kernel
+ *  - used from one thread at a time, like the frames of a transport
+ **********************************************************************/
+class uring : boost::noncopyable{
+public:
+    uring(const size_t entries, const bool sqpoll):
+        _sq_ptr(MAP_FAILED), _cq_ptr(MAP_FAILED), _sqes(MAP_FAILED),
+        _sqpoll(sqpoll), _pending(0)
+    {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        if (sqpoll){
+            params.flags |= IORING_SETUP_SQPOLL;
+            params.sq_thread_idle = SQPOLL_IDLE_MS;
+        }
+        _fd = int(::syscall(__NR_io_uring_setup, unsigned(entries), &params));
+        if (_fd < 0) throw uhd::os_error(str(boost::format(
+            "io_uring_setup failed: %s") % std::strerror(errno)));
+
+        _sq_size = params.sq_off.array + params.sq_entries*sizeof(unsigned);
+        _cq_size = params.cq_off.cqes + params.cq_entries*sizeof(io_uring_cqe);
+        _single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (_single_mmap) _sq_size = _cq_size = std::max(_sq_size, _cq_size);
+        _sqes_size = params.sq_entries*sizeof(io_uring_sqe);
+
+        _sq_ptr = ::mmap(NULL, _sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+        _cq_ptr = (_single_mmap)? _sq_ptr :
+            ::mmap(NULL, _cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+        _sqes = ::mmap(NULL, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+        if (_sq_ptr == MAP_FAILED or _cq_ptr == MAP_FAILED or _sqes == MAP_FAILED){
+            const int err = errno;
+            this->unmap();
+            ::close(_fd);
+            throw uhd::os_error(str(boost::format("io_uring mmap failed: %s") % std::strerror(err)));
+        }
+
+        char *sq = static_cast<char *>(_sq_ptr);
+        _sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        _sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        _sq_mask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        _sq_entries = params.sq_entries;
+        _sq_flags = reinterpret_cast<unsigned *>(sq + params.sq_off.flags);
+        _sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+        char *cq = static_cast<char *>(_cq_ptr);
+        _cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        _cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        _cq_mask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        _cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    }
+
+    ~uring(void){
+        this->unmap();
+        ::close(_fd);
+    }
+
+    //! Register the frames, ops on them use the buffer index
+    bool register_buffers(const std::vector<iovec> &iovecs){
+        return this->enter_register(IORING_REGISTER_BUFFERS, &iovecs[0], unsigned(iovecs.size()));
+    }
+
+    //! Register the socket as the fixed file 0
+    bool register_file(int fd){
+        return this->enter_register(IORING_REGISTER_FILES, &fd, 1);
+    }
+
+    /*!
+     * Can the kernel do the operation?
+     * Kernels that set up a ring may still lack the plain reads and writes.
+     */
+    bool supports(const boost::uint8_t opcode){
+        std::vector<char> mem(sizeof(io_uring_probe) + IORING_OP_LAST*sizeof(io_uring_probe_op), 0);
+        io_uring_probe *probe = reinterpret_cast<io_uring_probe *>(&mem[0]);
+        if (not this->enter_register(IORING_REGISTER_PROBE, probe, IORING_OP_LAST)) return false;
+        return opcode <= probe->last_op and (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+
+    //! Is the kernel submitting the queued entries with a polling thread?
+    UHD_INLINE bool sqpoll(void) const{
+        return _sqpoll;
+    }
+
+    //! Queue a read or write on fixed file 0, submitted by the next submit()
+    UHD_INLINE void prep(
+        const boost::uint8_t opcode, void *mem, const size_t len,
+        const int buf_index, const boost::uint64_t user_data
+    ){
+        if (this->sq_full()) this->make_room();
+        const unsigned tail = *_sq_tail;
+        const unsigned index = tail & _sq_mask;
+        io_uring_sqe *sqe = static_cast<io_uring_sqe *>(_sqes) + index;
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->flags = IOSQE_FIXED_FILE;
+        sqe->fd = 0;
+        sqe->addr = reinterpret_cast<boost::uint64_t>(mem);
+        sqe->len = boost::uint32_t(len);
+        sqe->buf_index = boost::uint16_t(std::max(buf_index, 0));
+        sqe->user_data = user_data;
+        _sq_array[index] = index;
+        __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+        _pending++;
+    }
+
+    //! Number of queued entries not yet submitted
+    UHD_INLINE size_t pending(void) const{
+        return _pending;
+    }
+
+    //! Hand the queued entries to the kernel (wake the polling thread)
+    void submit(void){
+        if (_pending == 0) return;
+        if (_sqpoll){
+            _pending = 0;
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            if ((__atomic_load_n(_sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) == 0) return;
+            this->enter(0, 0, IORING_ENTER_SQ_WAKEUP);
+            return;
+        }
+        const int ret = this->enter(unsigned(_pending), 0, 0);
+        if (ret > 0) _pending -= std::min(_pending, size_t(ret));
+    }
+
+    //! Pop the next completion
+    UHD_INLINE bool reap(boost::uint64_t &user_data, int &res){
+        const unsigned head = *_cq_head;
+        if (head == __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE)) return false;
+        const io_uring_cqe &cqe = _cqes[head & _cq_mask];
+        user_data = cqe.user_data;
+        res = cqe.res;
+        __atomic_store_n(_cq_head, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    //! Wait for a completion, submit the queued entries first
+    bool wait(const double timeout){
+        this->submit();
+        if (__atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE) != *_cq_head) return true;
+        pollfd pfd;
+        pfd.fd = _fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        timespec ts;
+        ts.tv_sec = time_t(timeout);
+        ts.tv_nsec = long((timeout - double(ts.tv_sec))*1e9);
+        return ::ppoll(&pfd, 1, &ts, NULL) > 0;
+    }
+
+private:
+    //! The kernel has not taken every entry yet
+    UHD_INLINE bool sq_full(void) const{
+        return *_sq_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) >= _sq_entries;
+    }
+
+    //! Submit the queued entries, the polling thread may take a moment
+    void make_room(void){
+        this->submit();
+        for (size_t i = 0; _sqpoll and this->sq_full() and i < 1000; i++) ::sched_yield();
+        if (this->sq_full()) throw uhd::os_error("io_uring submission queue is full");
+    }
+
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags){
+        int ret;
+        do{
+            ret = int(::syscall(__NR_io_uring_enter, _fd, to_submit, min_complete, flags, NULL, 0));
+        } while (ret < 0 and errno == EINTR);
+        if (ret < 0 and errno != EAGAIN and errno != EBUSY) throw uhd::os_error(str(
+            boost::format("io_uring_enter failed: %s") % std::strerror(errno)));
+        return ret;
+    }
+
+    bool enter_register(unsigned opcode, const void *arg, unsigned nr_args){
+        const int ret = int(::syscall(__NR_io_uring_register, _fd, opcode, arg, nr_args));
+        if (ret < 0) UHD_LOG << boost::format("io_uring_register(%u) failed: %s") % opcode % std::strerror(errno) << std::endl;
+        return ret >= 0;
+    }
+
+    void unmap(void){
+        if (_sqes != MAP_FAILED) ::munmap(_sqes, _sqes_size);
+        if (_cq_ptr != MAP_FAILED and not _single_mmap) ::munmap(_cq_ptr, _cq_size);
+        if (_sq_ptr != MAP_FAILED) ::munmap(_sq_ptr, _sq_size);
+    }
+
+    int _fd;
+    void *_sq_ptr, *_cq_ptr, *_sqes;
+    size_t _sq_size, _cq_size, _sqes_size;
+    bool _single_mmap;
+    const bool _sqpoll;
+    size_t _pending;
+
+    unsigned *_sq_head, *_sq_tail, *_sq_flags, *_sq_array;
+    unsigned _sq_mask, _sq_entries;
+    unsigned *_cq_head, *_cq_tail;
+    unsigned _cq_mask;
+    io_uring_cqe *_cqes;
+};
+
+/***********************************************************************
+ * Frame fifo:
+ *  - frame indexes in order, each frame is in at most one fifo
+ **********************************************************************/
+class frame_fifo{
+public:
+    frame_fifo(const size_t capacity): _indexes(capacity), _head(0), _size(0){}
+
+    UHD_INLINE bool empty(void) const{return _size == 0;}
+
+    UHD_INLINE size_t front(void) const{return _indexes[_head];}
+
+    UHD_INLINE void push(const size_t index){
+        _indexes[(_head + _size++) % _indexes.size()] = index;
+    }
+
+    UHD_INLINE size_t pop(void){
+        const size_t index = _indexes[_head];
+        _head = (_head + 1) % _indexes.size();
+        _size--;
+        return index;
+    }
+
+private:
+    std::vector<size_t> _indexes;
+    size_t _head, _size;
+};
+
+/***********************************************************************
+ * Reusable managed receiver buffer:
+ *  - claimed while the ring reads into it or the caller holds it
+ **********************************************************************/
+class udp_uring_mrb : public managed_recv_buffer{
+public:
+    udp_uring_mrb(void *mem): _mem(mem), _len(0){
+        _claimer.claim_with_wait(0.0);
+    }
+
+    void release(void){
+        _claimer.release();
+    }
+
+    //! Take the frame back from a caller that released it
+    UHD_INLINE bool reclaim(void){
+        return _claimer.claim_with_wait(0.0);
+    }
+
+    UHD_INLINE void set_len(const size_t len){_len = len;}
+
+    UHD_INLINE sptr get_new(void){
+        return make(this, _mem, _len);
+    }
+
+    void *mem(void){return _mem;}
+
+private:
+    void *_mem;
+    size_t _len;
+    simple_claimer _claimer;
+};
+
+/***********************************************************************
+ * Reusable managed send buffer:
+ *  - commit queues a write on the ring
+ *  - claimed until the write completes
+ **********************************************************************/
+class udp_uring_impl;
+
+class udp_uring_msb : public managed_send_buffer{
+public:
+    udp_uring_msb(void *mem, udp_uring_impl &xport, const size_t index, const size_t frame_size):
+        _mem(mem), _xport(xport), _index(index), _frame_size(frame_size) { /*NOP*/ }
+
+    void release(void);
+
+    UHD_INLINE sptr get_new(void){
+        _claimer.claim_with_wait(0.0);
+        return make(this, _mem, _frame_size);
+    }
+
+    UHD_INLINE bool in_flight(void){
+        if (not _claimer.claim_with_wait(0.0)) return true;
+        _claimer.release();
+        return false;
+    }
+
+    UHD_INLINE void sent(void){
+        _claimer.release();
+    }
+
+    void *mem(void){return _mem;}
+
+private:
+    void *_mem;
+    udp_uring_impl &_xport;
+    const size_t _index;
+    const size_t _frame_size;
+    simple_claimer _claimer;
+};
+
+/***********************************************************************
+ * Zero Copy UDP implementation with io_uring:
+ *   The receive ring keeps a read queued for every free frame.
+ *   A receive takes the next completion without a system call while
+ *   packets are waiting; released frames are queued again in batches.
+ *   The send ring writes committed frames; with a polling thread the
+ *   kernel picks them up without a system call. Otherwise the writes
+ *   are submitted in batches of a quarter of the frames, and a flush
+ *   thread submits a partial batch after 100 us, so the last frames of
+ *   a burst do not wait for the next commit. The send mutex keeps the
+ *   flush thread and the sender apart on the submission queue.
+ *   Send completions are reaped when frames are needed.
+ *   Receive and send use separate rings, so one thread can receive
+ *   while another thread sends, like the socket implementation.
+ **********************************************************************/
+class udp_uring_impl : public udp_uring_zero_copy{
+public:
+    udp_uring_impl(
+        const std::string &addr,
+        const std::string &port,
+        const zero_copy_xport_params &xport_params,
+        const bool sqpoll
+    ):
+        _recv_frame_size(xport_params.recv_frame_size),
+        _num_recv_frames(xport_params.num_recv_frames),
+        _send_frame_size(xport_params.send_frame_size),
+        _num_send_frames(xport_params.num_send_frames),
+        _recv_buffer_pool(buffer_pool::make(xport_params.num_recv_frames, xport_params.recv_frame_size)),
+        _send_buffer_pool(buffer_pool::make(xport_params.num_send_frames, xport_params.send_frame_size)),
+        _next_send_buff_index(0),
+        _recv_ring(_num_recv_frames, false),
+        _send_ring(_num_send_frames, sqpoll),
+        _completed(_num_recv_frames),
+        _outstanding(_num_recv_frames),
+        _recv_submit_batch(std::max<size_t>(_num_recv_frames/4, 1)),
+        _send_submit_batch(std::max<size_t>(_num_send_frames/4, 1)),
+        _reads_in_flight(0), _writes_in_flight(0)
+    {
+        UHD_LOG << boost::format("Creating udp io_uring transport for %s %s") % addr % port << std::endl;
+
+        //resolve the address
+        asio::ip::udp::resolver resolver(_io_service);
+        asio::ip::udp::resolver::query query(asio::ip::udp::v4(), addr, port);
+        asio::ip::udp::endpoint receiver_endpoint = *resolver.resolve(query);
+
+        //create, open, and connect the socket
+        _socket = socket_sptr(new asio::ip::udp::socket(_io_service));
+        _socket->open(asio::ip::udp::v4());
+        _socket->connect(receiver_endpoint);
+        const int sock_fd = _socket->native();
+
+        //register the socket, the sqpoll thread needs a fixed file
+        if (not _recv_ring.register_file(sock_fd) or not _send_ring.register_file(sock_fd)){
+            throw uhd::os_error("io_uring cannot register the socket");
+        }
+
+        //register the frames, unregistered frames are plain reads and writes
+        std::vector<iovec> iovecs(_num_recv_frames);
+        for (size_t i = 0; i < _num_recv_frames; i++){
+            iovecs[i].iov_base = _recv_buffer_pool->at(i);
+            iovecs[i].iov_len = _recv_frame_size;
+        }
+        _recv_fixed = _recv_ring.register_buffers(iovecs);
+        iovecs.resize(_num_send_frames);
+        for (size_t i = 0; i < _num_send_frames; i++){
+            iovecs[i].iov_base = _send_buffer_pool->at(i);
+            iovecs[i].iov_len = _send_frame_size;
+        }
+        _send_fixed = _send_ring.register_buffers(iovecs);
+        if (not _recv_fixed or not _send_fixed) UHD_LOG
+            << "io_uring cannot register the frames (locked memory limit?), using plain reads and writes" << std::endl;
+
+        //allocate re-usable managed receive buffers, queue a read into each
+        for (size_t i = 0; i < _num_recv_frames; i++){
+            _mrb_pool.push_back(boost::make_shared<udp_uring_mrb>(_recv_buffer_pool->at(i)));
+            this->queue_read(i);
+        }
+        _recv_ring.submit();
+
+        //allocate re-usable managed send buffers
+        for (size_t i = 0; i < _num_send_frames; i++){
+            _msb_pool.push_back(boost::make_shared<udp_uring_msb>(
+                _send_buffer_pool->at(i), boost::ref(*this), i, _send_frame_size
+            ));
+        }
+
+        if (not _send_ring.sqpoll()){
+            _flush_task = task::make(boost::bind(&udp_uring_impl::flush_loop, this));
+        }
+    }
+
+    ~udp_uring_impl(void){
+        _flush_task.reset();
+        UHD_SAFE_CALL(this->drain();)
+    }
+
+    asio::ip::udp::socket &get_socket(void){
+        return *_socket;
+    }
+
+    /*******************************************************************
+     * Receive implementation:
+     * Queue the frames that the caller released, take the next
+     * completed read, wait on the ring when there is none.
+     ******************************************************************/
+    managed_recv_buffer::sptr get_recv_buff(double timeout){
+        //frames go back to the ring in the order they were handed out
+        while (not _outstanding.empty() and _mrb_pool[_outstanding.front()]->reclaim()){
+            this->queue_read(_outstanding.pop());
+        }
+        if (_recv_ring.pending() >= _recv_submit_batch) _recv_ring.submit();
+
+        this->reap_recv();
+        if (_completed.empty() and _recv_ring.wait(timeout)) this->reap_recv();
+        if (_completed.empty()) return managed_recv_buffer::sptr(); //null for timeout
+
+        const size_t index = _completed.pop();
+        _outstanding.push(index);
+        return _mrb_pool[index]->get_new();
+    }
+
+    size_t get_num_recv_frames(void) const {return _num_recv_frames;}
+    size_t get_recv_frame_size(void) const {return _recv_frame_size;}
+
+    /*******************************************************************
+     * Send implementation:
+     * Wait for the write of the next frame to complete, reaping
+     * the send completions, and advance the index.
+     ******************************************************************/
+    managed_send_buffer::sptr get_send_buff(double timeout){
+        if (_next_send_buff_index == _num_send_frames) _next_send_buff_index = 0;
+        udp_uring_msb &msb = *_msb_pool[_next_send_buff_index];
+
+        this->reap_send();
+        while (msb.in_flight()){
+            this->flush_send(); //the frame may be waiting for its batch
+            if (not _send_ring.wait(timeout)) return managed_send_buffer::sptr();
+            this->reap_send();
+        }
+
+        _next_send_buff_index++;
+        return msb.get_new();
+    }
+
+    size_t get_num_send_frames(void) const {return _num_send_frames;}
+    size_t get_send_frame_size(void) const {return _send_frame_size;}
+
+    //! Called by a send buffer on commit
+    UHD_INLINE void commit_send(const size_t index, void *mem, const size_t len){
+        if (len == 0){
+            _msb_pool[index]->sent();
+            return;
+        }
+        boost::mutex::scoped_lock lock(_send_mutex);
+        _send_ring.prep(
+            (_send_fixed)? IORING_OP_WRITE_FIXED : IORING_OP_WRITE,
+            mem, len, (_send_fixed)? int(index) : -1, index
+        );
+        _writes_in_flight++;
+        if (_send_ring.sqpoll() or _send_ring.pending() >= _send_submit_batch) _send_ring.submit();
+        else if (_send_ring.pending() == 1) _send_cond.notify_one(); //the flush thread submits it in time
+    }
+
+private:
+    UHD_INLINE void queue_read(const size_t index){
+        _recv_ring.prep(
+            (_recv_fixed)? IORING_OP_READ_FIXED : IORING_OP_READ,
+            _mrb_pool[index]->mem(), _recv_frame_size, (_recv_fixed)? int(index) : -1, index
+        );
+        _reads_in_flight++;
+    }
+
+    //! Submit the deferred writes now
+    void flush_send(void){
+        boost::mutex::scoped_lock lock(_send_mutex);
+        _send_ring.submit();
+    }
+
+    /*******************************************************************
+     * Flush thread:
+     * Wait for a deferred write, give the sender the flush delay to
+     * fill the batch, then submit what is still queued.
+     ******************************************************************/
+    void flush_loop(void){
+        boost::mutex::scoped_lock lock(_send_mutex);
+        while (_send_ring.pending() == 0) _send_cond.wait(lock);
+        const boost::system_time flush_time = boost::get_system_time() +
+            boost::posix_time::microseconds(SEND_FLUSH_DELAY_US);
+        while (_send_ring.pending() != 0 and _send_cond.timed_wait(lock, flush_time)){}
+        _send_ring.submit();
+    }
+
+    /*******************************************************************
+     * The kernel may still fill or send a frame after the ring is
+     * closed, so cancel the reads and let the writes finish first.
+     ******************************************************************/
+    void drain(void){
+        _recv_ring.submit();
+        for (size_t i = 0; i < _num_recv_frames; i++){
+            _recv_ring.prep(IORING_OP_ASYNC_CANCEL, reinterpret_cast<void *>(i), 0, -1, CANCEL_USER_DATA);
+        }
+        boost::uint64_t index; int res;
+        for (size_t tries = 0; _reads_in_flight != 0 and tries < 10; tries++){
+            _recv_ring.wait(0.1);
+            while (_recv_ring.reap(index, res)){
+                if (index != CANCEL_USER_DATA) _reads_in_flight--;
+            }
+        }
+        for (size_t tries = 0; _writes_in_flight != 0 and tries < 10; tries++){
+            _send_ring.wait(0.1);
+            while (_send_ring.reap(index, res)) _writes_in_flight--;
+        }
+        if (_reads_in_flight != 0 or _writes_in_flight != 0) UHD_MSG(warning)
+            << "io_uring transport closed with transfers in flight" << std::endl;
+    }
+
+    void reap_recv(void){
+        boost::uint64_t index; int res;
+        while (_recv_ring.reap(index, res)){
+            _reads_in_flight--;
+            if (res < 0 and is_fatal(-res)) throw uhd::os_error(str(
+                boost::format("io_uring read failed: %s") % std::strerror(-res)));
+            if (res < 0){ //connection refused or similar, the frame reads again
+                UHD_LOG << boost::format("io_uring read failed: %s") % std::strerror(-res) << std::endl;
+                this->queue_read(size_t(index));
+                continue;
+            }
+            _mrb_pool[size_t(index)]->set_len(size_t(res));
+            _completed.push(size_t(index));
+        }
+    }
+
+    //! A read that fails this way fails again, the kernel or the socket cannot do it
+    static bool is_fatal(const int err){
+        return err == EINVAL or err == EOPNOTSUPP or err == EBADF or err == EFAULT;
+    }
+
+    void reap_send(void){
+        boost::uint64_t index; int res;
+        while (_send_ring.reap(index, res)){
+            _writes_in_flight--;
+            udp_uring_msb &msb = *_msb_pool[size_t(index)];
+            if (res == -ENOBUFS){ //try to send again
+                this->commit_send(size_t(index), msb.mem(), msb.size());
+                continue;
+            }
+            if (res < 0) UHD_LOG << boost::format("io_uring write failed: %s") % std::strerror(-res) << std::endl;
+            msb.sent();
+        }
+    }
+
+    //memory management -> buffers and fifos
+    const size_t _recv_frame_size, _num_recv_frames;
+    const size_t _send_frame_size, _num_send_frames;
+    buffer_pool::sptr _recv_buffer_pool, _send_buffer_pool;
+    std::vector<boost::shared_ptr<udp_uring_msb> > _msb_pool;
+    std::vector<boost::shared_ptr<udp_uring_mrb> > _mrb_pool;
+    size_t _next_send_buff_index;
+
+    //asio guts -> socket and service
+    asio::io_service _io_service;
+    socket_sptr _socket;
+
+    //ring guts -> completed reads and frames held by the caller
+    uring _recv_ring, _send_ring;
+    bool _recv_fixed, _send_fixed;
+    frame_fifo _completed, _outstanding;
+    const size_t _recv_submit_batch, _send_submit_batch;
+    size_t _reads_in_flight, _writes_in_flight;
+
+    //flush thread -> submits the writes that wait for their batch
+    boost::mutex _send_mutex;
+    boost::condition_variable _send_cond;
+    task::sptr _flush_task;
+};
+
+void udp_uring_msb::release(void){
+    _xport.commit_send(_index, _mem, size());
+}
+
+/***********************************************************************
+ * io_uring zero copy make functions
+ **********************************************************************/
+bool udp_uring_zero_copy::is_supported(void){
+    try{
+        uring probe(1, false);
+        if (probe.supports(IORING_OP_READ) and probe.supports(IORING_OP_WRITE)
+            and probe.supports(IORING_OP_ASYNC_CANCEL)) return true;
+        UHD_LOG << "io_uring lacks reads and writes on this kernel" << std::endl;
+    }
+    catch(const uhd::exception &e){
+        UHD_LOG << e.what() << std::endl;
+    }
+    return false;
+}
+
+udp_uring_zero_copy::sptr udp_uring_zero_copy::make(
+    const std::string &addr,
+    const std::string &port,
+    const zero_copy_xport_params &xport_params,
+    const bool sqpoll
+){
+    try{
+        return sptr(new udp_uring_impl(addr, port, xport_params, sqpoll));
+    }
+    catch(const uhd::os_error &e){
+        if (not sqpoll) throw;
+        UHD_LOG << e.what() << ", trying without a polling thread" << std::endl;
+    }
+    return sptr(new udp_uring_impl(addr, port, xport_params, false));
+}
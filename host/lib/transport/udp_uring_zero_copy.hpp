@@ -0,0 +1,67 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_TRANSPORT_UDP_URING_ZERO_COPY_HPP
+#define INCLUDED_LIBUHD_TRANSPORT_UDP_URING_ZERO_COPY_HPP
+
+#include "udp_common.hpp"
+#include <uhd/transport/udp_zero_copy.hpp>
+
+namespace uhd{ namespace transport{
+
+/*!
+ * A zero copy udp transport on Linux io_uring (transport=uring).
+ *
+ * Every receive frame has a read queued on the ring while the caller
+ * does not hold it, a filled frame is a completion on the ring.
+ * Send frames are written from the ring, a kernel thread picks them up
+ * when send_sqpoll is enabled. The frames are registered buffers and
+ * the socket is a registered file.
+ */
+class udp_uring_zero_copy : public udp_zero_copy{
+public:
+    typedef boost::shared_ptr<udp_uring_zero_copy> sptr;
+
+    /*!
+     * Can this process set up an io_uring?
+     * The kernel may lack support, or a policy may forbid it.
+     */
+    static bool is_supported(void);
+
+    /*!
+     * Make a new io_uring transport:
+     * The socket is connected to the given address and port.
+     * \param addr a string representing the destination address
+     * \param port a string representing the destination port
+     * \param xport_params the frame sizes and numbers
+     * \param sqpoll true to submit sends with a kernel polling thread
+     * \throws uhd::os_error when the ring cannot be set up
+     */
+    static sptr make(
+        const std::string &addr,
+        const std::string &port,
+        const zero_copy_xport_params &xport_params,
+        const bool sqpoll
+    );
+
+    //! Get the socket, to resize its kernel buffers
+    virtual boost::asio::ip::udp::socket &get_socket(void) = 0;
+};
+
+}} //namespace uhd::transport
+
+#endif /* INCLUDED_LIBUHD_TRANSPORT_UDP_URING_ZERO_COPY_HPP */
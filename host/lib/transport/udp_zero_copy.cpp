@@ -16,6 +16,10 @@
 //
 
 #include "udp_common.hpp"
+#include "async_reactor.hpp"
+#ifdef HAVE_IO_URING
+#include "udp_uring_zero_copy.hpp"
+#endif /*HAVE_IO_URING*/
 #include <uhd/transport/udp_zero_copy.hpp>
 #include <uhd/transport/udp_simple.hpp> //mtu
 #include <uhd/transport/buffer_pool.hpp>
@@ -24,7 +28,9 @@
 #include <uhd/utils/atomic.hpp>
 #include <boost/format.hpp>
 #include <boost/make_shared.hpp>
+#include <uhd/types/time_spec.hpp>
 #include <boost/thread/thread.hpp> //sleep
+#include <algorithm>
 #include <vector>
 
 using namespace uhd;
@@ -67,8 +73,8 @@ static void check_registry_for_fast_send_threshold(const size_t mtu){
  **********************************************************************/
 class udp_zero_copy_asio_mrb : public managed_recv_buffer{
 public:
-    udp_zero_copy_asio_mrb(void *mem, int sock_fd, const size_t frame_size):
-        _mem(mem), _sock_fd(sock_fd), _frame_size(frame_size), _len(0) { /*NOP*/ }
+    udp_zero_copy_asio_mrb(void *mem, int sock_fd, const size_t frame_size, const double busy_poll):
+        _mem(mem), _sock_fd(sock_fd), _frame_size(frame_size), _len(0), _busy_poll(busy_poll) { /*NOP*/ }
 
     void release(void){
         _claimer.release();
@@ -76,16 +82,23 @@ public:
 
     UHD_INLINE sptr get_new(const double timeout, size_t &index){
         if (not _claimer.claim_with_wait(timeout)) return sptr();
+        double poll_time = 0.0;
 
         #ifdef MSG_DONTWAIT //try a non-blocking recv() if supported
-        _len = ::recv(_sock_fd, (char *)_mem, _frame_size, MSG_DONTWAIT);
-        if (_len > 0){
-            index++; //advances the caller's buffer
-            return make(this, _mem, size_t(_len));
-        }
+        //busy poll: keep trying for up to the poll budget before blocking
+        poll_time = std::min(_busy_poll, timeout);
+        const time_spec_t poll_end = (poll_time > 0.0)?
+            time_spec_t::get_system_time() + time_spec_t(poll_time) : time_spec_t(0.0);
+        do{
+            _len = ::recv(_sock_fd, (char *)_mem, _frame_size, MSG_DONTWAIT);
+            if (_len > 0){
+                index++; //advances the caller's buffer
+                return make(this, _mem, size_t(_len));
+            }
+        } while (poll_time > 0.0 and time_spec_t::get_system_time() < poll_end);
         #endif
 
-        if (wait_for_recv_ready(_sock_fd, timeout)){
+        if (wait_for_recv_ready(_sock_fd, timeout - poll_time)){
             _len = ::recv(_sock_fd, (char *)_mem, _frame_size, 0);
             UHD_ASSERT_THROW(_len > 0); // TODO: Handle case of recv error
             index++; //advances the caller's buffer
@@ -101,6 +114,7 @@ private:
     int _sock_fd;
     size_t _frame_size;
     ssize_t _len;
+    const double _busy_poll;
     simple_claimer _claimer;
 };
 
@@ -151,14 +165,15 @@ private:
  *   However, it is not a true zero copy implementation as each
  *   send and recv requires a copy operation to/from userspace.
  **********************************************************************/
-class udp_zero_copy_asio_impl : public udp_zero_copy{
+class udp_zero_copy_asio_impl : public udp_zero_copy, public recv_pollable{
 public:
     typedef boost::shared_ptr<udp_zero_copy_asio_impl> sptr;
 
     udp_zero_copy_asio_impl(
         const std::string &addr,
         const std::string &port,
-        const zero_copy_xport_params& xport_params
+        const zero_copy_xport_params& xport_params,
+        const double busy_poll
     ):
         _recv_frame_size(xport_params.recv_frame_size),
         _num_recv_frames(xport_params.num_recv_frames),
@@ -185,10 +200,20 @@ public:
         _socket->connect(receiver_endpoint);
         _sock_fd = _socket->native();
 
+        //let blocking receives also poll the device queue (linux only)
+        #ifdef SO_BUSY_POLL
+        if (busy_poll > 0.0){
+            const int busy_poll_us = int(busy_poll*1e6);
+            if (::setsockopt(_sock_fd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_us, sizeof(busy_poll_us)) != 0){
+                UHD_LOG << "Cannot set SO_BUSY_POLL, busy polling in user space only" << std::endl;
+            }
+        }
+        #endif /*SO_BUSY_POLL*/
+
         //allocate re-usable managed receive buffers
         for (size_t i = 0; i < get_num_recv_frames(); i++){
             _mrb_pool.push_back(boost::make_shared<udp_zero_copy_asio_mrb>(
-                _recv_buffer_pool->at(i), _sock_fd, get_recv_frame_size()
+                _recv_buffer_pool->at(i), _sock_fd, get_recv_frame_size(), busy_poll
             ));
         }
 
@@ -200,18 +225,8 @@ public:
         }
     }
 
-    //get size for internal socket buffer
-    template <typename Opt> size_t get_buff_size(void) const{
-        Opt option;
-        _socket->get_option(option);
-        return option.value();
-    }
-
-    //set size for internal socket buffer
-    template <typename Opt> size_t resize_buff(size_t num_bytes){
-        Opt option(num_bytes);
-        _socket->set_option(option);
-        return get_buff_size<Opt>();
+    asio::ip::udp::socket &get_socket(void){
+        return *_socket;
     }
 
     /*******************************************************************
@@ -226,6 +241,10 @@ public:
     size_t get_num_recv_frames(void) const {return _num_recv_frames;}
     size_t get_recv_frame_size(void) const {return _recv_frame_size;}
 
+    int get_recv_fd(void){
+        return _sock_fd;
+    }
+
     /*******************************************************************
      * Send implementation:
      * Block on the managed buffer's get call and advance the index.
@@ -257,7 +276,7 @@ private:
  * UDP zero copy make function
  **********************************************************************/
 template<typename Opt> static size_t resize_buff_helper(
-    udp_zero_copy_asio_impl::sptr udp_trans,
+    asio::ip::udp::socket &socket,
     const size_t target_size,
     const std::string &name
 ){
@@ -271,7 +290,10 @@ template<typename Opt> static size_t resize_buff_helper(
 
     //resize the buffer if size was provided
     if (target_size > 0){
-        actual_size = udp_trans->resize_buff<Opt>(target_size);
+        socket.set_option(Opt(int(target_size)));
+        Opt option;
+        socket.get_option(option);
+        actual_size = size_t(option.value());
         UHD_LOG << boost::format(
             "Target %s sock buff size: %d bytes\n"
             "Actual %s sock buff size: %d bytes"
@@ -302,6 +324,9 @@ udp_zero_copy::sptr udp_zero_copy::make(
     xport_params.send_frame_size = size_t(hints.cast<double>("send_frame_size", default_buff_args.send_frame_size));
     xport_params.num_send_frames = size_t(hints.cast<double>("num_send_frames", default_buff_args.num_send_frames));
 
+    //time to spin on the socket before a receive blocks
+    const double busy_poll = hints.cast<double>("recv_busy_poll", 0.0)/1e6;
+
     //extract buffer size hints from the device addr
     size_t usr_recv_buff_size = size_t(hints.cast<double>("recv_buff_size", 0.0));
     size_t usr_send_buff_size = size_t(hints.cast<double>("send_buff_size", 0.0));
@@ -322,15 +347,39 @@ udp_zero_copy::sptr udp_zero_copy::make(
         }
     }
 
+    //the io_uring implementation when requested and supported
+    const std::string transport = hints.get("transport", "");
+    if (not transport.empty() and transport != "uring") throw uhd::value_error(
+        "unknown udp transport " + transport + ", use uring or leave it unset");
+    #ifdef HAVE_IO_URING
+    if (transport == "uring" and busy_poll > 0.0) UHD_MSG(warning)
+        << "recv_busy_poll does not apply to transport=uring, ignoring it" << std::endl;
+    if (transport == "uring" and udp_uring_zero_copy::is_supported()){
+        udp_uring_zero_copy::sptr uring_trans = udp_uring_zero_copy::make(
+            addr, port, xport_params, hints.cast<int>("send_sqpoll", 0) != 0
+        );
+        buff_params_out.recv_buff_size =
+            resize_buff_helper<asio::socket_base::receive_buffer_size>(uring_trans->get_socket(), usr_recv_buff_size, "recv");
+        buff_params_out.send_buff_size =
+            resize_buff_helper<asio::socket_base::send_buffer_size>   (uring_trans->get_socket(), usr_send_buff_size, "send");
+        return uring_trans;
+    }
+    #endif /*HAVE_IO_URING*/
+    static bool warned = false; //only allow one printed warning per process
+    if (transport == "uring" and not warned){
+        UHD_MSG(warning) << "io_uring is not available on this system, using the socket transport" << std::endl;
+        warned = true;
+    }
+
     udp_zero_copy_asio_impl::sptr udp_trans(
-        new udp_zero_copy_asio_impl(addr, port, xport_params)
+        new udp_zero_copy_asio_impl(addr, port, xport_params, busy_poll)
     );
 
     //call the helper to resize send and recv buffers
     buff_params_out.recv_buff_size =
-        resize_buff_helper<asio::socket_base::receive_buffer_size>(udp_trans, usr_recv_buff_size, "recv");
+        resize_buff_helper<asio::socket_base::receive_buffer_size>(udp_trans->get_socket(), usr_recv_buff_size, "recv");
     buff_params_out.send_buff_size =
-        resize_buff_helper<asio::socket_base::send_buffer_size>   (udp_trans, usr_send_buff_size, "send");
+        resize_buff_helper<asio::socket_base::send_buffer_size>   (udp_trans->get_socket(), usr_send_buff_size, "send");
 
     return udp_trans;
 }
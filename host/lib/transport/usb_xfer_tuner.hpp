@@ -0,0 +1,128 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_TRANSPORT_USB_XFER_TUNER_HPP
+#define INCLUDED_LIBUHD_TRANSPORT_USB_XFER_TUNER_HPP
+
+#include <uhd/config.hpp>
+#include <boost/utility.hpp>
+#include <algorithm>
+
+namespace uhd{ namespace transport{
+
+static const size_t USB_XFER_MIN_IN_FLIGHT  = 2;
+static const size_t USB_XFER_MIN_AHEAD      = 2;   //grow when fewer transfers were queued ahead
+static const size_t USB_XFER_ADAPT_WINDOW   = 256; //completions between shrink decisions
+static const double USB_XFER_MAX_GAP        = 4.0; //intervals, longer gaps are stream starts and stops
+
+/***********************************************************************
+ * USB transfer tuner:
+ * Adapts the number of receive transfers in flight in packet mode.
+ *
+ * Every receive transfer is timed from its submit to its completion.
+ * While streaming, the bus completes transfers at a steady interval,
+ * and a transfer completes after the transfers queued ahead of it:
+ * latency/interval - 1 transfers were ahead of it when it was submitted.
+ *
+ *  - Fewer than 2 transfers ahead means the host barely keeps up:
+ *    grow by one, or by two when none were ahead. With none ahead, the
+ *    bus went idle waiting for the host, and the device overflows if
+ *    this lasts; the transport cannot decode the overflow packets,
+ *    so this is how it sees them coming.
+ *  - After a window of 256 completions that all had more than 4 ahead,
+ *    shrink by one.
+ *
+ * The interval is a running average of the time between completions.
+ * Longer gaps (the stream started, stopped or the rate changed) are not
+ * averaged in, until 8 of them in a row show a new rate.
+ * The tuner is called by the thread that pops the completions.
+ **********************************************************************/
+class usb_xfer_tuner : boost::noncopyable{
+public:
+    /*!
+     * Make a new tuner.
+     * \param max_in_flight the number of transfers, the upper limit
+     */
+    usb_xfer_tuner(const size_t max_in_flight):
+        _max_in_flight(std::max(max_in_flight, USB_XFER_MIN_IN_FLIGHT)),
+        _num_in_flight(std::max(USB_XFER_MIN_IN_FLIGHT, max_in_flight/2)),
+        _last_complete(0.0), _interval(0.0),
+        _num_gaps(0), _adapt_count(0), _adapt_min_ahead(max_in_flight)
+    {
+        _num_in_flight = std::min(_num_in_flight, _max_in_flight);
+    }
+
+    //! The number of transfers to keep in flight
+    size_t get_num_in_flight(void) const
+    {
+        return _num_in_flight;
+    }
+
+    //! The average time between completions in seconds, 0.0 before it is known
+    double get_interval(void) const
+    {
+        return _interval;
+    }
+
+    /*!
+     * Note a completed transfer.
+     * \param latency_secs the time from submit to completion
+     * \param complete_secs the time of the completion
+     * \return true when the number of transfers in flight changed
+     */
+    bool update(const double latency_secs, const double complete_secs)
+    {
+        const double gap = complete_secs - _last_complete;
+        const bool first = (_last_complete == 0.0);
+        _last_complete = complete_secs;
+        if (first or gap <= 0.0) return false;
+
+        //track the interval, skipping the gaps of a stream that starts or stops
+        const bool long_gap = (_interval != 0.0 and gap >= USB_XFER_MAX_GAP*_interval);
+        if (long_gap and ++_num_gaps < 8) return false;
+        _interval = (_interval == 0.0 or long_gap)? gap : _interval + (gap - _interval)/8;
+        _num_gaps = 0;
+
+        //the transfers that were queued ahead of this one at submit
+        const double ahead = std::max(latency_secs/_interval - 1.0, 0.0);
+        const size_t num_ahead = size_t(ahead + 0.5);
+        _adapt_min_ahead = std::min(_adapt_min_ahead, num_ahead);
+
+        const size_t old_num_in_flight = _num_in_flight;
+        if (num_ahead < USB_XFER_MIN_AHEAD){
+            _num_in_flight = std::min(_max_in_flight, _num_in_flight + ((num_ahead == 0)? 2 : 1));
+        }
+        if (++_adapt_count == USB_XFER_ADAPT_WINDOW){
+            if (_adapt_min_ahead > 2*USB_XFER_MIN_AHEAD){
+                _num_in_flight = std::max(USB_XFER_MIN_IN_FLIGHT, _num_in_flight - 1);
+            }
+            _adapt_count = 0;
+            _adapt_min_ahead = _max_in_flight;
+        }
+        return _num_in_flight != old_num_in_flight;
+    }
+
+private:
+    const size_t _max_in_flight;
+    size_t _num_in_flight;
+    double _last_complete, _interval;
+    size_t _num_gaps, _adapt_count, _adapt_min_ahead;
+};
+
+}} //namespace uhd::transport
+
+#endif /* INCLUDED_LIBUHD_TRANSPORT_USB_XFER_TUNER_HPP */
@@ -17,6 +17,8 @@
 
 #include "b200_impl.hpp"
 #include "b200_regs.hpp"
+#include "init_profiler.hpp"
+#include "../../transport/io_service.hpp"
 #include <uhd/transport/usb_control.hpp>
 #include <uhd/utils/msg.hpp>
 #include <uhd/utils/cast.hpp>
@@ -156,6 +158,9 @@ b200_impl::b200_impl(const device_addr_t &device_addr)
 {
     _tree = property_tree::make();
     const fs_path mb_path = "/mboards/0";
+    init_profiler::sptr init_perf = init_profiler::make("b200_impl");
+    _convert_cpus = device_addr.get("convert_cpus", "");
+    init_span span("usb_open");
 
     //try to match the given device address with something on the USB bus
     boost::uint16_t vid = B200_VENDOR_ID;
@@ -181,11 +186,13 @@ b200_impl::b200_impl(const device_addr_t &device_addr)
     //create control objects
     usb_control::sptr control = usb_control::make(handle, 0);
     _iface = b200_iface::make(control);
+    span.next("fw_compat");
     this->check_fw_compat(); //check after making
 
     ////////////////////////////////////////////////////////////////////
     // setup the mboard eeprom
     ////////////////////////////////////////////////////////////////////
+    span.next("mb_eeprom");
     const mboard_eeprom_t mb_eeprom(*_iface, "B200");
     _tree->create<mboard_eeprom_t>(mb_path / "eeprom")
         .set(mb_eeprom)
@@ -194,6 +201,7 @@ b200_impl::b200_impl(const device_addr_t &device_addr)
     ////////////////////////////////////////////////////////////////////
     // Load the FPGA image, then reset GPIF
     ////////////////////////////////////////////////////////////////////
+    span.next("load_fpga");
     std::string default_file_name;
     std::string product_name = "B200?";
     if (not mb_eeprom["product"].empty())
@@ -234,6 +242,7 @@ b200_impl::b200_impl(const device_addr_t &device_addr)
     ////////////////////////////////////////////////////////////////////
     // Create control transport
     ////////////////////////////////////////////////////////////////////
+    span.next("ctrl_transport");
     boost::uint8_t usb_speed = _iface->get_usb_speed();
     UHD_MSG(status) << "Operating over USB " << (int) usb_speed << "." << std::endl;
     const std::string min_frame_size = (usb_speed == 3) ? "1024" : "512";
@@ -243,6 +252,7 @@ b200_impl::b200_impl(const device_addr_t &device_addr)
     ctrl_xport_args["num_recv_frames"] = "16";
     ctrl_xport_args["send_frame_size"] = min_frame_size;
     ctrl_xport_args["num_send_frames"] = "16";
+    if (device_addr.has_key("io_cpus")) ctrl_xport_args["io_cpus"] = device_addr["io_cpus"];
 
     _ctrl_transport = usb_zero_copy::make(
         handle,
@@ -258,7 +268,7 @@ b200_impl::b200_impl(const device_addr_t &device_addr)
     ////////////////////////////////////////////////////////////////////
     _async_task_data.reset(new AsyncTaskData());
     _async_task_data->async_md.reset(new async_md_type(1000/*messages deep*/));
-    _async_task = uhd::msg_task::make(boost::bind(&b200_impl::handle_async_task, this, _ctrl_transport, _async_task_data));
+    _async_task = uhd::msg_task::make(boost::bind(&b200_impl::handle_async_task, this, _ctrl_transport, _async_task_data), device_addr.get("io_cpus", ""));
 
     ////////////////////////////////////////////////////////////////////
     // Local control endpoint
@@ -266,6 +276,7 @@ b200_impl::b200_impl(const device_addr_t &device_addr)
     _local_ctrl = radio_ctrl_core_3000::make(false/*lilE*/, _ctrl_transport, zero_copy_if::sptr()/*null*/, B200_LOCAL_CTRL_SID);
     _local_ctrl->hold_task(_async_task);
     _async_task_data->local_ctrl = _local_ctrl; //weak
+    span.next("fpga_compat");
     this->check_fpga_compat();
 
     /* Initialize the GPIOs, set the default bandsels to the lower range. Note
@@ -277,6 +288,7 @@ b200_impl::b200_impl(const device_addr_t &device_addr)
     ////////////////////////////////////////////////////////////////////
     // Create the GPSDO control
     ////////////////////////////////////////////////////////////////////
+    span.next("gpsdo");
     _async_task_data->gpsdo_uart = b200_uart::make(_ctrl_transport, B200_TX_GPS_UART_SID);
     _async_task_data->gpsdo_uart->set_baud_divider(B200_BUS_CLOCK_RATE/115200);
     _async_task_data->gpsdo_uart->write_uart("\n"); //cause the baud and response to be setup
@@ -322,11 +334,14 @@ b200_impl::b200_impl(const device_addr_t &device_addr)
     // be in the FPGAs buffers doesn't get pulled into the transport
     // before being cleared.
     ////////////////////////////////////////////////////////////////////
+    span.next("data_transport");
     device_addr_t data_xport_args;
     data_xport_args["recv_frame_size"] = device_addr.get("recv_frame_size", "8192");
     data_xport_args["num_recv_frames"] = device_addr.get("num_recv_frames", "16");
     data_xport_args["send_frame_size"] = device_addr.get("send_frame_size", "8192");
     data_xport_args["num_send_frames"] = device_addr.get("num_send_frames", "16");
+    if (device_addr.has_key("recv_xfer_size")) data_xport_args["recv_xfer_size"] = device_addr["recv_xfer_size"];
+    if (device_addr.has_key("io_cpus")) data_xport_args["io_cpus"] = device_addr["io_cpus"];
 
     _data_transport = usb_zero_copy::make(
         handle,        // identifier
@@ -335,11 +350,16 @@ b200_impl::b200_impl(const device_addr_t &device_addr)
         data_xport_args    // param hints
     );
     while (_data_transport->get_recv_buff(0.0)){} //flush ctrl xport
+    if (device_addr.cast<int>("io_service", 0) != 0)
+    {
+        _data_transport = io_service::get("usb", device_addr.get("io_cpus", ""))->attach(_data_transport);
+    }
     _demux = recv_packet_demuxer_3000::make(_data_transport);
 
     ////////////////////////////////////////////////////////////////////
     // Init codec - turns on clocks
     ////////////////////////////////////////////////////////////////////
+    span.next("codec_init");
     UHD_MSG(status) << "Initialize CODEC control..." << std::endl;
     _codec_ctrl = ad9361_ctrl::make(_iface);
     this->reset_codec_dcm();
@@ -357,6 +377,9 @@ b200_impl::b200_impl(const device_addr_t &device_addr)
         _tree->create<std::string>(codec_path / "name").set(product_name+" TX dual DAC");
         _tree->create<int>(codec_path / "gains"); //empty cuz gains are in frontend
     }
+    _tree->create<bool>(mb_path / "codec_batch")
+        .set(false)
+        .subscribe(boost::bind(&b200_impl::update_codec_batch, this, _1));
 
     ////////////////////////////////////////////////////////////////////
     // create clock control objects
@@ -389,6 +412,7 @@ b200_impl::b200_impl(const device_addr_t &device_addr)
     ////////////////////////////////////////////////////////////////////
     // setup radio control
     ////////////////////////////////////////////////////////////////////
+    span.next("radio_init");
     UHD_MSG(status) << "Initialize Radio control..." << std::endl;
     const size_t num_radio_chains = ((_local_ctrl->peek32(RB32_CORE_STATUS) >> 8) & 0xff);
     UHD_ASSERT_THROW(num_radio_chains > 0);
@@ -407,6 +431,7 @@ b200_impl::b200_impl(const device_addr_t &device_addr)
     ////////////////////////////////////////////////////////////////////
     // create time and clock control objects
     ////////////////////////////////////////////////////////////////////
+    span.next("time_clock_init");
     _spi_iface = spi_core_3000::make(_local_ctrl, TOREG(SR_CORE_SPI), RB32_CORE_SPI);
     _spi_iface->set_divider(B200_BUS_CLOCK_RATE/ADF4001_SPI_RATE);
     _adf4001_iface = boost::shared_ptr<adf4001_ctrl>(new adf4001_ctrl(_spi_iface, ADF4001_SLAVENO));
@@ -446,6 +471,7 @@ b200_impl::b200_impl(const device_addr_t &device_addr)
     ////////////////////////////////////////////////////////////////////
     // do some post-init tasks
     ////////////////////////////////////////////////////////////////////
+    span.next("post_init");
 
     //init the clock rate to something reasonable
     _tree->access<double>(mb_path / "tick_rate").set(
@@ -479,6 +505,8 @@ b200_impl::b200_impl(const device_addr_t &device_addr)
         _tree->access<time_spec_t>(mb_path / "time" / "pps").set(time_spec_t(tp));
     }
 
+    span.end();
+    init_perf->finish(_tree, mb_path / "perf" / "init");
 }
 
 b200_impl::~b200_impl(void)
@@ -497,6 +525,7 @@ void b200_impl::setup_radio(const size_t dspno)
 {
     radio_perifs_t &perif = _radio_perifs[dspno];
     const fs_path mb_path = "/mboards/0";
+    init_span span(str(boost::format("setup_radio%u") % dspno));
 
     ////////////////////////////////////////////////////////////////////
     // radio control
@@ -509,6 +538,11 @@ void b200_impl::setup_radio(const size_t dspno)
         .subscribe(boost::bind(&radio_ctrl_core_3000::set_time, perif.ctrl, _1));
     _tree->access<double>(mb_path / "tick_rate")
         .subscribe(boost::bind(&radio_ctrl_core_3000::set_tick_rate, perif.ctrl, _1));
+    const std::string queue_name = str(boost::format("%u") % dspno);
+    _tree->create<size_t>(mb_path / "time" / "cmd_queue" / queue_name / "depth")
+        .publish(boost::bind(&radio_ctrl_core_3000::get_num_outstanding, perif.ctrl));
+    _tree->create<size_t>(mb_path / "time" / "cmd_queue" / queue_name / "capacity")
+        .publish(boost::bind(&radio_ctrl_core_3000::get_max_outstanding, perif.ctrl));
     this->register_loopback_self_test(perif.ctrl);
     perif.atr = gpio_core_200_32wo::make(perif.ctrl, TOREG(SR_ATR));
 
@@ -584,6 +618,7 @@ void b200_impl::setup_radio(const size_t dspno)
 
             _tree->create<double>(rf_fe_path / "gains" / name / "value")
                 .coerce(boost::bind(&ad9361_ctrl::set_gain, _codec_ctrl, key, _1))
+                .publish(boost::bind(&ad9361_ctrl::get_gain, _codec_ctrl, key))
                 .set(0.0);
         }
         _tree->create<std::string>(rf_fe_path / "connection").set("IQ");
@@ -597,6 +632,7 @@ void b200_impl::setup_radio(const size_t dspno)
         _tree->create<double>(rf_fe_path / "freq" / "value")
             .set(0.0)
             .coerce(boost::bind(&ad9361_ctrl::tune, _codec_ctrl, key, _1))
+            .publish(boost::bind(&ad9361_ctrl::get_freq, _codec_ctrl, key))
             .subscribe(boost::bind(&b200_impl::update_bandsel, this, key, _1));
         _tree->create<meta_range_t>(rf_fe_path / "freq" / "range")
             .publish(boost::bind(&ad9361_ctrl::get_rf_freq_range));
@@ -903,6 +939,12 @@ void b200_impl::update_antenna_sel(const size_t which, const std::string &ant)
     this->update_atrs();
 }
 
+void b200_impl::update_codec_batch(const bool enb)
+{
+    if (enb) _codec_ctrl->begin_batch();
+    else _codec_ctrl->commit_batch();
+}
+
 void b200_impl::update_enables(void)
 {
     //extract settings from state variables
@@ -111,6 +111,7 @@ private:
 
     boost::weak_ptr<uhd::rx_streamer> _rx_streamer;
     boost::weak_ptr<uhd::tx_streamer> _tx_streamer;
+    std::string _convert_cpus;
 
     //async ctrl + msgs
     uhd::msg_task::sptr _async_task;
@@ -178,6 +179,7 @@ private:
     void reset_codec_dcm(void);
 
     void update_enables(void);
+    void update_codec_batch(const bool);
     void update_atrs(void);
 
     double _tick_rate;
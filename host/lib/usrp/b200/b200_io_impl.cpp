@@ -290,6 +290,7 @@ rx_streamer::sptr b200_impl::get_rx_stream(const uhd::stream_args_t &args_)
 
         //make the new streamer given the samples per packet
         if (not my_streamer) my_streamer = boost::make_shared<sph::recv_packet_streamer>(spp);
+        my_streamer->set_convert_cpus(_convert_cpus);
         my_streamer->resize(args.channels.size());
 
         //init some streamer stuff
@@ -392,6 +393,7 @@ tx_streamer::sptr b200_impl::get_tx_stream(const uhd::stream_args_t &args_)
 
         //make the new streamer given the samples per packet
         if (not my_streamer) my_streamer = boost::make_shared<sph::send_packet_streamer>(spp);
+        my_streamer->set_convert_cpus(_convert_cpus);
         my_streamer->resize(args.channels.size());
 
         //init some streamer stuff
@@ -0,0 +1,351 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "timed_cmd_scheduler.hpp"
+#include <uhd/usrp/capture_scheduler.hpp>
+#include <uhd/transport/bounded_buffer.hpp>
+#include <uhd/convert.hpp>
+#include <uhd/exception.hpp>
+#include <uhd/utils/msg.hpp>
+#include <uhd/utils/tasks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <deque>
+
+using namespace uhd;
+using namespace uhd::usrp;
+
+static const double DEFAULT_LEAD_TIME = 0.1; //secs
+static const size_t DEFAULT_QUEUE_DEPTH = 8; //captures per channel
+static const double COMMAND_POLL_PERIOD = 0.0005; //secs
+static const double RECV_TIMEOUT_MARGIN = 0.1; //secs after the lead time
+static const double TIME_RESYNC_PERIOD = 1.0; //secs
+
+/***********************************************************************
+ * Command port:
+ * The stream commands carry their own time, so the command time is
+ * never set. The device time is estimated from the host clock, which
+ * saves a control round trip per poll, and read again every second.
+ * The queue is the captures in flight per channel, bounded by the
+ * command queue of the device when it reports one.
+ **********************************************************************/
+class capture_cmd_port : public timed_cmd_port{
+public:
+    capture_cmd_port(
+        multi_usrp::sptr usrp,
+        const boost::function<size_t(void)> &get_num_in_flight,
+        const size_t capacity
+    ):
+        _usrp(usrp), _get_num_in_flight(get_num_in_flight),
+        _capacity(capacity), _synced(false)
+    {
+        try{
+            _tree_port.reset(new timed_cmd_tree_port(_usrp->get_device()->get_tree(), "/mboards/0"));
+        }
+        catch(const uhd::not_implemented_error &){
+            //the device does not report its command queue
+        }
+    }
+
+    void set_command_time(const time_spec_t &){
+        /* NOP */
+    }
+
+    time_spec_t get_time_now(void){
+        const time_spec_t host_now = time_spec_t::get_system_time();
+        if (not _synced or (host_now - _sync_time).get_real_secs() > TIME_RESYNC_PERIOD){
+            _offset = _usrp->get_time_now() - host_now;
+            _sync_time = host_now;
+            _synced = true;
+        }
+        return host_now + _offset;
+    }
+
+    size_t get_queue_depth(void){
+        const size_t depth = _get_num_in_flight();
+        if (not _tree_port) return depth;
+        return std::max(depth, _tree_port->get_queue_depth());
+    }
+
+    size_t get_queue_capacity(void){
+        if (not _tree_port) return _capacity;
+        return std::min(_capacity, _tree_port->get_queue_capacity());
+    }
+
+private:
+    multi_usrp::sptr _usrp;
+    boost::function<size_t(void)> _get_num_in_flight;
+    const size_t _capacity;
+    timed_cmd_port::sptr _tree_port;
+    bool _synced;
+    time_spec_t _sync_time, _offset;
+};
+
+/***********************************************************************
+ * Capture scheduler implementation:
+ * The command thread issues the stream commands through a timed
+ * command scheduler. Issuing a capture queues it on its channels,
+ * and the receive thread of a channel takes the captures in order.
+ **********************************************************************/
+class capture_scheduler_impl : public capture_scheduler{
+public:
+    capture_scheduler_impl(
+        multi_usrp::sptr usrp,
+        const stream_args_t &args_,
+        const size_t max_nsamps,
+        const size_t num_buffers
+    ):
+        _max_nsamps(max_nsamps),
+        _completed(std::max<size_t>(1, num_buffers)),
+        _next_id(0), _num_in_flight(0)
+    {
+        stream_args_t args = args_;
+        _lead_time = args.args.cast<double>("capture_lead_time", DEFAULT_LEAD_TIME);
+        const size_t queue_depth = args.args.cast<size_t>("capture_queue_depth", DEFAULT_QUEUE_DEPTH);
+        if (args.args.has_key("capture_lead_time")) args.args.pop("capture_lead_time");
+        if (args.args.has_key("capture_queue_depth")) args.args.pop("capture_queue_depth");
+        if (args.channels.empty()) args.channels = std::vector<size_t>(1, 0);
+        if (args.channels.size() > 32) throw uhd::value_error("capture_scheduler: at most 32 channels");
+        if (max_nsamps == 0 or num_buffers == 0) throw uhd::value_error("capture_scheduler: no buffers");
+
+        //one single-channel streamer per channel
+        for (size_t ch = 0; ch < args.channels.size(); ch++){
+            stream_args_t chan_args = args;
+            chan_args.channels = std::vector<size_t>(1, args.channels[ch]);
+            _streamers.push_back(usrp->get_rx_stream(chan_args));
+        }
+        _chan_queues.resize(_streamers.size());
+
+        //preallocate the buffer sets
+        _bytes_per_item = convert::get_bytes_per_item(args.cpu_format);
+        _memory.resize(num_buffers);
+        _states.resize(num_buffers);
+        for (size_t i = 0; i < num_buffers; i++){
+            _memory[i].resize(_streamers.size(), std::vector<char>(max_nsamps*_bytes_per_item));
+            _free.push_back(num_buffers - 1 - i);
+        }
+
+        _cmd_scheduler.reset(new timed_cmd_scheduler(timed_cmd_port::sptr(new capture_cmd_port(
+            usrp, boost::bind(&capture_scheduler_impl::get_max_chan_queue, this), queue_depth
+        )), _lead_time));
+        for (size_t ch = 0; ch < _streamers.size(); ch++){
+            _recv_tasks.push_back(task::make(boost::bind(&capture_scheduler_impl::recv_task, this, ch)));
+        }
+        _cmd_task = task::make(boost::bind(&capture_scheduler_impl::cmd_task, this));
+    }
+
+    ~capture_scheduler_impl(void){
+        _cmd_task.reset();
+        _recv_tasks.clear();
+    }
+
+    size_t schedule(const std::vector<request_t> &requests){
+        const boost::uint32_t all_chans = (_streamers.size() == 32)?
+            0xffffffff : ((boost::uint32_t(1) << _streamers.size()) - 1);
+        for (size_t i = 0; i < requests.size(); i++){
+            if (requests[i].nsamps == 0 or requests[i].nsamps > _max_nsamps) throw uhd::value_error(str(
+                boost::format("capture_scheduler: %u samples, expected 1 to %u") % requests[i].nsamps % _max_nsamps));
+            if (requests[i].channel_mask == 0 or (requests[i].channel_mask & ~all_chans) != 0) throw uhd::value_error(str(
+                boost::format("capture_scheduler: invalid channel mask 0x%x") % requests[i].channel_mask));
+        }
+
+        std::vector<size_t> indexes;
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            for (size_t i = 0; i < requests.size() and not _free.empty(); i++){
+                const size_t index = _free.back();
+                _free.pop_back();
+                capture_state &state = _states[index];
+                state.capture.request = requests[i];
+                state.capture.id = _next_id++;
+                state.capture.buffs.assign(_streamers.size(), NULL);
+                state.capture.nsamps = requests[i].nsamps;
+                state.capture.time = requests[i].time;
+                state.capture.error_code = rx_metadata_t::ERROR_CODE_NONE;
+                state.capture.buffer_index = index;
+                state.num_chans_left = 0;
+                state.has_time = false;
+                state.busy = true;
+                for (size_t ch = 0; ch < _streamers.size(); ch++){
+                    if ((requests[i].channel_mask & (1 << ch)) == 0) continue;
+                    state.capture.buffs[ch] = &_memory[index][ch].front();
+                    state.num_chans_left++;
+                }
+                _num_in_flight++;
+                indexes.push_back(index);
+            }
+        }
+
+        //the command thread holds the scheduler while it takes the mutex
+        for (size_t i = 0; i < indexes.size(); i++){
+            _cmd_scheduler->schedule(requests[i].time, boost::bind(&capture_scheduler_impl::issue, this, indexes[i]));
+        }
+        return indexes.size();
+    }
+
+    bool get_completed(capture_t &capture, const double timeout){
+        size_t index;
+        if (not _completed.pop_with_timed_wait(index, timeout)) return false;
+        boost::mutex::scoped_lock lock(_mutex);
+        capture = _states[index].capture;
+        return true;
+    }
+
+    void release(const capture_t &capture){
+        boost::mutex::scoped_lock lock(_mutex);
+        if (capture.buffer_index >= _states.size() or not _states[capture.buffer_index].busy){
+            throw uhd::value_error("capture_scheduler: the capture was released already");
+        }
+        _states[capture.buffer_index].busy = false;
+        _free.push_back(capture.buffer_index);
+    }
+
+    size_t get_num_in_flight(void){
+        boost::mutex::scoped_lock lock(_mutex);
+        return _num_in_flight;
+    }
+
+private:
+    struct capture_state{
+        capture_t capture;
+        size_t num_chans_left;
+        bool has_time, busy;
+    };
+
+    size_t get_max_chan_queue(void){
+        boost::mutex::scoped_lock lock(_mutex);
+        size_t depth = 0;
+        for (size_t ch = 0; ch < _chan_queues.size(); ch++){
+            depth = std::max(depth, _chan_queues[ch].size());
+        }
+        return depth;
+    }
+
+    void cmd_task(void){
+        try{
+            _cmd_scheduler->poll();
+        }
+        catch(const uhd::exception &e){
+            UHD_MSG(error) << "capture_scheduler: issuing stream commands failed: " << e.what() << std::endl;
+        }
+        boost::this_thread::sleep(boost::posix_time::microseconds(long(COMMAND_POLL_PERIOD*1e6)));
+    }
+
+    //! Issue the stream commands of a capture, called by the timed command scheduler
+    void issue(const size_t index){
+        request_t request;
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            request = _states[index].capture.request;
+            for (size_t ch = 0; ch < _streamers.size(); ch++){
+                if ((request.channel_mask & (1 << ch)) != 0) _chan_queues[ch].push_back(index);
+            }
+        }
+        _chan_cond.notify_all();
+
+        stream_cmd_t stream_cmd(stream_cmd_t::STREAM_MODE_NUM_SAMPS_AND_DONE);
+        stream_cmd.num_samps = request.nsamps;
+        stream_cmd.stream_now = false;
+        stream_cmd.time_spec = request.time;
+        for (size_t ch = 0; ch < _streamers.size(); ch++){
+            if ((request.channel_mask & (1 << ch)) != 0) _streamers[ch]->issue_stream_cmd(stream_cmd);
+        }
+    }
+
+    //! Receive the next capture of a channel
+    void recv_task(const size_t ch){
+        size_t index;
+        size_t nsamps;
+        char *mem;
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            while (_chan_queues[ch].empty()) _chan_cond.wait(lock);
+            index = _chan_queues[ch].front();
+            nsamps = _states[index].capture.request.nsamps;
+            mem = &_memory[index][ch].front();
+        }
+
+        //the first packet arrives within the lead time, the rest follow it
+        const double timeout = _lead_time + RECV_TIMEOUT_MARGIN;
+        rx_metadata_t md;
+        size_t num_samps = 0;
+        time_spec_t time;
+        rx_metadata_t::error_code_t error_code = rx_metadata_t::ERROR_CODE_NONE;
+        while (num_samps < nsamps){
+            const size_t n = _streamers[ch]->recv(mem + num_samps*_bytes_per_item, nsamps - num_samps, md, timeout);
+            if (n != 0 and num_samps == 0) time = md.time_spec;
+            num_samps += n;
+            if (md.error_code != rx_metadata_t::ERROR_CODE_NONE){
+                error_code = md.error_code;
+                break;
+            }
+            if (md.end_of_burst) break;
+        }
+
+        boost::mutex::scoped_lock lock(_mutex);
+        _chan_queues[ch].pop_front();
+        capture_state &state = _states[index];
+        state.capture.nsamps = std::min(state.capture.nsamps, num_samps);
+        if (num_samps != 0 and not state.has_time){
+            state.capture.time = time;
+            state.has_time = true;
+        }
+        if (state.capture.error_code == rx_metadata_t::ERROR_CODE_NONE) state.capture.error_code = error_code;
+        if (--state.num_chans_left != 0) return;
+        _num_in_flight--;
+        lock.unlock();
+        _completed.push_with_haste(index);
+    }
+
+    const size_t _max_nsamps;
+    double _lead_time;
+    size_t _bytes_per_item;
+    std::vector<rx_streamer::sptr> _streamers;
+
+    //capture state, under the mutex
+    boost::mutex _mutex;
+    boost::condition_variable _chan_cond;
+    std::vector<std::vector<std::vector<char> > > _memory; //[buffer set][channel]
+    std::vector<capture_state> _states; //[buffer set]
+    std::vector<size_t> _free;
+    std::vector<std::deque<size_t> > _chan_queues;
+    transport::bounded_buffer<size_t> _completed;
+    size_t _next_id, _num_in_flight;
+
+    boost::shared_ptr<timed_cmd_scheduler> _cmd_scheduler;
+    std::vector<task::sptr> _recv_tasks;
+    task::sptr _cmd_task;
+};
+
+/***********************************************************************
+ * The factory function
+ **********************************************************************/
+capture_scheduler::~capture_scheduler(void){
+    /* NOP */
+}
+
+capture_scheduler::sptr capture_scheduler::make(
+    multi_usrp::sptr usrp,
+    const stream_args_t &args,
+    const size_t max_nsamps,
+    const size_t num_buffers
+){
+    return sptr(new capture_scheduler_impl(usrp, args, max_nsamps, num_buffers));
+}
@@ -16,13 +16,20 @@
 //
 
 #include "ad9361_ctrl.hpp"
+#include "init_profiler.hpp"
 #include "ad9361_transaction.h"
 #include <uhd/exception.hpp>
 #include <uhd/types/ranges.hpp>
 #include <uhd/utils/msg.hpp>
+#include <uhd/utils/log.hpp>
+#include <uhd/utils/safe_call.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/format.hpp>
+#include <algorithm>
+#include <utility>
+#include <map>
 #include <cstring>
+#include <vector>
 
 //! compat strnlen for platforms that dont have it
 static size_t my_strnlen(const char *str, size_t max)
@@ -37,15 +44,30 @@ using namespace uhd;
 struct ad9361_ctrl_impl : public ad9361_ctrl
 {
     ad9361_ctrl_impl(ad9361_ctrl_iface_sptr iface):
-        _iface(iface), _seq(0)
+        _iface(iface), _seq(0), _batching(false), _batch_supported(false)
     {
         ad9361_transaction_t request;
 
+        uhd::usrp::init_span span("ad9361_echo");
         request.action = AD9361_ACTION_ECHO;
         this->do_transaction(request);
 
+        span.next("ad9361_init");
         request.action = AD9361_ACTION_INIT;
         this->do_transaction(request);
+        span.end();
+
+        //an empty batch tells if the firmware supports batches
+        ad9361_batch_transaction_t probe = {};
+        probe.action = AD9361_ACTION_BATCH;
+        const std::string error_msg = this->transact_batch(probe).second;
+        _batch_supported = error_msg.empty();
+        if (not _batch_supported) UHD_LOG << "AD9361 firmware does not support batched transactions: " << error_msg << std::endl;
+    }
+
+    ~ad9361_ctrl_impl(void)
+    {
+        UHD_SAFE_CALL(this->commit_batch();)
     }
 
     double set_gain(const std::string &which, const double value)
@@ -58,8 +80,11 @@ struct ad9361_ctrl_impl : public ad9361_ctrl
         if (which == "TX2") request.action = AD9361_ACTION_SET_TX2_GAIN;
 
         ad9361_double_pack(value, request.value.gain);
+        const std::string key = which + "/gain";
+        const double expected = ad9361_ctrl::get_gain_range(which).clip(value, true);
+        if (this->queue_action(request, key, expected)) return expected;
         const ad9361_transaction_t reply = this->do_transaction(request);
-        return ad9361_double_unpack(reply.value.gain);
+        return this->store_value(key, reply.value.gain);
     }
 
     //! set a new clock rate, return the exact value
@@ -71,10 +96,15 @@ struct ad9361_ctrl_impl : public ad9361_ctrl
             "The driver recommends a master clock rate less than %f MHz.\n"
         ) % (rate/1e6) % 56.0 << std::endl;
 
+        //a new clock rate re-initializes the synthesizers,
+        //so queued actions must be applied before it
+        this->flush_batch();
+
         //clip to known bounds
         const meta_range_t clock_rate_range = ad9361_ctrl::get_clock_rate_range();
         const double clipped_rate = clock_rate_range.clip(rate);
 
+        uhd::usrp::init_span span("ad9361_set_clock_rate");
         ad9361_transaction_t request;
         request.action = AD9361_ACTION_SET_CLOCK_RATE;
         ad9361_double_pack(clipped_rate, request.value.rate);
@@ -94,6 +124,7 @@ struct ad9361_ctrl_impl : public ad9361_ctrl
         ad9361_transaction_t request;
         request.action = AD9361_ACTION_SET_ACTIVE_CHAINS;
         request.value.enable_mask = mask;
+        if (this->queue_action(request)) return;
         this->do_transaction(request);
     }
 
@@ -111,8 +142,10 @@ struct ad9361_ctrl_impl : public ad9361_ctrl
 
         const double value = ad9361_ctrl::get_rf_freq_range().clip(clipped_freq);
         ad9361_double_pack(value, request.value.freq);
+        const std::string key = which.substr(0, 1) + "/freq";
+        if (this->queue_action(request, key, value)) return value;
         const ad9361_transaction_t reply = this->do_transaction(request);
-        return ad9361_double_unpack(reply.value.freq);
+        return this->store_value(key, reply.value.freq);
     }
 
     //! turn on/off Catalina's data port loopback
@@ -121,20 +154,159 @@ struct ad9361_ctrl_impl : public ad9361_ctrl
         ad9361_transaction_t request;
         request.action = AD9361_ACTION_SET_CODEC_LOOP;
         request.value.codec_loop = on? 1 : 0;
+        if (this->queue_action(request)) return;
         this->do_transaction(request);
     }
 
-    ad9361_transaction_t do_transaction(const ad9361_transaction_t &request)
+    double get_gain(const std::string &which)
     {
-        boost::mutex::scoped_lock lock(_mutex);
+        return this->get_value(which + "/gain");
+    }
+
+    double get_freq(const std::string &which)
+    {
+        return this->get_value(which.substr(0, 1) + "/freq");
+    }
+
+    void begin_batch(void)
+    {
+        boost::mutex::scoped_lock lock(_batch_mutex);
+        _batching = true;
+    }
+
+    void commit_batch(void)
+    {
+        boost::mutex::scoped_lock lock(_batch_mutex);
+        _batching = false;
+        this->send_batch();
+    }
+
+    //! send queued actions but keep the batch open
+    void flush_batch(void)
+    {
+        boost::mutex::scoped_lock lock(_batch_mutex);
+        this->send_batch();
+    }
+
+    /*!
+     * Queue the action when a batch is open, return true if queued.
+     * The key names the value the action sets, empty for none;
+     * until the batch is sent, the key reads back the expected value.
+     */
+    bool queue_action(const ad9361_transaction_t &request, const std::string &key = "", const double expected = 0.0)
+    {
+        boost::mutex::scoped_lock lock(_batch_mutex);
+        if (not _batching) return false;
+        ad9361_batch_item_t item;
+        item.action = request.action;
+        std::memcpy(item.value, &request.value, sizeof(item.value));
+        _batch.push_back(item);
+        _batch_keys.push_back(key);
+        if (not key.empty()) _values[key] = expected;
+        return true;
+    }
 
+    //! store the result of an action for the getters, return it
+    double store_value(const std::string &key, const boost::uint32_t value[2])
+    {
+        boost::mutex::scoped_lock lock(_batch_mutex);
+        return _values[key] = ad9361_double_unpack(value);
+    }
+
+    double get_value(const std::string &key)
+    {
+        boost::mutex::scoped_lock lock(_batch_mutex);
+        return _values[key];
+    }
+
+    //! send the queued actions, called with the batch mutex held
+    void send_batch(void)
+    {
+        std::vector<ad9361_batch_item_t> items;
+        std::vector<std::string> keys;
+        items.swap(_batch);
+        keys.swap(_batch_keys);
+
+        size_t i = 0;
+        while (i < items.size())
+        {
+            const size_t n = std::min<size_t>(items.size() - i, AD9361_BATCH_MAX_ACTIONS);
+
+            //a single action or firmware without batch support: one by one
+            if (n == 1 or not _batch_supported)
+            {
+                ad9361_transaction_t request;
+                request.action = items[i].action;
+                std::memcpy(&request.value, items[i].value, sizeof(items[i].value));
+                const ad9361_transaction_t reply = this->do_transaction(request);
+                //the freq and gain results share the same layout
+                if (not keys[i].empty()) _values[keys[i]] = ad9361_double_unpack(reply.value.freq);
+                i++;
+                continue;
+            }
+
+            ad9361_batch_transaction_t request = {};
+            request.action = AD9361_ACTION_BATCH;
+            request.num_actions = n;
+            std::copy(items.begin() + i, items.begin() + i + n, request.items);
+            const std::pair<size_t, std::string> reply = this->transact_batch(request);
+
+            //the error message overwrites the results of a failed batch,
+            //so the values of its completed actions stay the expected ones
+            if (reply.first != n) throw uhd::runtime_error(str(boost::format(
+                "[ad9361_ctrl::commit_batch] firmware reported on action %u: \"%s\""
+            ) % request.items[std::min(reply.first, n-1)].action % reply.second));
+            for (size_t j = 0; j < n; j++)
+            {
+                if (not keys[i+j].empty()) _values[keys[i+j]] = ad9361_double_unpack(request.items[j].value);
+            }
+            i += n;
+        }
+    }
+
+    /*!
+     * Transact a batch, return the number of completed actions and the error message.
+     * When all actions complete, the request items are updated with their results.
+     */
+    std::pair<size_t, std::string> transact_batch(ad9361_batch_transaction_t &request)
+    {
+        unsigned char in_buff[AD9361_DISPATCH_PACKET_SIZE] = {};
+        unsigned char out_buff[AD9361_DISPATCH_PACKET_SIZE] = {};
+        std::memcpy(in_buff, &request, sizeof(request));
+        this->transact(in_buff, out_buff);
+
+        //error_msg overlaps the item results: it holds an error only when
+        //an action failed, or when the firmware rejected an empty batch
+        const ad9361_batch_transaction_t *out = (const ad9361_batch_transaction_t *)out_buff;
+        const size_t num_done = out->num_actions;
+        if (num_done < request.num_actions or num_done == 0) return std::make_pair(num_done, get_error_msg(out_buff));
+        std::copy(out->items, out->items + std::min<size_t>(num_done, AD9361_BATCH_MAX_ACTIONS), request.items);
+        return std::make_pair(num_done, std::string());
+    }
+
+    ad9361_transaction_t do_transaction(const ad9361_transaction_t &request)
+    {
         //declare in/out buffers
-        unsigned char in_buff[64] = {};
-        unsigned char out_buff[64] = {};
+        unsigned char in_buff[AD9361_DISPATCH_PACKET_SIZE] = {};
+        unsigned char out_buff[AD9361_DISPATCH_PACKET_SIZE] = {};
 
         //copy the input transaction
         std::memcpy(in_buff, &request, sizeof(request));
-    
+
+        //transact and handle errors
+        this->transact(in_buff, out_buff);
+        const std::string error_msg = get_error_msg(out_buff);
+        if (not error_msg.empty()) throw uhd::runtime_error("[ad9361_ctrl::do_transaction] firmware reported: \"" + error_msg + "\"");
+
+        //return result done!
+        return *(ad9361_transaction_t *)out_buff;
+    }
+
+    //! transact one dispatch packet with version and sequence checks
+    void transact(unsigned char in_buff[AD9361_DISPATCH_PACKET_SIZE], unsigned char out_buff[AD9361_DISPATCH_PACKET_SIZE])
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+
         //fill in other goodies
         ad9361_transaction_t *in = (ad9361_transaction_t *)in_buff;
         in->version = AD9361_TRANSACTION_VERSION;
@@ -147,20 +319,29 @@ struct ad9361_ctrl_impl : public ad9361_ctrl
         //sanity checks
         UHD_ASSERT_THROW(out->version == in->version);
         UHD_ASSERT_THROW(out->sequence == in->sequence);
+    }
 
-        //handle errors
+    static std::string get_error_msg(const unsigned char out_buff[AD9361_DISPATCH_PACKET_SIZE])
+    {
+        const ad9361_transaction_t *out = (const ad9361_transaction_t *)out_buff;
         const size_t len = my_strnlen(out->error_msg, AD9361_TRANSACTION_MAX_ERROR_MSG);
-        const std::string error_msg(out->error_msg, len);
-        if (not error_msg.empty()) throw uhd::runtime_error("[ad9361_ctrl::do_transaction] firmware reported: \"" + error_msg + "\"");
-
-        //return result done!
-        return *out;
+        return std::string(out->error_msg, len);
     }
 
     ad9361_ctrl_iface_sptr _iface;
     size_t _seq;
     boost::mutex _mutex;
 
+    //queued actions of the open batch
+    boost::mutex _batch_mutex;
+    bool _batching;
+    bool _batch_supported;
+    std::vector<ad9361_batch_item_t> _batch;
+    std::vector<std::string> _batch_keys;
+
+    //values set by the actions, by key, see queue_action
+    std::map<std::string, double> _values;
+
 };
 
 
@@ -18,6 +18,7 @@
 #ifndef INCLUDED_AD9361_CTRL_HPP
 #define INCLUDED_AD9361_CTRL_HPP
 
+#include <uhd/config.hpp>
 #include <uhd/transport/zero_copy.hpp>
 #include <uhd/types/serial.hpp>
 #include <uhd/types/ranges.hpp>
@@ -68,7 +69,7 @@ struct ad9361_ctrl_over_zc : ad9361_ctrl_iface_type
 };
 
 
-class ad9361_ctrl : boost::noncopyable{
+class UHD_API ad9361_ctrl : boost::noncopyable{
 public:
     typedef boost::shared_ptr<ad9361_ctrl> sptr;
 
@@ -130,6 +131,27 @@ public:
 
     //! turn on/off Catalina's data port loopback
     virtual void data_port_loopback(const bool on) = 0;
+
+    //! get the gain set for a particular gain element, see begin_batch
+    virtual double get_gain(const std::string &which) = 0;
+
+    //! get the frequency tuned for the given frontend, see begin_batch
+    virtual double get_freq(const std::string &which) = 0;
+
+    /*!
+     * Begin a batch: until commit_batch(), calls to set_gain, tune,
+     * set_active_chains, and data_port_loopback are queued and sent
+     * together in as few firmware transactions as possible.
+     *
+     * The firmware result of a queued setting is not known until the
+     * batch is sent: while queued, set_gain and tune return the requested
+     * value clipped to its range. Once commit_batch() returns,
+     * get_gain and get_freq return the values the firmware set.
+     */
+    virtual void begin_batch(void) = 0;
+
+    //! Send all queued actions and end the batch, throws on firmware errors
+    virtual void commit_batch(void) = 0;
 };
 
 #endif /* INCLUDED_AD9361_CTRL_HPP */
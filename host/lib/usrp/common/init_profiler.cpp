@@ -0,0 +1,228 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "init_profiler.hpp"
+#include <uhd/utils/msg.hpp>
+#include <uhd/utils/log.hpp>
+#include <uhd/utils/platform.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <fstream>
+#include <cstdlib> //getenv
+#include <set>
+#include <vector>
+
+using namespace uhd;
+using namespace uhd::usrp;
+namespace pt = boost::posix_time;
+
+/***********************************************************************
+ * Chrome trace-event file shared by all profilers of the process
+ **********************************************************************/
+static boost::mutex trace_mutex;
+
+static std::vector<std::string> &get_trace_events(void){
+    static std::vector<std::string> events;
+    return events;
+}
+
+static std::string json_escape(const std::string &in){
+    std::string out;
+    BOOST_FOREACH(const char ch, in){
+        if (ch == '"' or ch == '\\') out += '\\';
+        out += ch;
+    }
+    return out;
+}
+
+/***********************************************************************
+ * Thread-local active profiler
+ **********************************************************************/
+typedef boost::weak_ptr<init_profiler> init_profiler_wptr;
+static boost::thread_specific_ptr<init_profiler_wptr> active_profiler;
+
+init_profiler::sptr init_profiler::get_active(void){
+    init_profiler_wptr *profiler = active_profiler.get();
+    if (profiler == NULL) return init_profiler::sptr();
+    return profiler->lock();
+}
+
+/***********************************************************************
+ * Profiler implementation
+ **********************************************************************/
+class init_profiler_impl :
+    public init_profiler,
+    public boost::enable_shared_from_this<init_profiler_impl>
+{
+public:
+    init_profiler_impl(const std::string &name):
+        _finished(false)
+    {
+        static size_t next_trace_tid = 0;
+        {
+            boost::mutex::scoped_lock lock(trace_mutex);
+            _trace_tid = next_trace_tid++;
+        }
+        this->begin(name);
+    }
+
+    void activate(void){
+        active_profiler.reset(new init_profiler_wptr(shared_from_this()));
+    }
+
+    void begin(const std::string &name){
+        boost::mutex::scoped_lock lock(_mutex);
+        if (_finished) return;
+        span_t span;
+        span.name = name;
+        span.parent = _open.empty()? 0 : _open.back();
+        span.start = pt::microsec_clock::universal_time();
+        _open.push_back(_spans.size());
+        _spans.push_back(span);
+    }
+
+    void end(void){
+        boost::mutex::scoped_lock lock(_mutex);
+        if (_open.size() > 1) this->close_innermost();
+    }
+
+    void finish(property_tree::sptr tree, const fs_path &path){
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            if (_finished) return;
+            while (not _open.empty()) this->close_innermost();
+            _finished = true;
+        }
+        if (get_active().get() == this) active_profiler.reset();
+
+        UHD_LOG << boost::format("%s initialized in %f seconds")
+            % _spans[0].name % to_secs(_spans[0].duration) << std::endl;
+        this->publish(tree, path, 0);
+        this->write_trace();
+    }
+
+private:
+    struct span_t{
+        std::string name;
+        size_t parent;
+        pt::ptime start;
+        pt::time_duration duration;
+    };
+
+    static double to_secs(const pt::time_duration &duration){
+        return duration.total_microseconds()/1e6;
+    }
+
+    void close_innermost(void){
+        span_t &span = _spans[_open.back()];
+        span.duration = pt::microsec_clock::universal_time() - span.start;
+        _open.pop_back();
+    }
+
+    void publish(property_tree::sptr tree, const fs_path &path, const size_t index){
+        tree->create<double>(path / "duration").set(to_secs(_spans[index].duration));
+
+        //children with the same name get a numeric suffix to stay unique
+        std::set<std::string> names;
+        for (size_t i = index+1; i < _spans.size(); i++){
+            if (_spans[i].parent != index) continue;
+            const std::string base = boost::algorithm::replace_all_copy(_spans[i].name, "/", "_");
+            std::string name = base;
+            for (size_t n = 1; names.count(name) != 0; n++){
+                name = str(boost::format("%s_%u") % base % n);
+            }
+            names.insert(name);
+            this->publish(tree, path / name, i);
+        }
+    }
+
+    void write_trace(void){
+        const char *trace_path = std::getenv("UHD_INIT_TRACE");
+        if (trace_path == NULL) return;
+
+        boost::mutex::scoped_lock lock(trace_mutex);
+        const pt::ptime epoch(boost::gregorian::date(1970, 1, 1));
+        BOOST_FOREACH(const span_t &span, _spans){
+            get_trace_events().push_back(str(boost::format(
+                "{\"name\": \"%s\", \"cat\": \"init\", \"ph\": \"X\", "
+                "\"ts\": %lld, \"dur\": %lld, \"pid\": %d, \"tid\": %u}"
+            ) % json_escape(span.name)
+              % (long long)(span.start - epoch).total_microseconds()
+              % (long long)span.duration.total_microseconds()
+              % get_process_id() % _trace_tid));
+        }
+
+        //rewrite the whole file so it is always a complete json document
+        std::ofstream trace_file(trace_path, std::ofstream::trunc);
+        trace_file << "{\"traceEvents\": [" << std::endl;
+        for (size_t i = 0; i < get_trace_events().size(); i++){
+            trace_file << "    " << get_trace_events()[i];
+            trace_file << ((i+1 == get_trace_events().size())? "" : ",") << std::endl;
+        }
+        trace_file << "]}" << std::endl;
+        if (not trace_file) UHD_MSG(warning)
+            << "Cannot write the init trace file " << trace_path << std::endl;
+    }
+
+    boost::mutex _mutex;
+    std::vector<span_t> _spans;
+    std::vector<size_t> _open;
+    size_t _trace_tid;
+    bool _finished;
+};
+
+init_profiler::sptr init_profiler::make(const std::string &name){
+    boost::shared_ptr<init_profiler_impl> profiler(new init_profiler_impl(name));
+    profiler->activate();
+    return profiler;
+}
+
+/***********************************************************************
+ * Scoped span
+ **********************************************************************/
+init_span::init_span(const std::string &name):
+    _profiler(init_profiler::get_active())
+{
+    if (_profiler) _profiler->begin(name);
+}
+
+init_span::init_span(init_profiler::sptr profiler, const std::string &name):
+    _profiler(profiler)
+{
+    if (_profiler) _profiler->begin(name);
+}
+
+init_span::~init_span(void){
+    this->end();
+}
+
+void init_span::next(const std::string &name){
+    if (not _profiler) return;
+    _profiler->end();
+    _profiler->begin(name);
+}
+
+void init_span::end(void){
+    if (_profiler) _profiler->end();
+    _profiler.reset();
+}
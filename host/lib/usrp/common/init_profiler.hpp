@@ -0,0 +1,97 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_USRP_COMMON_INIT_PROFILER_HPP
+#define INCLUDED_LIBUHD_USRP_COMMON_INIT_PROFILER_HPP
+
+#include <uhd/config.hpp>
+#include <uhd/property_tree.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+#include <string>
+
+namespace uhd{ namespace usrp{
+
+/*!
+ * The init profiler records named, nested timing spans while a device
+ * is being constructed. The profiler is active on the thread that made
+ * it, so spans opened anywhere below the device constructor (codec
+ * init, dboard eeprom reads, clock calibration) attach to it without
+ * passing the profiler around. Spans opened while no profiler is
+ * active cost one thread-local lookup and record nothing.
+ *
+ * When the span tree is finished, it is published into the property
+ * tree as a double "duration" (seconds) per span, and when the
+ * environment variable UHD_INIT_TRACE names a file, all spans of the
+ * process are written there in Chrome trace-event JSON format.
+ */
+class UHD_API init_profiler : boost::noncopyable{
+public:
+    typedef boost::shared_ptr<init_profiler> sptr;
+
+    virtual ~init_profiler(void){}
+
+    //! Make a profiler with an open root span and make it active
+    static sptr make(const std::string &name);
+
+    //! Get the profiler active on the calling thread, may be null
+    static sptr get_active(void);
+
+    //! Make this profiler the active one on the calling thread
+    virtual void activate(void) = 0;
+
+    //! Open a span as a child of the innermost open span
+    virtual void begin(const std::string &name) = 0;
+
+    //! Close the innermost open span (the root is closed by finish)
+    virtual void end(void) = 0;
+
+    /*!
+     * Close all open spans, deactivate, and publish the span tree.
+     * \param tree the property tree to publish into
+     * \param path the tree path for the root span, ex: /mboards/0/perf/init
+     */
+    virtual void finish(property_tree::sptr tree, const fs_path &path) = 0;
+};
+
+/*!
+ * A scoped span: begins on construction and ends on destruction.
+ * Use next() for a linear sequence of sibling steps in one scope.
+ */
+class UHD_API init_span : boost::noncopyable{
+public:
+    //! Open a span on the profiler active on this thread, if any
+    init_span(const std::string &name);
+
+    //! Open a span on the given profiler, which may be null
+    init_span(init_profiler::sptr profiler, const std::string &name);
+
+    ~init_span(void);
+
+    //! End this span and begin a sibling span
+    void next(const std::string &name);
+
+    //! End this span early, the destructor will do nothing
+    void end(void);
+
+private:
+    init_profiler::sptr _profiler;
+};
+
+}} //namespace uhd::usrp
+
+#endif /* INCLUDED_LIBUHD_USRP_COMMON_INIT_PROFILER_HPP */
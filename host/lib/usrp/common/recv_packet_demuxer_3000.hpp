@@ -19,6 +19,7 @@
 #define INCLUDED_LIBUHD_USRP_COMMON_RECV_PACKET_DEMUXER_3000_HPP
 
 #include <uhd/config.hpp>
+#include <uhd/exception.hpp>
 #include <uhd/transport/zero_copy.hpp>
 #include <boost/cstdint.hpp>
 #include <boost/thread.hpp>
@@ -26,12 +27,77 @@
 #include <uhd/utils/atomic.hpp>
 #include <uhd/types/time_spec.hpp>
 #include <uhd/utils/byteswap.hpp>
-#include <queue>
-#include <map>
+#include <vector>
+#include <boost/shared_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
 
 namespace uhd{ namespace usrp{
 
+    /*!
+     * A single-producer single-consumer queue of buffers for one SID.
+     * The producer is the thread currently dispatching the transport,
+     * the consumer is the thread receiving on the SID or clearing it,
+     * whichever holds the consumer mutex.
+     */
+    struct recv_packet_demuxer_sid_queue_3000
+    {
+        recv_packet_demuxer_sid_queue_3000(const boost::uint32_t sid, const size_t capacity):
+            sid(sid), _ring(capacity + 1)
+        {
+            _head.write(0);
+            _tail.write(0);
+        }
+
+        //! Push a buffer (producer only), return false when full
+        bool push(transport::managed_recv_buffer::sptr &buff)
+        {
+            const boost::uint32_t tail = _tail.read();
+            const boost::uint32_t next = boost::uint32_t((tail + 1) % _ring.size());
+            if (next == _head.read()) return false;
+            _ring[tail].swap(buff);
+            _tail.write(next);
+            return true;
+        }
+
+        //! Pop a buffer (consumer only), null when empty
+        transport::managed_recv_buffer::sptr pop(void)
+        {
+            transport::managed_recv_buffer::sptr buff;
+            const boost::uint32_t head = _head.read();
+            if (head == _tail.read()) return buff;
+            _ring[head].swap(buff);
+            _head.write(boost::uint32_t((head + 1) % _ring.size()));
+            return buff;
+        }
+
+        //! Check for buffers without popping
+        bool empty(void)
+        {
+            return _head.read() == _tail.read();
+        }
+
+        const boost::uint32_t sid;
+
+        //! Held by the consumer, it is not contended unless the SID is cleared while in use
+        boost::mutex consumer_mutex;
+
+    private:
+        std::vector<transport::managed_recv_buffer::sptr> _ring;
+        uhd::atomic_uint32_t _head, _tail;
+    };
+
+    /*!
+     * Demultiplex a shared transport into streams by SID.
+     *
+     * Any thread receiving on a SID first pops its own queue.
+     * When that is empty, the thread claims the transport and dispatches
+     * packets into the queues of their SIDs until one is its own;
+     * when another thread holds the claim, it parks until its queue fills
+     * or the claim is released. The SID queues are found through a flat
+     * table with lock-free lookups. On the data path, the only lock is the
+     * consumer mutex of the SID, which is not contended: it keeps a SID
+     * from being cleared while a thread receives on it.
+     */
     struct recv_packet_demuxer_3000 : boost::enable_shared_from_this<recv_packet_demuxer_3000>
     {
         typedef boost::shared_ptr<recv_packet_demuxer_3000> sptr;
@@ -40,103 +106,169 @@ namespace uhd{ namespace usrp{
             return sptr(new recv_packet_demuxer_3000(xport));
         }
 
+        //! The number of buffers one SID queue holds before packets are dropped
+        static const size_t QUEUE_CAPACITY = 256;
+
+        //! The number of SIDs the lookup table holds (a power of two)
+        static const size_t TABLE_SIZE = 64;
+
         recv_packet_demuxer_3000(transport::zero_copy_if::sptr xport):
-            _xport(xport)
-        {/*NOP*/}
+            _xport(xport), _table(TABLE_SIZE), _table_used(TABLE_SIZE)
+        {
+            _claimed.write(0);
+            _num_waiting.write(0);
+        }
 
         transport::managed_recv_buffer::sptr get_recv_buff(const boost::uint32_t sid, const double timeout)
         {
-            const time_spec_t exit_time = time_spec_t(timeout) + time_spec_t::get_system_time();
+            const boost::system_time exit_time = boost::get_system_time() +
+                boost::posix_time::microseconds(long(timeout*1e6));
+            recv_packet_demuxer_sid_queue_3000 &queue = this->get_queue(sid);
+            boost::mutex::scoped_lock consumer_lock(queue.consumer_mutex);
             transport::managed_recv_buffer::sptr buff;
-            buff = _internal_get_recv_buff(sid, timeout);
-            while (not buff) //loop until timeout
+            while (true)
             {
-                const time_spec_t delta = exit_time - time_spec_t::get_system_time();
-                const double new_timeout = delta.get_real_secs();
-                if (new_timeout < 0.0) break;
-                buff = _internal_get_recv_buff(sid, new_timeout);
-            }
-            return buff;
-        }
+                buff = queue.pop();
+                if (buff) return buff;
 
-        transport::managed_recv_buffer::sptr _internal_get_recv_buff(const boost::uint32_t sid, const double timeout)
-        {
-            transport::managed_recv_buffer::sptr buff;
+                const double remaining = double((exit_time - boost::get_system_time()).total_microseconds())/1e6;
 
-            //----------------------------------------------------------
-            //-- Check the queue to see if we already have a buffer
-            //----------------------------------------------------------
-            {
-                boost::mutex::scoped_lock l(mutex);
-                queue_type_t &queue = _queues[sid];
-                if (not queue.empty())
+                //----------------------------------------------------------
+                //-- Claim the transport and dispatch, or wait patiently
+                //----------------------------------------------------------
+                if (_claimed.cas(1, 0) == 0)
                 {
-                    buff = queue.front();
-                    queue.front().reset();
-                    queue.pop();
-                    return buff;
+                    //the previous dispatcher may have queued a packet for us
+                    buff = queue.pop();
+                    if (not buff) buff = this->dispatch(sid, std::max(remaining, 0.0));
+                    _claimed.write(0);
+                    this->wake_waiting();
+                    if (buff) return buff;
                 }
+                else if (remaining > 0.0)
+                {
+                    this->wait(queue, exit_time);
+                }
+
+                if (remaining <= 0.0) return queue.pop();
             }
-            // Following is disabled by default as super_recv_packet_handler (caller) is not thread safe
-            // Only underlying transport (libusb1_zero_copy) is thread safe
-            // The onus is on the caller to super_recv_packet_handler (and therefore this) to serialise access
-#ifdef RECV_PACKET_DEMUXER_3000_THREAD_SAFE
-            //----------------------------------------------------------
-            //-- Try to claim the transport or wait patiently
-            //----------------------------------------------------------
-            if (_claimed.cas(1, 0))
+        }
+
+        /*!
+         * Allocate the queue of a SID, or clear it if already allocated.
+         * Clearing pops the queue, so it waits for a thread still
+         * receiving on the SID to return, up to the timeout of its call.
+         */
+        void realloc_sid(const boost::uint32_t sid)
+        {
+            recv_packet_demuxer_sid_queue_3000 &queue = this->get_queue(sid);
+            boost::mutex::scoped_lock consumer_lock(queue.consumer_mutex);
+            while (queue.pop()){}
+        }
+
+        transport::zero_copy_if::sptr make_proxy(const boost::uint32_t sid);
+
+    private:
+        /*!
+         * Receive one buffer from the transport.
+         * Return it when it is for the given SID,
+         * otherwise queue it for its SID and return null.
+         */
+        transport::managed_recv_buffer::sptr dispatch(const boost::uint32_t sid, const double timeout)
+        {
+            transport::managed_recv_buffer::sptr buff = _xport->get_recv_buff(timeout);
+            if (not buff) return buff;
+
+            const boost::uint32_t new_sid = uhd::wtohx(buff->cast<const boost::uint32_t *>()[1]);
+            if (new_sid == sid) return buff;
+
+            recv_packet_demuxer_sid_queue_3000 *queue = this->find_queue(new_sid);
+            if (queue == NULL) UHD_MSG(error)
+                << "recv packet demuxer unexpected sid 0x" << std::hex << new_sid << std::dec
+                << std::endl;
+            else if (not queue->push(buff)) UHD_MSG(error)
+                << "recv packet demuxer queue full for sid 0x" << std::hex << new_sid << std::dec
+                << std::endl;
+            else this->wake_waiting();
+            buff.reset();
+            return buff;
+        }
+
+        //! Park until the queue fills, the transport is free, or the time is up
+        void wait(recv_packet_demuxer_sid_queue_3000 &queue, const boost::system_time &exit_time)
+        {
+            boost::mutex::scoped_lock l(_wait_mutex);
+            _num_waiting.inc();
+            //check again after counting ourselves so a wakeup cannot be missed
+            while (queue.empty() and _claimed.read() != 0)
             {
-                boost::mutex::scoped_lock l(mutex);
-                cond.timed_wait(l, boost::posix_time::microseconds(long(timeout*1e6)));
+                if (not _wait_cond.timed_wait(l, exit_time)) break;
             }
+            _num_waiting.dec();
+        }
 
-            //----------------------------------------------------------
-            //-- Wait on the transport for input buffers
-            //----------------------------------------------------------
-            else
-#endif // RECV_PACKET_DEMUXER_3000_THREAD_SAFE
+        /*!
+         * Wake parked consumers after releasing the claim or queueing a packet.
+         * The read of the waiter count is a compare-and-swap that changes
+         * nothing: its full barrier orders the store before it, like the
+         * increment in wait() orders the count before its checks.
+         */
+        void wake_waiting(void)
+        {
+            if (_num_waiting.cas(0, 0) == 0) return;
+            boost::mutex::scoped_lock l(_wait_mutex);
+            _wait_cond.notify_all();
+        }
+
+        static size_t hash(const boost::uint32_t sid)
+        {
+            return size_t(sid ^ (sid >> 16) ^ (sid >> 4));
+        }
+
+        //! Flat table lookup: linear probing from a hash of the SID
+        recv_packet_demuxer_sid_queue_3000 *find_queue(const boost::uint32_t sid)
+        {
+            for (size_t i = 0; i < TABLE_SIZE; i++)
             {
-                buff = _xport->get_recv_buff(timeout);
-                if (buff)
-                {
-                    const boost::uint32_t new_sid = uhd::wtohx(buff->cast<const boost::uint32_t *>()[1]);
-                    if (new_sid != sid)
-                    {
-                        boost::mutex::scoped_lock l(mutex);
-                        if (_queues.count(new_sid) == 0) UHD_MSG(error)
-                            << "recv packet demuxer unexpected sid 0x" << std::hex << new_sid << std::dec
-                            << std::endl;
-                        else _queues[new_sid].push(buff);
-                        buff.reset();
-                    }
-                }
-#ifdef RECV_PACKET_DEMUXER_3000_THREAD_SAFE
-                _claimed.write(0);
-                cond.notify_all();
-#endif // RECV_PACKET_DEMUXER_3000_THREAD_SAFE
+                const size_t slot = (this->hash(sid) + i) & (TABLE_SIZE - 1);
+                if (_table_used[slot].read() == 0) return NULL;
+                if (_table[slot]->sid == sid) return _table[slot].get();
             }
-            return buff;
+            return NULL;
         }
 
-        void realloc_sid(const boost::uint32_t sid)
+        //! Find the queue for a SID, adding it to the table if needed
+        recv_packet_demuxer_sid_queue_3000 &get_queue(const boost::uint32_t sid)
         {
-            boost::mutex::scoped_lock l(mutex);
-            while(not _queues[sid].empty()) //allocated and clears if already allocated
+            recv_packet_demuxer_sid_queue_3000 *queue = this->find_queue(sid);
+            if (queue != NULL) return *queue;
+
+            boost::mutex::scoped_lock l(_table_mutex);
+            for (size_t i = 0; i < TABLE_SIZE; i++)
             {
-                _queues[sid].pop();
+                const size_t slot = (this->hash(sid) + i) & (TABLE_SIZE - 1);
+                if (_table_used[slot].read() == 0)
+                {
+                    _table[slot].reset(new recv_packet_demuxer_sid_queue_3000(sid, QUEUE_CAPACITY));
+                    _table_used[slot].write(1); //publish after the queue is made
+                    return *_table[slot];
+                }
+                if (_table[slot]->sid == sid) return *_table[slot];
             }
+            throw uhd::runtime_error("recv packet demuxer: too many sids");
         }
 
-        transport::zero_copy_if::sptr make_proxy(const boost::uint32_t sid);
-
-        typedef std::queue<transport::managed_recv_buffer::sptr> queue_type_t;
-        std::map<boost::uint32_t, queue_type_t> _queues;
         transport::zero_copy_if::sptr _xport;
-#ifdef RECV_PACKET_DEMUXER_3000_THREAD_SAFE
-        uhd::atomic_uint32_t _claimed;
-        boost::condition_variable cond;
-#endif // RECV_PACKET_DEMUXER_3000_THREAD_SAFE
-        boost::mutex mutex;
+
+        //! SID queues, slots are filled once and never emptied
+        std::vector<boost::shared_ptr<recv_packet_demuxer_sid_queue_3000> > _table;
+        std::vector<uhd::atomic_uint32_t> _table_used;
+        boost::mutex _table_mutex;
+
+        //! dispatch claim and parked consumers
+        uhd::atomic_uint32_t _claimed, _num_waiting;
+        boost::mutex _wait_mutex;
+        boost::condition_variable _wait_cond;
     };
 
     struct recv_packet_demuxer_proxy_3000 : transport::zero_copy_if
@@ -0,0 +1,126 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_USRP_COMMON_SYNTH_CACHE_HPP
+#define INCLUDED_LIBUHD_USRP_COMMON_SYNTH_CACHE_HPP
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace uhd{ namespace usrp{
+
+/*!
+ * The solution of a synthesizer tune:
+ * the register words to write, in order, and the frequency they produce.
+ */
+struct synth_solution_t{
+    double actual_freq;
+    std::vector<boost::uint32_t> regs;
+
+    synth_solution_t(void): actual_freq(0.0){}
+};
+
+/*!
+ * What a synthesizer solution depends on.
+ * The mode holds any tune arguments that change the solution (ex: mode_n).
+ */
+struct synth_key_t{
+    double target_freq;
+    double ref_freq;
+    std::string mode;
+
+    synth_key_t(const double target_freq, const double ref_freq, const std::string &mode):
+        target_freq(target_freq), ref_freq(ref_freq), mode(mode){}
+
+    bool operator<(const synth_key_t &rhs) const{
+        if (target_freq != rhs.target_freq) return target_freq < rhs.target_freq;
+        if (ref_freq != rhs.ref_freq) return ref_freq < rhs.ref_freq;
+        return mode < rhs.mode;
+    }
+};
+
+/*!
+ * A least-recently-used cache of synthesizer solutions, one per frontend.
+ * Retuning to a cached frequency replays the register writes
+ * without searching the divider settings again.
+ */
+class synth_cache : boost::noncopyable{
+public:
+    static const size_t DEFAULT_CAPACITY = 128;
+
+    synth_cache(const size_t capacity = DEFAULT_CAPACITY):
+        _capacity(capacity){}
+
+    //! Get the cached solution for the key, return false if not cached
+    bool lookup(const synth_key_t &key, synth_solution_t &solution){
+        boost::mutex::scoped_lock lock(_mutex);
+        lru_map_t::iterator it = _map.find(key);
+        if (it == _map.end()) return false;
+        _lru.splice(_lru.begin(), _lru, it->second); //most recently used
+        solution = it->second->second;
+        return true;
+    }
+
+    //! Store a solution, evicting the least recently used one when full
+    void store(const synth_key_t &key, const synth_solution_t &solution){
+        boost::mutex::scoped_lock lock(_mutex);
+        lru_map_t::iterator it = _map.find(key);
+        if (it != _map.end()){
+            _lru.erase(it->second);
+            _map.erase(it);
+        }
+        if (_capacity == 0) return;
+        while (_map.size() >= _capacity){
+            _map.erase(_lru.back().first);
+            _lru.pop_back();
+        }
+        _lru.push_front(entry_t(key, solution));
+        _map[key] = _lru.begin();
+    }
+
+    //! Forget all cached solutions
+    void clear(void){
+        boost::mutex::scoped_lock lock(_mutex);
+        _map.clear();
+        _lru.clear();
+    }
+
+    //! Get the number of cached solutions
+    size_t size(void){
+        boost::mutex::scoped_lock lock(_mutex);
+        return _map.size();
+    }
+
+private:
+    typedef std::pair<synth_key_t, synth_solution_t> entry_t;
+    typedef std::list<entry_t> lru_list_t;
+    typedef std::map<synth_key_t, lru_list_t::iterator> lru_map_t;
+
+    const size_t _capacity;
+    boost::mutex _mutex;
+    lru_list_t _lru;
+    lru_map_t _map;
+};
+
+}} //namespace uhd::usrp
+
+#endif /* INCLUDED_LIBUHD_USRP_COMMON_SYNTH_CACHE_HPP */
@@ -0,0 +1,263 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_USRP_COMMON_TIMED_CMD_SCHEDULER_HPP
+#define INCLUDED_LIBUHD_USRP_COMMON_TIMED_CMD_SCHEDULER_HPP
+
+#include <uhd/property_tree.hpp>
+#include <uhd/types/time_spec.hpp>
+#include <uhd/exception.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/foreach.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/utility.hpp>
+#include <algorithm>
+#include <map>
+#include <string>
+
+namespace uhd{ namespace usrp{
+
+static const double TIMED_CMD_TIME_RESYNC_PERIOD = 1.0; //secs, device time reads while the queues are empty
+
+/*!
+ * The control port of a device as seen by the timed command scheduler:
+ * the command time, the device time, and the command FIFO occupancy.
+ */
+class timed_cmd_port : boost::noncopyable{
+public:
+    typedef boost::shared_ptr<timed_cmd_port> sptr;
+
+    virtual ~timed_cmd_port(void){}
+
+    //! Set the time of the following commands, 0.0 for untimed commands
+    virtual void set_command_time(const uhd::time_spec_t &time) = 0;
+
+    //! Get the current device time
+    virtual uhd::time_spec_t get_time_now(void) = 0;
+
+    //! Get the number of commands in the FIFO (sent but not acknowledged)
+    virtual size_t get_queue_depth(void) = 0;
+
+    //! Get the number of commands the FIFO holds before a send blocks
+    virtual size_t get_queue_capacity(void) = 0;
+};
+
+/*!
+ * A timed command port on the property tree of a motherboard.
+ * The command queues are the nodes under time/cmd_queue;
+ * the fullest queue sets the depth and the smallest sets the capacity.
+ *
+ * Reading time/now is a control transaction that waits for the acks
+ * of all queued commands, so it would wait until the queued timed
+ * commands ran. The device time is estimated from the host clock
+ * instead, and read again only while the queues are empty.
+ */
+class timed_cmd_tree_port : public timed_cmd_port{
+public:
+    timed_cmd_tree_port(property_tree::sptr tree, const fs_path &mb_path):
+        _tree(tree), _mb_path(mb_path), _synced(false)
+    {
+        if (not _tree->exists(_mb_path / "time" / "cmd_queue")) throw uhd::not_implemented_error(
+            "timed_cmd_tree_port: this device does not report command queue occupancy"
+        );
+    }
+
+    void set_command_time(const uhd::time_spec_t &time){
+        _tree->access<uhd::time_spec_t>(_mb_path / "time" / "cmd").set(time);
+    }
+
+    uhd::time_spec_t get_time_now(void){
+        const uhd::time_spec_t host_now = uhd::time_spec_t::get_system_time();
+        const bool stale = not _synced or (host_now - _sync_time).get_real_secs() > TIMED_CMD_TIME_RESYNC_PERIOD;
+        if (stale and (not _synced or this->get_queue_depth() == 0)){
+            _offset = _tree->access<uhd::time_spec_t>(_mb_path / "time" / "now").get() - host_now;
+            _sync_time = host_now;
+            _synced = true;
+        }
+        return host_now + _offset;
+    }
+
+    size_t get_queue_depth(void){
+        size_t depth = 0;
+        BOOST_FOREACH(const std::string &name, _tree->list(_mb_path / "time" / "cmd_queue")){
+            depth = std::max(depth, _tree->access<size_t>(_mb_path / "time" / "cmd_queue" / name / "depth").get());
+        }
+        return depth;
+    }
+
+    size_t get_queue_capacity(void){
+        size_t capacity = 0;
+        BOOST_FOREACH(const std::string &name, _tree->list(_mb_path / "time" / "cmd_queue")){
+            const size_t c = _tree->access<size_t>(_mb_path / "time" / "cmd_queue" / name / "capacity").get();
+            capacity = (capacity == 0)? c : std::min(capacity, c);
+        }
+        return capacity;
+    }
+
+private:
+    property_tree::sptr _tree;
+    const fs_path _mb_path;
+    bool _synced;
+    uhd::time_spec_t _sync_time, _offset;
+};
+
+/*!
+ * The timed command scheduler holds a time-ordered list of operations.
+ * An operation is any function that sets properties (and so sends commands);
+ * the scheduler runs it with the command time set to the operation's time.
+ *
+ * Operations are issued just in time: not before the device time is within
+ * the lead time of the operation, and not while the command FIFO could
+ * overflow. The number of commands an operation sends is learned from the
+ * FIFO depth, so the FIFO never fills and sends never block on an ack.
+ */
+class timed_cmd_scheduler : boost::noncopyable{
+public:
+    typedef boost::function<void(void)> operation_t;
+
+    struct stats_t{
+        //! number of operations scheduled and issued
+        size_t num_scheduled, num_issued;
+        //! command FIFO depth at the last poll and the maximum seen
+        size_t queue_depth, max_queue_depth;
+        //! the largest number of commands sent by one operation
+        size_t max_cmds_per_op;
+        //! number of operations issued after their time
+        size_t num_late;
+        //! lateness of late operations in seconds, worst and total
+        double max_lateness, total_lateness;
+
+        stats_t(void):
+            num_scheduled(0), num_issued(0),
+            queue_depth(0), max_queue_depth(0),
+            max_cmds_per_op(0), num_late(0),
+            max_lateness(0.0), total_lateness(0.0){}
+    };
+
+    /*!
+     * Make a new scheduler.
+     * \param port the control port to feed
+     * \param lead_time issue operations this many seconds before their time
+     */
+    timed_cmd_scheduler(timed_cmd_port::sptr port, const double lead_time = 0.1):
+        _port(port), _lead_time(lead_time), _cmds_per_op(1){}
+
+    //! Schedule an operation, operations at the same time keep their order
+    void schedule(const uhd::time_spec_t &time, const operation_t &operation){
+        boost::mutex::scoped_lock lock(_mutex);
+        _pending.insert(std::make_pair(time, operation));
+        _stats.num_scheduled++;
+    }
+
+    //! Get the number of operations not issued yet
+    size_t get_num_pending(void){
+        boost::mutex::scoped_lock lock(_mutex);
+        return _pending.size();
+    }
+
+    /*!
+     * Issue the operations that are due and fit into the command FIFO.
+     * \return the number of operations issued
+     */
+    size_t poll(void){
+        boost::mutex::scoped_lock lock(_mutex);
+        const size_t capacity = _port->get_queue_capacity();
+        size_t depth = this->update_depth();
+        size_t num_issued = 0;
+
+        while (not _pending.empty()){
+            const uhd::time_spec_t time = _pending.begin()->first;
+            const uhd::time_spec_t now = _port->get_time_now();
+            if ((time - now).get_real_secs() > _lead_time) break;
+            if (depth + _cmds_per_op > capacity and depth != 0) break;
+
+            const operation_t operation = _pending.begin()->second;
+            _pending.erase(_pending.begin());
+
+            _port->set_command_time(time);
+            try{
+                operation();
+            }
+            catch(...){
+                _port->set_command_time(uhd::time_spec_t(0.0));
+                throw;
+            }
+            _port->set_command_time(uhd::time_spec_t(0.0));
+
+            //learn the commands per operation from the depth change
+            const size_t new_depth = this->update_depth();
+            if (new_depth > depth) _cmds_per_op = std::max(_cmds_per_op, new_depth - depth);
+            _stats.max_cmds_per_op = std::max(_stats.max_cmds_per_op, _cmds_per_op);
+            depth = new_depth;
+
+            //lateness is measured against the time before the commands were sent
+            const double lateness = (now - time).get_real_secs();
+            if (lateness > 0.0){
+                _stats.num_late++;
+                _stats.total_lateness += lateness;
+                _stats.max_lateness = std::max(_stats.max_lateness, lateness);
+            }
+            _stats.num_issued++;
+            num_issued++;
+        }
+        return num_issued;
+    }
+
+    /*!
+     * Poll until all operations are issued.
+     * \param poll_interval the time between polls in seconds
+     * \param timeout the maximum time to wait in seconds
+     * \return true if all operations were issued
+     */
+    bool run(const double poll_interval = 0.001, const double timeout = 10.0){
+        const boost::system_time exit_time = boost::get_system_time() +
+            boost::posix_time::microseconds(long(timeout*1e6));
+        while (true){
+            this->poll();
+            if (this->get_num_pending() == 0) return true;
+            if (boost::get_system_time() > exit_time) return false;
+            boost::this_thread::sleep(boost::posix_time::microseconds(long(poll_interval*1e6)));
+        }
+    }
+
+    //! Get the statistics since construction
+    stats_t get_stats(void){
+        boost::mutex::scoped_lock lock(_mutex);
+        this->update_depth();
+        return _stats;
+    }
+
+private:
+    size_t update_depth(void){
+        _stats.queue_depth = _port->get_queue_depth();
+        _stats.max_queue_depth = std::max(_stats.max_queue_depth, _stats.queue_depth);
+        return _stats.queue_depth;
+    }
+
+    timed_cmd_port::sptr _port;
+    const double _lead_time;
+    size_t _cmds_per_op;
+    boost::mutex _mutex;
+    std::multimap<uhd::time_spec_t, operation_t> _pending;
+    stats_t _stats;
+};
+
+}} //namespace uhd::usrp
+
+#endif /* INCLUDED_LIBUHD_USRP_COMMON_TIMED_CMD_SCHEDULER_HPP */
@@ -27,6 +27,8 @@
 #include <boost/thread/thread.hpp>
 #include <boost/format.hpp>
 #include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/make_shared.hpp>
 #include <queue>
 
 using namespace uhd;
@@ -37,7 +39,8 @@ static const double ACK_TIMEOUT = 2.0; //supposed to be worst case practical tim
 static const double MASSIVE_TIMEOUT = 10.0; //for when we wait on a timed command
 static const size_t SR_READBACK = 32;
 
-class radio_ctrl_core_3000_impl: public radio_ctrl_core_3000
+class radio_ctrl_core_3000_impl: public radio_ctrl_core_3000,
+    public boost::enable_shared_from_this<radio_ctrl_core_3000_impl>
 {
 public:
 
@@ -103,6 +106,33 @@ public:
         return this->wait_for_ack(true);
     }
 
+    //! Poke without the command time, the time stays set for other pokes
+    void poke32_untimed(const wb_addr_type addr, const boost::uint32_t data)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        UHD_LOGV(always) << _name << std::hex << " untimed addr 0x" << addr << " data 0x" << data << std::dec << std::endl;
+
+        const bool use_time = _use_time;
+        _use_time = false;
+        this->send_pkt(addr/4, data);
+        _use_time = use_time;
+        this->wait_for_ack(false);
+    }
+
+    class untimed_iface : public uhd::wb_iface
+    {
+    public:
+        untimed_iface(boost::shared_ptr<radio_ctrl_core_3000_impl> ctrl): _ctrl(ctrl){}
+        void poke32(const wb_addr_type addr, const boost::uint32_t data){_ctrl->poke32_untimed(addr, data);}
+    private:
+        boost::shared_ptr<radio_ctrl_core_3000_impl> _ctrl;
+    };
+
+    uhd::wb_iface::sptr get_untimed_iface(void)
+    {
+        return boost::make_shared<untimed_iface>(shared_from_this());
+    }
+
     /*******************************************************************
      * Update methods for time
      ******************************************************************/
@@ -120,6 +150,29 @@ public:
         _tick_rate = rate;
     }
 
+    /*******************************************************************
+     * Command queue introspection
+     ******************************************************************/
+    size_t get_num_outstanding(void)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        resp_buff_type resp_buff;
+        managed_recv_buffer::sptr buff;
+        const boost::uint32_t *pkt = NULL;
+        size_t num_words = 0;
+        while (not _outstanding_seqs.empty() and this->get_response(resp_buff, buff, pkt, num_words, 0.0))
+        {
+            this->check_response(pkt, num_words, _outstanding_seqs.front());
+            _outstanding_seqs.pop();
+        }
+        return _outstanding_seqs.size();
+    }
+
+    size_t get_max_outstanding(void)
+    {
+        return _resp_queue_size;
+    }
+
 private:
     // This is the buffer type for messages in radio control core.
     struct resp_buff_type
@@ -180,106 +233,112 @@ private:
             const size_t seq_to_ack = _outstanding_seqs.front();
             _outstanding_seqs.pop();
 
-            //parse the packet
-            vrt::if_packet_info_t packet_info;
+            //get buffer from response endpoint - or die in timeout
             resp_buff_type resp_buff;
-            memset(&resp_buff, 0x00, sizeof(resp_buff));
-            boost::uint32_t const *pkt = NULL;
             managed_recv_buffer::sptr buff;
-
-            //get buffer from response endpoint - or die in timeout
-            if (_resp_xport)
-            {
-                buff = _resp_xport->get_recv_buff(_timeout);
-                try
-                {
-                    UHD_ASSERT_THROW(bool(buff));
-                    UHD_ASSERT_THROW(bool(buff->size()));
-                }
-                catch(const std::exception &ex)
-                {
-                    throw uhd::io_error(str(boost::format("Radio ctrl (%s) no response packet - %s") % _name % ex.what()));
-                }
-                pkt = buff->cast<const boost::uint32_t *>();
-                packet_info.num_packet_words32 = buff->size()/sizeof(boost::uint32_t);
-            }
-
-            //get buffer from response endpoint - or die in timeout
-            else
-            {
-                /*
-                 * Couldn't get message with haste.
-                 * Now check both possible queues for messages.
-                 * Messages should come in on _resp_queue,
-                 * but could end up in dump_queue.
-                 * If we don't get a message --> Die in timeout.
-                 */
-                double accum_timeout = 0.0;
-                const double short_timeout = 0.005; // == 5ms
-                while(not ((_resp_queue.pop_with_haste(resp_buff))
-                        || (check_dump_queue(resp_buff))
-                        || (_resp_queue.pop_with_timed_wait(resp_buff, short_timeout))
-                        )){
-                    /*
-                     * If a message couldn't be received within a given timeout
-                     * --> throw AssertionError!
-                     */
-                    accum_timeout += short_timeout;
-                    UHD_ASSERT_THROW(accum_timeout < _timeout);
-                }
-
-                pkt = resp_buff.data;
-                packet_info.num_packet_words32 = sizeof(resp_buff)/sizeof(boost::uint32_t);
-            }
-
-            //parse the buffer
-            try
-            {
-                packet_info.link_type = _link_type;
-                if (_bige) vrt::if_hdr_unpack_be(pkt, packet_info);
-                else vrt::if_hdr_unpack_le(pkt, packet_info);
-            }
-            catch(const std::exception &ex)
+            boost::uint32_t const *pkt = NULL;
+            size_t num_words = 0;
+            if (not this->get_response(resp_buff, buff, pkt, num_words, _timeout))
             {
-                UHD_MSG(error) << "Radio ctrl bad VITA packet: " << ex.what() << std::endl;
-                if (buff){
-                    UHD_VAR(buff->size());
-                }
-                else{
-                    UHD_MSG(status) << "buff is NULL" << std::endl;
-                }
-                UHD_MSG(status) << std::hex << pkt[0] << std::dec << std::endl;
-                UHD_MSG(status) << std::hex << pkt[1] << std::dec << std::endl;
-                UHD_MSG(status) << std::hex << pkt[2] << std::dec << std::endl;
-                UHD_MSG(status) << std::hex << pkt[3] << std::dec << std::endl;
+                throw uhd::io_error(str(boost::format("Radio ctrl (%s) no response packet - timeout") % _name));
             }
 
-            //check the buffer
-            try
-            {
-                UHD_ASSERT_THROW(packet_info.has_sid);
-                UHD_ASSERT_THROW(packet_info.sid == boost::uint32_t((_sid >> 16) | (_sid << 16)));
-                UHD_ASSERT_THROW(packet_info.packet_count == (seq_to_ack & 0xfff));
-                UHD_ASSERT_THROW(packet_info.num_payload_words32 == 2);
-                UHD_ASSERT_THROW(packet_info.packet_type == _packet_type);
-            }
-            catch(const std::exception &ex)
-            {
-                throw uhd::io_error(str(boost::format("Radio ctrl (%s) packet parse error - %s") % _name % ex.what()));
-            }
+            //parse and check the buffer
+            const boost::uint64_t value = this->check_response(pkt, num_words, seq_to_ack);
 
             //return the readback value
-            if (readback and _outstanding_seqs.empty())
-            {
-                const boost::uint64_t hi = (_bige)? uhd::ntohx(pkt[packet_info.num_header_words32+0]) : uhd::wtohx(pkt[packet_info.num_header_words32+0]);
-                const boost::uint64_t lo = (_bige)? uhd::ntohx(pkt[packet_info.num_header_words32+1]) : uhd::wtohx(pkt[packet_info.num_header_words32+1]);
-                return ((hi << 32) | lo);
-            }
+            if (readback and _outstanding_seqs.empty()) return value;
         }
 
         return 0;
     }
 
+    /*!
+     * Get the next response packet, either from the response endpoint
+     * or from the pushed response queue. Return false on timeout.
+     */
+    bool get_response(
+        resp_buff_type &resp_buff,
+        managed_recv_buffer::sptr &buff,
+        boost::uint32_t const *&pkt,
+        size_t &num_words,
+        const double timeout
+    ){
+        if (_resp_xport)
+        {
+            buff = _resp_xport->get_recv_buff(timeout);
+            if (not buff) return false;
+            if (not buff->size()) throw uhd::io_error(str(boost::format("Radio ctrl (%s) empty response packet") % _name));
+            pkt = buff->cast<const boost::uint32_t *>();
+            num_words = buff->size()/sizeof(boost::uint32_t);
+            return true;
+        }
+
+        /*
+         * Couldn't get message with haste.
+         * Now check both possible queues for messages.
+         * Messages should come in on _resp_queue,
+         * but could end up in dump_queue.
+         * If we don't get a message --> Die in timeout.
+         */
+        std::memset(&resp_buff, 0x00, sizeof(resp_buff));
+        double accum_timeout = 0.0;
+        const double short_timeout = 0.005; // == 5ms
+        while(not ((_resp_queue.pop_with_haste(resp_buff))
+                || (check_dump_queue(resp_buff))
+                )){
+            if (accum_timeout >= timeout) return false;
+            if (_resp_queue.pop_with_timed_wait(resp_buff, short_timeout)) break;
+            accum_timeout += short_timeout;
+        }
+
+        pkt = resp_buff.data;
+        num_words = sizeof(resp_buff)/sizeof(boost::uint32_t);
+        return true;
+    }
+
+    //! Parse and check a response packet, return its readback value
+    boost::uint64_t check_response(boost::uint32_t const *pkt, const size_t num_words, const size_t seq_to_ack)
+    {
+        vrt::if_packet_info_t packet_info;
+        packet_info.num_packet_words32 = num_words;
+
+        //parse the buffer
+        try
+        {
+            packet_info.link_type = _link_type;
+            if (_bige) vrt::if_hdr_unpack_be(pkt, packet_info);
+            else vrt::if_hdr_unpack_le(pkt, packet_info);
+        }
+        catch(const std::exception &ex)
+        {
+            UHD_MSG(error) << "Radio ctrl bad VITA packet: " << ex.what() << std::endl;
+            UHD_VAR(num_words);
+            UHD_MSG(status) << std::hex << pkt[0] << std::dec << std::endl;
+            UHD_MSG(status) << std::hex << pkt[1] << std::dec << std::endl;
+            UHD_MSG(status) << std::hex << pkt[2] << std::dec << std::endl;
+            UHD_MSG(status) << std::hex << pkt[3] << std::dec << std::endl;
+        }
+
+        //check the buffer
+        try
+        {
+            UHD_ASSERT_THROW(packet_info.has_sid);
+            UHD_ASSERT_THROW(packet_info.sid == boost::uint32_t((_sid >> 16) | (_sid << 16)));
+            UHD_ASSERT_THROW(packet_info.packet_count == (seq_to_ack & 0xfff));
+            UHD_ASSERT_THROW(packet_info.num_payload_words32 == 2);
+            UHD_ASSERT_THROW(packet_info.packet_type == _packet_type);
+        }
+        catch(const std::exception &ex)
+        {
+            throw uhd::io_error(str(boost::format("Radio ctrl (%s) packet parse error - %s") % _name % ex.what()));
+        }
+
+        const boost::uint64_t hi = (_bige)? uhd::ntohx(pkt[packet_info.num_header_words32+0]) : uhd::wtohx(pkt[packet_info.num_header_words32+0]);
+        const boost::uint64_t lo = (_bige)? uhd::ntohx(pkt[packet_info.num_header_words32+1]) : uhd::wtohx(pkt[packet_info.num_header_words32+1]);
+        return ((hi << 32) | lo);
+    }
+
     /*
      * If ctrl_core waits for a message that didn't arrive it can search for it in the dump queue.
      * This actually happens during shutdown.
@@ -52,8 +52,25 @@ public:
     //! Set the command time that will activate
     virtual void set_time(const uhd::time_spec_t &time) = 0;
 
+    /*!
+     * Get an interface to this control for poke32 without the command time,
+     * for writes that apply now while another thread sets timed commands.
+     * The writes still wait behind queued timed commands in the FIFO.
+     */
+    virtual uhd::wb_iface::sptr get_untimed_iface(void) = 0;
+
     //! Set the tick rate (converting time into ticks)
     virtual void set_tick_rate(const double rate) = 0;
+
+    /*!
+     * Get the number of commands sent but not acknowledged yet,
+     * which includes timed commands waiting in the command FIFO.
+     * Acknowledgements that already arrived are collected first.
+     */
+    virtual size_t get_num_outstanding(void) = 0;
+
+    //! Get the number of outstanding commands after which a poke blocks
+    virtual size_t get_max_outstanding(void) = 0;
 };
 
 #endif /* INCLUDED_LIBUHD_USRP_RADIO_CTRL_3000_HPP */
@@ -37,9 +37,11 @@ struct rx_vita_core_3000_impl : rx_vita_core_3000
 {
     rx_vita_core_3000_impl(
         wb_iface::sptr iface,
-        const size_t base
+        const size_t base,
+        wb_iface::sptr untimed_iface
     ):
         _iface(iface),
+        _untimed_iface((untimed_iface)? untimed_iface : iface),
         _base(base),
         _continuous_streaming(false),
         _is_setup(false)
@@ -63,6 +65,11 @@ struct rx_vita_core_3000_impl : rx_vita_core_3000
         _iface->poke32(REG_FC_ENABLE, window_size?1:0);
     }
 
+    void set_flow_control_window(const size_t window_size)
+    {
+        _untimed_iface->poke32(REG_FC_WINDOW, window_size-1);
+    }
+
     void clear(void)
     {
         this->configure_flow_control(0); //disable fc
@@ -138,6 +145,7 @@ struct rx_vita_core_3000_impl : rx_vita_core_3000
     }
 
     wb_iface::sptr _iface;
+    wb_iface::sptr _untimed_iface;
     const size_t _base;
     double _tick_rate;
     bool _continuous_streaming;
@@ -146,8 +154,9 @@ struct rx_vita_core_3000_impl : rx_vita_core_3000
 
 rx_vita_core_3000::sptr rx_vita_core_3000::make(
     wb_iface::sptr iface,
-    const size_t base
+    const size_t base,
+    wb_iface::sptr untimed_iface
 )
 {
-    return rx_vita_core_3000::sptr(new rx_vita_core_3000_impl(iface, base));
+    return rx_vita_core_3000::sptr(new rx_vita_core_3000_impl(iface, base, untimed_iface));
 }
@@ -32,9 +32,16 @@ class rx_vita_core_3000 : boost::noncopyable
 public:
     typedef boost::shared_ptr<rx_vita_core_3000> sptr;
 
+    /*!
+     * Make a new framer.
+     * \param iface the control of the framer registers
+     * \param base the base address of the framer registers
+     * \param untimed_iface writes the window while streaming, see set_flow_control_window
+     */
     static sptr make(
         uhd::wb_iface::sptr iface,
-        const size_t base
+        const size_t base,
+        uhd::wb_iface::sptr untimed_iface = uhd::wb_iface::sptr()
     );
 
     virtual void clear(void) = 0;
@@ -53,6 +60,13 @@ public:
 
     virtual void configure_flow_control(const size_t window_size) = 0;
 
+    /*!
+     * Change the window of the enabled flow control while streaming.
+     * One write through the untimed interface (iface when there is none),
+     * so a command time set by another thread does not apply to it.
+     */
+    virtual void set_flow_control_window(const size_t window_size) = 0;
+
     virtual bool in_continuous_streaming_mode(void) = 0;
 };
 
@@ -41,7 +41,7 @@ sbx_xcvr::cbx::~cbx(void){
 /***********************************************************************
  * Tuning
  **********************************************************************/
-double sbx_xcvr::cbx::set_lo_freq(dboard_iface::unit_t unit, double target_freq) {
+synth_solution_t sbx_xcvr::cbx::solve_lo_freq(dboard_iface::unit_t unit, double target_freq) {
     UHD_LOGV(often) << boost::format(
         "CBX tune: target frequency %f Mhz"
     ) % (target_freq/1e6) << std::endl;
@@ -168,6 +168,8 @@ double sbx_xcvr::cbx::set_lo_freq(dboard_iface::unit_t unit, double target_freq)
             ) % board_name.c_str() % (target_freq/1e6) % (actual_freq/1e6) % (vco_freq/1e6) % (pfd_freq/1e6) % (pfd_freq/BS/1e6) << std::endl;
 
     //load the register values
+    synth_solution_t solution;
+    solution.actual_freq = actual_freq;
     max2870_regs_t regs;
 
     if ((unit == dboard_iface::UNIT_TX) and (actual_freq == sbx_tx_lo_2dbm.clip(actual_freq)))
@@ -205,7 +207,7 @@ double sbx_xcvr::cbx::set_lo_freq(dboard_iface::unit_t unit, double target_freq)
     regs.ldf = ldf;
     regs.cpoc = cpoc;
 
-    //write the registers
+    //the register words, written by set_lo_freq
     //correct power-up sequence to write registers (5, 4, 3, 2, 1, 0)
     int addr;
 
@@ -213,16 +215,13 @@ double sbx_xcvr::cbx::set_lo_freq(dboard_iface::unit_t unit, double target_freq)
         UHD_LOGV(often) << boost::format(
             "%s SPI Reg (0x%02x): 0x%08x"
         ) % board_name.c_str() % addr % regs.get_reg(addr) << std::endl;
-        self_base->get_iface()->write_spi(
-            unit, spi_config_t::EDGE_RISE,
-            regs.get_reg(addr), 32
-        );
+        solution.regs.push_back(regs.get_reg(addr));
     }
 
     //return the actual frequency
     UHD_LOGV(often) << boost::format(
         "%s tune: actual frequency %f Mhz"
     ) % board_name.c_str() % (actual_freq/1e6) << std::endl;
-    return actual_freq;
+    return solution;
 }
 
@@ -171,6 +171,9 @@ sbx_xcvr::sbx_xcvr(ctor_args_t args) : xcvr_dboard_base(args){
         .coerce(boost::bind(&sbx_xcvr::set_lo_freq, this, dboard_iface::UNIT_RX, _1))
         .set((freq_range.start() + freq_range.stop())/2.0);
     this->get_rx_subtree()->create<meta_range_t>("freq/range").set(freq_range);
+    this->get_rx_subtree()->create<std::vector<double> >("freq/pretune")
+        .subscribe(boost::bind(&sbx_xcvr::pretune_lo_freqs, this, dboard_iface::UNIT_RX, _1))
+        .set(std::vector<double>());
     this->get_rx_subtree()->create<std::string>("antenna/value")
         .subscribe(boost::bind(&sbx_xcvr::set_rx_ant, this, _1))
         .set("RX2");
@@ -212,6 +215,9 @@ sbx_xcvr::sbx_xcvr(ctor_args_t args) : xcvr_dboard_base(args){
         .coerce(boost::bind(&sbx_xcvr::set_lo_freq, this, dboard_iface::UNIT_TX, _1))
         .set((freq_range.start() + freq_range.stop())/2.0);
     this->get_tx_subtree()->create<meta_range_t>("freq/range").set(freq_range);
+    this->get_tx_subtree()->create<std::vector<double> >("freq/pretune")
+        .subscribe(boost::bind(&sbx_xcvr::pretune_lo_freqs, this, dboard_iface::UNIT_TX, _1))
+        .set(std::vector<double>());
     this->get_tx_subtree()->create<std::string>("antenna/value")
         .subscribe(boost::bind(&sbx_xcvr::set_tx_ant, this, _1))
         .set(sbx_tx_antennas.at(0));
@@ -327,7 +333,11 @@ void sbx_xcvr::set_tx_ant(const std::string &ant){
  * Tuning
  **********************************************************************/
 double sbx_xcvr::set_lo_freq(dboard_iface::unit_t unit, double target_freq) {
-    const double actual = db_actual->set_lo_freq(unit, target_freq);
+    const synth_solution_t solution = this->get_lo_solution(unit, target_freq);
+    BOOST_FOREACH(const boost::uint32_t reg, solution.regs){
+        this->get_iface()->write_spi(unit, spi_config_t::EDGE_RISE, reg, 32);
+    }
+    const double actual = solution.actual_freq;
     if (unit == dboard_iface::UNIT_RX){
         _rx_lo_lock_cache = false;
         _rx_lo_freq = actual;
@@ -340,6 +350,29 @@ double sbx_xcvr::set_lo_freq(dboard_iface::unit_t unit, double target_freq) {
     return actual;
 }
 
+synth_solution_t sbx_xcvr::get_lo_solution(dboard_iface::unit_t unit, double target_freq) {
+    property_tree::sptr subtree = (unit == dboard_iface::UNIT_RX) ? this->get_rx_subtree()
+                                                                  : this->get_tx_subtree();
+    synth_cache &cache = (unit == dboard_iface::UNIT_RX) ? _rx_synth_cache : _tx_synth_cache;
+    const synth_key_t key(
+        target_freq, this->get_iface()->get_clock_rate(unit),
+        subtree->access<device_addr_t>("tune_args").get().to_string()
+    );
+
+    synth_solution_t solution;
+    if (not cache.lookup(key, solution)){
+        solution = db_actual->solve_lo_freq(unit, target_freq);
+        cache.store(key, solution);
+    }
+    return solution;
+}
+
+void sbx_xcvr::pretune_lo_freqs(dboard_iface::unit_t unit, const std::vector<double> &freqs) {
+    BOOST_FOREACH(const double freq, freqs){
+        this->get_lo_solution(unit, freq);
+    }
+}
+
 
 sensor_value_t sbx_xcvr::get_locked(dboard_iface::unit_t unit) {
     const bool locked = (this->get_iface()->read_gpio(unit) & LOCKDET_MASK) != 0;
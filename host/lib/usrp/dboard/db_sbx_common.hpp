@@ -18,6 +18,7 @@
 #include <uhd/types/device_addr.hpp>
 
 #include "../common/adf435x_common.hpp"
+#include "../common/synth_cache.hpp"
 
 // Common IO Pins
 #define LO_LPF_EN       (1 << 15)
@@ -150,6 +151,25 @@ protected:
      */
     virtual double set_lo_freq(dboard_iface::unit_t unit, double target_freq);
 
+    /*!
+     * Get the synthesizer solution for a target frequency,
+     * from the cache of the unit or solved and then cached.
+     * \param unit which unit rx or tx
+     * \param target_freq the desired frequency in Hz
+     * \return the register words and the actual frequency
+     */
+    synth_solution_t get_lo_solution(dboard_iface::unit_t unit, double target_freq);
+
+    /*!
+     * Solve and cache the synthesizer for a list of frequencies.
+     * \param unit which unit rx or tx
+     * \param freqs the frequencies in Hz
+     */
+    void pretune_lo_freqs(dboard_iface::unit_t unit, const std::vector<double> &freqs);
+
+    //! per-unit caches of synthesizer solutions
+    synth_cache _rx_synth_cache, _tx_synth_cache;
+
     /*!
      * Get the lock detect status of the LO.
      * \param unit which unit rx or tx
@@ -174,7 +194,7 @@ protected:
         sbx_versionx() {}
         ~sbx_versionx(void) {}
 
-        virtual double set_lo_freq(dboard_iface::unit_t unit, double target_freq) = 0;
+        virtual synth_solution_t solve_lo_freq(dboard_iface::unit_t unit, double target_freq) = 0;
     };
 
     /*!
@@ -185,7 +205,7 @@ protected:
         sbx_version3(sbx_xcvr *_self_sbx_xcvr);
         ~sbx_version3(void);
 
-        double set_lo_freq(dboard_iface::unit_t unit, double target_freq);
+        synth_solution_t solve_lo_freq(dboard_iface::unit_t unit, double target_freq);
 
         /*! This is the registered instance of the wrapper class, sbx_base. */
         sbx_xcvr *self_base;
@@ -201,7 +221,7 @@ protected:
         sbx_version4(sbx_xcvr *_self_sbx_xcvr);
         ~sbx_version4(void);
 
-        double set_lo_freq(dboard_iface::unit_t unit, double target_freq);
+        synth_solution_t solve_lo_freq(dboard_iface::unit_t unit, double target_freq);
 
         /*! This is the registered instance of the wrapper class, sbx_base. */
         sbx_xcvr *self_base;
@@ -219,7 +239,7 @@ protected:
         cbx(sbx_xcvr *_self_sbx_xcvr);
         ~cbx(void);
 
-        double set_lo_freq(dboard_iface::unit_t unit, double target_freq);
+        synth_solution_t solve_lo_freq(dboard_iface::unit_t unit, double target_freq);
 
         /*! This is the registered instance of the wrapper class, sbx_base. */
         sbx_xcvr *self_base;
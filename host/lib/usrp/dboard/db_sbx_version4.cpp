@@ -43,7 +43,7 @@ sbx_xcvr::sbx_version4::~sbx_version4(void){
 /***********************************************************************
  * Tuning
  **********************************************************************/
-double sbx_xcvr::sbx_version4::set_lo_freq(dboard_iface::unit_t unit, double target_freq) {
+synth_solution_t sbx_xcvr::sbx_version4::solve_lo_freq(dboard_iface::unit_t unit, double target_freq) {
     UHD_LOGV(often) << boost::format(
         "SBX tune: target frequency %f Mhz"
     ) % (target_freq/1e6) << std::endl;
@@ -96,6 +96,8 @@ double sbx_xcvr::sbx_version4::set_lo_freq(dboard_iface::unit_t unit, double tar
         tuning_constraints, actual_freq);
 
     //load the register values
+    synth_solution_t solution;
+    solution.actual_freq = actual_freq;
     adf4351_regs_t regs;
 
     if ((unit == dboard_iface::UNIT_TX) and (actual_freq == sbx_tx_lo_2dbm.clip(actual_freq))) 
@@ -128,10 +130,10 @@ double sbx_xcvr::sbx_version4::set_lo_freq(dboard_iface::unit_t unit, double tar
 
     //reset the N and R counter
     regs.counter_reset = adf4351_regs_t::COUNTER_RESET_ENABLED;
-    self_base->get_iface()->write_spi(unit, spi_config_t::EDGE_RISE, regs.get_reg(2), 32);
+    solution.regs.push_back(regs.get_reg(2));
     regs.counter_reset = adf4351_regs_t::COUNTER_RESET_DISABLED;
 
-    //write the registers
+    //the register words, written by set_lo_freq
     //correct power-up sequence to write registers (5, 4, 3, 2, 1, 0)
     int addr;
 
@@ -141,16 +143,13 @@ double sbx_xcvr::sbx_version4::set_lo_freq(dboard_iface::unit_t unit, double tar
         UHD_LOGV(often) << boost::format(
             "%s SPI Reg (0x%02x): 0x%08x"
         ) % board_name.c_str() % addr % regs.get_reg(addr) << std::endl;
-        self_base->get_iface()->write_spi(
-            unit, spi_config_t::EDGE_RISE,
-            regs.get_reg(addr), 32
-        );
+        solution.regs.push_back(regs.get_reg(addr));
     }
 
     //return the actual frequency
     UHD_LOGV(often) << boost::format(
         "%s tune: actual frequency %f Mhz"
     ) % board_name.c_str() % (actual_freq/1e6) << std::endl;
-    return actual_freq;
+    return solution;
 }
 
@@ -102,21 +102,27 @@ wbx_base::wbx_base(ctor_args_t args) : xcvr_dboard_base(args){
     switch(rx_id) {
         case 0x0053:
             db_actual = wbx_versionx_sptr(new wbx_version2(this));
-            return;
+            break;
         case 0x0057:
             db_actual = wbx_versionx_sptr(new wbx_version3(this));
-            return;
+            break;
         case 0x0063:
             db_actual = wbx_versionx_sptr(new wbx_version4(this));
-            return;
+            break;
         case 0x0081:
             db_actual = wbx_versionx_sptr(new wbx_version4(this));
-            return;
+            break;
         default:
             /* We didn't recognize the version of the board... */
             UHD_THROW_INVALID_CODE_PATH();
     }
 
+    this->get_rx_subtree()->create<std::vector<double> >("freq/pretune")
+        .subscribe(boost::bind(&wbx_base::wbx_versionx::pretune_lo_freqs, db_actual.get(), dboard_iface::UNIT_RX, _1))
+        .set(std::vector<double>());
+    this->get_tx_subtree()->create<std::vector<double> >("freq/pretune")
+        .subscribe(boost::bind(&wbx_base::wbx_versionx::pretune_lo_freqs, db_actual.get(), dboard_iface::UNIT_TX, _1))
+        .set(std::vector<double>());
 }
 
 
@@ -156,3 +162,37 @@ sensor_value_t wbx_base::get_locked(dboard_iface::unit_t unit){
     const bool locked = (this->get_iface()->read_gpio(unit) & LOCKDET_MASK) != 0;
     return sensor_value_t("LO", locked, "locked", "unlocked");
 }
+
+/***********************************************************************
+ * Synthesizer solutions
+ **********************************************************************/
+double wbx_base::wbx_versionx::set_lo_freq(dboard_iface::unit_t unit, double target_freq){
+    const synth_solution_t solution = this->get_lo_solution(unit, target_freq);
+    BOOST_FOREACH(const boost::uint32_t reg, solution.regs){
+        self_base->get_iface()->write_spi(unit, spi_config_t::EDGE_RISE, reg, 32);
+    }
+    return solution.actual_freq;
+}
+
+synth_solution_t wbx_base::wbx_versionx::get_lo_solution(dboard_iface::unit_t unit, double target_freq){
+    property_tree::sptr subtree = (unit == dboard_iface::UNIT_RX) ? this->get_rx_subtree()
+                                                                  : this->get_tx_subtree();
+    synth_cache &cache = (unit == dboard_iface::UNIT_RX) ? _rx_synth_cache : _tx_synth_cache;
+    const synth_key_t key(
+        target_freq, self_base->get_iface()->get_clock_rate(unit),
+        subtree->access<device_addr_t>("tune_args").get().to_string()
+    );
+
+    synth_solution_t solution;
+    if (not cache.lookup(key, solution)){
+        solution = this->solve_lo_freq(unit, target_freq);
+        cache.store(key, solution);
+    }
+    return solution;
+}
+
+void wbx_base::wbx_versionx::pretune_lo_freqs(dboard_iface::unit_t unit, const std::vector<double> &freqs){
+    BOOST_FOREACH(const double freq, freqs){
+        this->get_lo_solution(unit, freq);
+    }
+}
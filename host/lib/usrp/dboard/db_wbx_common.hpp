@@ -21,6 +21,7 @@
 #include <uhd/types/device_addr.hpp>
 
 #include "../common/adf435x_common.hpp"
+#include "../common/synth_cache.hpp"
 
 // TX IO Pins
 #define TX_PUP_5V       (1 << 7)                // enables 5.0V power supply
@@ -130,7 +131,24 @@ protected:
 
         virtual double set_tx_gain(double gain, const std::string &name) = 0;
         virtual void set_tx_enabled(bool enb) = 0;
-        virtual double set_lo_freq(dboard_iface::unit_t unit, double target_freq) = 0;
+        virtual synth_solution_t solve_lo_freq(dboard_iface::unit_t unit, double target_freq) = 0;
+
+        /*!
+         * Tune the LO, replaying the cached synthesizer solution if there is one.
+         * \param unit which unit rx or tx
+         * \param target_freq the desired frequency in Hz
+         * \return the actual frequency in Hz
+         */
+        double set_lo_freq(dboard_iface::unit_t unit, double target_freq);
+
+        //! Solve and cache the synthesizer for a list of frequencies
+        void pretune_lo_freqs(dboard_iface::unit_t unit, const std::vector<double> &freqs);
+
+        //! Get the cached synthesizer solution, or solve and cache it
+        synth_solution_t get_lo_solution(dboard_iface::unit_t unit, double target_freq);
+
+        //! per-unit caches of synthesizer solutions
+        synth_cache _rx_synth_cache, _tx_synth_cache;
 
         /*! This is the registered instance of the wrapper class, wbx_base. */
         wbx_base *self_base;
@@ -157,7 +175,7 @@ protected:
 
         double set_tx_gain(double gain, const std::string &name);
         void set_tx_enabled(bool enb);
-        double set_lo_freq(dboard_iface::unit_t unit, double target_freq);
+        synth_solution_t solve_lo_freq(dboard_iface::unit_t unit, double target_freq);
     };
 
     /*!
@@ -172,7 +190,7 @@ protected:
 
         double set_tx_gain(double gain, const std::string &name);
         void set_tx_enabled(bool enb);
-        double set_lo_freq(dboard_iface::unit_t unit, double target_freq);
+        synth_solution_t solve_lo_freq(dboard_iface::unit_t unit, double target_freq);
     };
 
     /*!
@@ -187,7 +205,7 @@ protected:
 
         double set_tx_gain(double gain, const std::string &name);
         void set_tx_enabled(bool enb);
-        double set_lo_freq(dboard_iface::unit_t unit, double target_freq);
+        synth_solution_t solve_lo_freq(dboard_iface::unit_t unit, double target_freq);
     };
 
     /*!
@@ -192,7 +192,7 @@ double wbx_base::wbx_version3::set_tx_gain(double gain, const std::string &name)
 /***********************************************************************
  * Tuning
  **********************************************************************/
-double wbx_base::wbx_version3::set_lo_freq(dboard_iface::unit_t unit, double target_freq) {
+synth_solution_t wbx_base::wbx_version3::solve_lo_freq(dboard_iface::unit_t unit, double target_freq) {
     //clip to tuning range
     target_freq = wbx_v3_freq_range.clip(target_freq);
 
@@ -255,6 +255,8 @@ double wbx_base::wbx_version3::set_lo_freq(dboard_iface::unit_t unit, double tar
     double actual_freq = synth_actual_freq / 2;
 
     //load the register values
+    synth_solution_t solution;
+    solution.actual_freq = actual_freq;
     adf4350_regs_t regs;
 
     if (unit == dboard_iface::UNIT_RX)
@@ -291,10 +293,10 @@ double wbx_base::wbx_version3::set_lo_freq(dboard_iface::unit_t unit, double tar
 
     //reset the N and R counter
     regs.counter_reset = adf4350_regs_t::COUNTER_RESET_ENABLED;
-    self_base->get_iface()->write_spi(unit, spi_config_t::EDGE_RISE, regs.get_reg(2), 32);
+    solution.regs.push_back(regs.get_reg(2));
     regs.counter_reset = adf4350_regs_t::COUNTER_RESET_DISABLED;
 
-    //write the registers
+    //the register words, written by set_lo_freq
     //correct power-up sequence to write registers (5, 4, 3, 2, 1, 0)
     int addr;
 
@@ -302,15 +304,12 @@ double wbx_base::wbx_version3::set_lo_freq(dboard_iface::unit_t unit, double tar
         UHD_LOGV(often) << boost::format(
             "WBX SPI Reg (0x%02x): 0x%08x"
         ) % addr % regs.get_reg(addr) << std::endl;
-        self_base->get_iface()->write_spi(
-            unit, spi_config_t::EDGE_RISE,
-            regs.get_reg(addr), 32
-        );
+        solution.regs.push_back(regs.get_reg(addr));
     }
 
     //return the actual frequency
     UHD_LOGV(often) << boost::format(
         "WBX tune: actual frequency %f Mhz"
     ) % (actual_freq/1e6) << std::endl;
-    return actual_freq;
+    return solution;
 }
@@ -15,6 +15,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include "init_profiler.hpp"
 #include <uhd/usrp/dboard_eeprom.hpp>
 #include <uhd/exception.hpp>
 #include <uhd/utils/log.hpp>
@@ -101,6 +102,7 @@ dboard_eeprom_t::dboard_eeprom_t(void){
 }
 
 void dboard_eeprom_t::load(i2c_iface &iface, boost::uint8_t addr){
+    init_span span(str(boost::format("dboard_eeprom_0x%02x") % int(addr)));
     byte_vector_t bytes = iface.read_eeprom(addr, 0, DB_EEPROM_CLEN);
 
     std::ostringstream ss;
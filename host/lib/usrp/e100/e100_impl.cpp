@@ -192,7 +192,7 @@ e100_impl::e100_impl(const uhd::device_addr_t &device_addr){
     // Create controller objects
     ////////////////////////////////////////////////////////////////////
     _fpga_i2c_ctrl = i2c_core_200::make(_fifo_ctrl, TOREG(SR_I2C), REG_RB_I2C);
-    _data_transport = e100_make_mmap_zero_copy(_fpga_ctrl);
+    _data_transport = e100_make_mmap_zero_copy(_fpga_ctrl, device_addr.cast<double>("recv_busy_poll", 0.0)/1e6);
 
     ////////////////////////////////////////////////////////////////////
     // Initialize the properties tree
@@ -42,7 +42,7 @@
 #ifndef INCLUDED_E100_IMPL_HPP
 #define INCLUDED_E100_IMPL_HPP
 
-uhd::transport::zero_copy_if::sptr e100_make_mmap_zero_copy(e100_ctrl::sptr iface);
+uhd::transport::zero_copy_if::sptr e100_make_mmap_zero_copy(e100_ctrl::sptr iface, const double busy_poll = 0.0);
 
 // = gpmc_clock_rate/clk_div/cycles_per_transaction*bytes_per_transaction
 static const double          E100_RX_LINK_RATE_BPS = 166e6/3/2*2;
@@ -18,12 +18,14 @@
 #include "e100_ctrl.hpp"
 #include <uhd/transport/zero_copy.hpp>
 #include <uhd/utils/log.hpp>
+#include <uhd/types/time_spec.hpp>
 #include <uhd/exception.hpp>
 #include <boost/make_shared.hpp>
 #include <linux/usrp_e.h>
 #include <sys/mman.h> //mmap
 #include <unistd.h> //getpagesize
 #include <poll.h> //poll
+#include <algorithm>
 #include <vector>
 
 using namespace uhd;
@@ -97,8 +99,8 @@ private:
  **********************************************************************/
 class e100_mmap_zero_copy_impl : public zero_copy_if{
 public:
-    e100_mmap_zero_copy_impl(e100_ctrl::sptr iface):
-        _fd(iface->get_file_descriptor()), _recv_index(0), _send_index(0)
+    e100_mmap_zero_copy_impl(e100_ctrl::sptr iface, const double busy_poll):
+        _fd(iface->get_file_descriptor()), _busy_poll(busy_poll), _recv_index(0), _send_index(0)
     {
         //get system sizes
         iface->ioctl(USRP_E_GET_RB_INFO, &_rb_size);
@@ -178,6 +180,12 @@ public:
         if (fp_verbose) UHD_LOGV(always) << "get_recv_buff: " << _recv_index << std::endl;
         e100_mmap_zero_copy_mrb &mrb = *_mrb_pool[_recv_index];
 
+        //busy poll: spin on the frame flags for up to the poll budget
+        if (_busy_poll > 0.0 and not mrb.ready()){
+            const time_spec_t poll_end = time_spec_t::get_system_time() + time_spec_t(std::min(_busy_poll, timeout));
+            while (not mrb.ready() and time_spec_t::get_system_time() < poll_end){}
+        }
+
         //poll/wait for a ready frame
         if (not mrb.ready()){
             for (size_t i = 0; i < poll_breakout; i++){
@@ -239,6 +247,9 @@ private:
     //file descriptor for mmap
     int _fd;
 
+    //time to spin on the frame flags before polling
+    const double _busy_poll;
+
     //the mapped memory itself
     void *_mapped_mem;
 
@@ -257,6 +268,6 @@ private:
 /***********************************************************************
  * The zero copy interface make function
  **********************************************************************/
-zero_copy_if::sptr e100_make_mmap_zero_copy(e100_ctrl::sptr iface){
-    return zero_copy_if::sptr(new e100_mmap_zero_copy_impl(iface));
+zero_copy_if::sptr e100_make_mmap_zero_copy(e100_ctrl::sptr iface, const double busy_poll){
+    return zero_copy_if::sptr(new e100_mmap_zero_copy_impl(iface, busy_poll));
 }
@@ -15,6 +15,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include "../transport/shm_ring_publisher.hpp"
 #include <uhd/property_tree.hpp>
 #include <uhd/usrp/multi_usrp.hpp>
 #include <uhd/utils/msg.hpp>
@@ -594,7 +595,11 @@ public:
      ******************************************************************/
     rx_streamer::sptr get_rx_stream(const stream_args_t &args) {
         _check_link_rate(args, false);
-        return this->get_device()->get_rx_stream(args);
+        rx_streamer::sptr rx_stream = this->get_device()->get_rx_stream(args);
+        //publish to shared memory when asked for by shm_name
+        transport::shm_ring_publish_rx_stream(
+            rx_stream, args, this->get_rx_rate(args.channels.empty()? 0 : args.channels.front()));
+        return rx_stream;
     }
 
     void set_rx_subdev_spec(const subdev_spec_t &spec, size_t mboard){
@@ -681,6 +686,12 @@ public:
         return _tree->access<meta_range_t>(rx_rf_fe_root(chan) / "freq" / "range").get();
     }
 
+    void pretune_rx_freqs(const std::vector<double> &freqs, size_t chan){
+        if (_tree->exists(rx_rf_fe_root(chan) / "freq" / "pretune")){
+            _tree->access<std::vector<double> >(rx_rf_fe_root(chan) / "freq" / "pretune").set(freqs);
+        }
+    }
+
     void set_rx_gain(double gain, const std::string &name, size_t chan){
         try {
             return rx_gain_group(chan)->set_value(gain, name);
@@ -879,6 +890,12 @@ public:
         return _tree->access<meta_range_t>(tx_rf_fe_root(chan) / "freq" / "range").get();
     }
 
+    void pretune_tx_freqs(const std::vector<double> &freqs, size_t chan){
+        if (_tree->exists(tx_rf_fe_root(chan) / "freq" / "pretune")){
+            _tree->access<std::vector<double> >(tx_rf_fe_root(chan) / "freq" / "pretune").set(freqs);
+        }
+    }
+
     void set_tx_gain(double gain, const std::string &name, size_t chan){
         try {
             return tx_gain_group(chan)->set_value(gain, name);
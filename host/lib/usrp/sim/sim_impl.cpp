@@ -0,0 +1,335 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "sim_impl.hpp"
+#include "validate_subdev_spec.hpp"
+#include <uhd/utils/msg.hpp>
+#include <uhd/utils/static.hpp>
+#include <uhd/exception.hpp>
+#include <uhd/types/ranges.hpp>
+#include <uhd/types/sensors.hpp>
+#include <uhd/usrp/mboard_eeprom.hpp>
+#include <uhd/usrp/dboard_eeprom.hpp>
+#include <boost/format.hpp>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/assign/list_of.hpp>
+#include <boost/math/special_functions/round.hpp>
+
+using namespace uhd;
+using namespace uhd::usrp;
+using namespace uhd::transport;
+
+/***********************************************************************
+ * Discovery
+ **********************************************************************/
+static device_addrs_t sim_find(const device_addr_t &hint)
+{
+    device_addrs_t sim_addrs;
+
+    //the simulator is only found when asked for by type
+    if (not hint.has_key("type") or hint["type"] != "sim") return sim_addrs;
+
+    device_addr_t new_addr;
+    new_addr["type"] = "sim";
+    new_addr["name"] = hint.get("name", "");
+    new_addr["serial"] = hint.get("serial", "SIM0");
+    sim_addrs.push_back(new_addr);
+    return sim_addrs;
+}
+
+/***********************************************************************
+ * Make
+ **********************************************************************/
+static device::sptr sim_make(const device_addr_t &device_addr)
+{
+    return device::sptr(new sim_impl(device_addr));
+}
+
+UHD_STATIC_BLOCK(register_sim_device)
+{
+    device::register_device(&sim_find, &sim_make);
+}
+
+/***********************************************************************
+ * Helpers
+ **********************************************************************/
+static void sim_check_source(const std::string &what, const std::string &source)
+{
+    if (source != "internal") throw uhd::key_error(str(
+        boost::format("sim: unsupported %s source %s") % what % source
+    ));
+}
+
+static meta_range_t sim_get_host_rates(const double tick_rate)
+{
+    meta_range_t range;
+    for (size_t decim = SIM_MAX_DECIM; decim > 0; decim--){
+        range.push_back(range_t(tick_rate/decim));
+    }
+    return range;
+}
+
+static double sim_clip_dsp_freq(const double tick_rate, const double freq)
+{
+    return std::max(-tick_rate/2, std::min(tick_rate/2, freq));
+}
+
+static meta_range_t sim_get_dsp_freq_range(const double tick_rate)
+{
+    return meta_range_t(-tick_rate/2, tick_rate/2);
+}
+
+/***********************************************************************
+ * Structors
+ **********************************************************************/
+sim_impl::sim_impl(const device_addr_t &device_addr):
+    _clock(new sim_clock()),
+    _io_cpus(device_addr.get("io_cpus", "")),
+    _convert_cpus(device_addr.get("convert_cpus", "")),
+    _async_md(new async_md_type(1000/*messages deep*/))
+{
+    _tree = property_tree::make();
+    const fs_path mb_path = "/mboards/0";
+
+    const bool paced = device_addr.cast<int>("paced", 1) != 0;
+    sim_faults_t faults(device_addr);
+    UHD_MSG(status) << boost::format(
+        "Creating simulated device (%s, drop %g, reorder %g, late %g)..."
+    ) % (paced? "paced" : "unpaced") % faults.drop_rate % faults.reorder_rate % faults.late_rate << std::endl;
+
+    ////////////////////////////////////////////////////////////////////
+    // create the links of each radio
+    ////////////////////////////////////////////////////////////////////
+    //the CHDR length field is 16 bits
+    zero_copy_xport_params rx_params;
+    rx_params.recv_frame_size = std::min<size_t>(0xfff8, device_addr.cast<size_t>("recv_frame_size", SIM_DATA_FRAME_SIZE));
+    rx_params.num_recv_frames = device_addr.cast<size_t>("num_recv_frames", SIM_DATA_NUM_FRAMES);
+    rx_params.send_frame_size = SIM_MSG_FRAME_SIZE;
+    rx_params.num_send_frames = SIM_MSG_NUM_FRAMES;
+    zero_copy_xport_params tx_params;
+    tx_params.recv_frame_size = SIM_MSG_FRAME_SIZE;
+    tx_params.num_recv_frames = SIM_MSG_NUM_FRAMES;
+    tx_params.send_frame_size = std::min<size_t>(0xfff8, device_addr.cast<size_t>("send_frame_size", SIM_DATA_FRAME_SIZE));
+    tx_params.num_send_frames = device_addr.cast<size_t>("num_send_frames", SIM_DATA_NUM_FRAMES);
+
+    _radios.resize(SIM_NUM_RADIOS);
+    for (size_t i = 0; i < _radios.size(); i++)
+    {
+        _radios[i].rx = sim_rx_link::make(_clock, rx_params, faults, paced);
+        faults.seed += 2;
+        _radios[i].tx = sim_tx_link::make(_clock, tx_params, faults, paced);
+        faults.seed += 2;
+    }
+
+    ////////////////////////////////////////////////////////////////////
+    // Initialize the properties tree
+    ////////////////////////////////////////////////////////////////////
+    _tree->create<std::string>("/name").set("Simulated Device");
+    _tree->create<std::string>(mb_path / "name").set("SIM");
+    _tree->create<mboard_eeprom_t>(mb_path / "eeprom").set(mboard_eeprom_t());
+
+    ////////////////////////////////////////////////////////////////////
+    // create codec objects
+    ////////////////////////////////////////////////////////////////////
+    _tree->create<std::string>(mb_path / "rx_codecs" / "A" / "name").set("SIM RX dual ADC");
+    _tree->create<int>(mb_path / "rx_codecs" / "A" / "gains"); //empty cuz gains are in frontend
+    _tree->create<std::string>(mb_path / "tx_codecs" / "A" / "name").set("SIM TX dual DAC");
+    _tree->create<int>(mb_path / "tx_codecs" / "A" / "gains"); //empty cuz gains are in frontend
+
+    ////////////////////////////////////////////////////////////////////
+    // create clock and time objects
+    ////////////////////////////////////////////////////////////////////
+    _tree->create<double>(mb_path / "tick_rate")
+        .coerce(boost::bind(&sim_impl::set_tick_rate, this, _1))
+        .publish(boost::bind(&sim_impl::get_tick_rate, this))
+        .subscribe(boost::bind(&sim_impl::update_tick_rate, this, _1))
+        .set(device_addr.cast<double>("master_clock_rate", SIM_DEFAULT_TICK_RATE));
+    _tree->create<time_spec_t>(mb_path / "time" / "now")
+        .publish(boost::bind(&sim_clock::get_time_now, _clock))
+        .subscribe(boost::bind(&sim_clock::set_time_now, _clock, _1));
+    _tree->create<time_spec_t>(mb_path / "time" / "pps")
+        .publish(boost::bind(&sim_clock::get_time_last_pps, _clock))
+        .subscribe(boost::bind(&sim_clock::set_time_next_pps, _clock, _1));
+    _tree->create<time_spec_t>(mb_path / "time" / "cmd"); //commands take effect at once
+
+    static const std::vector<std::string> sources(1, "internal");
+    _tree->create<std::string>(mb_path / "time_source" / "value")
+        .subscribe(boost::bind(&sim_check_source, "time", _1));
+    _tree->create<std::vector<std::string> >(mb_path / "time_source" / "options").set(sources);
+    _tree->create<std::string>(mb_path / "clock_source" / "value")
+        .subscribe(boost::bind(&sim_check_source, "clock", _1));
+    _tree->create<std::vector<std::string> >(mb_path / "clock_source" / "options").set(sources);
+    _tree->create<sensor_value_t>(mb_path / "sensors" / "ref_locked")
+        .set(sensor_value_t("Ref", true, "locked", "unlocked"));
+
+    ////////////////////////////////////////////////////////////////////
+    // create frontend mapping
+    ////////////////////////////////////////////////////////////////////
+    std::vector<size_t> default_map(SIM_NUM_RADIOS, 0);
+    for (size_t i = 0; i < default_map.size(); i++) default_map[i] = i;
+    _tree->create<std::vector<size_t> >(mb_path / "rx_chan_dsp_mapping").set(default_map);
+    _tree->create<std::vector<size_t> >(mb_path / "tx_chan_dsp_mapping").set(default_map);
+    _tree->create<subdev_spec_t>(mb_path / "rx_subdev_spec")
+        .subscribe(boost::bind(&sim_impl::update_subdev_spec, this, "rx", _1));
+    _tree->create<subdev_spec_t>(mb_path / "tx_subdev_spec")
+        .subscribe(boost::bind(&sim_impl::update_subdev_spec, this, "tx", _1));
+
+    ////////////////////////////////////////////////////////////////////
+    // dboard eeproms but not really
+    ////////////////////////////////////////////////////////////////////
+    dboard_eeprom_t db_eeprom;
+    _tree->create<dboard_eeprom_t>(mb_path / "dboards" / "A" / "rx_eeprom").set(db_eeprom);
+    _tree->create<dboard_eeprom_t>(mb_path / "dboards" / "A" / "tx_eeprom").set(db_eeprom);
+    _tree->create<dboard_eeprom_t>(mb_path / "dboards" / "A" / "gdb_eeprom").set(db_eeprom);
+
+    ////////////////////////////////////////////////////////////////////
+    // create the dsps and frontends of each radio
+    ////////////////////////////////////////////////////////////////////
+    for (size_t dspno = 0; dspno < _radios.size(); dspno++)
+    {
+        radio_t &radio = _radios[dspno];
+        const std::string dsp_name = boost::lexical_cast<std::string>(dspno);
+
+        const fs_path rx_dsp_path = mb_path / "rx_dsps" / dsp_name;
+        _tree->create<meta_range_t>(rx_dsp_path / "rate" / "range")
+            .publish(boost::bind(&sim_get_host_rates, boost::bind(&sim_impl::get_tick_rate, this)));
+        _tree->create<double>(rx_dsp_path / "rate" / "value")
+            .coerce(boost::bind(&sim_impl::coerce_samp_rate, this, _1))
+            .subscribe(boost::bind(&sim_impl::update_rx_samp_rate, this, dspno, _1))
+            .set(1e6);
+        _tree->create<double>(rx_dsp_path / "freq" / "value")
+            .coerce(boost::bind(&sim_clip_dsp_freq, boost::bind(&sim_impl::get_tick_rate, this), _1))
+            .set(0.0);
+        _tree->create<meta_range_t>(rx_dsp_path / "freq" / "range")
+            .publish(boost::bind(&sim_get_dsp_freq_range, boost::bind(&sim_impl::get_tick_rate, this)));
+        _tree->create<stream_cmd_t>(rx_dsp_path / "stream_cmd")
+            .subscribe(boost::bind(&sim_rx_link::issue_stream_command, radio.rx, _1));
+        _tree->create<size_t>(mb_path / "time" / "cmd_queue" / dsp_name / "depth")
+            .publish(boost::bind(&sim_rx_link::get_num_queued_cmds, radio.rx));
+        _tree->create<size_t>(mb_path / "time" / "cmd_queue" / dsp_name / "capacity")
+            .set(SIM_CMD_QUEUE_DEPTH);
+
+        const fs_path tx_dsp_path = mb_path / "tx_dsps" / dsp_name;
+        _tree->create<meta_range_t>(tx_dsp_path / "rate" / "range")
+            .publish(boost::bind(&sim_get_host_rates, boost::bind(&sim_impl::get_tick_rate, this)));
+        _tree->create<double>(tx_dsp_path / "rate" / "value")
+            .coerce(boost::bind(&sim_impl::coerce_samp_rate, this, _1))
+            .subscribe(boost::bind(&sim_impl::update_tx_samp_rate, this, dspno, _1))
+            .set(1e6);
+        _tree->create<double>(tx_dsp_path / "freq" / "value")
+            .coerce(boost::bind(&sim_clip_dsp_freq, boost::bind(&sim_impl::get_tick_rate, this), _1))
+            .set(0.0);
+        _tree->create<meta_range_t>(tx_dsp_path / "freq" / "range")
+            .publish(boost::bind(&sim_get_dsp_freq_range, boost::bind(&sim_impl::get_tick_rate, this)));
+
+        for (size_t direction = 0; direction < 2; direction++)
+        {
+            const std::string x = direction? "rx" : "tx";
+            const fs_path rf_fe_path = mb_path / "dboards" / "A" / (x+"_frontends") / (dspno? "B" : "A");
+
+            _tree->create<std::string>(rf_fe_path / "name").set(str(boost::format("SIM-%s%u") % (direction? "RX" : "TX") % dspno));
+            _tree->create<int>(rf_fe_path / "sensors"); //empty
+            _tree->create<meta_range_t>(rf_fe_path / "gains" / "PGA" / "range")
+                .set(meta_range_t(0.0, 31.5, 0.5));
+            _tree->create<double>(rf_fe_path / "gains" / "PGA" / "value")
+                .coerce(boost::bind(&meta_range_t::clip, meta_range_t(0.0, 31.5, 0.5), _1, true))
+                .set(0.0);
+            _tree->create<std::string>(rf_fe_path / "connection").set("IQ");
+            _tree->create<bool>(rf_fe_path / "enabled").set(true);
+            _tree->create<bool>(rf_fe_path / "use_lo_offset").set(false);
+            _tree->create<double>(rf_fe_path / "bandwidth" / "value")
+                .coerce(boost::bind(&meta_range_t::clip, meta_range_t(200e3, 56e6), _1, false))
+                .set(56e6);
+            _tree->create<meta_range_t>(rf_fe_path / "bandwidth" / "range")
+                .set(meta_range_t(200e3, 56e6));
+            _tree->create<double>(rf_fe_path / "freq" / "value")
+                .coerce(boost::bind(&meta_range_t::clip, meta_range_t(0.0, 6e9), _1, false))
+                .set(0.0);
+            _tree->create<meta_range_t>(rf_fe_path / "freq" / "range")
+                .set(meta_range_t(0.0, 6e9));
+            const std::vector<std::string> ants(1, direction? "RX2" : "TX/RX");
+            _tree->create<std::vector<std::string> >(rf_fe_path / "antenna" / "options").set(ants);
+            _tree->create<std::string>(rf_fe_path / "antenna" / "value").set(ants.front());
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////
+    // do some post-init tasks
+    ////////////////////////////////////////////////////////////////////
+    //subdev spec contains full width of selections
+    subdev_spec_t rx_spec, tx_spec;
+    BOOST_FOREACH(const std::string &fe, _tree->list(mb_path / "dboards" / "A" / "rx_frontends"))
+    {
+        rx_spec.push_back(subdev_spec_pair_t("A", fe));
+    }
+    BOOST_FOREACH(const std::string &fe, _tree->list(mb_path / "dboards" / "A" / "tx_frontends"))
+    {
+        tx_spec.push_back(subdev_spec_pair_t("A", fe));
+    }
+    _tree->access<subdev_spec_t>(mb_path / "rx_subdev_spec").set(rx_spec);
+    _tree->access<subdev_spec_t>(mb_path / "tx_subdev_spec").set(tx_spec);
+
+    _tree->access<std::string>(mb_path / "clock_source" / "value").set("internal");
+    _tree->access<std::string>(mb_path / "time_source" / "value").set("internal");
+    _tree->access<time_spec_t>(mb_path / "time" / "now").set(time_spec_t(0.0));
+}
+
+sim_impl::~sim_impl(void)
+{
+    /* NOP */
+}
+
+/***********************************************************************
+ * Clock and rates
+ **********************************************************************/
+double sim_impl::set_tick_rate(const double rate)
+{
+    if (rate <= 0.0) throw uhd::value_error("sim: the tick rate must be positive");
+    _clock->set_tick_rate(rate);
+    return rate;
+}
+
+double sim_impl::get_tick_rate(void)
+{
+    return _clock->get_tick_rate();
+}
+
+double sim_impl::coerce_samp_rate(const double rate)
+{
+    const double tick_rate = this->get_tick_rate();
+    const double decim = std::max<double>(1, std::min<double>(SIM_MAX_DECIM,
+        boost::math::iround(tick_rate/sim_get_host_rates(tick_rate).clip(rate, true))));
+    return tick_rate/decim;
+}
+
+/***********************************************************************
+ * Setup dboard muxing for IQ
+ **********************************************************************/
+void sim_impl::update_subdev_spec(const std::string &tx_rx, const subdev_spec_t &spec)
+{
+    validate_subdev_spec(_tree, spec, tx_rx);
+
+    //the frontend name selects the radio
+    std::vector<size_t> chan_to_dsp_map(spec.size(), 0);
+    for (size_t i = 0; i < spec.size(); i++)
+    {
+        chan_to_dsp_map[i] = (spec[i].sd_name == "A")? 0 : 1;
+    }
+    _tree->access<std::vector<size_t> >(fs_path("/mboards/0") / (tx_rx + "_chan_dsp_mapping")).set(chan_to_dsp_map);
+}
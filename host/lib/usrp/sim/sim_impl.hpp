@@ -0,0 +1,100 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_SIM_IMPL_HPP
+#define INCLUDED_SIM_IMPL_HPP
+
+#include "sim_zero_copy.hpp"
+#include <uhd/device.hpp>
+#include <uhd/property_tree.hpp>
+#include <uhd/types/device_addr.hpp>
+#include <uhd/types/metadata.hpp>
+#include <uhd/usrp/subdev_spec.hpp>
+#include <uhd/transport/bounded_buffer.hpp>
+#include <uhd/transport/vrt_if_packet.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/weak_ptr.hpp>
+#include <vector>
+
+static const double SIM_DEFAULT_TICK_RATE           = 200e6;        //Hz
+static const size_t SIM_MAX_DECIM                   = 1024;
+static const size_t SIM_NUM_RADIOS                  = 2;
+static const size_t SIM_CMD_QUEUE_DEPTH             = 16;           //stream commands per radio
+
+static const size_t SIM_DATA_FRAME_SIZE             = 8000;         //bytes
+static const size_t SIM_DATA_NUM_FRAMES             = 32;
+static const size_t SIM_MSG_FRAME_SIZE              = 256;          //bytes
+static const size_t SIM_MSG_NUM_FRAMES              = 32;
+
+static const size_t SIM_TX_HW_BUFF_SIZE             = 0x90000;      //576KiB
+static const size_t SIM_TX_FC_RESPONSE_FREQ         = 8;            //per flow-control window
+static const size_t SIM_RX_FC_REQUEST_FREQ          = 4;            //per flow-control window
+
+static const size_t SIM_MAX_HDR_LEN                 =           // bytes
+      sizeof(boost::uint32_t)                              // Header
+    + sizeof(uhd::transport::vrt::if_packet_info_t().sid)  // SID
+    + sizeof(uhd::transport::vrt::if_packet_info_t().tsf); // Timestamp
+
+#define SIM_RX_DATA_SID(radio) (boost::uint32_t(0x000000A0 + 0x10*(radio)))
+#define SIM_TX_DATA_SID(radio) (boost::uint32_t(0x00000050 + 0x10*(radio)))
+#define SIM_TX_MSG_SID(radio) ((SIM_TX_DATA_SID(radio) << 16) | (SIM_TX_DATA_SID(radio) >> 16))
+
+/*!
+ * A simulated device for streaming without hardware (type=sim).
+ *
+ * Each radio is a pair of in-process links that behave like the
+ * streaming engines of an X300 or B200 FPGA. The streamers, flow
+ * control and async message handling are the same as on hardware.
+ */
+class sim_impl : public uhd::device
+{
+public:
+    sim_impl(const uhd::device_addr_t &);
+    ~sim_impl(void);
+
+    //the io interface
+    uhd::rx_streamer::sptr get_rx_stream(const uhd::stream_args_t &args);
+    uhd::tx_streamer::sptr get_tx_stream(const uhd::stream_args_t &args);
+    bool recv_async_msg(uhd::async_metadata_t &, double);
+
+    typedef uhd::transport::bounded_buffer<uhd::async_metadata_t> async_md_type;
+
+private:
+    struct radio_t
+    {
+        sim_rx_link::sptr rx;
+        sim_tx_link::sptr tx;
+        boost::weak_ptr<uhd::rx_streamer> rx_streamer;
+        boost::weak_ptr<uhd::tx_streamer> tx_streamer;
+    };
+    std::vector<radio_t> _radios;
+    sim_clock::sptr _clock;
+    std::string _io_cpus, _convert_cpus;
+    boost::mutex _transport_setup_mutex;
+    boost::shared_ptr<async_md_type> _async_md;
+
+    double set_tick_rate(const double rate);
+    double get_tick_rate(void);
+    void update_tick_rate(const double rate);
+    double coerce_samp_rate(const double rate);
+    void update_rx_samp_rate(const size_t dspno, const double rate);
+    void update_tx_samp_rate(const size_t dspno, const double rate);
+    void update_subdev_spec(const std::string &tx_rx, const uhd::usrp::subdev_spec_t &spec);
+    void handle_overflow(radio_t &radio, boost::weak_ptr<uhd::rx_streamer> streamer);
+};
+
+#endif /* INCLUDED_SIM_IMPL_HPP */
@@ -0,0 +1,504 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "sim_impl.hpp"
+#include "../../transport/super_recv_packet_handler.hpp"
+#include "../../transport/super_send_packet_handler.hpp"
+#include "../../transport/async_reactor.hpp"
+#include "async_packet_handler.hpp"
+#include <uhd/utils/log.hpp>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/make_shared.hpp>
+
+using namespace uhd;
+using namespace uhd::usrp;
+using namespace uhd::transport;
+
+/***********************************************************************
+ * update streamer rates
+ **********************************************************************/
+void sim_impl::update_tick_rate(const double rate)
+{
+    BOOST_FOREACH(radio_t &radio, _radios)
+    {
+        radio.rx->set_tick_rate(rate);
+        radio.tx->set_tick_rate(rate);
+        boost::shared_ptr<sph::recv_packet_streamer> rx_streamer =
+            boost::dynamic_pointer_cast<sph::recv_packet_streamer>(radio.rx_streamer.lock());
+        if (rx_streamer) rx_streamer->set_tick_rate(rate);
+        boost::shared_ptr<sph::send_packet_streamer> tx_streamer =
+            boost::dynamic_pointer_cast<sph::send_packet_streamer>(radio.tx_streamer.lock());
+        if (tx_streamer) tx_streamer->set_tick_rate(rate);
+    }
+}
+
+void sim_impl::update_rx_samp_rate(const size_t dspno, const double rate)
+{
+    _radios[dspno].rx->set_samp_rate(rate);
+    boost::shared_ptr<sph::recv_packet_streamer> my_streamer =
+        boost::dynamic_pointer_cast<sph::recv_packet_streamer>(_radios[dspno].rx_streamer.lock());
+    if (my_streamer) my_streamer->set_samp_rate(rate);
+}
+
+void sim_impl::update_tx_samp_rate(const size_t dspno, const double rate)
+{
+    _radios[dspno].tx->set_samp_rate(rate);
+    boost::shared_ptr<sph::send_packet_streamer> my_streamer =
+        boost::dynamic_pointer_cast<sph::send_packet_streamer>(_radios[dspno].tx_streamer.lock());
+    if (my_streamer) my_streamer->set_samp_rate(rate);
+}
+
+/***********************************************************************
+ * VITA stuff
+ **********************************************************************/
+static void sim_if_hdr_unpack_le(
+    const boost::uint32_t *packet_buff,
+    vrt::if_packet_info_t &if_packet_info
+){
+    if_packet_info.link_type = vrt::if_packet_info_t::LINK_TYPE_CHDR;
+    return vrt::if_hdr_unpack_le(packet_buff, if_packet_info);
+}
+
+static void sim_if_hdr_pack_le(
+    boost::uint32_t *packet_buff,
+    vrt::if_packet_info_t &if_packet_info
+){
+    if_packet_info.link_type = vrt::if_packet_info_t::LINK_TYPE_CHDR;
+    return vrt::if_hdr_pack_le(packet_buff, if_packet_info);
+}
+
+/***********************************************************************
+ * RX flow control handler
+ **********************************************************************/
+static void handle_rx_flowctrl(const boost::uint32_t sid, const zero_copy_if::sptr &xport, const boost::shared_ptr<boost::uint32_t> &seq32_state, const size_t last_seq)
+{
+    managed_send_buffer::sptr buff = xport->get_send_buff(0.0);
+    if (not buff)
+    {
+        throw uhd::runtime_error("handle_rx_flowctrl timed out getting a send buffer");
+    }
+    boost::uint32_t *pkt = buff->cast<boost::uint32_t *>();
+
+    //recover seq32
+    boost::uint32_t &seq32 = *seq32_state;
+    const size_t seq12 = seq32 & 0xfff;
+    if (last_seq < seq12) seq32 += (1 << 12);
+    seq32 &= ~0xfff;
+    seq32 |= last_seq;
+
+    //load packet info
+    vrt::if_packet_info_t packet_info;
+    packet_info.packet_type = vrt::if_packet_info_t::PACKET_TYPE_CONTEXT;
+    packet_info.num_payload_words32 = 2;
+    packet_info.num_payload_bytes = packet_info.num_payload_words32*sizeof(boost::uint32_t);
+    packet_info.packet_count = seq32;
+    packet_info.sob = false;
+    packet_info.eob = false;
+    packet_info.sid = sid;
+    packet_info.has_sid = true;
+    packet_info.has_cid = false;
+    packet_info.has_tsi = false;
+    packet_info.has_tsf = false;
+    packet_info.has_tlr = false;
+
+    //load header
+    sim_if_hdr_pack_le(pkt, packet_info);
+
+    //load payload
+    pkt[packet_info.num_header_words32+0] = uhd::htowx<boost::uint32_t>(0);
+    pkt[packet_info.num_header_words32+1] = uhd::htowx<boost::uint32_t>(seq32);
+
+    //send the buffer over the interface
+    buff->commit(sizeof(boost::uint32_t)*(packet_info.num_packet_words32));
+}
+
+/***********************************************************************
+ * TX flow control handler
+ **********************************************************************/
+struct sim_tx_fc_guts_t
+{
+    sim_tx_fc_guts_t(void):
+        stream_channel(0),
+        device_channel(0),
+        last_seq_out(0){}
+    size_t stream_channel;
+    size_t device_channel;
+    size_t last_seq_out;
+    //credit: the last sequence number consumed by the radio
+    atomic_uint32_t last_seq_ack;
+    //one reader of the async transport at a time, claimed with a cas:
+    //the sender takes it when it runs out of credit
+    atomic_uint32_t xport_claimed;
+    atomic_uint32_t sender_waiting;
+    boost::shared_ptr<sim_impl::async_md_type> async_queue;
+    boost::shared_ptr<sim_impl::async_md_type> old_async_queue;
+    sph::stream_stats_counters::sptr stats;
+};
+
+#define SIM_ASYNC_EVENT_CODE_FLOW_CTRL 0
+
+//how long the async handler holds the transport while no message arrives
+static const double SIM_TX_ASYNC_POLL_TIMEOUT = 0.01; //seconds
+
+static void handle_tx_async_msg(const boost::shared_ptr<sim_tx_fc_guts_t> &guts, const managed_recv_buffer::sptr &buff, const sim_clock::sptr &clock)
+{
+    //extract packet info
+    vrt::if_packet_info_t if_packet_info;
+    if_packet_info.num_packet_words32 = buff->size()/sizeof(boost::uint32_t);
+    const boost::uint32_t *packet_buff = buff->cast<const boost::uint32_t *>();
+
+    //unpacking can fail
+    try
+    {
+        sim_if_hdr_unpack_le(packet_buff, if_packet_info);
+    }
+    catch(const std::exception &ex)
+    {
+        UHD_MSG(error) << "Error parsing async message packet: " << ex.what() << std::endl;
+        return;
+    }
+
+    //fill in the async metadata
+    async_metadata_t metadata;
+    load_metadata_from_buff(
+        uhd::wtohx<boost::uint32_t>, metadata, if_packet_info, packet_buff,
+        clock->get_tick_rate(), guts->stream_channel);
+
+    //The FC response and the burst ack are two indicators that the radio
+    //consumed packets. Use them to update the FC credit
+    if (metadata.event_code == SIM_ASYNC_EVENT_CODE_FLOW_CTRL or
+        metadata.event_code == async_metadata_t::EVENT_CODE_BURST_ACK
+    ) {
+        guts->last_seq_ack.write(metadata.user_payload[0]);
+        guts->stats->tx_acks.acked(metadata.user_payload[0]);
+    }
+
+    //FC responses don't propagate up to the user so filter them here
+    if (metadata.event_code != SIM_ASYNC_EVENT_CODE_FLOW_CTRL) {
+        guts->async_queue->push_with_pop_on_full(metadata);
+        metadata.channel = guts->device_channel;
+        guts->old_async_queue->push_with_pop_on_full(metadata);
+        standard_async_msg_prints(metadata);
+        guts->stats->count_async_msg(metadata);
+    }
+}
+
+static bool handle_tx_async_msgs(const boost::shared_ptr<sim_tx_fc_guts_t> &guts, const zero_copy_if::sptr &xport, const sim_clock::sptr &clock, const double timeout)
+{
+    //the sender is out of credit and reads the transport itself
+    if (guts->sender_waiting.read() != 0 or guts->xport_claimed.cas(1, 0) != 0)
+    {
+        return false;
+    }
+
+    managed_recv_buffer::sptr buff = xport->get_recv_buff(std::min(timeout, SIM_TX_ASYNC_POLL_TIMEOUT));
+    if (buff) handle_tx_async_msg(guts, buff, clock);
+    buff.reset();
+    guts->xport_claimed.write(0);
+    return true;
+}
+
+static UHD_INLINE bool sim_tx_has_credit(boost::shared_ptr<sim_tx_fc_guts_t> guts, size_t fc_pkt_window)
+{
+    const size_t delta = (guts->last_seq_out & 0xfff) - (guts->last_seq_ack.read() & 0xfff);
+    return (delta & 0xfff) <= fc_pkt_window;
+}
+
+static managed_send_buffer::sptr get_tx_buff_with_flowctrl(
+    const async_reactor::registration::sptr &/*holds ref*/,
+    const boost::shared_ptr<sim_tx_fc_guts_t> &guts,
+    const zero_copy_if::sptr &xport,
+    const sim_clock::sptr &clock,
+    size_t fc_pkt_window,
+    const double timeout
+){
+    //out of credit: handle the flow control responses in this thread
+    if (not sim_tx_has_credit(guts, fc_pkt_window))
+    {
+        guts->stats->fc_stalls.inc();
+        guts->sender_waiting.write(1);
+        const time_spec_t exit_time = time_spec_t::get_system_time() + time_spec_t(timeout);
+        while (not sim_tx_has_credit(guts, fc_pkt_window))
+        {
+            const double remaining = (exit_time - time_spec_t::get_system_time()).get_real_secs();
+            if (remaining < 0.0)
+            {
+                guts->sender_waiting.write(0);
+                return managed_send_buffer::sptr(); //timeout waiting for flow control
+            }
+
+            //the async handler may hold the transport for one poll, spin on the credit
+            if (guts->xport_claimed.cas(1, 0) != 0)
+            {
+                boost::this_thread::yield();
+                continue;
+            }
+            managed_recv_buffer::sptr buff = xport->get_recv_buff(remaining);
+            if (buff) handle_tx_async_msg(guts, buff, clock);
+            buff.reset();
+            guts->xport_claimed.write(0);
+        }
+        guts->sender_waiting.write(0);
+    }
+
+    managed_send_buffer::sptr buff = xport->get_send_buff(timeout);
+    if (buff) {
+        guts->last_seq_out++; //update seq, this will actually be a send
+    }
+    return buff;
+}
+
+/***********************************************************************
+ * Async Data
+ **********************************************************************/
+bool sim_impl::recv_async_msg(
+    async_metadata_t &async_metadata, double timeout
+){
+    return _async_md->pop_with_timed_wait(async_metadata, timeout);
+}
+
+/***********************************************************************
+ * Receive streamer
+ **********************************************************************/
+rx_streamer::sptr sim_impl::get_rx_stream(const uhd::stream_args_t &args_)
+{
+    boost::mutex::scoped_lock lock(_transport_setup_mutex);
+    stream_args_t args = args_;
+
+    //setup defaults for unspecified values
+    if (not args.otw_format.empty() and args.otw_format != "sc16")
+    {
+        throw uhd::value_error("sim_impl::get_rx_stream only supports otw_format sc16");
+    }
+    args.otw_format = "sc16";
+    args.channels = args.channels.empty()? std::vector<size_t>(1, 0) : args.channels;
+
+    boost::shared_ptr<sph::recv_packet_streamer> my_streamer;
+    for (size_t stream_i = 0; stream_i < args.channels.size(); stream_i++)
+    {
+        const size_t chan = args.channels[stream_i];
+        const std::vector<size_t> dsp_map = _tree->access<std::vector<size_t> >("/mboards/0/rx_chan_dsp_mapping").get();
+        UHD_ASSERT_THROW(chan < dsp_map.size());
+        const size_t radio_index = dsp_map[chan];
+        radio_t &radio = _radios.at(radio_index);
+        const boost::uint32_t data_sid = SIM_RX_DATA_SID(radio_index);
+
+        const size_t bpp = radio.rx->get_recv_frame_size() - SIM_MAX_HDR_LEN; // bytes per packet
+        const size_t bpi = convert::get_bytes_per_item(args.otw_format); // bytes per item
+        const size_t spp = unsigned(args.args.cast<double>("spp", bpp/bpi)); // samples per packet
+
+        //make the new streamer given the samples per packet
+        if (not my_streamer) my_streamer = boost::make_shared<sph::recv_packet_streamer>(spp);
+        my_streamer->set_convert_cpus(_convert_cpus);
+        my_streamer->resize(args.channels.size());
+
+        //init some streamer stuff
+        my_streamer->set_vrt_unpacker(&sim_if_hdr_unpack_le);
+
+        //set the converter
+        uhd::convert::id_type id;
+        id.input_format = args.otw_format + "_item32_le";
+        id.num_inputs = 1;
+        id.output_format = args.cpu_format;
+        id.num_outputs = 1;
+        my_streamer->set_converter(id);
+
+        radio.rx->clear();
+        radio.rx->set_nsamps_per_packet(spp);
+        radio.rx->set_sid(data_sid);
+
+        //flow control setup: the window is the frames of the link
+        const size_t fc_window = radio.rx->get_num_recv_frames();
+        const size_t fc_handle_window = std::max<size_t>(1, fc_window / SIM_RX_FC_REQUEST_FREQ);
+        UHD_LOG << "RX Flow Control Window = " << fc_window << ", RX Flow Control Handler Window = " << fc_handle_window << std::endl;
+        radio.rx->configure_flow_control(fc_window);
+
+        boost::shared_ptr<boost::uint32_t> seq32(new boost::uint32_t(0));
+        //Give the streamer a functor to get the recv_buffer
+        //bind requires a zero_copy_if::sptr to add a streamer->xport lifetime dependency
+        my_streamer->set_xport_chan_get_buff(
+            stream_i,
+            boost::bind(&zero_copy_if::get_recv_buff, radio.rx, _1),
+            true /*flush*/
+        );
+        //Give the streamer a functor to handle overflows
+        //bind requires a weak_ptr to break the a streamer->streamer circular dependency
+        //Using "this" is OK because we know that sim_impl will outlive the streamer
+        my_streamer->set_overflow_handler(
+            stream_i,
+            boost::bind(&sim_impl::handle_overflow, this, boost::ref(radio), boost::weak_ptr<uhd::rx_streamer>(my_streamer))
+        );
+        //Give the streamer a functor to send flow control messages
+        //handle_rx_flowctrl is static and has no lifetime issues
+        my_streamer->set_xport_handle_flowctrl(
+            stream_i, boost::bind(&handle_rx_flowctrl, data_sid, radio.rx, seq32, _1),
+            fc_handle_window,
+            true/*init*/
+        );
+        //Give the streamer a tuner to adapt the window while streaming
+        //the link has no room beyond its frames, so the window can only shrink and regrow,
+        //the applier thread writes it like the X300 does
+        if (args.args.cast<int>("fc_adapt", 1) != 0) my_streamer->set_xport_fc_tuner(
+            stream_i, boost::make_shared<sph::rx_fc_tuner>(
+                fc_window, fc_window, SIM_RX_FC_REQUEST_FREQ,
+                boost::bind(&sph::rx_fc_window_applier::set_window, boost::make_shared<sph::rx_fc_window_applier>(
+                    boost::bind(&sim_rx_link::configure_flow_control, radio.rx, _1)
+                ), _1)
+            )
+        );
+        //Give the streamer a functor issue stream cmd
+        //bind requires a sim_rx_link::sptr to add a streamer->link lifetime dependency
+        my_streamer->set_issue_stream_cmd(
+            stream_i, boost::bind(&sim_rx_link::issue_stream_command, radio.rx, _1)
+        );
+
+        //Store a weak pointer to prevent a streamer->sim_impl->streamer circular dependency
+        radio.rx_streamer = boost::weak_ptr<uhd::rx_streamer>(my_streamer);
+
+        //sets all tick and samp rates on this streamer
+        _tree->access<double>("/mboards/0/tick_rate").update();
+        _tree->access<double>("/mboards/0/rx_dsps/" + boost::lexical_cast<std::string>(radio_index) + "/rate/value").update();
+    }
+
+    return my_streamer;
+}
+
+void sim_impl::handle_overflow(radio_t &radio, boost::weak_ptr<uhd::rx_streamer> streamer)
+{
+    boost::shared_ptr<sph::recv_packet_streamer> my_streamer =
+            boost::dynamic_pointer_cast<sph::recv_packet_streamer>(streamer.lock());
+    if (not my_streamer) return; //If the rx_streamer has expired then overflow handling makes no sense.
+
+    if (my_streamer->get_num_channels() == 1)
+    {
+        radio.rx->handle_overflow();
+        return;
+    }
+
+    /////////////////////////////////////////////////////////////
+    // MIMO overflow recovery time
+    /////////////////////////////////////////////////////////////
+    //find out if we were in continuous mode before stopping
+    const bool in_continuous_streaming_mode = radio.rx->in_continuous_streaming_mode();
+    //stop streaming
+    my_streamer->issue_stream_cmd(stream_cmd_t::STREAM_MODE_STOP_CONTINUOUS);
+    //flush transports
+    my_streamer->flush_all(0.001);
+    //restart streaming
+    if (in_continuous_streaming_mode)
+    {
+        stream_cmd_t stream_cmd(stream_cmd_t::STREAM_MODE_START_CONTINUOUS);
+        stream_cmd.stream_now = false;
+        stream_cmd.time_spec = _clock->get_time_now() + time_spec_t(0.01);
+        my_streamer->issue_stream_cmd(stream_cmd);
+    }
+}
+
+/***********************************************************************
+ * Transmit streamer
+ **********************************************************************/
+tx_streamer::sptr sim_impl::get_tx_stream(const uhd::stream_args_t &args_)
+{
+    boost::mutex::scoped_lock lock(_transport_setup_mutex);
+    stream_args_t args = args_;
+
+    //setup defaults for unspecified values
+    if (not args.otw_format.empty() and args.otw_format != "sc16")
+    {
+        throw uhd::value_error("sim_impl::get_tx_stream only supports otw_format sc16");
+    }
+    args.otw_format = "sc16";
+    args.channels = args.channels.empty()? std::vector<size_t>(1, 0) : args.channels;
+
+    //shared async queue for all channels in streamer
+    boost::shared_ptr<async_md_type> async_md(new async_md_type(1000/*messages deep*/));
+
+    boost::shared_ptr<sph::send_packet_streamer> my_streamer;
+    for (size_t stream_i = 0; stream_i < args.channels.size(); stream_i++)
+    {
+        const size_t chan = args.channels[stream_i];
+        const std::vector<size_t> dsp_map = _tree->access<std::vector<size_t> >("/mboards/0/tx_chan_dsp_mapping").get();
+        UHD_ASSERT_THROW(chan < dsp_map.size());
+        const size_t radio_index = dsp_map[chan];
+        radio_t &radio = _radios.at(radio_index);
+        const boost::uint32_t data_sid = SIM_TX_DATA_SID(radio_index);
+
+        const size_t bpp = radio.tx->get_send_frame_size() - SIM_MAX_HDR_LEN;
+        const size_t bpi = convert::get_bytes_per_item(args.otw_format);
+        const size_t spp = unsigned(args.args.cast<double>("spp", bpp/bpi));
+
+        //make the new streamer given the samples per packet
+        if (not my_streamer) my_streamer = boost::make_shared<sph::send_packet_streamer>(spp);
+        my_streamer->set_convert_cpus(_convert_cpus);
+        my_streamer->resize(args.channels.size());
+
+        my_streamer->set_vrt_packer(&sim_if_hdr_pack_le);
+
+        //set the converter
+        uhd::convert::id_type id;
+        id.input_format = args.cpu_format;
+        id.num_inputs = 1;
+        id.output_format = args.otw_format + "_item32_le";
+        id.num_outputs = 1;
+        my_streamer->set_converter(id);
+
+        radio.tx->clear();
+        radio.tx->set_sid(SIM_TX_MSG_SID(radio_index));
+
+        //flow control setup
+        const size_t fc_window = std::max<size_t>(1, SIM_TX_HW_BUFF_SIZE/radio.tx->get_send_frame_size()); //In packets
+        const size_t fc_handle_window = std::max<size_t>(1, fc_window/SIM_TX_FC_RESPONSE_FREQ);
+        UHD_LOG << "TX Flow Control Window = " << fc_window << ", TX Flow Control Handler Window = " << fc_handle_window << std::endl;
+        radio.tx->configure_flow_control(fc_handle_window);
+
+        boost::shared_ptr<sim_tx_fc_guts_t> guts(new sim_tx_fc_guts_t());
+        guts->stream_channel = stream_i;
+        guts->device_channel = chan;
+        guts->async_queue = async_md;
+        guts->old_async_queue = _async_md;
+        guts->stats = my_streamer->get_xport_chan_stats(stream_i);
+        guts->stats->tx_acks.set_window(fc_window);
+        async_reactor::registration::sptr async_reg = async_reactor::get(_io_cpus)->add(
+            radio.tx, boost::bind(&handle_tx_async_msgs, guts, radio.tx, _clock, _1)
+        );
+
+        //Give the streamer a functor to get the send buffer
+        //get_tx_buff_with_flowctrl is static so bind has no lifetime issues
+        //radio.tx (sptr) is required to add streamer->data-transport lifetime dependency
+        //async_reg (sptr) is required to add a streamer->async-handler lifetime dependency
+        my_streamer->set_xport_chan_get_buff(
+            stream_i,
+            boost::bind(&get_tx_buff_with_flowctrl, async_reg, guts, radio.tx, _clock, fc_window, _1)
+        );
+        //Give the streamer a functor handled received async messages
+        my_streamer->set_async_receiver(
+            boost::bind(&async_md_type::pop_with_timed_wait, async_md, _1, _2)
+        );
+        my_streamer->set_xport_chan_sid(stream_i, true, data_sid);
+        my_streamer->set_enable_trailer(false);
+
+        //Store a weak pointer to prevent a streamer->sim_impl->streamer circular dependency
+        radio.tx_streamer = boost::weak_ptr<uhd::tx_streamer>(my_streamer);
+
+        //sets all tick and samp rates on this streamer
+        _tree->access<double>("/mboards/0/tick_rate").update();
+        _tree->access<double>("/mboards/0/tx_dsps/" + boost::lexical_cast<std::string>(radio_index) + "/rate/value").update();
+    }
+
+    return my_streamer;
+}
@@ -0,0 +1,1065 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "sim_zero_copy.hpp"
+#include <uhd/transport/vrt_if_packet.hpp>
+#include <uhd/types/metadata.hpp>
+#include <uhd/utils/byteswap.hpp>
+#include <uhd/utils/log.hpp>
+#include <uhd/exception.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/foreach.hpp>
+#include <boost/circular_buffer.hpp>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <deque>
+#include <cmath>
+
+using namespace uhd;
+using namespace uhd::transport;
+
+//! header of an RX data or message packet: CHDR header, SID, 64-bit timestamp
+static const size_t SIM_HDR_LEN = 4*sizeof(boost::uint32_t);
+
+//! the RX device buffer holds this many packets while the host is behind
+static const size_t SIM_RX_HW_BUFF_PKTS = 64;
+
+//! event code of a TX flow control response
+static const boost::uint32_t SIM_ASYNC_EVENT_CODE_FLOW_CTRL = 0;
+
+/***********************************************************************
+ * Device clock
+ **********************************************************************/
+sim_clock::sim_clock(void):
+    _tick_rate(1.0), _epoch(boost::get_system_time())
+{
+    /* NOP */
+}
+
+void sim_clock::set_tick_rate(const double rate)
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    _tick_rate = rate;
+}
+
+double sim_clock::get_tick_rate(void)
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    return _tick_rate;
+}
+
+time_spec_t sim_clock::get_time_at(const boost::system_time &now)
+{
+    const boost::posix_time::time_duration elapsed = now - _epoch;
+    return _epoch_time + time_spec_t(
+        time_t(elapsed.total_seconds()),
+        double(elapsed.fractional_seconds())/elapsed.ticks_per_second()
+    );
+}
+
+time_spec_t sim_clock::get_time_now(void)
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    return this->get_time_at(boost::get_system_time());
+}
+
+time_spec_t sim_clock::get_time_last_pps(void)
+{
+    return time_spec_t(this->get_time_now().get_full_secs());
+}
+
+void sim_clock::set_time_now(const time_spec_t &time)
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    _epoch = boost::get_system_time();
+    _epoch_time = time;
+}
+
+void sim_clock::set_time_next_pps(const time_spec_t &time)
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    const boost::system_time now = boost::get_system_time();
+    const time_spec_t to_edge = time_spec_t(this->get_time_at(now).get_full_secs() + 1) - this->get_time_at(now);
+    _epoch = now + boost::posix_time::microseconds(long(to_edge.get_real_secs()*1e6));
+    _epoch_time = time;
+}
+
+boost::system_time sim_clock::to_system_time(const time_spec_t &time)
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    return _epoch + boost::posix_time::microseconds(long((time - _epoch_time).get_real_secs()*1e6));
+}
+
+/***********************************************************************
+ * Fault injection
+ **********************************************************************/
+sim_faults_t::sim_faults_t(const device_addr_t &args):
+    drop_rate(args.cast<double>("drop_rate", 0.0)),
+    reorder_rate(args.cast<double>("reorder_rate", 0.0)),
+    late_rate(args.cast<double>("late_rate", 0.0)),
+    late_time(args.cast<double>("late_time", 0.001)),
+    seed(args.cast<boost::uint32_t>("seed", 0))
+{
+    /* NOP */
+}
+
+//! A small deterministic random source, one per link
+class sim_fault_rng
+{
+public:
+    sim_fault_rng(const boost::uint32_t seed):
+        _state(seed*2654435761u + 0x9e3779b9u)
+    {
+        if (_state == 0) _state = 1;
+    }
+
+    //! true with the given probability
+    bool roll(const double rate)
+    {
+        if (rate <= 0.0) return false;
+        _state ^= _state << 13;
+        _state ^= _state >> 17;
+        _state ^= _state << 5;
+        return _state < rate*4294967296.0;
+    }
+
+private:
+    boost::uint32_t _state;
+};
+
+/***********************************************************************
+ * Frames and managed buffers
+ **********************************************************************/
+class sim_link_base
+{
+public:
+    virtual ~sim_link_base(void){}
+    virtual void release_recv_frame(const size_t index) = 0;
+    virtual void commit_send_frame(const size_t index, const size_t length) = 0;
+};
+
+class sim_mrb : public managed_recv_buffer
+{
+public:
+    sim_mrb(sim_link_base &link, const size_t index, void *mem):
+        _link(link), _index(index), _mem(mem){}
+
+    void release(void)
+    {
+        _link.release_recv_frame(_index);
+    }
+
+    sptr get_new(const size_t length)
+    {
+        return make(this, _mem, length);
+    }
+
+private:
+    sim_link_base &_link;
+    const size_t _index;
+    void *_mem;
+};
+
+class sim_msb : public managed_send_buffer
+{
+public:
+    sim_msb(sim_link_base &link, const size_t index, void *mem, const size_t frame_size):
+        _link(link), _index(index), _mem(mem), _frame_size(frame_size){}
+
+    void release(void)
+    {
+        _link.commit_send_frame(_index, size());
+    }
+
+    sptr get_new(void)
+    {
+        return make(this, _mem, _frame_size);
+    }
+
+private:
+    sim_link_base &_link;
+    const size_t _index;
+    void *_mem;
+    const size_t _frame_size;
+};
+
+//! Frame memory and the indexes of the frames owned by the link
+class sim_frame_pool : boost::noncopyable
+{
+public:
+    sim_frame_pool(const size_t frame_size, const size_t num_frames):
+        _frame_size(frame_size), _mem(frame_size*num_frames)
+    {
+        for (size_t i = 0; i < num_frames; i++) _free.push_back(num_frames-i-1);
+    }
+
+    char *at(const size_t index)
+    {
+        return &_mem[index*_frame_size];
+    }
+
+    bool empty(void) const
+    {
+        return _free.empty();
+    }
+
+    size_t pop(void)
+    {
+        const size_t index = _free.back();
+        _free.pop_back();
+        return index;
+    }
+
+    void push(const size_t index)
+    {
+        _free.push_back(index);
+    }
+
+private:
+    const size_t _frame_size;
+    std::vector<char> _mem;
+    std::vector<size_t> _free;
+};
+
+static size_t sim_pack_packet(char *mem, vrt::if_packet_info_t &info)
+{
+    info.link_type = vrt::if_packet_info_t::LINK_TYPE_CHDR;
+    info.num_payload_bytes = info.num_payload_words32*sizeof(boost::uint32_t);
+    info.sob = false;
+    info.has_sid = true;
+    info.has_cid = false;
+    info.has_tsi = false;
+    info.has_tsf = true;
+    info.has_tlr = false;
+    vrt::if_hdr_pack_le(reinterpret_cast<boost::uint32_t *>(mem), info);
+    return info.num_packet_words32*sizeof(boost::uint32_t);
+}
+
+static size_t sim_pack_message(
+    char *mem, const boost::uint32_t sid, const size_t seq,
+    const boost::uint32_t code, const boost::uint32_t payload,
+    const time_spec_t &time, const double tick_rate
+){
+    vrt::if_packet_info_t info;
+    info.packet_type = vrt::if_packet_info_t::PACKET_TYPE_CONTEXT;
+    info.num_payload_words32 = 2;
+    info.packet_count = seq;
+    info.eob = false;
+    info.sid = sid;
+    info.tsf = time.to_ticks(tick_rate);
+    const size_t length = sim_pack_packet(mem, info);
+    boost::uint32_t *words = reinterpret_cast<boost::uint32_t *>(mem) + info.num_header_words32;
+    words[0] = uhd::htowx(code);
+    words[1] = uhd::htowx(payload);
+    return length;
+}
+
+/***********************************************************************
+ * RX link
+ **********************************************************************/
+class sim_rx_link_impl : public sim_rx_link, public sim_link_base
+{
+public:
+    sim_rx_link_impl(
+        sim_clock::sptr clock,
+        const zero_copy_xport_params &params,
+        const sim_faults_t &faults,
+        const bool paced
+    ):
+        _clock(clock), _params(params), _faults(faults), _rng(faults.seed), _paced(paced),
+        _recv_pool(params.recv_frame_size, params.num_recv_frames),
+        _send_pool(params.send_frame_size, params.num_send_frames),
+        _sid(0), _spp((params.recv_frame_size - SIM_HDR_LEN)/sizeof(boost::uint32_t)),
+        _tick_rate(1.0), _samp_rate(1.0), _fc_window(params.num_recv_frames),
+        _streaming(false), _continuous(false), _chain(false), _num_samps_left(0),
+        _samps_sent(0), _seq32(0), _acked32(0),
+        _ready(params.num_recv_frames), _has_held(false)
+    {
+        UHD_ASSERT_THROW(params.recv_frame_size > SIM_HDR_LEN);
+        for (size_t i = 0; i < params.num_recv_frames; i++){
+            _mrbs.push_back(boost::make_shared<sim_mrb>(boost::ref(*this), i, _recv_pool.at(i)));
+        }
+        for (size_t i = 0; i < params.num_send_frames; i++){
+            _msbs.push_back(boost::make_shared<sim_msb>(boost::ref(*this), i, _send_pool.at(i), params.send_frame_size));
+        }
+
+        //fill the payload of every frame with a test tone once,
+        //headers and messages only overwrite the first two words
+        const size_t num_words = (params.recv_frame_size - SIM_HDR_LEN)/sizeof(boost::uint32_t);
+        for (size_t i = 0; i < params.num_recv_frames; i++){
+            boost::uint32_t *payload = reinterpret_cast<boost::uint32_t *>(_recv_pool.at(i) + SIM_HDR_LEN);
+            for (size_t n = 0; n < num_words; n++){
+                const double phase = 2*M_PI*(n % 16)/16;
+                const boost::uint16_t re = boost::uint16_t(boost::int16_t(std::floor(16384*std::cos(phase) + 0.5)));
+                const boost::uint16_t im = boost::uint16_t(boost::int16_t(std::floor(16384*std::sin(phase) + 0.5)));
+                payload[n] = uhd::htowx(boost::uint32_t((re << 16) | im));
+            }
+            _tone_head[0] = payload[0];
+            _tone_head[1] = payload[1];
+        }
+    }
+
+    ~sim_rx_link_impl(void)
+    {
+        //the buffers hold references to this link
+        _mrbs.clear();
+        _msbs.clear();
+    }
+
+    /*******************************************************************
+     * Device controls
+     ******************************************************************/
+    void clear(void)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        this->stop();
+        BOOST_FOREACH(const ready_t &r, _ready) _recv_pool.push(r.index);
+        _ready.clear();
+        _seq32 = 0;
+        _acked32 = 0;
+    }
+
+    void set_nsamps_per_packet(const size_t nsamps)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _spp = std::min(nsamps, (_params.recv_frame_size - SIM_HDR_LEN)/sizeof(boost::uint32_t));
+    }
+
+    void issue_stream_command(const stream_cmd_t &stream_cmd)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        if (stream_cmd.stream_mode == stream_cmd_t::STREAM_MODE_STOP_CONTINUOUS) this->stop();
+        else _cmds.push_back(queued_cmd_t(stream_cmd, _clock->get_time_now()));
+        _cond.notify_all();
+    }
+
+    size_t get_num_queued_cmds(void)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        return _cmds.size();
+    }
+
+    void set_tick_rate(const double rate)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _tick_rate = rate;
+    }
+
+    void set_samp_rate(const double rate)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _samp_rate = rate;
+    }
+
+    void set_sid(const boost::uint32_t sid)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _sid = sid;
+    }
+
+    void handle_overflow(void)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        if (not _continuous) return;
+        _cmds.clear();
+        _cmds.push_back(queued_cmd_t(stream_cmd_t(stream_cmd_t::STREAM_MODE_START_CONTINUOUS), _clock->get_time_now()));
+        _cond.notify_all();
+    }
+
+    void configure_flow_control(const size_t window_size)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _fc_window = window_size;
+    }
+
+    bool in_continuous_streaming_mode(void)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        return _continuous;
+    }
+
+    /*******************************************************************
+     * Device to host
+     ******************************************************************/
+    managed_recv_buffer::sptr get_recv_buff(double timeout)
+    {
+        const boost::system_time exit_time = boost::get_system_time() +
+            boost::posix_time::microseconds(long(timeout*1e6));
+        boost::mutex::scoped_lock lock(_mutex);
+        while (true)
+        {
+            const boost::system_time now = boost::get_system_time();
+            if (not _ready.empty() and _ready.front().time <= now)
+            {
+                const ready_t r = _ready.front();
+                _ready.pop_front();
+                return _mrbs[r.index]->get_new(r.length);
+            }
+
+            boost::system_time wake_time = exit_time;
+            if (not _ready.empty()) wake_time = std::min(wake_time, _ready.front().time);
+            if (this->produce(wake_time)) continue;
+
+            if (now >= exit_time) return managed_recv_buffer::sptr();
+            _cond.timed_wait(lock, wake_time);
+        }
+    }
+
+    void release_recv_frame(const size_t index)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _recv_pool.push(index);
+        _cond.notify_all();
+    }
+
+    size_t get_num_recv_frames(void) const
+    {
+        return _params.num_recv_frames;
+    }
+
+    size_t get_recv_frame_size(void) const
+    {
+        return _params.recv_frame_size;
+    }
+
+    /*******************************************************************
+     * Host to device: flow control
+     ******************************************************************/
+    managed_send_buffer::sptr get_send_buff(double timeout)
+    {
+        const boost::system_time exit_time = boost::get_system_time() +
+            boost::posix_time::microseconds(long(timeout*1e6));
+        boost::mutex::scoped_lock lock(_mutex);
+        while (_send_pool.empty())
+        {
+            if (not _cond.timed_wait(lock, exit_time)) return managed_send_buffer::sptr();
+        }
+        return _msbs[_send_pool.pop()]->get_new();
+    }
+
+    void commit_send_frame(const size_t index, const size_t length)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        vrt::if_packet_info_t info;
+        info.link_type = vrt::if_packet_info_t::LINK_TYPE_CHDR;
+        info.num_packet_words32 = length/sizeof(boost::uint32_t);
+        const boost::uint32_t *words = reinterpret_cast<const boost::uint32_t *>(_send_pool.at(index));
+        try
+        {
+            vrt::if_hdr_unpack_le(words, info);
+            if (info.num_payload_words32 >= 2)
+            {
+                _acked32 = uhd::wtohx(words[info.num_header_words32+1]);
+            }
+        }
+        catch(const std::exception &ex)
+        {
+            UHD_LOG << "sim_rx_link: bad flow control packet: " << ex.what() << std::endl;
+        }
+        _send_pool.push(index);
+        _cond.notify_all();
+    }
+
+    size_t get_num_send_frames(void) const
+    {
+        return _params.num_send_frames;
+    }
+
+    size_t get_send_frame_size(void) const
+    {
+        return _params.send_frame_size;
+    }
+
+private:
+    struct ready_t
+    {
+        size_t index, length;
+        boost::system_time time;
+    };
+
+    //! A stream command and the device time it arrived at
+    struct queued_cmd_t
+    {
+        queued_cmd_t(const stream_cmd_t &cmd, const time_spec_t &arrival):
+            cmd(cmd), arrival(arrival){}
+        stream_cmd_t cmd;
+        time_spec_t arrival;
+    };
+
+    void stop(void)
+    {
+        _cmds.clear();
+        _idle_time = _clock->get_time_now();
+        _streaming = false;
+        _continuous = false;
+        _chain = false;
+        if (_has_held) this->push_ready(_held.index, _held.length, boost::get_system_time());
+        _has_held = false;
+    }
+
+    //! Put a packet on the link, it cannot overtake the packets before it
+    void push_ready(const size_t index, const size_t length, boost::system_time time)
+    {
+        if (not _ready.empty()) time = std::max(time, _ready.back().time);
+        ready_t r;
+        r.index = index;
+        r.length = length;
+        r.time = time;
+        _ready.push_back(r);
+    }
+
+    void push_message(const rx_metadata_t::error_code_t code, const time_spec_t &time)
+    {
+        const size_t index = _recv_pool.pop();
+        const size_t length = sim_pack_message(
+            _recv_pool.at(index), _sid, _seq32 & 0xfff, boost::uint32_t(code), _seq32, time, _tick_rate);
+        this->push_ready(index, length, boost::get_system_time());
+    }
+
+    /*!
+     * Run the device until it puts a packet on the link.
+     * \param wake_time set to when the next packet is due if earlier
+     * \return true if the device state changed
+     */
+    bool produce(boost::system_time &wake_time)
+    {
+        if (_recv_pool.empty()) return false; //woken by a release
+        const time_spec_t now = _clock->get_time_now();
+
+        //start the next stream command
+        if (not _streaming)
+        {
+            if (_cmds.empty())
+            {
+                if (not _chain) return false;
+                _chain = false;
+                this->push_message(rx_metadata_t::ERROR_CODE_BROKEN_CHAIN, now);
+                return true;
+            }
+            //the device takes a command when it arrives or when the
+            //stream before it ends, not when the host polls the link
+            const stream_cmd_t cmd = _cmds.front().cmd;
+            const time_spec_t taken = std::max(_cmds.front().arrival, _idle_time);
+            _cmds.pop_front();
+            if (not cmd.stream_now and cmd.time_spec < taken)
+            {
+                _chain = false;
+                this->push_message(rx_metadata_t::ERROR_CODE_LATE_COMMAND, now);
+                return true;
+            }
+            if (not (_chain and cmd.stream_now))
+            {
+                _start_time = cmd.stream_now? now : cmd.time_spec;
+                _samps_sent = 0;
+            }
+            _continuous = (cmd.stream_mode == stream_cmd_t::STREAM_MODE_START_CONTINUOUS);
+            _chain = (cmd.stream_mode == stream_cmd_t::STREAM_MODE_NUM_SAMPS_AND_MORE);
+            _num_samps_left = cmd.num_samps;
+            _streaming = _continuous or _num_samps_left != 0;
+            return true;
+        }
+
+        //the packet is due when the device time passes its last sample
+        const size_t nsamps = _continuous? _spp : std::min(_spp, _num_samps_left);
+        const double ticks_per_samp = _tick_rate/_samp_rate;
+        const long long start_ticks = _start_time.to_ticks(_tick_rate);
+        const long long tsf = start_ticks + boost::int64_t(std::floor(_samps_sent*ticks_per_samp + 0.5));
+        const time_spec_t end_time = time_spec_t::from_ticks(
+            start_ticks + boost::int64_t(std::floor((_samps_sent + nsamps)*ticks_per_samp + 0.5)), _tick_rate);
+        if (_paced and now < end_time)
+        {
+            wake_time = std::min(wake_time, _clock->to_system_time(end_time));
+            return false;
+        }
+
+        //the host holds back flow control: the device buffers samples,
+        //and stops with an overflow when its buffer is full
+        if (boost::uint32_t(_seq32 - _acked32) >= _fc_window)
+        {
+            if (_paced and (now - end_time).get_real_secs() > SIM_RX_HW_BUFF_PKTS*_spp/_samp_rate)
+            {
+                const bool continuous = _continuous;
+                this->stop();
+                _continuous = continuous;
+                this->push_message(rx_metadata_t::ERROR_CODE_OVERFLOW, time_spec_t::from_ticks(tsf, _tick_rate));
+                return true;
+            }
+            return false; //woken by a flow control packet
+        }
+
+        //load the data packet
+        vrt::if_packet_info_t info;
+        info.packet_type = vrt::if_packet_info_t::PACKET_TYPE_DATA;
+        info.num_payload_words32 = nsamps;
+        info.packet_count = _seq32 & 0xfff;
+        info.eob = (not _continuous and not _chain and nsamps == _num_samps_left);
+        info.sid = _sid;
+        info.tsf = tsf;
+        const size_t index = _recv_pool.pop();
+        char *mem = _recv_pool.at(index);
+        const size_t length = sim_pack_packet(mem, info);
+        std::memcpy(mem + SIM_HDR_LEN, _tone_head, sizeof(_tone_head));
+
+        _seq32++;
+        _samps_sent += nsamps;
+        if (not _continuous)
+        {
+            _num_samps_left -= nsamps;
+            if (_num_samps_left == 0)
+            {
+                _streaming = false;
+                _idle_time = end_time;
+            }
+        }
+
+        //put the packet on the link with faults
+        boost::system_time time = boost::get_system_time();
+        if (_rng.roll(_faults.drop_rate))
+        {
+            _recv_pool.push(index);
+            return true;
+        }
+        if (_rng.roll(_faults.late_rate))
+        {
+            time += boost::posix_time::microseconds(long(_faults.late_time*1e6));
+        }
+        if (_continuous and not _has_held and _rng.roll(_faults.reorder_rate))
+        {
+            _held.index = index;
+            _held.length = length;
+            _has_held = true;
+            return true;
+        }
+        this->push_ready(index, length, time);
+        if (_has_held) this->push_ready(_held.index, _held.length, time);
+        _has_held = false;
+        return true;
+    }
+
+    sim_clock::sptr _clock;
+    const zero_copy_xport_params _params;
+    const sim_faults_t _faults;
+    sim_fault_rng _rng;
+    const bool _paced;
+
+    boost::mutex _mutex;
+    boost::condition_variable _cond;
+    sim_frame_pool _recv_pool, _send_pool;
+    std::vector<boost::shared_ptr<sim_mrb> > _mrbs;
+    std::vector<boost::shared_ptr<sim_msb> > _msbs;
+    boost::uint32_t _tone_head[2];
+
+    //configuration
+    boost::uint32_t _sid;
+    size_t _spp;
+    double _tick_rate, _samp_rate;
+    size_t _fc_window;
+
+    //stream state
+    std::deque<queued_cmd_t> _cmds;
+    time_spec_t _idle_time;
+    bool _streaming, _continuous, _chain;
+    size_t _num_samps_left;
+    time_spec_t _start_time;
+    boost::uint64_t _samps_sent;
+    boost::uint32_t _seq32, _acked32;
+
+    //packets on the link, each holds a frame
+    boost::circular_buffer<ready_t> _ready;
+    bool _has_held;
+    ready_t _held;
+};
+
+sim_rx_link::sptr sim_rx_link::make(
+    sim_clock::sptr clock,
+    const zero_copy_xport_params &params,
+    const sim_faults_t &faults,
+    const bool paced
+){
+    return sptr(new sim_rx_link_impl(clock, params, faults, paced));
+}
+
+/***********************************************************************
+ * TX link
+ **********************************************************************/
+class sim_tx_link_impl : public sim_tx_link, public sim_link_base
+{
+public:
+    sim_tx_link_impl(
+        sim_clock::sptr clock,
+        const zero_copy_xport_params &params,
+        const sim_faults_t &faults,
+        const bool paced
+    ):
+        _clock(clock), _params(params), _faults(faults), _rng(faults.seed + 1), _paced(paced),
+        _recv_pool(params.recv_frame_size, params.num_recv_frames),
+        _send_pool(params.send_frame_size, params.num_send_frames),
+        _sid(0), _tick_rate(1.0), _samp_rate(1.0), _fc_window(1),
+        _arrivals(params.num_send_frames), _has_held(false),
+        _expected_seq(0), _in_burst(false), _dropping(false),
+        _num_consumed(0), _num_msgs(0), _num_events(0)
+    {
+        _events.reserve(params.num_send_frames);
+        for (size_t i = 0; i < params.num_recv_frames; i++){
+            _mrbs.push_back(boost::make_shared<sim_mrb>(boost::ref(*this), i, _recv_pool.at(i)));
+        }
+        for (size_t i = 0; i < params.num_send_frames; i++){
+            _msbs.push_back(boost::make_shared<sim_msb>(boost::ref(*this), i, _send_pool.at(i), params.send_frame_size));
+        }
+    }
+
+    ~sim_tx_link_impl(void)
+    {
+        //the buffers hold references to this link
+        _mrbs.clear();
+        _msbs.clear();
+    }
+
+    /*******************************************************************
+     * Device controls
+     ******************************************************************/
+    void clear(void)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        BOOST_FOREACH(const arrival_t &a, _arrivals) _send_pool.push(a.index);
+        _arrivals.clear();
+        if (_has_held) _send_pool.push(_held.index);
+        _has_held = false;
+        _events.clear();
+        _expected_seq = 0;
+        _in_burst = false;
+        _dropping = false;
+        _num_consumed = 0;
+        _cond.notify_all();
+    }
+
+    void set_tick_rate(const double rate)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _tick_rate = rate;
+    }
+
+    void set_samp_rate(const double rate)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _samp_rate = rate;
+    }
+
+    void set_sid(const boost::uint32_t sid)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _sid = sid;
+    }
+
+    void configure_flow_control(const size_t window_size)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _fc_window = std::max<size_t>(1, window_size);
+    }
+
+    /*******************************************************************
+     * Device to host: async messages
+     ******************************************************************/
+    managed_recv_buffer::sptr get_recv_buff(double timeout)
+    {
+        const boost::system_time exit_time = boost::get_system_time() +
+            boost::posix_time::microseconds(long(timeout*1e6));
+        boost::mutex::scoped_lock lock(_mutex);
+        while (true)
+        {
+            this->advance();
+            boost::system_time wake_time = exit_time;
+            if (not _arrivals.empty()) wake_time = std::min(wake_time, _arrivals.front().time);
+            if (not _events.empty() and not _recv_pool.empty())
+            {
+                const time_spec_t time = _events.front().time;
+                if (time <= _clock->get_time_now())
+                {
+                    const event_t event = _events.front();
+                    std::pop_heap(_events.begin(), _events.end(), event_later());
+                    _events.pop_back();
+                    const size_t index = _recv_pool.pop();
+                    const size_t length = sim_pack_message(
+                        _recv_pool.at(index), _sid, _num_msgs++ & 0xfff,
+                        event.code, event.seq, time, _tick_rate);
+                    return _mrbs[index]->get_new(length);
+                }
+                wake_time = std::min(wake_time, _clock->to_system_time(time));
+            }
+
+            if (boost::get_system_time() >= exit_time) return managed_recv_buffer::sptr();
+            _cond.timed_wait(lock, wake_time);
+        }
+    }
+
+    void release_recv_frame(const size_t index)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _recv_pool.push(index);
+        _cond.notify_all();
+    }
+
+    size_t get_num_recv_frames(void) const
+    {
+        return _params.num_recv_frames;
+    }
+
+    size_t get_recv_frame_size(void) const
+    {
+        return _params.recv_frame_size;
+    }
+
+    /*******************************************************************
+     * Host to device: data
+     ******************************************************************/
+    managed_send_buffer::sptr get_send_buff(double timeout)
+    {
+        const boost::system_time exit_time = boost::get_system_time() +
+            boost::posix_time::microseconds(long(timeout*1e6));
+        boost::mutex::scoped_lock lock(_mutex);
+        while (true)
+        {
+            this->advance();
+            if (not _send_pool.empty()) return _msbs[_send_pool.pop()]->get_new();
+
+            boost::system_time wake_time = exit_time;
+            if (not _arrivals.empty()) wake_time = std::min(wake_time, _arrivals.front().time);
+            if (boost::get_system_time() >= exit_time) return managed_send_buffer::sptr();
+            _cond.timed_wait(lock, wake_time);
+        }
+    }
+
+    void commit_send_frame(const size_t index, const size_t length)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        if (_rng.roll(_faults.drop_rate))
+        {
+            _send_pool.push(index);
+            _cond.notify_all();
+            return;
+        }
+
+        arrival_t a;
+        a.index = index;
+        a.length = length;
+        a.time = boost::get_system_time();
+        if (_rng.roll(_faults.late_rate))
+        {
+            a.time += boost::posix_time::microseconds(long(_faults.late_time*1e6));
+        }
+        if (not _arrivals.empty()) a.time = std::max(a.time, _arrivals.back().time);
+
+        //a packet is only held back when another packet of the burst follows
+        const boost::uint32_t chdr = uhd::wtohx(*reinterpret_cast<const boost::uint32_t *>(_send_pool.at(index)));
+        const bool eob = ((chdr >> 28) & 0x1) != 0;
+        if (not eob and not _has_held and _rng.roll(_faults.reorder_rate))
+        {
+            _held = a;
+            _has_held = true;
+            return;
+        }
+        _arrivals.push_back(a);
+        if (_has_held)
+        {
+            _held.time = a.time;
+            _arrivals.push_back(_held);
+        }
+        _has_held = false;
+        _cond.notify_all();
+    }
+
+    size_t get_num_send_frames(void) const
+    {
+        return _params.num_send_frames;
+    }
+
+    size_t get_send_frame_size(void) const
+    {
+        return _params.send_frame_size;
+    }
+
+private:
+    struct arrival_t
+    {
+        size_t index, length;
+        boost::system_time time;
+    };
+
+    struct event_t
+    {
+        time_spec_t time;
+        size_t order;
+        boost::uint32_t code, seq;
+    };
+
+    //! Orders the event heap: the earliest event first, then in the order pushed
+    struct event_later
+    {
+        bool operator()(const event_t &a, const event_t &b) const
+        {
+            if (a.time != b.time) return b.time < a.time;
+            return a.order > b.order;
+        }
+    };
+
+    void push_event(const boost::uint32_t code, const size_t seq, const time_spec_t &time)
+    {
+        event_t event;
+        event.time = time;
+        event.order = _num_events++;
+        event.code = code;
+        event.seq = boost::uint32_t(seq);
+        _events.push_back(event);
+        std::push_heap(_events.begin(), _events.end(), event_later());
+    }
+
+    //! The device consumed a packet, send flow control once per window
+    void consume(const size_t seq, const time_spec_t &time)
+    {
+        if (++_num_consumed % _fc_window == 0)
+        {
+            this->push_event(SIM_ASYNC_EVENT_CODE_FLOW_CTRL, seq, time);
+        }
+    }
+
+    //! Process the packets that arrived at the device
+    void advance(void)
+    {
+        const boost::system_time now = boost::get_system_time();
+        bool progress = false;
+        while (not _arrivals.empty() and _arrivals.front().time <= now)
+        {
+            const arrival_t a = _arrivals.front();
+            _arrivals.pop_front();
+            this->process(_send_pool.at(a.index), a.length);
+            _send_pool.push(a.index);
+            progress = true;
+        }
+        if (progress) _cond.notify_all();
+    }
+
+    void process(const char *mem, const size_t length)
+    {
+        const time_spec_t now = _clock->get_time_now();
+        vrt::if_packet_info_t info;
+        info.link_type = vrt::if_packet_info_t::LINK_TYPE_CHDR;
+        info.num_packet_words32 = length/sizeof(boost::uint32_t);
+        try
+        {
+            vrt::if_hdr_unpack_le(reinterpret_cast<const boost::uint32_t *>(mem), info);
+        }
+        catch(const std::exception &ex)
+        {
+            UHD_LOG << "sim_tx_link: bad data packet: " << ex.what() << std::endl;
+            return;
+        }
+        if (info.packet_type != vrt::if_packet_info_t::PACKET_TYPE_DATA) return;
+
+        //sequence check
+        const size_t seq = info.packet_count;
+        if (seq != _expected_seq)
+        {
+            this->push_event(_in_burst?
+                async_metadata_t::EVENT_CODE_SEQ_ERROR_IN_BURST :
+                async_metadata_t::EVENT_CODE_SEQ_ERROR, seq, now);
+        }
+        _expected_seq = (seq + 1) & 0xfff;
+
+        //after a time error the rest of the burst is dropped
+        if (_dropping)
+        {
+            _dropping = not info.eob;
+            this->consume(seq, now);
+            return;
+        }
+
+        //the first packet of a burst starts the playout
+        if (not _in_burst)
+        {
+            _playout_end = now;
+            if (info.has_tsf)
+            {
+                const time_spec_t time = time_spec_t::from_ticks(info.tsf, _tick_rate);
+                if (time < now)
+                {
+                    this->push_event(async_metadata_t::EVENT_CODE_TIME_ERROR, seq, now);
+                    _dropping = not info.eob;
+                    this->consume(seq, now);
+                    return;
+                }
+                _playout_end = time;
+            }
+            _in_burst = true;
+        }
+        else if (_paced and _playout_end < now)
+        {
+            this->push_event(async_metadata_t::EVENT_CODE_UNDERFLOW, seq, _playout_end);
+            _playout_end = now;
+        }
+
+        //a packet is consumed when its last sample is played
+        const size_t nsamps = info.num_payload_bytes/sizeof(boost::uint32_t);
+        if (_paced) _playout_end += time_spec_t(nsamps/_samp_rate);
+        else _playout_end = now;
+        this->consume(seq, _playout_end);
+        if (info.eob)
+        {
+            this->push_event(async_metadata_t::EVENT_CODE_BURST_ACK, seq, _playout_end);
+            _in_burst = false;
+        }
+    }
+
+    sim_clock::sptr _clock;
+    const zero_copy_xport_params _params;
+    const sim_faults_t _faults;
+    sim_fault_rng _rng;
+    const bool _paced;
+
+    boost::mutex _mutex;
+    boost::condition_variable _cond;
+    sim_frame_pool _recv_pool, _send_pool;
+    std::vector<boost::shared_ptr<sim_mrb> > _mrbs;
+    std::vector<boost::shared_ptr<sim_msb> > _msbs;
+
+    //configuration
+    boost::uint32_t _sid;
+    double _tick_rate, _samp_rate;
+    size_t _fc_window;
+
+    //packets on the link, each holds a frame
+    boost::circular_buffer<arrival_t> _arrivals;
+    bool _has_held;
+    arrival_t _held;
+
+    //burst state and pending messages
+    size_t _expected_seq;
+    bool _in_burst, _dropping;
+    time_spec_t _playout_end;
+    size_t _num_consumed, _num_msgs, _num_events;
+    std::vector<event_t> _events; //a heap, keeps its capacity when drained
+};
+
+sim_tx_link::sptr sim_tx_link::make(
+    sim_clock::sptr clock,
+    const zero_copy_xport_params &params,
+    const sim_faults_t &faults,
+    const bool paced
+){
+    return sptr(new sim_tx_link_impl(clock, params, faults, paced));
+}
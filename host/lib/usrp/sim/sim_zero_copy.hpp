@@ -0,0 +1,172 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_USRP_SIM_ZERO_COPY_HPP
+#define INCLUDED_LIBUHD_USRP_SIM_ZERO_COPY_HPP
+
+#include <uhd/config.hpp>
+#include <uhd/transport/zero_copy.hpp>
+#include <uhd/types/device_addr.hpp>
+#include <uhd/types/stream_cmd.hpp>
+#include <uhd/types/time_spec.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread_time.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+#include <boost/cstdint.hpp>
+
+/*!
+ * The clock of a simulated device.
+ * The device time runs with the host system clock,
+ * the tick rate only sets the timestamp resolution.
+ */
+class sim_clock : boost::noncopyable
+{
+public:
+    typedef boost::shared_ptr<sim_clock> sptr;
+
+    sim_clock(void);
+
+    void set_tick_rate(const double rate);
+
+    double get_tick_rate(void);
+
+    uhd::time_spec_t get_time_now(void);
+
+    uhd::time_spec_t get_time_last_pps(void);
+
+    void set_time_now(const uhd::time_spec_t &time);
+
+    //! The next PPS edge is on the next whole second of device time
+    void set_time_next_pps(const uhd::time_spec_t &time);
+
+    //! Get the host system time at which the device time is time
+    boost::system_time to_system_time(const uhd::time_spec_t &time);
+
+private:
+    uhd::time_spec_t get_time_at(const boost::system_time &now);
+    boost::mutex _mutex;
+    double _tick_rate;
+    boost::system_time _epoch;
+    uhd::time_spec_t _epoch_time;
+};
+
+/*!
+ * Faults injected by a simulated link, as probabilities per packet.
+ * Device args: drop_rate, reorder_rate, late_rate, late_time, seed.
+ */
+struct sim_faults_t
+{
+    //! the packet is lost on the link
+    double drop_rate;
+    //! the packet is swapped with the next packet
+    double reorder_rate;
+    //! the packet (and all packets behind it) arrive late_time seconds late
+    double late_rate;
+    double late_time;
+    boost::uint32_t seed;
+
+    sim_faults_t(const uhd::device_addr_t &args = uhd::device_addr_t());
+};
+
+/*!
+ * The receive side of a simulated radio on its link to the host.
+ *
+ * The recv side of the link carries CHDR data packets (little endian)
+ * with a test tone, sequence numbers and timestamps, and inline error
+ * messages (late command, broken chain, overflow). The send side takes
+ * flow control packets from the host, the payload word 1 is the last
+ * consumed sequence number.
+ *
+ * When paced, a packet is ready when the device time passes its last
+ * sample; if the host falls behind by more than the device buffer,
+ * streaming stops with an overflow like on an X300 or B200.
+ * Otherwise packets are ready as fast as the host takes them.
+ */
+class sim_rx_link : public uhd::transport::zero_copy_if
+{
+public:
+    typedef boost::shared_ptr<sim_rx_link> sptr;
+
+    static sptr make(
+        sim_clock::sptr clock,
+        const uhd::transport::zero_copy_xport_params &params,
+        const sim_faults_t &faults,
+        const bool paced
+    );
+
+    virtual void clear(void) = 0;
+
+    virtual void set_nsamps_per_packet(const size_t nsamps) = 0;
+
+    virtual void issue_stream_command(const uhd::stream_cmd_t &stream_cmd) = 0;
+
+    //! Get the number of stream commands that are queued or running
+    virtual size_t get_num_queued_cmds(void) = 0;
+
+    virtual void set_tick_rate(const double rate) = 0;
+
+    virtual void set_samp_rate(const double rate) = 0;
+
+    virtual void set_sid(const boost::uint32_t sid) = 0;
+
+    virtual void handle_overflow(void) = 0;
+
+    virtual void configure_flow_control(const size_t window_size) = 0;
+
+    virtual bool in_continuous_streaming_mode(void) = 0;
+};
+
+/*!
+ * The transmit side of a simulated radio on its link to the host.
+ *
+ * The send side of the link takes CHDR data packets (little endian).
+ * The recv side carries async message packets: flow control responses
+ * (event code 0), burst ACKs, underflows, sequence and time errors.
+ * The payload word 1 of a flow control response or burst ACK is the
+ * sequence number of the last consumed packet.
+ *
+ * When paced, the device plays out samples at the sample rate and
+ * consumes a packet when its last sample is played; a burst that runs
+ * dry underflows. Otherwise packets are consumed as they arrive.
+ */
+class sim_tx_link : public uhd::transport::zero_copy_if
+{
+public:
+    typedef boost::shared_ptr<sim_tx_link> sptr;
+
+    static sptr make(
+        sim_clock::sptr clock,
+        const uhd::transport::zero_copy_xport_params &params,
+        const sim_faults_t &faults,
+        const bool paced
+    );
+
+    virtual void clear(void) = 0;
+
+    virtual void set_tick_rate(const double rate) = 0;
+
+    virtual void set_samp_rate(const double rate) = 0;
+
+    //! Set the SID of the async messages
+    virtual void set_sid(const boost::uint32_t sid) = 0;
+
+    //! Send a flow control response every window_size packets
+    virtual void configure_flow_control(const size_t window_size) = 0;
+};
+
+#endif /* INCLUDED_LIBUHD_USRP_SIM_ZERO_COPY_HPP */
@@ -19,15 +19,14 @@
 #include "async_packet_handler.hpp"
 #include "../../transport/super_recv_packet_handler.hpp"
 #include "../../transport/super_send_packet_handler.hpp"
+#include "../../transport/async_reactor.hpp"
 #include "usrp2_impl.hpp"
 #include "usrp2_regs.hpp"
 #include "fw_common.h"
 #include <uhd/utils/log.hpp>
 #include <uhd/utils/msg.hpp>
-#include <uhd/utils/tasks.hpp>
 #include <uhd/exception.hpp>
 #include <uhd/utils/byteswap.hpp>
-#include <uhd/utils/thread_priority.hpp>
 #include <uhd/transport/bounded_buffer.hpp>
 #include <boost/thread/thread.hpp>
 #include <boost/format.hpp>
@@ -61,7 +60,7 @@ static const size_t vrt_send_header_offset_words32 = 1;
 
 /***********************************************************************
  * flow control monitor for a single tx channel
- *  - the pirate thread calls update
+ *  - the pirate calls update
  *  - the get send buffer calls check
  **********************************************************************/
 class flow_control_monitor{
@@ -145,8 +144,8 @@ struct usrp2_impl::io_impl{
     }
 
     ~io_impl(void){
-        //Manually deconstuct the tasks, since this was not happening automatically.
-        pirate_tasks.clear();
+        //Manually remove the pirates, their handlers point to this object.
+        pirate_regs.clear();
     }
 
     managed_send_buffer::sptr get_send_buff(size_t chan, double timeout){
@@ -169,62 +168,59 @@ struct usrp2_impl::io_impl{
     std::vector<flow_control_monitor::sptr> fc_mons;
 
     //methods and variables for the pirate crew
-    void recv_pirate_loop(zero_copy_if::sptr, size_t);
-    std::list<task::sptr> pirate_tasks;
+    bool recv_pirate(zero_copy_if::sptr, size_t, const double);
+    std::list<async_reactor::registration::sptr> pirate_regs;
     bounded_buffer<async_metadata_t> async_msg_fifo;
     double tick_rate;
 };
 
 /***********************************************************************
- * Receive Pirate Loop
- * - while raiding, loot for message packet
+ * Receive Pirate
+ * - called by the async reactor to loot one message packet
  * - update flow control condition count
  * - put async message packets into queue
  **********************************************************************/
-void usrp2_impl::io_impl::recv_pirate_loop(
-    zero_copy_if::sptr err_xport, size_t index
+bool usrp2_impl::io_impl::recv_pirate(
+    zero_copy_if::sptr err_xport, size_t index, const double timeout
 ){
-    set_thread_priority_safe();
-
     //store a reference to the flow control monitor (offset by max dsps)
     flow_control_monitor &fc_mon = *(this->fc_mons[index]);
 
-    while (not boost::this_thread::interruption_requested()){
-        managed_recv_buffer::sptr buff = err_xport->get_recv_buff();
-        if (not buff.get()) continue; //ignore timeout/error buffers
-
-        try{
-            //extract the vrt header packet info
-            vrt::if_packet_info_t if_packet_info;
-            if_packet_info.num_packet_words32 = buff->size()/sizeof(boost::uint32_t);
-            const boost::uint32_t *vrt_hdr = buff->cast<const boost::uint32_t *>();
-            vrt::if_hdr_unpack_be(vrt_hdr, if_packet_info);
-
-            //handle a tx async report message
-            if (if_packet_info.sid == USRP2_TX_ASYNC_SID and if_packet_info.packet_type != vrt::if_packet_info_t::PACKET_TYPE_DATA){
-
-                //fill in the async metadata
-                async_metadata_t metadata;
-                load_metadata_from_buff(uhd::ntohx<boost::uint32_t>, metadata, if_packet_info, vrt_hdr, tick_rate, index);
-
-                //catch the flow control packets and react
-                if (metadata.event_code == 0){
-                    boost::uint32_t fc_word32 = (vrt_hdr + if_packet_info.num_header_words32)[1];
-                    fc_mon.update_fc_condition(uhd::ntohx(fc_word32));
-                    continue;
-                }
-                //else UHD_MSG(often) << "metadata.event_code " << metadata.event_code << std::endl;
-                async_msg_fifo.push_with_pop_on_full(metadata);
+    managed_recv_buffer::sptr buff = err_xport->get_recv_buff(timeout);
+    if (not buff.get()) return true; //ignore timeout/error buffers
 
-                standard_async_msg_prints(metadata);
-            }
-            else{
-                //TODO unknown received packet, may want to print error...
+    try{
+        //extract the vrt header packet info
+        vrt::if_packet_info_t if_packet_info;
+        if_packet_info.num_packet_words32 = buff->size()/sizeof(boost::uint32_t);
+        const boost::uint32_t *vrt_hdr = buff->cast<const boost::uint32_t *>();
+        vrt::if_hdr_unpack_be(vrt_hdr, if_packet_info);
+
+        //handle a tx async report message
+        if (if_packet_info.sid == USRP2_TX_ASYNC_SID and if_packet_info.packet_type != vrt::if_packet_info_t::PACKET_TYPE_DATA){
+
+            //fill in the async metadata
+            async_metadata_t metadata;
+            load_metadata_from_buff(uhd::ntohx<boost::uint32_t>, metadata, if_packet_info, vrt_hdr, tick_rate, index);
+
+            //catch the flow control packets and react
+            if (metadata.event_code == 0){
+                boost::uint32_t fc_word32 = (vrt_hdr + if_packet_info.num_header_words32)[1];
+                fc_mon.update_fc_condition(uhd::ntohx(fc_word32));
+                return true;
             }
-        }catch(const std::exception &e){
-            UHD_MSG(error) << "Error in recv pirate loop: " << e.what() << std::endl;
+            //else UHD_MSG(often) << "metadata.event_code " << metadata.event_code << std::endl;
+            async_msg_fifo.push_with_pop_on_full(metadata);
+
+            standard_async_msg_prints(metadata);
+        }
+        else{
+            //TODO unknown received packet, may want to print error...
         }
+    }catch(const std::exception &e){
+        UHD_MSG(error) << "Error in recv pirate: " << e.what() << std::endl;
     }
+    return true;
 }
 
 /***********************************************************************
@@ -249,13 +245,14 @@ void usrp2_impl::io_init(void){
         _mbc[mb].tx_streamers.resize(1/*known to be 1 dsp*/);
     }
 
-    //create a new pirate thread for each zc if (yarr!!)
+    //register a new pirate with the reactor for each zc if (yarr!!)
     size_t index = 0;
     BOOST_FOREACH(const std::string &mb, _mbc.keys()){
-        //spawn a new pirate to plunder the recv booty
-        _io_impl->pirate_tasks.push_back(task::make(boost::bind(
-            &usrp2_impl::io_impl::recv_pirate_loop, _io_impl.get(),
-            _mbc[mb].tx_dsp_xport, index++
+        //the reactor calls the pirate when there is recv booty to plunder
+        _io_impl->pirate_regs.push_back(async_reactor::get()->add(
+            _mbc[mb].tx_dsp_xport, boost::bind(
+                &usrp2_impl::io_impl::recv_pirate, _io_impl.get(),
+                _mbc[mb].tx_dsp_xport, index++, _1
         )));
     }
 }
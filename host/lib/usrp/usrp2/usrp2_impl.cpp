@@ -18,6 +18,7 @@
 #include "usrp2_impl.hpp"
 #include "fw_common.h"
 #include "apply_corrections.hpp"
+#include "init_profiler.hpp"
 #include <uhd/utils/log.hpp>
 #include <uhd/utils/msg.hpp>
 #include <uhd/exception.hpp>
@@ -281,10 +282,10 @@ static zero_copy_if::sptr make_xport(
     const std::string &filter
 ){
 
-    //only copy hints that contain the filter word
+    //only copy hints that contain the filter word (and the transport type)
     device_addr_t filtered_hints;
     BOOST_FOREACH(const std::string &key, hints.keys()){
-        if (key.find(filter) == std::string::npos) continue;
+        if (key.find(filter) == std::string::npos and key != "transport") continue;
         filtered_hints[key] = hints[key];
     }
 
@@ -368,12 +369,15 @@ usrp2_impl::usrp2_impl(const device_addr_t &_device_addr){
     ////////////////////////////////////////////////////////////////////
     _tree = property_tree::make();
     _tree->create<std::string>("/name").set("USRP2 / N-Series Device");
+    uhd::dict<std::string, init_profiler::sptr> init_perfs;
 
     for (size_t mbi = 0; mbi < device_args.size(); mbi++){
         const device_addr_t device_args_i = device_args[mbi];
         const std::string mb = boost::lexical_cast<std::string>(mbi);
         const std::string addr = device_args_i["addr"];
         const fs_path mb_path = "/mboards/" + mb;
+        init_perfs[mb] = init_profiler::make("usrp2_impl");
+        init_span span("iface_init");
 
         ////////////////////////////////////////////////////////////////
         // create the iface that controls i2c, spi, uart, and wb
@@ -408,6 +412,7 @@ usrp2_impl::usrp2_impl(const device_addr_t &_device_addr){
         ////////////////////////////////////////////////////////////////
         // construct transports for RX and TX DSPs
         ////////////////////////////////////////////////////////////////
+        span.next("xport_init");
         UHD_LOG << "Making transport for RX DSP0..." << std::endl;
         _mbc[mb].rx_dsp_xports.push_back(make_xport(
             addr, BOOST_STRINGIZE(USRP2_UDP_RX_DSP0_PORT), device_args_i, "recv"
@@ -454,6 +459,7 @@ usrp2_impl::usrp2_impl(const device_addr_t &_device_addr){
         ////////////////////////////////////////////////////////////////
         // create clock control objects
         ////////////////////////////////////////////////////////////////
+        span.next("clock_codec_init");
         _mbc[mb].clock = usrp2_clock_ctrl::make(_mbc[mb].iface, _mbc[mb].spiface);
         _tree->create<double>(mb_path / "tick_rate")
             .publish(boost::bind(&usrp2_clock_ctrl::get_master_clock_rate, _mbc[mb].clock))
@@ -495,6 +501,7 @@ usrp2_impl::usrp2_impl(const device_addr_t &_device_addr){
         ////////////////////////////////////////////////////////////////////
         // Create the GPSDO control
         ////////////////////////////////////////////////////////////////////
+        span.next("gpsdo");
         static const boost::uint32_t dont_look_for_gpsdo = 0x1234abcdul;
 
         //disable check for internal GPSDO when not the following:
@@ -539,6 +546,7 @@ usrp2_impl::usrp2_impl(const device_addr_t &_device_addr){
         ////////////////////////////////////////////////////////////////
         // and do the misc mboard sensors
         ////////////////////////////////////////////////////////////////
+        span.next("dsp_time_init");
         _tree->create<sensor_value_t>(mb_path / "sensors/mimo_locked")
             .publish(boost::bind(&usrp2_impl::get_mimo_locked, this, mb));
         _tree->create<sensor_value_t>(mb_path / "sensors/ref_locked")
@@ -692,6 +700,7 @@ usrp2_impl::usrp2_impl(const device_addr_t &_device_addr){
         ////////////////////////////////////////////////////////////////
 
         //read the dboard eeprom to extract the dboard ids
+        span.next("dboard_init");
         dboard_eeprom_t rx_db_eeprom, tx_db_eeprom, gdb_eeprom;
         rx_db_eeprom.load(*_mbc[mb].iface, USRP2_I2C_ADDR_RX_DB);
         tx_db_eeprom.load(*_mbc[mb].iface, USRP2_I2C_ADDR_TX_DB);
@@ -739,6 +748,8 @@ usrp2_impl::usrp2_impl(const device_addr_t &_device_addr){
     this->update_rates();
     BOOST_FOREACH(const std::string &mb, _mbc.keys()){
         fs_path root = "/mboards/" + mb;
+        init_perfs[mb]->activate();
+        init_span span("post_init");
 
         //reset cordic rates and their properties to zero
         BOOST_FOREACH(const std::string &name, _tree->list(root / "rx_dsps")){
@@ -762,6 +773,9 @@ usrp2_impl::usrp2_impl(const device_addr_t &_device_addr){
             UHD_MSG(status) << "Initializing time to the internal GPSDO" << std::endl;
             _mbc[mb].time64->set_time_next_pps(time_spec_t(time_t(_mbc[mb].gps->get_sensor("gps_time").to_int()+1)));
         }
+
+        span.end();
+        init_perfs[mb]->finish(_tree, root / "perf" / "init");
     }
 
 }
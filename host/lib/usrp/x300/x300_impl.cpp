@@ -22,6 +22,7 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/asio.hpp>
 #include "apply_corrections.hpp"
+#include "init_profiler.hpp"
 #include <uhd/utils/static.hpp>
 #include <uhd/utils/msg.hpp>
 #include <uhd/utils/images.hpp>
@@ -372,6 +373,8 @@ void x300_impl::setup_mb(const size_t mb_i, const uhd::device_addr_t &dev_addr)
 {
     const fs_path mb_path = "/mboards/"+boost::lexical_cast<std::string>(mb_i);
     mboard_members_t &mb = _mb[mb_i];
+    init_profiler::sptr init_perf = init_profiler::make("x300_impl");
+    init_span span("transport_init");
 
     mb.addr = dev_addr.has_key("resource") ? dev_addr["resource"] : dev_addr["addr"];
     mb.xport_path = dev_addr.has_key("resource") ? "nirio" : "eth";
@@ -419,7 +422,12 @@ void x300_impl::setup_mb(const size_t mb_i, const uhd::device_addr_t &dev_addr)
     {
         if (key.find("recv") != std::string::npos) mb.recv_args[key] = dev_addr[key];
         if (key.find("send") != std::string::npos) mb.send_args[key] = dev_addr[key];
+        //the transport type applies to both directions
+        if (key == "transport") mb.recv_args[key] = mb.send_args[key] = dev_addr[key];
     }
+    mb.io_cpus = dev_addr.get("io_cpus", "");
+    mb.io_service = dev_addr.cast<int>("io_service", 0) != 0;
+    mb.convert_cpus = dev_addr.get("convert_cpus", "");
 
     if (mb.xport_path == "eth" ) {
         /* This is an ETH connection. Figure out what the maximum supported frame
@@ -482,6 +490,7 @@ void x300_impl::setup_mb(const size_t mb_i, const uhd::device_addr_t &dev_addr)
     }
 
     //create basic communication
+    span.next("basic_comm");
     UHD_MSG(status) << "Setup basic communication..." << std::endl;
     if (mb.xport_path == "nirio") {
         boost::mutex::scoped_lock(pcie_zpu_iface_registry_mutex);
@@ -509,6 +518,7 @@ void x300_impl::setup_mb(const size_t mb_i, const uhd::device_addr_t &dev_addr)
     }
 
     //check compat -- good place to do after conditional loading
+    span.next("compat_check");
     this->check_fw_compat(mb_path, mb.zpu_ctrl);
     this->check_fpga_compat(mb_path, mb.zpu_ctrl);
 
@@ -546,6 +556,7 @@ void x300_impl::setup_mb(const size_t mb_i, const uhd::device_addr_t &dev_addr)
     ////////////////////////////////////////////////////////////////////
     // setup the mboard eeprom
     ////////////////////////////////////////////////////////////////////
+    span.next("mb_eeprom");
     UHD_MSG(status) << "Loading values from EEPROM..." << std::endl;
     i2c_iface::sptr eeprom16 = mb.zpu_i2c->eeprom16();
     if (dev_addr.has_key("blank_eeprom"))
@@ -595,6 +606,7 @@ void x300_impl::setup_mb(const size_t mb_i, const uhd::device_addr_t &dev_addr)
     ////////////////////////////////////////////////////////////////////
     // read dboard eeproms
     ////////////////////////////////////////////////////////////////////
+    span.next("db_eeproms");
     for (size_t i = 0; i < 8; i++)
     {
         if (i == 0 or i == 2) continue; //not used
@@ -604,6 +616,7 @@ void x300_impl::setup_mb(const size_t mb_i, const uhd::device_addr_t &dev_addr)
     ////////////////////////////////////////////////////////////////////
     // create clock control objects
     ////////////////////////////////////////////////////////////////////
+    span.next("clock_init");
     UHD_MSG(status) << "Setup RF frontend clocking..." << std::endl;
 
     mb.hw_rev = 0;
@@ -663,6 +676,7 @@ void x300_impl::setup_mb(const size_t mb_i, const uhd::device_addr_t &dev_addr)
     ////////////////////////////////////////////////////////////////////
     // Create the GPSDO control
     ////////////////////////////////////////////////////////////////////
+    span.next("gpsdo");
     static const boost::uint32_t dont_look_for_gpsdo = 0x1234abcdul;
 
     //otherwise if not disabled, look for the internal GPSDO
@@ -694,6 +708,7 @@ void x300_impl::setup_mb(const size_t mb_i, const uhd::device_addr_t &dev_addr)
     ////////////////////////////////////////////////////////////////////
     //clear router?
     ////////////////////////////////////////////////////////////////////
+    span.next("router_clear");
     for (size_t i = 0; i < 512; i++) {
         mb.zpu_ctrl->poke32(SR_ADDR(SETXB_BASE, i), 0);
     }
@@ -701,6 +716,7 @@ void x300_impl::setup_mb(const size_t mb_i, const uhd::device_addr_t &dev_addr)
     ////////////////////////////////////////////////////////////////////
     // setup radios
     ////////////////////////////////////////////////////////////////////
+    span.next("radio_init");
     UHD_MSG(status) << "Initialize Radio control..." << std::endl;
     this->setup_radio(mb_i, "A");
     this->setup_radio(mb_i, "B");
@@ -708,6 +724,7 @@ void x300_impl::setup_mb(const size_t mb_i, const uhd::device_addr_t &dev_addr)
     ////////////////////////////////////////////////////////////////////
     // front panel gpio
     ////////////////////////////////////////////////////////////////////
+    span.next("property_init");
     mb.fp_gpio = gpio_core_200::make(mb.radio_perifs[0].ctrl, TOREG(SR_FP_GPIO), RB32_FP_GPIO);
     const std::vector<std::string> GPIO_ATTRS = boost::assign::list_of("CTRL")("DDR")("OUT")("ATR_0X")("ATR_RX")("ATR_TX")("ATR_XX");
     BOOST_FOREACH(const std::string &attr, GPIO_ATTRS)
@@ -808,6 +825,7 @@ void x300_impl::setup_mb(const size_t mb_i, const uhd::device_addr_t &dev_addr)
     _tree->access<subdev_spec_t>(mb_path / "rx_subdev_spec").set(rx_fe_spec);
     _tree->access<subdev_spec_t>(mb_path / "tx_subdev_spec").set(tx_fe_spec);
 
+    span.next("ref_init");
     UHD_MSG(status) << "Initializing clock and PPS references..." << std::endl;
     try {
         //First, try external source
@@ -846,6 +864,9 @@ void x300_impl::setup_mb(const size_t mb_i, const uhd::device_addr_t &dev_addr)
             UHD_MSG(status) << "References initialized to internal sources" << std::endl;
         }
     }
+
+    span.end();
+    init_perf->finish(_tree, mb_path / "perf" / "init");
 }
 
 x300_impl::~x300_impl(void)
@@ -890,6 +911,8 @@ void x300_impl::setup_radio(const size_t mb_i, const std::string &slot_name)
     mboard_members_t &mb = _mb[mb_i];
     const size_t radio_index = mb.get_radio_index(slot_name);
     radio_perifs_t &perif = mb.radio_perifs[radio_index];
+    init_span radio_span("setup_radio_" + slot_name);
+    init_span span("radio_ctrl");
 
     ////////////////////////////////////////////////////////////////////
     // radio control
@@ -912,10 +935,15 @@ void x300_impl::setup_radio(const size_t mb_i, const std::string &slot_name)
         .subscribe(boost::bind(&radio_ctrl_core_3000::set_time, perif.ctrl, _1));
     _tree->access<double>(mb_path / "tick_rate")
         .subscribe(boost::bind(&radio_ctrl_core_3000::set_tick_rate, perif.ctrl, _1));
+    _tree->create<size_t>(mb_path / "time" / "cmd_queue" / slot_name / "depth")
+        .publish(boost::bind(&radio_ctrl_core_3000::get_num_outstanding, perif.ctrl));
+    _tree->create<size_t>(mb_path / "time" / "cmd_queue" / slot_name / "capacity")
+        .publish(boost::bind(&radio_ctrl_core_3000::get_max_outstanding, perif.ctrl));
 
     ////////////////////////////////////////////////////////////////
     // ADC self test
     ////////////////////////////////////////////////////////////////
+    span.next("adc_self_test");
     perif.adc->set_test_word("ones", "ones"); check_adc(perif.ctrl, 0xfffcfffc);
     perif.adc->set_test_word("zeros", "zeros"); check_adc(perif.ctrl, 0x00000000);
     perif.adc->set_test_word("ones", "zeros"); check_adc(perif.ctrl, 0xfffc0000);
@@ -935,6 +963,7 @@ void x300_impl::setup_radio(const size_t mb_i, const std::string &slot_name)
     ////////////////////////////////////////////////////////////////
     // Sync DAC's for MIMO
     ////////////////////////////////////////////////////////////////
+    span.end();
     UHD_MSG(status) << "Sync DAC's." << std::endl;
     perif.dac->arm_dac_sync();               // Put DAC into data Sync mode
     perif.ctrl->poke32(TOREG(SR_DACSYNC), 0x1);  // Arm FRAMEP/N sync pulse
@@ -981,7 +1010,7 @@ void x300_impl::setup_radio(const size_t mb_i, const std::string &slot_name)
     ////////////////////////////////////////////////////////////////////
     // create rx dsp control objects
     ////////////////////////////////////////////////////////////////////
-    perif.framer = rx_vita_core_3000::make(perif.ctrl, TOREG(SR_RX_CTRL));
+    perif.framer = rx_vita_core_3000::make(perif.ctrl, TOREG(SR_RX_CTRL), perif.ctrl->get_untimed_iface());
     perif.ddc = rx_dsp_core_3000::make(perif.ctrl, TOREG(SR_RX_DSP));
     perif.ddc->set_link_rate(10e9/8); //whatever
     _tree->access<double>(mb_path / "tick_rate")
@@ -196,6 +196,9 @@ private:
         int router_dst_here;
         uhd::device_addr_t send_args;
         uhd::device_addr_t recv_args;
+        std::string io_cpus; //CPU set of the async message threads
+        bool io_service; //receive the data in the I/O service thread
+        std::string convert_cpus; //CPU set of the streamer converter threads
         bool if_pkt_is_big_endian;
         uhd::niusrprio::niusrprio_session::sptr  rio_fpga_interface;
 
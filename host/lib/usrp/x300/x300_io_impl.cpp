@@ -20,11 +20,12 @@
 #include "validate_subdev_spec.hpp"
 #include "../../transport/super_recv_packet_handler.hpp"
 #include "../../transport/super_send_packet_handler.hpp"
+#include "../../transport/async_reactor.hpp"
+#include "../../transport/io_service.hpp"
 #include <uhd/transport/nirio_zero_copy.hpp>
 #include "async_packet_handler.hpp"
 #include <uhd/transport/bounded_buffer.hpp>
 #include <boost/bind.hpp>
-#include <uhd/utils/tasks.hpp>
 #include <uhd/utils/log.hpp>
 #include <boost/foreach.hpp>
 #include <boost/make_shared.hpp>
@@ -176,7 +177,7 @@ static size_t get_rx_flow_control_window(size_t frame_size, size_t sw_buff_size,
     return window_in_pkts;
 }
 
-static void handle_rx_flowctrl(const boost::uint32_t sid, zero_copy_if::sptr xport, bool big_endian, boost::shared_ptr<boost::uint32_t> seq32_state, const size_t last_seq)
+static void handle_rx_flowctrl(const boost::uint32_t sid, const zero_copy_if::sptr &xport, bool big_endian, const boost::shared_ptr<boost::uint32_t> &seq32_state, const size_t last_seq)
 {
     managed_send_buffer::sptr buff = xport->get_send_buff(0.0);
     if (not buff)
@@ -230,20 +231,26 @@ struct x300_tx_fc_guts_t
     x300_tx_fc_guts_t(void):
         stream_channel(0),
         device_channel(0),
-        last_seq_out(0),
-        last_seq_ack(0),
-        seq_queue(1){}
+        last_seq_out(0){}
     size_t stream_channel;
     size_t device_channel;
     size_t last_seq_out;
-    size_t last_seq_ack;
-    bounded_buffer<size_t> seq_queue;
+    //credit: the last sequence number consumed by the radio
+    atomic_uint32_t last_seq_ack;
+    //one reader of the async transport at a time, claimed with a cas:
+    //the sender takes it when it runs out of credit
+    atomic_uint32_t xport_claimed;
+    atomic_uint32_t sender_waiting;
     boost::shared_ptr<x300_impl::async_md_type> async_queue;
     boost::shared_ptr<x300_impl::async_md_type> old_async_queue;
+    sph::stream_stats_counters::sptr stats;
 };
 
 #define X300_ASYNC_EVENT_CODE_FLOW_CTRL 0
 
+//how long the async handler holds the transport while no message arrives
+static const double X300_TX_ASYNC_POLL_TIMEOUT = 0.01; //seconds
+
 static size_t get_tx_flow_control_window(size_t frame_size, const device_addr_t& tx_args)
 {
     double hw_buff_size = tx_args.cast<double>("send_buff_size", X300_TX_HW_BUFF_SIZE);
@@ -254,11 +261,8 @@ static size_t get_tx_flow_control_window(size_t frame_size, const device_addr_t&
     return window_in_pkts;
 }
 
-static void handle_tx_async_msgs(boost::shared_ptr<x300_tx_fc_guts_t> guts, zero_copy_if::sptr xport, bool big_endian, x300_clock_ctrl::sptr clock)
+static void handle_tx_async_msg(const boost::shared_ptr<x300_tx_fc_guts_t> &guts, const managed_recv_buffer::sptr &buff, bool big_endian, const x300_clock_ctrl::sptr &clock)
 {
-    managed_recv_buffer::sptr buff = xport->get_recv_buff();
-    if (not buff) return;
-
     //extract packet info
     vrt::if_packet_info_t if_packet_info;
     if_packet_info.num_packet_words32 = buff->size()/sizeof(boost::uint32_t);
@@ -292,12 +296,12 @@ static void handle_tx_async_msgs(boost::shared_ptr<x300_tx_fc_guts_t> guts, zero
         clock->get_master_clock_rate(), guts->stream_channel);
 
     //The FC response and the burst ack are two indicators that the radio
-    //consumed packets. Use them to update the FC metadata
+    //consumed packets. Use them to update the FC credit
     if (metadata.event_code == X300_ASYNC_EVENT_CODE_FLOW_CTRL or
         metadata.event_code == async_metadata_t::EVENT_CODE_BURST_ACK
     ) {
-        const size_t seq = metadata.user_payload[0];
-        guts->seq_queue.push_with_pop_on_full(seq);
+        guts->last_seq_ack.write(metadata.user_payload[0]);
+        guts->stats->tx_acks.acked(metadata.user_payload[0]);
     }
 
     //FC responses don't propagate up to the user so filter them here
@@ -306,23 +310,68 @@ static void handle_tx_async_msgs(boost::shared_ptr<x300_tx_fc_guts_t> guts, zero
         metadata.channel = guts->device_channel;
         guts->old_async_queue->push_with_pop_on_full(metadata);
         standard_async_msg_prints(metadata);
+        guts->stats->count_async_msg(metadata);
     }
 }
 
+static bool handle_tx_async_msgs(const boost::shared_ptr<x300_tx_fc_guts_t> &guts, const zero_copy_if::sptr &xport, bool big_endian, const x300_clock_ctrl::sptr &clock, const double timeout)
+{
+    //the sender is out of credit and reads the transport itself
+    if (guts->sender_waiting.read() != 0 or guts->xport_claimed.cas(1, 0) != 0)
+    {
+        return false;
+    }
+
+    managed_recv_buffer::sptr buff = xport->get_recv_buff(std::min(timeout, X300_TX_ASYNC_POLL_TIMEOUT));
+    if (buff) handle_tx_async_msg(guts, buff, big_endian, clock);
+    buff.reset();
+    guts->xport_claimed.write(0);
+    return true;
+}
+
+static UHD_INLINE bool x300_tx_has_credit(boost::shared_ptr<x300_tx_fc_guts_t> guts, size_t fc_pkt_window)
+{
+    const size_t delta = (guts->last_seq_out & 0xfff) - (guts->last_seq_ack.read() & 0xfff);
+    return (delta & 0xfff) <= fc_pkt_window;
+}
+
 static managed_send_buffer::sptr get_tx_buff_with_flowctrl(
-    task::sptr /*holds ref*/,
-    boost::shared_ptr<x300_tx_fc_guts_t> guts,
-    zero_copy_if::sptr xport,
+    const async_reactor::registration::sptr &/*holds ref*/,
+    const boost::shared_ptr<x300_tx_fc_guts_t> &guts,
+    const zero_copy_if::sptr &xport,
+    const zero_copy_if::sptr &async_xport,
+    bool big_endian,
+    const x300_clock_ctrl::sptr &clock,
     size_t fc_pkt_window,
     const double timeout
 ){
-    while (true)
+    //out of credit: handle the flow control responses in this thread
+    if (not x300_tx_has_credit(guts, fc_pkt_window))
     {
-        const size_t delta = (guts->last_seq_out & 0xfff) - (guts->last_seq_ack & 0xfff);
-        if ((delta & 0xfff) <= fc_pkt_window) break;
+        guts->stats->fc_stalls.inc();
+        guts->sender_waiting.write(1);
+        const time_spec_t exit_time = time_spec_t::get_system_time() + time_spec_t(timeout);
+        while (not x300_tx_has_credit(guts, fc_pkt_window))
+        {
+            const double remaining = (exit_time - time_spec_t::get_system_time()).get_real_secs();
+            if (remaining < 0.0)
+            {
+                guts->sender_waiting.write(0);
+                return managed_send_buffer::sptr(); //timeout waiting for flow control
+            }
 
-        const bool ok = guts->seq_queue.pop_with_timed_wait(guts->last_seq_ack, timeout);
-        if (not ok) return managed_send_buffer::sptr(); //timeout waiting for flow control
+            //the async handler may hold the transport for one poll, spin on the credit
+            if (guts->xport_claimed.cas(1, 0) != 0)
+            {
+                boost::this_thread::yield();
+                continue;
+            }
+            managed_recv_buffer::sptr buff = async_xport->get_recv_buff(remaining);
+            if (buff) handle_tx_async_msg(guts, buff, big_endian, clock);
+            buff.reset();
+            guts->xport_claimed.write(0);
+        }
+        guts->sender_waiting.write(0);
     }
 
     managed_send_buffer::sptr buff = xport->get_send_buff(timeout);
@@ -407,6 +456,7 @@ rx_streamer::sptr x300_impl::get_rx_stream(const uhd::stream_args_t &args_)
         UHD_LOG << "creating rx stream " << device_addr.to_string() << std::endl;
         both_xports_t xport = this->make_transport(mb_index, dest, X300_RADIO_DEST_PREFIX_RX, device_addr, data_sid);
         UHD_LOG << boost::format("data_sid = 0x%08x, actual recv_buff_size = %d\n") % data_sid % xport.recv_buff_size << std::endl;
+        if (mb.io_service) xport.recv = io_service::get("x300:" + mb.addr, mb.io_cpus)->attach(xport.recv);
 
 	// To calculate the max number of samples per packet, we assume the maximum header length
 	// to avoid fragmentation should the entire header be used.
@@ -416,6 +466,7 @@ rx_streamer::sptr x300_impl::get_rx_stream(const uhd::stream_args_t &args_)
 
         //make the new streamer given the samples per packet
         if (not my_streamer) my_streamer = boost::make_shared<sph::recv_packet_streamer>(spp);
+        my_streamer->set_convert_cpus(mb.convert_cpus);
         my_streamer->resize(args.channels.size());
 
         //init some streamer stuff
@@ -472,6 +523,18 @@ rx_streamer::sptr x300_impl::get_rx_stream(const uhd::stream_args_t &args_)
             fc_handle_window,
             true/*init*/
         );
+        //Give the streamer a tuner to adapt the window while streaming
+        //the window never grows past recv_buff_fullness of the socket buffer,
+        //the applier thread writes it untimed, so recv() never waits on the radio control
+        //bind requires a rx_vita_core_3000::sptr to add a streamer->framer lifetime dependency
+        if (args.args.cast<int>("fc_adapt", 1) != 0) my_streamer->set_xport_fc_tuner(
+            stream_i, boost::make_shared<sph::rx_fc_tuner>(
+                fc_window, fc_window, X300_RX_FC_REQUEST_FREQ,
+                boost::bind(&sph::rx_fc_window_applier::set_window, boost::make_shared<sph::rx_fc_window_applier>(
+                    boost::bind(&rx_vita_core_3000::set_flow_control_window, perif.framer, _1)
+                ), _1)
+            )
+        );
         //Give the streamer a functor issue stream cmd
         //bind requires a rx_vita_core_3000::sptr to add a streamer->framer lifetime dependency
         my_streamer->set_issue_stream_cmd(
@@ -579,6 +642,7 @@ tx_streamer::sptr x300_impl::get_tx_stream(const uhd::stream_args_t &args_)
 
         //make the new streamer given the samples per packet
         if (not my_streamer) my_streamer = boost::make_shared<sph::send_packet_streamer>(spp);
+        my_streamer->set_convert_cpus(mb.convert_cpus);
         my_streamer->resize(args.channels.size());
 
         std::string conv_endianness;
@@ -614,15 +678,19 @@ tx_streamer::sptr x300_impl::get_tx_stream(const uhd::stream_args_t &args_)
         guts->device_channel = chan;
         guts->async_queue = async_md;
         guts->old_async_queue = _async_md;
-        task::sptr task = task::make(boost::bind(&handle_tx_async_msgs, guts, xport.recv, mb.if_pkt_is_big_endian, mb.clock));
+        guts->stats = my_streamer->get_xport_chan_stats(stream_i);
+        guts->stats->tx_acks.set_window(fc_window);
+        async_reactor::registration::sptr async_reg = async_reactor::get(mb.io_cpus)->add(
+            xport.recv, boost::bind(&handle_tx_async_msgs, guts, xport.recv, mb.if_pkt_is_big_endian, mb.clock, _1)
+        );
 
         //Give the streamer a functor to get the send buffer
         //get_tx_buff_with_flowctrl is static so bind has no lifetime issues
         //xport.send (sptr) is required to add streamer->data-transport lifetime dependency
-        //task (sptr) is required to add  a streamer->async-handler lifetime dependency
+        //async_reg (sptr) is required to add a streamer->async-handler lifetime dependency
         my_streamer->set_xport_chan_get_buff(
             stream_i,
-            boost::bind(&get_tx_buff_with_flowctrl, task, guts, xport.send, fc_window, _1)
+            boost::bind(&get_tx_buff_with_flowctrl, async_reg, guts, xport.send, xport.recv, mb.if_pkt_is_big_endian, mb.clock, fc_window, _1)
         );
         //Give the streamer a functor handled received async messages
         my_streamer->set_async_receiver(
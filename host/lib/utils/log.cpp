@@ -15,6 +15,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include "log_queue.hpp"
 #include <uhd/utils/log.hpp>
 #include <uhd/utils/msg.hpp>
 #include <uhd/utils/static.hpp>
@@ -23,6 +24,7 @@
 #include <boost/format.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/date_time/c_local_time_adjustor.hpp>
 #ifdef BOOST_MSVC
 //whoops! https://svn.boost.org/trac/boost/ticket/5287
 //enjoy this useless dummy class instead
@@ -126,39 +128,29 @@ static std::string get_rel_file_path(const fs::path &file){
     return rel_path.string();
 }
 
-struct uhd::_log::log::impl{
-    std::ostringstream ss;
-    verbosity_t verbosity;
-};
+//! format a queued log record and write it to the file (writer thread)
+static void log_record_sink(const uhd::_log::record_header &header, const std::string &text){
+    //the log may have been disabled since the record was queued
+    if (header.type < log_rs().level) return;
 
-uhd::_log::log::log(
-    const verbosity_t verbosity,
-    const std::string &file,
-    const unsigned int line,
-    const std::string &function
-){
-    _impl = UHD_PIMPL_MAKE(impl, ());
-    _impl->verbosity = verbosity;
-    const std::string time = pt::to_simple_string(pt::microsec_clock::local_time());
-    const std::string header1 = str(boost::format("-- %s - level %d") % time % int(verbosity));
-    const std::string header2 = str(boost::format("-- %s") % function).substr(0, 80);
-    const std::string header3 = str(boost::format("-- %s:%u") % get_rel_file_path(file) % line);
+    const pt::ptime local_time = boost::date_time::c_local_adjustor<pt::ptime>::utc_to_local(header.time);
+    const std::string time = pt::to_simple_string(local_time);
+    const std::string header1 = str(boost::format("-- %s - level %d") % time % header.type);
+    const std::string header2 = str(boost::format("-- %s") % header.function).substr(0, 80);
+    const std::string header3 = str(boost::format("-- %s:%u") % get_rel_file_path(header.file) % header.line);
     const std::string border = std::string(std::max(std::max(header1.size(), header2.size()), header3.size()), '-');
-    _impl->ss
+    std::ostringstream ss;
+    ss
         << std::endl
         << border << std::endl
         << header1 << std::endl
         << header2 << std::endl
         << header3 << std::endl
         << border << std::endl
+        << text
     ;
-}
-
-uhd::_log::log::~log(void){
-    if (_impl->verbosity < log_rs().level) return;
-    _impl->ss << std::endl;
     try{
-        log_rs().log_to_file(_impl->ss.str());
+        log_rs().log_to_file(ss.str());
     }
     catch(const std::exception &e){
         /*!
@@ -167,7 +159,7 @@ uhd::_log::log::~log(void){
          * This is because the message facility will call into the logging facility.
          * Therefore we must disable the logger (level = never) before messaging.
          */
-        log_rs().level = never;
+        log_rs().level = uhd::_log::never;
         UHD_MSG(error)
             << "Logging failed: " << e.what() << std::endl
             << "Logging has been disabled for this process" << std::endl
@@ -175,6 +167,40 @@ uhd::_log::log::~log(void){
     }
 }
 
+/*!
+ * The caller only fills in the binary header and the text.
+ * The time, function, and file are formatted by the writer thread.
+ * A record below the log level gets the null stream.
+ */
+uhd::_log::log::log(
+    const verbosity_t verbosity,
+    const char *file,
+    const unsigned int line,
+    const char *function
+){
+    _buff = acquire_record_buffer();
+    if (verbosity < log_rs().level){
+        _buff->header.sink = NULL;
+        return;
+    }
+    _buff->reset();
+    _buff->header.sink = &log_record_sink;
+    _buff->header.type = verbosity;
+    _buff->header.file = file;
+    _buff->header.line = line;
+    _buff->header.function = function;
+    _buff->header.time = pt::microsec_clock::universal_time();
+}
+
+uhd::_log::log::~log(void){
+    if (_buff->header.sink != NULL){
+        _buff->stream() << std::endl;
+        queue_record(_buff);
+    }
+    release_record_buffer(_buff);
+}
+
 std::ostream & uhd::_log::log::operator()(void){
-    return _impl->ss;
+    if (_buff->header.sink == NULL) return _buff->null_stream();
+    return _buff->stream();
 }
@@ -0,0 +1,226 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "log_queue.hpp"
+#include <uhd/utils/log.hpp>
+#include <uhd/utils/atomic.hpp>
+#include <uhd/utils/tasks.hpp>
+#include <uhd/utils/static.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/format.hpp>
+#include <boost/bind.hpp>
+#include <cstring>
+
+using namespace uhd;
+using namespace uhd::_log;
+
+static const size_t RECORD_RING_SIZE = 1024; //a power of two
+static const double WRITER_POLL_PERIOD = 0.001; //secs
+static const size_t WRITER_POLLS_BEFORE_IDLE = 10;
+static const double WRITER_IDLE_TIMEOUT = 0.1; //secs
+
+/***********************************************************************
+ * Record buffer
+ **********************************************************************/
+record_buffer::record_buffer(void):
+    _busy(false), _per_thread(false), _os(this), _null_os(NULL)
+{
+    this->reset();
+}
+
+void record_buffer::reset(void){
+    this->setp(_inline, _inline + INLINE_SIZE);
+    _spill.clear();
+    _os.clear();
+    _os.flags(std::ios_base::skipws | std::ios_base::dec);
+    _os.fill(' ');
+    _os.precision(6);
+    _os.width(0);
+}
+
+record_buffer::int_type record_buffer::overflow(int_type ch){
+    _spill.append(this->pbase(), this->pptr());
+    this->setp(_inline, _inline + INLINE_SIZE);
+    if (not traits_type::eq_int_type(ch, traits_type::eof())){
+        _spill.push_back(traits_type::to_char_type(ch));
+    }
+    return traits_type::not_eof(ch);
+}
+
+typedef boost::thread_specific_ptr<record_buffer> thread_buffer_type;
+UHD_SINGLETON_FCN(thread_buffer_type, get_thread_buffer);
+
+record_buffer *uhd::_log::acquire_record_buffer(void){
+    thread_buffer_type &thread_buffer = get_thread_buffer();
+    record_buffer *buff = thread_buffer.get();
+    if (buff == NULL){
+        buff = new record_buffer();
+        buff->_per_thread = true;
+        thread_buffer.reset(buff);
+    }
+    if (buff->_busy) buff = new record_buffer();
+    buff->_busy = true;
+    return buff;
+}
+
+void uhd::_log::release_record_buffer(record_buffer *buff){
+    if (buff->_per_thread) buff->_busy = false;
+    else delete buff;
+}
+
+/***********************************************************************
+ * Record queue:
+ * A bounded multi-producer, single-consumer ring.
+ * Every slot has a sequence number: a producer claims the slot at the
+ * tail when its sequence equals the tail, fills it, and publishes it
+ * by setting the sequence to the tail + 1. The writer thread consumes
+ * the slot at the head when its sequence equals the head + 1,
+ * and frees it by setting the sequence to the head + the ring size.
+ **********************************************************************/
+class record_queue : boost::noncopyable{
+public:
+    record_queue(void):
+        _slots(new slot_type[RECORD_RING_SIZE]),
+        _head(0), _num_reported_drops(0), _num_empty_polls(0)
+    {
+        for (size_t i = 0; i < RECORD_RING_SIZE; i++){
+            _slots[i].seq.write(boost::uint32_t(i));
+        }
+        _writer_task = task::make(boost::bind(&record_queue::writer_task, this));
+    }
+
+    ~record_queue(void){
+        //write whatever is left at exit
+        _writer_task.reset();
+        while (this->pop()){}
+    }
+
+    void push(const record_buffer *buff){
+        boost::uint32_t pos = _tail.read();
+        while (true){
+            const boost::int32_t diff = boost::int32_t(_slots[pos % RECORD_RING_SIZE].seq.read() - pos);
+            if (diff == 0){
+                const boost::uint32_t old = _tail.cas(pos + 1, pos);
+                if (old == pos) break;
+                pos = old;
+            }
+            else if (diff < 0){
+                _num_drops.inc();
+                return;
+            }
+            else pos = _tail.read();
+        }
+
+        slot_type &slot = _slots[pos % RECORD_RING_SIZE];
+        slot.header = buff->header;
+        if (buff->is_inline()){
+            slot.size = buff->inline_size();
+            std::memcpy(slot.text, buff->inline_data(), slot.size);
+            slot.spill = NULL;
+        }
+        else{
+            slot.size = 0;
+            slot.spill = new std::string(buff->str());
+        }
+        slot.seq.write(pos + 1);
+
+        //only wake the writer when it went idle
+        if (_writer_idle.read() != 0){
+            boost::mutex::scoped_lock lock(_mutex);
+            _cond.notify_one();
+        }
+    }
+
+private:
+    struct slot_type{
+        atomic_uint32_t seq;
+        record_header header;
+        size_t size;
+        std::string *spill;
+        char text[record_buffer::INLINE_SIZE];
+    };
+
+    //! Pop and write one record, false when the ring is empty
+    bool pop(void){
+        slot_type &slot = _slots[_head % RECORD_RING_SIZE];
+        if (slot.seq.read() != _head + 1) return false;
+        const record_header header = slot.header;
+        std::string text;
+        if (slot.spill == NULL) text.assign(slot.text, slot.size);
+        else{
+            text.swap(*slot.spill);
+            delete slot.spill;
+        }
+        slot.seq.write(_head + boost::uint32_t(RECORD_RING_SIZE));
+        _head++;
+        header.sink(header, text);
+        return true;
+    }
+
+    /*!
+     * Drain the ring, then poll it for a while before going idle.
+     * While the writer polls the producers never touch the mutex,
+     * so a burst of records does not make a system call per record.
+     */
+    void writer_task(void){
+        if (this->pop()){
+            while (this->pop()){}
+            this->report_drops();
+            _num_empty_polls = 0;
+            return;
+        }
+        if (++_num_empty_polls < WRITER_POLLS_BEFORE_IDLE){
+            boost::this_thread::sleep(boost::posix_time::microseconds(long(WRITER_POLL_PERIOD*1e6)));
+            return;
+        }
+        boost::mutex::scoped_lock lock(_mutex);
+        _writer_idle.write(1);
+        //check again, a producer may have missed the idle flag
+        if (_slots[_head % RECORD_RING_SIZE].seq.read() != _head + 1){
+            _cond.timed_wait(lock, boost::posix_time::microseconds(long(WRITER_IDLE_TIMEOUT*1e6)));
+        }
+        _writer_idle.write(0);
+    }
+
+    void report_drops(void){
+        const boost::uint32_t num_drops = _num_drops.read();
+        if (num_drops == _num_reported_drops) return;
+        UHD_LOGV(rarely) << boost::format(
+            "The record queue was full, %u log and message records were dropped"
+        ) % (num_drops - _num_reported_drops) << std::endl;
+        _num_reported_drops = num_drops;
+    }
+
+    boost::scoped_array<slot_type> _slots;
+    atomic_uint32_t _tail, _num_drops, _writer_idle;
+
+    //state of the writer thread
+    boost::uint32_t _head, _num_reported_drops;
+    size_t _num_empty_polls;
+    boost::mutex _mutex;
+    boost::condition_variable _cond;
+    task::sptr _writer_task;
+};
+
+UHD_SINGLETON_FCN(record_queue, get_record_queue);
+
+void uhd::_log::queue_record(const record_buffer *buff){
+    get_record_queue().push(buff);
+}
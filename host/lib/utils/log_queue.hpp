@@ -0,0 +1,130 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_UTILS_LOG_QUEUE_HPP
+#define INCLUDED_LIBUHD_UTILS_LOG_QUEUE_HPP
+
+#include <uhd/config.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/utility.hpp>
+#include <streambuf>
+#include <ostream>
+#include <string>
+
+namespace uhd{ namespace _log{
+
+struct record_header;
+
+/*!
+ * A record sink formats and writes a record.
+ * It is called by the writer thread, one record at a time.
+ */
+typedef void (*record_sink_t)(const record_header &header, const std::string &text);
+
+/*!
+ * The binary header of a record.
+ * The caller fills in the fields, the sink formats them.
+ * The strings are literals (__FILE__ and the function name),
+ * so only the pointers are kept.
+ */
+struct record_header{
+    record_sink_t sink;
+    int type; //a message type or a log verbosity
+    const char *file;
+    unsigned int line;
+    const char *function;
+    boost::posix_time::ptime time; //UTC
+};
+
+/***********************************************************************
+ * Record buffer:
+ * A stream that composes the text of one record.
+ * The text goes into a fixed array; only text that does not fit
+ * spills into a string. Every thread reuses its own buffer,
+ * so composing a short record does not allocate memory.
+ **********************************************************************/
+class record_buffer : public std::streambuf, boost::noncopyable{
+public:
+    static const size_t INLINE_SIZE = 192;
+
+    record_header header;
+
+    record_buffer(void);
+
+    //! Clear the text and the format state of the stream
+    void reset(void);
+
+    std::ostream &stream(void){
+        return _os;
+    }
+
+    //! The stream for a disabled record, it drops everything
+    std::ostream &null_stream(void){
+        return _null_os;
+    }
+
+    //! The text is in the inline array only
+    bool is_inline(void) const{
+        return _spill.empty();
+    }
+
+    const char *inline_data(void) const{
+        return this->pbase();
+    }
+
+    size_t inline_size(void) const{
+        return this->pptr() - this->pbase();
+    }
+
+    //! The whole text, allocates when the text is not inline
+    std::string str(void) const{
+        return _spill + std::string(this->pbase(), this->pptr());
+    }
+
+protected:
+    int_type overflow(int_type ch);
+
+private:
+    friend record_buffer *acquire_record_buffer(void);
+    friend void release_record_buffer(record_buffer *);
+    bool _busy, _per_thread;
+    char _inline[INLINE_SIZE];
+    std::string _spill;
+    std::ostream _os, _null_os;
+};
+
+/*!
+ * Get a buffer to compose a record.
+ * This is the buffer of the calling thread, or a new buffer when
+ * the buffer of the thread is already composing (a nested message).
+ */
+record_buffer *acquire_record_buffer(void);
+
+//! Return a buffer from acquire_record_buffer()
+void release_record_buffer(record_buffer *buff);
+
+/*!
+ * Queue the record in the buffer for the writer thread.
+ * The queue is a lock-free ring shared by all threads.
+ * This call never blocks: when the ring is full the record is dropped,
+ * and the writer reports the number of dropped records.
+ */
+void queue_record(const record_buffer *buff);
+
+}} //namespace uhd::_log
+
+#endif /* INCLUDED_LIBUHD_UTILS_LOG_QUEUE_HPP */
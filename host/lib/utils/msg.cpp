@@ -15,6 +15,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include "log_queue.hpp"
 #include <uhd/utils/msg.hpp>
 #include <uhd/utils/log.hpp>
 #include <uhd/utils/static.hpp>
@@ -108,21 +109,32 @@ UHD_STATIC_BLOCK(msg_register_default_handler){
 /***********************************************************************
  * The message object implementation
  **********************************************************************/
-struct uhd::msg::_msg::impl{
-    std::ostringstream ss;
-    type_t type;
-};
+//! handle a queued fastpath message (writer thread)
+static void msg_record_sink(const uhd::_log::record_header &header, const std::string &text){
+    boost::mutex::scoped_lock lock(msg_rs().mutex);
+    msg_rs().handler(uhd::msg::type_t(header.type), text);
+}
 
 uhd::msg::_msg::_msg(const type_t type){
-    _impl = UHD_PIMPL_MAKE(impl, ());
-    _impl->type = type;
+    _buff = uhd::_log::acquire_record_buffer();
+    _buff->reset();
+    _buff->header.sink = &msg_record_sink;
+    _buff->header.type = type;
 }
 
 uhd::msg::_msg::~_msg(void){
-    boost::mutex::scoped_lock lock(msg_rs().mutex);
-    msg_rs().handler(_impl->type, _impl->ss.str());
+    //fastpath messages come from the streaming threads, never block them
+    if (_buff->header.type == fastpath){
+        uhd::_log::queue_record(_buff);
+    }
+    else{
+        const std::string text = _buff->str();
+        boost::mutex::scoped_lock lock(msg_rs().mutex);
+        msg_rs().handler(type_t(_buff->header.type), text);
+    }
+    uhd::_log::release_record_buffer(_buff);
 }
 
 std::ostream & uhd::msg::_msg::operator()(void){
-    return _impl->ss;
+    return _buff->stream();
 }
@@ -18,6 +18,7 @@
 #include <uhd/utils/tasks.hpp>
 #include <uhd/utils/msg_task.hpp>
 #include <uhd/utils/msg.hpp>
+#include <uhd/utils/thread_priority.hpp>
 #include <boost/thread/thread.hpp>
 #include <boost/thread/barrier.hpp>
 #include <exception>
@@ -29,10 +30,10 @@ using namespace uhd;
 class task_impl : public task{
 public:
 
-    task_impl(const task_fcn_type &task_fcn):
+    task_impl(const task_fcn_type &task_fcn, const std::string &cpus = ""):
         _spawn_barrier(2)
     {
-        _thread_group.create_thread(boost::bind(&task_impl::task_loop, this, task_fcn));
+        _thread_group.create_thread(boost::bind(&task_impl::task_loop, this, task_fcn, cpus));
         _spawn_barrier.wait();
     }
 
@@ -44,7 +45,8 @@ public:
 
 private:
 
-    void task_loop(const task_fcn_type &task_fcn){
+    void task_loop(const task_fcn_type &task_fcn, const std::string &cpus){
+        if (not cpus.empty()) set_thread_affinity_safe(cpus);
         _running = true;
         _spawn_barrier.wait();
 
@@ -83,6 +85,10 @@ task::sptr task::make(const task_fcn_type &task_fcn){
     return task::sptr(new task_impl(task_fcn));
 }
 
+task::sptr task::make(const task_fcn_type &task_fcn, const std::string &cpus){
+    return task::sptr(new task_impl(task_fcn, cpus));
+}
+
 /*
  * During shutdown pointers to queues for radio_ctrl_core might not be available anymore.
  * msg_task_impl provides a dump_queue for such messages.
@@ -92,10 +98,10 @@ task::sptr task::make(const task_fcn_type &task_fcn){
 class msg_task_impl : public msg_task{
 public:
 
-    msg_task_impl(const task_fcn_type &task_fcn):
+    msg_task_impl(const task_fcn_type &task_fcn, const std::string &cpus = ""):
         _spawn_barrier(2)
     {
-        _thread_group.create_thread(boost::bind(&msg_task_impl::task_loop, this, task_fcn));
+        _thread_group.create_thread(boost::bind(&msg_task_impl::task_loop, this, task_fcn, cpus));
         _spawn_barrier.wait();
     }
 
@@ -127,7 +133,8 @@ public:
 
 private:
 
-    void task_loop(const task_fcn_type &task_fcn){
+    void task_loop(const task_fcn_type &task_fcn, const std::string &cpus){
+        if (not cpus.empty()) set_thread_affinity_safe(cpus);
         _running = true;
         _spawn_barrier.wait();
 
@@ -179,3 +186,7 @@ private:
 msg_task::sptr msg_task::make(const task_fcn_type &task_fcn){
     return msg_task::sptr(new msg_task_impl(task_fcn));
 }
+
+msg_task::sptr msg_task::make(const task_fcn_type &task_fcn, const std::string &cpus){
+    return msg_task::sptr(new msg_task_impl(task_fcn, cpus));
+}
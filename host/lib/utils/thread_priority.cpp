@@ -19,7 +19,12 @@
 #include <uhd/utils/msg.hpp>
 #include <uhd/exception.hpp>
 #include <boost/format.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/foreach.hpp>
+#include <fstream>
 #include <iostream>
+#include <vector>
 
 bool uhd::set_thread_priority_safe(float priority, bool realtime){
     try{
@@ -35,11 +40,84 @@ bool uhd::set_thread_priority_safe(float priority, bool realtime){
     }
 }
 
+bool uhd::set_thread_priority_safe(float priority, bool realtime, const std::string &cpus){
+    const bool prio_ok = set_thread_priority_safe(priority, realtime);
+    const bool cpus_ok = cpus.empty() or set_thread_affinity_safe(cpus);
+    return prio_ok and cpus_ok;
+}
+
+bool uhd::set_thread_affinity_safe(const std::string &cpus){
+    try{
+        set_thread_affinity(cpus);
+        return true;
+    }catch(const std::exception &e){
+        UHD_MSG(warning) << boost::format(
+            "Unable to set the thread affinity to CPUs \"%s\". Performance may be negatively affected.\n"
+            "%s\n"
+        ) % cpus % e.what();
+        return false;
+    }
+}
+
 static void check_priority_range(float priority){
     if (priority > +1.0 or priority < -1.0)
         throw uhd::value_error("priority out of range [-1.0, +1.0]");
 }
 
+/***********************************************************************
+ * Parse a CPU set into a list of CPU numbers
+ **********************************************************************/
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+    #include <pthread.h>
+    static const size_t MAX_NUM_CPUS = CPU_SETSIZE;
+#else
+    static const size_t MAX_NUM_CPUS = 1024;
+#endif
+
+//a numa node's cpulist uses the same syntax with comma separators
+static std::vector<size_t> get_numa_node_cpu_list(const std::string &node){
+    const std::string path = "/sys/devices/system/node/node" + node + "/cpulist";
+    std::ifstream file(path.c_str());
+    std::string line;
+    if (not std::getline(file, line)) throw uhd::value_error(
+        "cannot read the CPUs of NUMA node " + node + " from " + path
+    );
+    return uhd::parse_cpu_set(line);
+}
+
+std::vector<size_t> uhd::parse_cpu_set(const std::string &cpus){
+    std::vector<std::string> tokens;
+    boost::split(tokens, cpus, boost::is_any_of(":, \n"), boost::token_compress_on);
+
+    std::vector<size_t> cpu_list;
+    BOOST_FOREACH(const std::string &token, tokens){
+        if (token.empty()) continue;
+        try{
+            if (boost::starts_with(token, "node")){
+                BOOST_FOREACH(size_t cpu, get_numa_node_cpu_list(token.substr(4))){
+                    cpu_list.push_back(cpu);
+                }
+                continue;
+            }
+            const size_t dash = token.find('-');
+            const size_t first = boost::lexical_cast<size_t>(token.substr(0, dash));
+            const size_t last = (dash == std::string::npos)?
+                first : boost::lexical_cast<size_t>(token.substr(dash+1));
+            if (last < first) throw uhd::value_error(
+                "range \"" + token + "\" ends before it starts in CPU set \"" + cpus + "\""
+            );
+            if (last >= MAX_NUM_CPUS) throw uhd::value_error(str(boost::format(
+                "CPU %u out of range in CPU set \"%s\"") % last % cpus));
+            for (size_t cpu = first; cpu <= last; cpu++) cpu_list.push_back(cpu);
+        }
+        catch(const boost::bad_lexical_cast &){
+            throw uhd::value_error("bad token \"" + token + "\" in CPU set \"" + cpus + "\"");
+        }
+    }
+    if (cpu_list.empty()) throw uhd::value_error("empty CPU set \"" + cpus + "\"");
+    return cpu_list;
+}
+
 /***********************************************************************
  * Pthread API to set priority
  **********************************************************************/
@@ -108,3 +186,50 @@ static void check_priority_range(float priority){
     }
 
 #endif /* HAVE_THREAD_PRIO_DUMMY */
+
+/***********************************************************************
+ * Pthread API to set affinity
+ **********************************************************************/
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+    #include <pthread.h>
+
+    void uhd::set_thread_affinity(const std::string &cpus){
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        BOOST_FOREACH(size_t cpu, uhd::parse_cpu_set(cpus)){
+            if (cpu >= CPU_SETSIZE) throw uhd::value_error(str(boost::format(
+                "CPU %u out of range in CPU set \"%s\"") % cpu % cpus));
+            CPU_SET(cpu, &cpu_set);
+        }
+        int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+        if (ret != 0) throw uhd::os_error("error in pthread_setaffinity_np");
+    }
+#endif /* HAVE_PTHREAD_SETAFFINITY_NP */
+
+/***********************************************************************
+ * Windows API to set affinity
+ **********************************************************************/
+#ifdef HAVE_WIN_SETTHREADAFFINITYMASK
+    #include <windows.h>
+
+    void uhd::set_thread_affinity(const std::string &cpus){
+        DWORD_PTR mask = 0;
+        BOOST_FOREACH(size_t cpu, uhd::parse_cpu_set(cpus)){
+            if (cpu >= sizeof(mask)*8) throw uhd::value_error(str(boost::format(
+                "CPU %u out of range in CPU set \"%s\"") % cpu % cpus));
+            mask |= DWORD_PTR(1) << cpu;
+        }
+        if (SetThreadAffinityMask(GetCurrentThread(), mask) == 0)
+            throw uhd::os_error("error in SetThreadAffinityMask");
+    }
+#endif /* HAVE_WIN_SETTHREADAFFINITYMASK */
+
+/***********************************************************************
+ * Unimplemented API to set affinity
+ **********************************************************************/
+#ifdef HAVE_THREAD_AFFINITY_DUMMY
+    void uhd::set_thread_affinity(const std::string &cpus){
+        uhd::parse_cpu_set(cpus); //still report a bad CPU set
+        throw uhd::not_implemented_error("set thread affinity not implemented");
+    }
+#endif /* HAVE_THREAD_AFFINITY_DUMMY */
@@ -0,0 +1,148 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <boost/test/unit_test.hpp>
+#include "../lib/usrp/common/ad9361_ctrl.hpp"
+#include <uhd/exception.hpp>
+#include <boost/make_shared.hpp>
+#include <cstring>
+#include <cmath>
+
+/***********************************************************************
+ * Fake firmware: tunes to a 1 MHz grid, fails TX gains above 80 dB
+ **********************************************************************/
+struct fake_ad9361_iface : ad9361_ctrl_iface_type
+{
+    fake_ad9361_iface(const bool batch_support):
+        batch_support(batch_support), num_transactions(0)
+    {
+        /* NOP */
+    }
+
+    void ad9361_transact(const unsigned char in_buff[AD9361_DISPATCH_PACKET_SIZE], unsigned char out_buff[AD9361_DISPATCH_PACKET_SIZE])
+    {
+        num_transactions++;
+        std::memcpy(out_buff, in_buff, AD9361_DISPATCH_PACKET_SIZE);
+        ad9361_transaction_t *response = (ad9361_transaction_t *)out_buff;
+        error_msg.clear();
+
+        if (response->action == AD9361_ACTION_BATCH and batch_support)
+        {
+            ad9361_batch_transaction_t *batch = (ad9361_batch_transaction_t *)out_buff;
+            size_t i = 0;
+            for (; i < batch->num_actions and error_msg.empty(); i++)
+            {
+                this->dispatch(batch->items[i].action, batch->items[i].value);
+            }
+            if (not error_msg.empty()) i--;
+            batch->num_actions = i;
+            if (not error_msg.empty()) std::strcpy(response->error_msg, error_msg.c_str());
+            return;
+        }
+
+        if (response->action == AD9361_ACTION_BATCH) error_msg = "unknown action";
+        else this->dispatch(response->action, response->value.freq);
+        std::strcpy(response->error_msg, error_msg.c_str());
+    }
+
+    void dispatch(const boost::uint32_t action, boost::uint32_t value[2])
+    {
+        switch (action)
+        {
+        case AD9361_ACTION_SET_RX_FREQ:
+        case AD9361_ACTION_SET_TX_FREQ:
+            ad9361_double_pack(std::floor(ad9361_double_unpack(value)/1e6)*1e6, value);
+            return;
+        case AD9361_ACTION_SET_TX1_GAIN:
+        case AD9361_ACTION_SET_TX2_GAIN:
+            if (ad9361_double_unpack(value) > 80.0) error_msg = "gain too high";
+            return;
+        default: return;
+        }
+    }
+
+    bool batch_support;
+    size_t num_transactions;
+    std::string error_msg;
+};
+
+/***********************************************************************
+ * Queued settings return the request, the getters the result
+ **********************************************************************/
+static void check_batch(const bool batch_support, const size_t expected_transactions)
+{
+    boost::shared_ptr<fake_ad9361_iface> iface = boost::make_shared<fake_ad9361_iface>(batch_support);
+    ad9361_ctrl::sptr ctrl = ad9361_ctrl::make(iface);
+
+    //outside of a batch, the firmware result is returned
+    BOOST_CHECK_EQUAL(ctrl->tune("RX1", 2.4505e9), 2.450e9);
+    BOOST_CHECK_EQUAL(ctrl->get_freq("RX1"), 2.450e9);
+
+    ctrl->begin_batch();
+    iface->num_transactions = 0;
+    BOOST_CHECK_EQUAL(ctrl->tune("RX1", 1.0001e9), 1.0001e9);
+    BOOST_CHECK_EQUAL(ctrl->set_gain("RX1", 40.4), 40.0);
+    BOOST_CHECK_EQUAL(ctrl->tune("TX1", 9e9), 6e9);
+    BOOST_CHECK_EQUAL(ctrl->set_gain("TX1", 60.1), 60.0);
+    ctrl->set_active_chains(true, false, true, false);
+    BOOST_CHECK_EQUAL(iface->num_transactions, size_t(0));
+    BOOST_CHECK_EQUAL(ctrl->get_freq("RX1"), 1.0001e9);
+
+    ctrl->commit_batch();
+    BOOST_CHECK_EQUAL(iface->num_transactions, expected_transactions);
+    BOOST_CHECK_EQUAL(ctrl->get_freq("RX1"), 1.000e9);
+    BOOST_CHECK_EQUAL(ctrl->get_freq("RX2"), 1.000e9);
+    BOOST_CHECK_EQUAL(ctrl->get_freq("TX1"), 6e9);
+    BOOST_CHECK_EQUAL(ctrl->get_gain("RX1"), 40.4);
+    BOOST_CHECK_EQUAL(ctrl->get_gain("TX1"), 60.1);
+
+    //after the commit, settings are sent right away
+    iface->num_transactions = 0;
+    BOOST_CHECK_EQUAL(ctrl->tune("TX1", 2.4e9 + 10), 2.4e9);
+    BOOST_CHECK_EQUAL(iface->num_transactions, size_t(1));
+}
+
+BOOST_AUTO_TEST_CASE(test_ad9361_batch)
+{
+    //5 actions: a full batch of 4, then a single action
+    check_batch(true, 2);
+}
+
+BOOST_AUTO_TEST_CASE(test_ad9361_batch_fallback)
+{
+    //old firmware: one transaction per action
+    check_batch(false, 5);
+}
+
+/***********************************************************************
+ * Errors of queued settings are thrown by commit
+ **********************************************************************/
+BOOST_AUTO_TEST_CASE(test_ad9361_batch_error)
+{
+    boost::shared_ptr<fake_ad9361_iface> iface = boost::make_shared<fake_ad9361_iface>(true);
+    ad9361_ctrl::sptr ctrl = ad9361_ctrl::make(iface);
+
+    ctrl->begin_batch();
+    ctrl->tune("RX1", 1.0001e9);
+    BOOST_CHECK_EQUAL(ctrl->set_gain("TX1", 85.0), 85.0);
+    BOOST_CHECK_THROW(ctrl->commit_batch(), uhd::runtime_error);
+
+    //the batch is closed, the next setting goes out right away
+    iface->num_transactions = 0;
+    BOOST_CHECK_EQUAL(ctrl->set_gain("TX1", 20.0), 20.0);
+    BOOST_CHECK_EQUAL(iface->num_transactions, size_t(1));
+}
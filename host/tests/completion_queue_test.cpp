@@ -0,0 +1,84 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <boost/test/unit_test.hpp>
+#include "../lib/transport/completion_queue.hpp"
+#include <uhd/types/time_spec.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+#include <vector>
+
+using namespace uhd::transport;
+
+#define NUM_ITEMS 8
+
+BOOST_AUTO_TEST_CASE(test_completion_queue_order){
+    std::vector<int> items(NUM_ITEMS);
+    completion_queue<int> queue(NUM_ITEMS);
+
+    //fill and drain a few times to wrap the ring
+    for (size_t round = 0; round < 3; round++){
+        for (size_t i = 0; i < NUM_ITEMS; i++) queue.push(&items[i]);
+        BOOST_CHECK_EQUAL(queue.size(), size_t(NUM_ITEMS));
+        for (size_t i = 0; i < NUM_ITEMS; i++){
+            BOOST_CHECK(queue.pop(0.0) == &items[i]);
+        }
+        BOOST_CHECK_EQUAL(queue.size(), size_t(0));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_completion_queue_timeout){
+    completion_queue<int> queue(NUM_ITEMS);
+    BOOST_CHECK(queue.pop(0.0) == NULL);
+
+    const uhd::time_spec_t start = uhd::time_spec_t::get_system_time();
+    BOOST_CHECK(queue.pop(0.05) == NULL);
+    BOOST_CHECK((uhd::time_spec_t::get_system_time() - start).get_real_secs() >= 0.04);
+}
+
+/***********************************************************************
+ * A consumer that waits for every item must see all of them in order.
+ * A lost wakeup shows up as a pop that times out.
+ **********************************************************************/
+static void produce(completion_queue<int> *queue, std::vector<int> *items, uhd::atomic_uint32_t *num_popped){
+    for (size_t i = 0; i < items->size(); i++){
+        //keep the ring from overflowing
+        while (i - num_popped->read() >= NUM_ITEMS) boost::this_thread::yield();
+        queue->push(&(*items)[i]);
+        if (i % 7 == 0) boost::this_thread::yield();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_completion_queue_threads){
+    std::vector<int> items(100000);
+    completion_queue<int> queue(NUM_ITEMS);
+    uhd::atomic_uint32_t num_popped;
+
+    boost::thread producer(boost::bind(&produce, &queue, &items, &num_popped));
+    size_t num_errors = 0;
+    for (size_t i = 0; i < items.size(); i++){
+        int *item = queue.pop((i % 2 == 0)? 5.0 : -1.0);
+        if (item != &items[i]) num_errors++;
+        if (item == NULL){
+            num_popped.write(boost::uint32_t(items.size())); //let the producer finish
+            break;
+        }
+        num_popped.inc();
+    }
+    producer.join();
+    BOOST_CHECK_EQUAL(num_errors, size_t(0));
+}
@@ -0,0 +1,160 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <boost/test/unit_test.hpp>
+#include <uhd/device.hpp>
+#include <uhd/exception.hpp>
+#include <uhd/types/time_spec.hpp>
+#include <uhd/utils/atomic.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/lexical_cast.hpp>
+#include <fstream>
+#include <cstdlib>
+#include <cstdio>
+#include <unistd.h>
+
+/***********************************************************************
+ * Fake backends, they only answer hints with type=fake:
+ * "fast" finds the device at one address, like a unicast probe,
+ * "slow" sleeps for the slow key,
+ * "thrower" throws for the throw key
+ **********************************************************************/
+static uhd::atomic_uint32_t num_fast_calls, num_slow_calls;
+static uhd::atomic_uint32_t num_slow_running, max_slow_running;
+static uhd::device_addr_t last_fast_hint;
+static std::string fast_serial = "A";
+
+static bool is_fake(const uhd::device_addr_t &hint){
+    return hint.has_key("type") and hint["type"] == "fake";
+}
+
+static uhd::device_addrs_t find_fast(const uhd::device_addr_t &hint){
+    uhd::device_addrs_t addrs;
+    if (not is_fake(hint)) return addrs;
+    num_fast_calls.inc();
+    last_fast_hint = hint;
+    if (hint.has_key("addr") and hint["addr"] != "10.0.0.2") return addrs;
+    addrs.push_back(uhd::device_addr_t("type=fake,addr=10.0.0.2,serial=" + fast_serial));
+    return addrs;
+}
+
+static uhd::device_addrs_t find_slow(const uhd::device_addr_t &hint){
+    uhd::device_addrs_t addrs;
+    if (not is_fake(hint)) return addrs;
+    num_slow_calls.inc();
+    if (not hint.has_key("slow")) return addrs;
+
+    //like a firmware load, this cannot be interrupted
+    boost::this_thread::disable_interruption di;
+    const boost::uint32_t running = num_slow_running.inc() + 1;
+    if (running > max_slow_running.read()) max_slow_running.write(running);
+    boost::this_thread::sleep(boost::posix_time::milliseconds(long(hint.cast<double>("slow", 0.0)*1e3)));
+    num_slow_running.dec();
+    addrs.push_back(uhd::device_addr_t("type=fake,serial=B"));
+    return addrs;
+}
+
+static uhd::device_addrs_t find_thrower(const uhd::device_addr_t &hint){
+    if (is_fake(hint) and hint.has_key("throw")) throw uhd::value_error("fake discovery error");
+    return uhd::device_addrs_t();
+}
+
+static uhd::device::sptr make_fake(const uhd::device_addr_t &){
+    throw uhd::not_implemented_error("fake device");
+}
+
+static void register_fakes(void){
+    static bool registered = false;
+    if (registered) return;
+    uhd::device::register_device(&find_fast, &make_fake);
+    uhd::device::register_device(&find_slow, &make_fake);
+    uhd::device::register_device(&find_thrower, &make_fake);
+    registered = true;
+}
+
+/***********************************************************************
+ * The deadline drops a late backend, which finishes before it runs again
+ **********************************************************************/
+BOOST_AUTO_TEST_CASE(test_find_deadline){
+    register_fakes();
+    const uhd::device_addr_t hint("type=fake,slow=0.5,find_timeout=0.1");
+
+    const uhd::time_spec_t start = uhd::time_spec_t::get_system_time();
+    const uhd::device_addrs_t addrs = uhd::device::find(hint);
+    BOOST_CHECK((uhd::time_spec_t::get_system_time() - start).get_real_secs() < 0.4);
+    BOOST_REQUIRE_EQUAL(addrs.size(), size_t(1));
+    BOOST_CHECK_EQUAL(addrs[0]["serial"], "A");
+
+    //the second discovery waits for the late one
+    uhd::device::find(hint);
+    BOOST_CHECK_EQUAL(max_slow_running.read(), boost::uint32_t(1));
+}
+
+/***********************************************************************
+ * A cache hit probes only the backend that found the device
+ **********************************************************************/
+BOOST_AUTO_TEST_CASE(test_find_cache){
+    register_fakes();
+    const std::string cache_path = "/tmp/uhd_device_find_test_" + boost::lexical_cast<std::string>(::getpid());
+    std::remove(cache_path.c_str());
+    ::setenv("UHD_DISCOVERY_CACHE", cache_path.c_str(), 1);
+
+    //a miss searches every backend and stores the result under the sorted hint
+    num_fast_calls.write(0);
+    num_slow_calls.write(0);
+    BOOST_CHECK_EQUAL(uhd::device::find(uhd::device_addr_t("type=fake")).size(), size_t(1));
+    BOOST_CHECK_EQUAL(num_fast_calls.read(), boost::uint32_t(1));
+    BOOST_CHECK_EQUAL(num_slow_calls.read(), boost::uint32_t(1));
+    {
+        std::ifstream cache_file(cache_path.c_str());
+        std::string line;
+        BOOST_REQUIRE(std::getline(cache_file, line));
+        BOOST_CHECK_EQUAL(line.substr(0, line.find('\t')), "type=fake");
+    }
+
+    //a hit probes the cached address with its own backend only
+    num_fast_calls.write(0);
+    num_slow_calls.write(0);
+    const uhd::device_addrs_t addrs = uhd::device::find(uhd::device_addr_t("type=fake,find_timeout=5"));
+    BOOST_REQUIRE_EQUAL(addrs.size(), size_t(1));
+    BOOST_CHECK_EQUAL(addrs[0]["serial"], "A");
+    BOOST_CHECK_EQUAL(num_fast_calls.read(), boost::uint32_t(1));
+    BOOST_CHECK_EQUAL(num_slow_calls.read(), boost::uint32_t(0));
+    BOOST_CHECK_EQUAL(last_fast_hint["serial"], "A");
+
+    //another device at the cached address is a miss, which searches every backend
+    fast_serial = "C";
+    num_slow_calls.write(0);
+    const uhd::device_addrs_t swapped = uhd::device::find(uhd::device_addr_t("type=fake"));
+    BOOST_REQUIRE_EQUAL(swapped.size(), size_t(1));
+    BOOST_CHECK_EQUAL(swapped[0]["serial"], "C");
+    BOOST_CHECK_EQUAL(num_slow_calls.read(), boost::uint32_t(1));
+    fast_serial = "A";
+
+    ::unsetenv("UHD_DISCOVERY_CACHE");
+    std::remove(cache_path.c_str());
+}
+
+/***********************************************************************
+ * A discovery error is thrown by make and printed by find
+ **********************************************************************/
+BOOST_AUTO_TEST_CASE(test_find_error){
+    register_fakes();
+    const uhd::device_addr_t hint("type=fake,throw=1");
+    BOOST_CHECK_EQUAL(uhd::device::find(hint).size(), size_t(1));
+    BOOST_CHECK_THROW(uhd::device::make(hint), uhd::value_error);
+}
@@ -0,0 +1,70 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <boost/test/unit_test.hpp>
+#include "../lib/usrp/common/init_profiler.hpp"
+#include <uhd/property_tree.hpp>
+
+using namespace uhd;
+using namespace uhd::usrp;
+
+BOOST_AUTO_TEST_CASE(test_init_profiler_nesting){
+    property_tree::sptr tree = property_tree::make();
+    init_profiler::sptr profiler = init_profiler::make("device");
+    BOOST_CHECK(init_profiler::get_active() == profiler);
+    {
+        init_span mboard("mboard");
+        {
+            //spans without a profiler argument attach to the active one
+            init_span step("codec");
+            step.next("dboards");
+        }
+        init_span late("clock");
+    }
+    profiler->finish(tree, "/perf/init");
+    BOOST_CHECK(not init_profiler::get_active());
+
+    BOOST_CHECK(tree->exists("/perf/init/duration"));
+    BOOST_CHECK(tree->exists("/perf/init/mboard/duration"));
+    BOOST_CHECK(tree->exists("/perf/init/mboard/codec/duration"));
+    BOOST_CHECK(tree->exists("/perf/init/mboard/dboards/duration"));
+    BOOST_CHECK(tree->exists("/perf/init/mboard/clock/duration"));
+    BOOST_CHECK(tree->access<double>("/perf/init/duration").get() >=
+                tree->access<double>("/perf/init/mboard/duration").get());
+
+    //spans opened after finish record nothing
+    init_span after("after");
+    BOOST_CHECK(not tree->exists("/perf/init/after"));
+}
+
+BOOST_AUTO_TEST_CASE(test_init_profiler_names){
+    property_tree::sptr tree = property_tree::make();
+    init_profiler::sptr profiler = init_profiler::make("device");
+    profiler->begin("rx/tx");
+    profiler->end();
+    profiler->begin("rx/tx");
+    profiler->end();
+    profiler->begin("rx/tx");
+    profiler->end();
+    profiler->finish(tree, "/perf/init");
+
+    //a slash in a name does not make a level, duplicates get a suffix
+    BOOST_CHECK(tree->exists("/perf/init/rx_tx/duration"));
+    BOOST_CHECK(tree->exists("/perf/init/rx_tx_1/duration"));
+    BOOST_CHECK(tree->exists("/perf/init/rx_tx_2/duration"));
+    BOOST_CHECK(not tree->exists("/perf/init/rx"));
+}
@@ -0,0 +1,180 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <boost/test/unit_test.hpp>
+#include "../lib/transport/io_service.hpp"
+#include <uhd/utils/atomic.hpp>
+#include <boost/shared_array.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <list>
+#include <vector>
+
+using namespace uhd::transport;
+
+/***********************************************************************
+ * A dummy managed receive buffer for testing
+ **********************************************************************/
+class dummy_mrb : public managed_recv_buffer{
+public:
+    dummy_mrb(uhd::atomic_uint32_t &num_out): _num_out(num_out){
+        _num_out.inc();
+    }
+
+    void release(void){
+        _num_out.dec();
+    }
+
+    sptr get_new(boost::shared_array<boost::uint32_t> mem, size_t len){
+        _mem = mem;
+        return make(this, _mem.get(), len);
+    }
+
+private:
+    uhd::atomic_uint32_t &_num_out;
+    boost::shared_array<boost::uint32_t> _mem;
+};
+
+static const size_t NUM_FRAMES = 16;
+
+/***********************************************************************
+ * A dummy transport: word 0 is a sequence.
+ * Like a real transport, it runs out of frames while buffers are held.
+ **********************************************************************/
+class dummy_xport : public zero_copy_if{
+public:
+    dummy_xport(void){
+        _num_out.write(0);
+    }
+
+    void push_back_packet(const boost::uint32_t seq){
+        boost::mutex::scoped_lock l(_mutex);
+        boost::shared_array<boost::uint32_t> mem(new boost::uint32_t[1]);
+        mem[0] = seq;
+        _mems.push_back(mem);
+    }
+
+    size_t get_num_waiting(void){
+        boost::mutex::scoped_lock l(_mutex);
+        return _mems.size();
+    }
+
+    size_t get_num_out(void){
+        return _num_out.read();
+    }
+
+    managed_recv_buffer::sptr get_recv_buff(double){
+        boost::mutex::scoped_lock l(_mutex);
+        if (_mems.empty() or _num_out.read() >= NUM_FRAMES) return managed_recv_buffer::sptr(); //timeout
+        _mrbs.push_back(boost::make_shared<dummy_mrb>(boost::ref(_num_out)));
+        managed_recv_buffer::sptr mrb = _mrbs.back()->get_new(_mems.front(), sizeof(boost::uint32_t));
+        _mems.pop_front();
+        return mrb;
+    }
+
+    size_t get_num_recv_frames(void) const {return NUM_FRAMES;}
+    size_t get_recv_frame_size(void) const {return 4;}
+    managed_send_buffer::sptr get_send_buff(double){return managed_send_buffer::sptr();}
+    size_t get_num_send_frames(void) const {return 0;}
+    size_t get_send_frame_size(void) const {return 8;}
+
+private:
+    boost::mutex _mutex;
+    uhd::atomic_uint32_t _num_out;
+    std::list<boost::shared_array<boost::uint32_t> > _mems;
+    std::vector<boost::shared_ptr<dummy_mrb> > _mrbs;
+};
+
+static boost::uint32_t get_seq(managed_recv_buffer::sptr buff){
+    return buff->cast<const boost::uint32_t *>()[0];
+}
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_io_service_order){
+////////////////////////////////////////////////////////////////////////
+    boost::shared_ptr<dummy_xport> xport = boost::make_shared<dummy_xport>();
+    zero_copy_if::sptr serviced = io_service::get("test_order")->attach(xport);
+    BOOST_CHECK_EQUAL(serviced->get_num_recv_frames(), NUM_FRAMES);
+    BOOST_CHECK_EQUAL(serviced->get_send_frame_size(), size_t(8));
+
+    //nothing to receive: the wait times out
+    BOOST_CHECK(not serviced->get_recv_buff(0.01));
+
+    for (size_t i = 0; i < 10; i++) xport->push_back_packet(i);
+    for (size_t i = 0; i < 10; i++){
+        managed_recv_buffer::sptr buff = serviced->get_recv_buff(1.0);
+        BOOST_REQUIRE(buff);
+        BOOST_CHECK_EQUAL(get_seq(buff), i);
+    }
+    BOOST_CHECK(not serviced->get_recv_buff(0.01));
+    BOOST_CHECK_EQUAL(xport->get_num_out(), size_t(0));
+}
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_io_service_full){
+////////////////////////////////////////////////////////////////////////
+    boost::shared_ptr<dummy_xport> xport = boost::make_shared<dummy_xport>();
+    zero_copy_if::sptr serviced = io_service::get("test_full")->attach(xport);
+
+    //with the ring full, the packets stay in the transport
+    for (size_t i = 0; i < 100; i++) xport->push_back_packet(i);
+    boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+    BOOST_CHECK_EQUAL(xport->get_num_out(), NUM_FRAMES);
+    BOOST_CHECK_EQUAL(xport->get_num_waiting(), size_t(100) - NUM_FRAMES);
+
+    //none is dropped
+    for (size_t i = 0; i < 100; i++){
+        managed_recv_buffer::sptr buff = serviced->get_recv_buff(1.0);
+        BOOST_REQUIRE(buff);
+        BOOST_CHECK_EQUAL(get_seq(buff), i);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_io_service_shared){
+////////////////////////////////////////////////////////////////////////
+    io_service::sptr service = io_service::get("test_shared");
+    BOOST_CHECK(service == io_service::get("test_shared"));
+    BOOST_CHECK(service != io_service::get("test_shared", "0"));
+
+    boost::shared_ptr<dummy_xport> xport0 = boost::make_shared<dummy_xport>();
+    boost::shared_ptr<dummy_xport> xport1 = boost::make_shared<dummy_xport>();
+    zero_copy_if::sptr serviced0 = service->attach(xport0);
+    zero_copy_if::sptr serviced1 = service->attach(xport1);
+
+    for (size_t i = 0; i < 5; i++){
+        xport0->push_back_packet(i);
+        xport1->push_back_packet(100 + i);
+    }
+    for (size_t i = 0; i < 5; i++){
+        managed_recv_buffer::sptr buff1 = serviced1->get_recv_buff(1.0);
+        BOOST_REQUIRE(buff1);
+        BOOST_CHECK_EQUAL(get_seq(buff1), 100 + i);
+    }
+
+    //detach with buffers in the ring: they go back to the transport
+    boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    BOOST_CHECK_EQUAL(xport0->get_num_out(), size_t(5));
+    serviced0.reset();
+    BOOST_CHECK_EQUAL(xport0->get_num_out(), size_t(0));
+
+    //the service goes on for the other transport
+    xport1->push_back_packet(105);
+    managed_recv_buffer::sptr buff1 = serviced1->get_recv_buff(1.0);
+    BOOST_REQUIRE(buff1);
+    BOOST_CHECK_EQUAL(get_seq(buff1), 105);
+}
@@ -17,6 +17,10 @@
 
 #include <boost/test/unit_test.hpp>
 #include <uhd/utils/msg.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
 #include <iostream>
 
 BOOST_AUTO_TEST_CASE(test_messages){
@@ -38,3 +42,53 @@ BOOST_AUTO_TEST_CASE(test_messages){
     UHD_VAR(x);
     std::cerr << "---end print test ---" << std::endl;
 }
+
+/***********************************************************************
+ * Fastpath messages are queued and handled by a background thread
+ **********************************************************************/
+static boost::mutex captured_mutex;
+static std::string captured;
+
+static void capture_handler(uhd::msg::type_t type, const std::string &msg){
+    if (type != uhd::msg::fastpath) return;
+    boost::mutex::scoped_lock lock(captured_mutex);
+    captured += msg;
+}
+
+static size_t captured_size(void){
+    boost::mutex::scoped_lock lock(captured_mutex);
+    return captured.size();
+}
+
+static void make_fastpath_messages(const char ch, const size_t num){
+    for (size_t i = 0; i < num; i++){
+        UHD_MSG(fastpath) << ch;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_fastpath_messages){
+    uhd::msg::register_handler(&capture_handler);
+
+    const size_t num_threads = 4, num_msgs = 200;
+    boost::thread_group threads;
+    for (size_t i = 0; i < num_threads; i++){
+        threads.create_thread(boost::bind(&make_fastpath_messages, char('A'+i), num_msgs));
+    }
+    threads.join_all();
+
+    //a message longer than the inline record text
+    const std::string long_msg(1000, 'x');
+    UHD_MSG(fastpath) << long_msg;
+
+    const size_t expected_size = num_threads*num_msgs + long_msg.size();
+    for (size_t i = 0; i < 500 and captured_size() < expected_size; i++){
+        boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    }
+
+    boost::mutex::scoped_lock lock(captured_mutex);
+    BOOST_REQUIRE_EQUAL(captured.size(), expected_size);
+    for (size_t i = 0; i < num_threads; i++){
+        BOOST_CHECK_EQUAL(size_t(std::count(captured.begin(), captured.end(), char('A'+i))), num_msgs);
+    }
+    BOOST_CHECK_EQUAL(captured.substr(captured.size() - long_msg.size()), long_msg);
+}
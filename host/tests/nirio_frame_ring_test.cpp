@@ -0,0 +1,167 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <boost/test/unit_test.hpp>
+#include "../lib/transport/nirio_frame_ring.hpp"
+#include <uhd/utils/byteswap.hpp>
+#include <vector>
+
+using namespace uhd::transport;
+
+typedef boost::uint64_t fifo_data_t;
+
+static const size_t FRAME_SIZE = 64;
+static const size_t FRAME_ELEMS = FRAME_SIZE/sizeof(fifo_data_t);
+static const size_t NUM_FRAMES = 32;
+
+/***********************************************************************
+ * A software stand-in for an NI-RIO DMA FIFO (device to host):
+ * the device writes frames into a circular buffer, acquire returns
+ * the oldest written elements, and release gives the oldest acquired
+ * elements back to the device. Acquire does not wait.
+ **********************************************************************/
+class nirio_fifo_sim{
+public:
+    nirio_fifo_sim(void):
+        num_acquire_calls(0), num_release_calls(0),
+        _buff(NUM_FRAMES*FRAME_ELEMS), _written(0), _acquired(0), _granted(0){}
+
+    //the device writes a frame with a CHDR header: sequence number and length
+    bool produce(const size_t seq, const size_t length = FRAME_SIZE){
+        if (_written - _granted == _buff.size()) return false; //full
+        const boost::uint32_t header = boost::uint32_t((seq & 0xfff) << 16) | boost::uint32_t(length);
+        *reinterpret_cast<boost::uint32_t *>(&_buff[_written % _buff.size()]) = uhd::htowx(header);
+        _written += FRAME_ELEMS;
+        return true;
+    }
+
+    nirio_status acquire(
+        fifo_data_t*& elements,
+        const size_t elements_requested,
+        const boost::uint32_t,
+        size_t& elements_acquired,
+        size_t& elements_remaining
+    ){
+        num_acquire_calls++;
+        elements_acquired = 0;
+        elements_remaining = _written - _acquired;
+        if (elements_remaining < elements_requested) return NiRio_Status_FifoTimeout;
+
+        //an acquired region is always contiguous
+        const size_t offset = _acquired % _buff.size();
+        BOOST_CHECK(offset + elements_requested <= _buff.size());
+        elements = &_buff[offset];
+        elements_acquired = elements_requested;
+        _acquired += elements_requested;
+        elements_remaining = _written - _acquired;
+        return NiRio_Status_Success;
+    }
+
+    nirio_status release(const size_t elements){
+        num_release_calls++;
+        _granted += elements;
+        BOOST_CHECK(_granted <= _acquired);
+        return NiRio_Status_Success;
+    }
+
+    size_t num_acquire_calls, num_release_calls;
+
+private:
+    std::vector<fifo_data_t> _buff;
+    size_t _written, _acquired, _granted;
+};
+
+typedef nirio_frame_ring<nirio_fifo_sim, fifo_data_t> sim_ring_t;
+
+static size_t get_seq(const fifo_data_t *frame){
+    return (uhd::wtohx(*reinterpret_cast<const boost::uint32_t *>(frame)) >> 16) & 0xfff;
+}
+
+/***********************************************************************
+ * Tests
+ **********************************************************************/
+BOOST_AUTO_TEST_CASE(test_nirio_frame_ring_batches){
+    nirio_fifo_sim fifo;
+    sim_ring_t ring(fifo, FRAME_SIZE, NUM_FRAMES, 8, true);
+    fifo_data_t *frame;
+
+    //nothing written: the acquire times out
+    BOOST_CHECK(nirio_status_fatal(ring.get_frame(0, frame)));
+
+    //one frame is acquired alone, the frames ready after it in batches of 8
+    for (size_t i = 0; i < 16; i++) BOOST_CHECK(fifo.produce(i));
+    fifo.num_acquire_calls = 0;
+    for (size_t i = 0; i < 16; i++){
+        BOOST_REQUIRE(nirio_status_not_fatal(ring.get_frame(0, frame)));
+        BOOST_CHECK_EQUAL(get_seq(frame), i);
+    }
+    BOOST_CHECK_EQUAL(fifo.num_acquire_calls, size_t(3)); //1 + 8 + 7 frames
+    BOOST_CHECK_EQUAL(ring.get_num_acquire_calls(), size_t(4));
+
+    //released frames go back in one call before the next acquire
+    for (size_t i = 0; i < 16; i++) ring.release_frame();
+    BOOST_CHECK_EQUAL(fifo.num_release_calls, size_t(0));
+    BOOST_CHECK(nirio_status_fatal(ring.get_frame(0, frame)));
+    BOOST_CHECK_EQUAL(fifo.num_release_calls, size_t(1));
+}
+
+BOOST_AUTO_TEST_CASE(test_nirio_frame_ring_wraps){
+    nirio_fifo_sim fifo;
+    sim_ring_t ring(fifo, FRAME_SIZE, NUM_FRAMES, NUM_FRAMES, true);
+    fifo_data_t *frame;
+
+    //stream many times around the ring, no batch crosses the end of the buffer
+    size_t next_write = 0, next_read = 0;
+    while (next_read < 10*NUM_FRAMES){
+        while (fifo.produce(next_write)) next_write++;
+        while (nirio_status_not_fatal(ring.get_frame(0, frame))){
+            BOOST_CHECK_EQUAL(get_seq(frame), next_read & 0xfff);
+            ring.release_frame();
+            next_read++;
+        }
+    }
+    BOOST_CHECK(fifo.num_acquire_calls < next_read/2);
+}
+
+BOOST_AUTO_TEST_CASE(test_nirio_frame_ring_commit_each){
+    nirio_fifo_sim fifo;
+    sim_ring_t ring(fifo, FRAME_SIZE, NUM_FRAMES, 8, false);
+    fifo_data_t *frame;
+
+    for (size_t i = 0; i < 4; i++) BOOST_CHECK(fifo.produce(i));
+    for (size_t i = 0; i < 4; i++){
+        BOOST_REQUIRE(nirio_status_not_fatal(ring.get_frame(0, frame)));
+        ring.release_frame();
+        BOOST_CHECK_EQUAL(fifo.num_release_calls, i+1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_nirio_chdr_frame_length){
+    nirio_fifo_sim fifo;
+    sim_ring_t ring(fifo, FRAME_SIZE, NUM_FRAMES, 8, true);
+    fifo_data_t *frame;
+
+    BOOST_CHECK(fifo.produce(0, 20));
+    BOOST_CHECK(fifo.produce(1, 0));
+    BOOST_CHECK(fifo.produce(2, 4*FRAME_SIZE));
+
+    BOOST_REQUIRE(nirio_status_not_fatal(ring.get_frame(0, frame)));
+    BOOST_CHECK_EQUAL(get_chdr_frame_length(frame, FRAME_SIZE), size_t(24)); //rounded to 64 bits
+    BOOST_REQUIRE(nirio_status_not_fatal(ring.get_frame(0, frame)));
+    BOOST_CHECK_EQUAL(get_chdr_frame_length(frame, FRAME_SIZE), FRAME_SIZE); //invalid length
+    BOOST_REQUIRE(nirio_status_not_fatal(ring.get_frame(0, frame)));
+    BOOST_CHECK_EQUAL(get_chdr_frame_length(frame, FRAME_SIZE), FRAME_SIZE); //too long
+}
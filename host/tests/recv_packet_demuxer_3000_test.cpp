@@ -0,0 +1,187 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <boost/test/unit_test.hpp>
+#include "../lib/usrp/common/recv_packet_demuxer_3000.hpp"
+#include <boost/shared_array.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/bind.hpp>
+#include <uhd/types/time_spec.hpp>
+#include <list>
+#include <vector>
+
+using namespace uhd::transport;
+using namespace uhd::usrp;
+
+/***********************************************************************
+ * A dummy managed receive buffer for testing
+ **********************************************************************/
+class dummy_mrb : public managed_recv_buffer{
+public:
+    dummy_mrb(uhd::atomic_uint32_t &num_out): _num_out(num_out){
+        _num_out.inc();
+    }
+
+    void release(void){
+        _num_out.dec();
+    }
+
+    sptr get_new(boost::shared_array<boost::uint32_t> mem, size_t len){
+        _mem = mem;
+        return make(this, _mem.get(), len);
+    }
+
+private:
+    uhd::atomic_uint32_t &_num_out;
+    boost::shared_array<boost::uint32_t> _mem;
+};
+
+/***********************************************************************
+ * A dummy shared transport: word 0 is a sequence, word 1 is the SID.
+ * Like a real transport, it runs out of frames while buffers are held.
+ **********************************************************************/
+class dummy_shared_xport : public zero_copy_if{
+public:
+    static const size_t NUM_FRAMES = 32;
+
+    void push_back_packet(const boost::uint32_t sid, const boost::uint32_t seq){
+        boost::shared_array<boost::uint32_t> mem(new boost::uint32_t[2]);
+        mem[0] = uhd::htowx(seq);
+        mem[1] = uhd::htowx(sid);
+        _mems.push_back(mem);
+    }
+
+    managed_recv_buffer::sptr get_recv_buff(double){
+        boost::mutex::scoped_lock l(_mutex);
+        if (_mems.empty() or _num_out.read() >= NUM_FRAMES) return managed_recv_buffer::sptr(); //timeout
+        _mrbs.push_back(boost::make_shared<dummy_mrb>(boost::ref(_num_out)));
+        managed_recv_buffer::sptr mrb = _mrbs.back()->get_new(_mems.front(), 2*sizeof(boost::uint32_t));
+        _mems.pop_front();
+        return mrb;
+    }
+
+    size_t get_num_recv_frames(void) const {return NUM_FRAMES;}
+    size_t get_recv_frame_size(void) const {return 8;}
+    managed_send_buffer::sptr get_send_buff(double){return managed_send_buffer::sptr();}
+    size_t get_num_send_frames(void) const {return 0;}
+    size_t get_send_frame_size(void) const {return 0;}
+
+private:
+    boost::mutex _mutex;
+    uhd::atomic_uint32_t _num_out;
+    std::list<boost::shared_array<boost::uint32_t> > _mems;
+    std::vector<boost::shared_ptr<dummy_mrb> > _mrbs;
+};
+
+static boost::uint32_t get_seq(managed_recv_buffer::sptr buff){
+    return uhd::wtohx(buff->cast<const boost::uint32_t *>()[0]);
+}
+
+/***********************************************************************
+ * A consumer thread: receive packets for one SID and check the order
+ **********************************************************************/
+static void consume(recv_packet_demuxer_3000::sptr demux, const boost::uint32_t sid, const size_t num_packets, size_t *num_in_order){
+    for (size_t i = 0; i < num_packets; i++){
+        managed_recv_buffer::sptr buff = demux->get_recv_buff(sid, 1.0);
+        if (not buff) return;
+        if (get_seq(buff) == i) (*num_in_order)++;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_recv_packet_demuxer_3000_queues){
+////////////////////////////////////////////////////////////////////////
+    boost::shared_ptr<dummy_shared_xport> xport = boost::make_shared<dummy_shared_xport>();
+    recv_packet_demuxer_3000::sptr demux = recv_packet_demuxer_3000::make(xport);
+    demux->realloc_sid(0xa0);
+    demux->realloc_sid(0xb0);
+
+    xport->push_back_packet(0xb0, 0);
+    xport->push_back_packet(0xc0, 0); //unexpected sid, dropped
+    xport->push_back_packet(0xb0, 1);
+    xport->push_back_packet(0xa0, 0);
+    xport->push_back_packet(0xb0, 2);
+
+    //packets for other sids are queued on the way
+    managed_recv_buffer::sptr buff = demux->get_recv_buff(0xa0, 0.1);
+    BOOST_REQUIRE(buff);
+    BOOST_CHECK_EQUAL(get_seq(buff), 0u);
+    BOOST_CHECK(not demux->get_recv_buff(0xa0, 0.0));
+
+    for (boost::uint32_t i = 0; i < 3; i++){
+        buff = demux->get_recv_buff(0xb0, 0.0);
+        BOOST_REQUIRE(buff);
+        BOOST_CHECK_EQUAL(get_seq(buff), i);
+    }
+    BOOST_CHECK(not demux->get_recv_buff(0xb0, 0.0));
+
+    //realloc clears the queue
+    xport->push_back_packet(0xb0, 3);
+    xport->push_back_packet(0xa0, 1);
+    BOOST_CHECK_EQUAL(get_seq(demux->get_recv_buff(0xa0, 0.1)), 1u);
+    demux->realloc_sid(0xb0);
+    BOOST_CHECK(not demux->get_recv_buff(0xb0, 0.0));
+}
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_recv_packet_demuxer_3000_threads){
+////////////////////////////////////////////////////////////////////////
+    static const size_t num_packets = 10000;
+    static const boost::uint32_t sids[] = {0xa0, 0xb0, 0x10};
+    static const size_t num_sids = sizeof(sids)/sizeof(sids[0]);
+
+    boost::shared_ptr<dummy_shared_xport> xport = boost::make_shared<dummy_shared_xport>();
+    recv_packet_demuxer_3000::sptr demux = recv_packet_demuxer_3000::make(xport);
+    for (size_t j = 0; j < num_sids; j++) demux->realloc_sid(sids[j]);
+
+    //interleave the sids unevenly
+    for (size_t i = 0; i < num_packets; i++){
+        for (size_t j = 0; j < num_sids; j++){
+            if (j == 2 and i % 4 != 0) continue;
+            xport->push_back_packet(sids[j], boost::uint32_t((j == 2)? i/4 : i));
+        }
+    }
+
+    //one consumer thread per sid
+    size_t num_in_order[num_sids] = {0, 0, 0};
+    boost::thread_group threads;
+    for (size_t j = 0; j < num_sids; j++){
+        threads.create_thread(boost::bind(&consume, demux, sids[j], (j == 2)? num_packets/4 : num_packets, &num_in_order[j]));
+    }
+    threads.join_all();
+
+    BOOST_CHECK_EQUAL(num_in_order[0], num_packets);
+    BOOST_CHECK_EQUAL(num_in_order[1], num_packets);
+    BOOST_CHECK_EQUAL(num_in_order[2], num_packets/4);
+}
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_recv_packet_demuxer_3000_clear_in_use){
+////////////////////////////////////////////////////////////////////////
+    boost::shared_ptr<dummy_shared_xport> xport = boost::make_shared<dummy_shared_xport>();
+    recv_packet_demuxer_3000::sptr demux = recv_packet_demuxer_3000::make(xport);
+    demux->realloc_sid(0xa0);
+
+    //clearing a SID waits for the thread receiving on it
+    size_t num_in_order = 0;
+    const uhd::time_spec_t start = uhd::time_spec_t::get_system_time();
+    boost::thread consumer(boost::bind(&consume, demux, 0xa0, 1, &num_in_order));
+    boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+    demux->realloc_sid(0xa0);
+    BOOST_CHECK((uhd::time_spec_t::get_system_time() - start).get_real_secs() >= 0.9);
+    consumer.join();
+    BOOST_CHECK_EQUAL(num_in_order, size_t(0));
+}
@@ -0,0 +1,219 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <boost/test/unit_test.hpp>
+#include "../lib/transport/super_recv_packet_handler.hpp"
+#include "../lib/transport/shm_ring_publisher.hpp"
+#include <uhd/transport/shm_ring.hpp>
+#include <boost/shared_array.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/bind.hpp>
+#include <complex>
+#include <vector>
+#include <list>
+
+#ifndef UHD_PLATFORM_WIN32
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+using namespace uhd::transport;
+
+#define NUM_SAMPS_PER_PACKET 100
+#define NUM_SLOTS 16
+
+/***********************************************************************
+ * A dummy transport of big endian VRT packets with a sample ramp
+ **********************************************************************/
+class dummy_mrb : public managed_recv_buffer{
+public:
+    void release(void){}
+    sptr get_new(boost::shared_array<char> mem, size_t len){
+        _mem = mem;
+        return make(this, _mem.get(), len);
+    }
+private:
+    boost::shared_array<char> _mem;
+};
+
+class dummy_recv_xport_class{
+public:
+    dummy_recv_xport_class(void): _count(0){}
+
+    void push_back_packets(const size_t num_packets){
+        for (size_t i = 0; i < num_packets; i++){
+            vrt::if_packet_info_t ifpi;
+            ifpi.packet_type = vrt::if_packet_info_t::PACKET_TYPE_DATA;
+            ifpi.num_payload_words32 = NUM_SAMPS_PER_PACKET;
+            ifpi.num_payload_bytes = NUM_SAMPS_PER_PACKET*sizeof(boost::uint32_t);
+            ifpi.packet_count = _count & 0xf;
+            ifpi.has_sid = false;
+            ifpi.has_cid = false;
+            ifpi.has_tsi = false;
+            ifpi.has_tsf = true;
+            ifpi.has_tlr = false;
+            ifpi.tsf = boost::uint64_t(_count)*NUM_SAMPS_PER_PACKET;
+            boost::shared_array<char> mem(new char[(NUM_SAMPS_PER_PACKET + vrt::max_if_hdr_words32)*sizeof(boost::uint32_t)]);
+            boost::uint32_t *words = reinterpret_cast<boost::uint32_t *>(mem.get());
+            vrt::if_hdr_pack_be(words, ifpi);
+            for (size_t n = 0; n < NUM_SAMPS_PER_PACKET; n++){
+                words[ifpi.num_header_words32 + n] = uhd::htonx(boost::uint32_t(_count << 16));
+            }
+            _mems.push_back(mem);
+            _lens.push_back(ifpi.num_packet_words32*sizeof(boost::uint32_t));
+            _count++;
+        }
+    }
+
+    managed_recv_buffer::sptr get_recv_buff(double){
+        if (_mems.empty()) return managed_recv_buffer::sptr(); //timeout
+        _mrbs.push_back(boost::make_shared<dummy_mrb>());
+        managed_recv_buffer::sptr mrb = _mrbs.back()->get_new(_mems.front(), _lens.front());
+        _mems.pop_front();
+        _lens.pop_front();
+        return mrb;
+    }
+
+private:
+    size_t _count;
+    std::list<boost::shared_array<char> > _mems;
+    std::list<size_t> _lens;
+    std::vector<boost::shared_ptr<dummy_mrb> > _mrbs;
+};
+
+static boost::shared_ptr<sph::recv_packet_streamer> make_publisher(
+    dummy_recv_xport_class &xport, const std::string &name
+){
+    boost::shared_ptr<sph::recv_packet_streamer> streamer =
+        boost::make_shared<sph::recv_packet_streamer>(NUM_SAMPS_PER_PACKET);
+    streamer->set_vrt_unpacker(&vrt::if_hdr_unpack_be);
+    streamer->set_tick_rate(1e6);
+    streamer->set_samp_rate(1e6);
+    uhd::convert::id_type id;
+    id.input_format = "sc16_item32_be";
+    id.num_inputs = 1;
+    id.output_format = "sc16";
+    id.num_outputs = 1;
+    streamer->set_converter(id);
+    streamer->set_xport_chan_get_buff(0, boost::bind(&dummy_recv_xport_class::get_recv_buff, &xport, _1));
+
+    uhd::stream_args_t args("sc16");
+    args.args["shm_name"] = name;
+    args.args["shm_num_slots"] = boost::lexical_cast<std::string>(NUM_SLOTS);
+    shm_ring_publish_rx_stream(streamer, args, 1e6);
+    return streamer;
+}
+
+static void publish_packets(uhd::rx_streamer::sptr streamer, const size_t num_packets){
+    std::vector<std::complex<short> > buff(NUM_SAMPS_PER_PACKET);
+    uhd::rx_metadata_t md;
+    for (size_t i = 0; i < num_packets; i++){
+        BOOST_REQUIRE_EQUAL(streamer->recv(&buff.front(), buff.size(), md, 0.0, true), buff.size());
+    }
+}
+
+/***********************************************************************
+ * A reader gets the samples and timestamps of the publisher
+ **********************************************************************/
+BOOST_AUTO_TEST_CASE(test_shm_ring_publish_and_read){
+    const std::string name = str(boost::format("test_read_%p") % &name);
+    dummy_recv_xport_class xport;
+    uhd::rx_streamer::sptr publisher = make_publisher(xport, name);
+    uhd::rx_streamer::sptr reader = shm_ring::make_rx_stream(name, uhd::stream_args_t("sc16"));
+    BOOST_CHECK_EQUAL(reader->get_max_num_samps(), size_t(NUM_SAMPS_PER_PACKET));
+
+    xport.push_back_packets(NUM_SLOTS/2);
+    publish_packets(publisher, NUM_SLOTS/2);
+
+    std::vector<std::complex<short> > buff(NUM_SAMPS_PER_PACKET);
+    uhd::rx_metadata_t md;
+    for (size_t i = 0; i < NUM_SLOTS/2; i++){
+        BOOST_REQUIRE_EQUAL(reader->recv(&buff.front(), buff.size(), md, 0.1, true), buff.size());
+        BOOST_CHECK_EQUAL(md.error_code, uhd::rx_metadata_t::ERROR_CODE_NONE);
+        BOOST_CHECK(md.has_time_spec);
+        BOOST_CHECK_EQUAL(md.time_spec.to_ticks(1e6), (long long)(i*NUM_SAMPS_PER_PACKET));
+        BOOST_CHECK_EQUAL(buff.front(), std::complex<short>(short(i), 0));
+    }
+
+    //nothing more published
+    reader->recv(&buff.front(), buff.size(), md, 0.01, true);
+    BOOST_CHECK_EQUAL(md.error_code, uhd::rx_metadata_t::ERROR_CODE_TIMEOUT);
+}
+
+/***********************************************************************
+ * A slow reader gets an overflow and continues with new packets
+ **********************************************************************/
+BOOST_AUTO_TEST_CASE(test_shm_ring_slow_reader){
+    const std::string name = str(boost::format("test_slow_%p") % &name);
+    dummy_recv_xport_class xport;
+    uhd::rx_streamer::sptr publisher = make_publisher(xport, name);
+    uhd::rx_streamer::sptr reader = shm_ring::make_rx_stream(name, uhd::stream_args_t("sc16"));
+
+    //the publisher laps the reader
+    xport.push_back_packets(2*NUM_SLOTS);
+    publish_packets(publisher, 2*NUM_SLOTS);
+
+    std::vector<std::complex<short> > buff(NUM_SAMPS_PER_PACKET);
+    uhd::rx_metadata_t md;
+    reader->recv(&buff.front(), buff.size(), md, 0.1, true);
+    BOOST_CHECK_EQUAL(md.error_code, uhd::rx_metadata_t::ERROR_CODE_OVERFLOW);
+
+    //the reader continues with the newest packets
+    xport.push_back_packets(1);
+    publish_packets(publisher, 1);
+    BOOST_REQUIRE_EQUAL(reader->recv(&buff.front(), buff.size(), md, 0.1, true), buff.size());
+    BOOST_CHECK_EQUAL(md.error_code, uhd::rx_metadata_t::ERROR_CODE_NONE);
+    BOOST_CHECK_EQUAL(md.time_spec.to_ticks(1e6), (long long)(2*NUM_SLOTS*NUM_SAMPS_PER_PACKET));
+}
+
+/***********************************************************************
+ * The ring of a running publisher is not replaced, a closed one is
+ **********************************************************************/
+BOOST_AUTO_TEST_CASE(test_shm_ring_owner){
+    const std::string name = str(boost::format("test_owner_%p") % &name);
+    dummy_recv_xport_class xport;
+    {
+        uhd::rx_streamer::sptr publisher = make_publisher(xport, name);
+        BOOST_CHECK_THROW(make_publisher(xport, name), uhd::io_error);
+
+        //the first ring is still there
+        BOOST_CHECK(shm_ring::make_rx_stream(name, uhd::stream_args_t("sc16")));
+    }
+    uhd::rx_streamer::sptr publisher = make_publisher(xport, name);
+    BOOST_CHECK(shm_ring::make_rx_stream(name, uhd::stream_args_t("sc16")));
+}
+
+#ifndef UHD_PLATFORM_WIN32
+BOOST_AUTO_TEST_CASE(test_shm_ring_stale){
+    const std::string name = str(boost::format("test_stale_%p") % &name);
+    dummy_recv_xport_class xport;
+
+    //a child publishes and exits without closing the ring
+    const pid_t pid = ::fork();
+    if (pid == 0){
+        uhd::rx_streamer::sptr publisher = make_publisher(xport, name);
+        ::_exit(0); //no destructors
+    }
+    int status = 0;
+    BOOST_REQUIRE_EQUAL(::waitpid(pid, &status, 0), pid);
+
+    uhd::rx_streamer::sptr publisher = make_publisher(xport, name);
+    BOOST_CHECK(shm_ring::make_rx_stream(name, uhd::stream_args_t("sc16")));
+}
+#endif /*UHD_PLATFORM_WIN32*/
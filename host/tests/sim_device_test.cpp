@@ -0,0 +1,190 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <boost/test/unit_test.hpp>
+#include <uhd/device.hpp>
+#include <uhd/exception.hpp>
+#include <uhd/stream.hpp>
+#include <uhd/usrp/capture_scheduler.hpp>
+#include <uhd/types/device_addr.hpp>
+#include <complex>
+#include <vector>
+
+#define NUM_SAMPS 10000
+#define SPP 100
+
+static uhd::device::sptr make_sim(const std::string &args){
+    return uhd::device::make(uhd::device_addr_t("type=sim,paced=0," + args));
+}
+
+/***********************************************************************
+ * Receive a finite burst, the timestamps are contiguous
+ **********************************************************************/
+BOOST_AUTO_TEST_CASE(test_sim_recv_num_samps){
+    uhd::device::sptr dev = make_sim("");
+    uhd::stream_args_t stream_args("sc16");
+    stream_args.args["spp"] = "100";
+    uhd::rx_streamer::sptr rx_stream = dev->get_rx_stream(stream_args);
+
+    uhd::stream_cmd_t stream_cmd(uhd::stream_cmd_t::STREAM_MODE_NUM_SAMPS_AND_DONE);
+    stream_cmd.num_samps = NUM_SAMPS;
+    stream_cmd.stream_now = true;
+    rx_stream->issue_stream_cmd(stream_cmd);
+
+    std::vector<std::complex<short> > buff(SPP);
+    uhd::rx_metadata_t md;
+    size_t num_samps = 0, num_calls = 0;
+    uhd::time_spec_t next_time;
+    while (not md.end_of_burst){
+        const size_t num_rx = rx_stream->recv(&buff.front(), buff.size(), md, 1.0);
+        num_calls++;
+        BOOST_REQUIRE_EQUAL(md.error_code, uhd::rx_metadata_t::ERROR_CODE_NONE);
+        BOOST_REQUIRE(md.has_time_spec);
+        if (num_samps != 0) BOOST_CHECK_EQUAL(md.time_spec.to_ticks(1e6), next_time.to_ticks(1e6));
+        num_samps += num_rx;
+        next_time = md.time_spec + uhd::time_spec_t::from_ticks(num_rx, 1e6);
+    }
+    BOOST_CHECK_EQUAL(num_samps, size_t(NUM_SAMPS));
+
+    //the statistics count every packet and call
+    const uhd::stream_stats_t stats = rx_stream->get_stats(0);
+    BOOST_CHECK_EQUAL(stats.num_packets, boost::uint64_t(NUM_SAMPS/SPP));
+    BOOST_CHECK_EQUAL(stats.num_bytes, boost::uint64_t(NUM_SAMPS*4));
+    BOOST_CHECK_EQUAL(stats.num_seq_errors, boost::uint64_t(0));
+    boost::uint64_t num_latencies = 0;
+    for (size_t i = 0; i < uhd::stream_stats_t::NUM_LATENCY_BINS; i++) num_latencies += stats.call_latency[i];
+    BOOST_CHECK_EQUAL(num_latencies, boost::uint64_t(num_calls));
+}
+
+/***********************************************************************
+ * A dropped packet is an out of sequence error
+ **********************************************************************/
+BOOST_AUTO_TEST_CASE(test_sim_recv_drop){
+    uhd::device::sptr dev = make_sim("drop_rate=0.05,seed=1,num_recv_frames=32");
+    uhd::stream_args_t stream_args("sc16");
+    stream_args.args["spp"] = "100";
+    uhd::rx_streamer::sptr rx_stream = dev->get_rx_stream(stream_args);
+
+    uhd::stream_cmd_t stream_cmd(uhd::stream_cmd_t::STREAM_MODE_NUM_SAMPS_AND_DONE);
+    stream_cmd.num_samps = NUM_SAMPS;
+    stream_cmd.stream_now = true;
+    rx_stream->issue_stream_cmd(stream_cmd);
+
+    std::vector<std::complex<short> > buff(SPP);
+    uhd::rx_metadata_t md;
+    size_t num_errors = 0;
+    while (true){
+        rx_stream->recv(&buff.front(), buff.size(), md, 0.1);
+        if (md.error_code == uhd::rx_metadata_t::ERROR_CODE_TIMEOUT) break;
+        if (md.error_code == uhd::rx_metadata_t::ERROR_CODE_OVERFLOW){
+            BOOST_CHECK(md.out_of_sequence);
+            num_errors++;
+        }
+        if (md.end_of_burst) break;
+    }
+    BOOST_CHECK(num_errors > 0);
+
+    //the drops are counted and shrink the flow control window
+    const uhd::stream_stats_t stats = rx_stream->get_stats(0);
+    BOOST_CHECK_EQUAL(stats.num_seq_errors, boost::uint64_t(num_errors));
+    BOOST_CHECK(stats.fc_adjustments > 0);
+    BOOST_CHECK(stats.fc_window > 0);
+    BOOST_CHECK(stats.fc_window < 32);
+}
+
+/***********************************************************************
+ * A transmitted burst is acknowledged
+ **********************************************************************/
+BOOST_AUTO_TEST_CASE(test_sim_send_burst_ack){
+    uhd::device::sptr dev = make_sim("");
+    uhd::stream_args_t stream_args("sc16");
+    uhd::tx_streamer::sptr tx_stream = dev->get_tx_stream(stream_args);
+
+    std::vector<std::complex<short> > buff(NUM_SAMPS);
+    uhd::tx_metadata_t md;
+    md.start_of_burst = true;
+    md.end_of_burst = true;
+    BOOST_CHECK_EQUAL(tx_stream->send(&buff.front(), buff.size(), md, 1.0), buff.size());
+
+    uhd::async_metadata_t async_md;
+    BOOST_REQUIRE(tx_stream->recv_async_msg(async_md, 1.0));
+    BOOST_CHECK_EQUAL(async_md.event_code, uhd::async_metadata_t::EVENT_CODE_BURST_ACK);
+
+    const uhd::stream_stats_t stats = tx_stream->get_stats(0);
+    BOOST_CHECK(stats.num_packets > 0);
+    BOOST_CHECK_EQUAL(stats.num_bytes, boost::uint64_t(NUM_SAMPS*4));
+    BOOST_CHECK_EQUAL(stats.num_underflows, boost::uint64_t(0));
+
+    //the burst ack acknowledges every packet
+    boost::uint64_t num_acked = 0, num_send_acked = 0, num_occupancies = 0;
+    for (size_t i = 0; i < uhd::stream_stats_t::NUM_LATENCY_BINS; i++){
+        num_acked += stats.ack_latency[i];
+        num_send_acked += stats.send_ack_latency[i];
+    }
+    for (size_t i = 0; i < uhd::stream_stats_t::NUM_OCCUPANCY_BINS; i++) num_occupancies += stats.buffer_occupancy[i];
+    BOOST_CHECK_EQUAL(num_acked, stats.num_packets);
+    BOOST_CHECK_EQUAL(num_send_acked, stats.num_packets);
+    BOOST_CHECK_EQUAL(num_occupancies, stats.num_packets);
+}
+
+/***********************************************************************
+ * Scheduled captures complete in order with their samples and times
+ **********************************************************************/
+BOOST_AUTO_TEST_CASE(test_sim_capture_scheduler){
+    uhd::usrp::multi_usrp::sptr usrp = uhd::usrp::multi_usrp::make(uhd::device_addr_t("type=sim,paced=0"));
+    usrp->set_time_now(uhd::time_spec_t(0.0));
+    uhd::stream_args_t stream_args("sc16");
+    stream_args.channels.push_back(0);
+    stream_args.channels.push_back(1);
+    stream_args.args["capture_queue_depth"] = "4";
+    uhd::usrp::capture_scheduler::sptr scheduler = uhd::usrp::capture_scheduler::make(usrp, stream_args, SPP*10, 6);
+
+    //short captures on either or both channels, more than the buffers
+    std::vector<uhd::usrp::capture_scheduler::request_t> requests;
+    for (size_t i = 0; i < 30; i++){
+        requests.push_back(uhd::usrp::capture_scheduler::request_t(
+            uhd::time_spec_t(0.1 + i*0.005), SPP*(1 + i%10), boost::uint32_t(1 + i%3)
+        ));
+    }
+    BOOST_CHECK_THROW(scheduler->schedule(std::vector<uhd::usrp::capture_scheduler::request_t>(
+        1, uhd::usrp::capture_scheduler::request_t(uhd::time_spec_t(0.1), SPP, 4)
+    )), uhd::value_error);
+
+    //the captures on different channels complete in any order
+    size_t num_scheduled = 0;
+    std::vector<bool> completed(requests.size(), false);
+    for (size_t i = 0; i < requests.size(); i++){
+        std::vector<uhd::usrp::capture_scheduler::request_t> remaining(requests.begin() + num_scheduled, requests.end());
+        num_scheduled += scheduler->schedule(remaining);
+        BOOST_REQUIRE(scheduler->get_num_in_flight() <= 6);
+
+        uhd::usrp::capture_scheduler::capture_t capture;
+        BOOST_REQUIRE(scheduler->get_completed(capture, 1.0));
+        BOOST_REQUIRE(capture.id < requests.size() and not completed[capture.id]);
+        completed[capture.id] = true;
+        const uhd::usrp::capture_scheduler::request_t &request = requests[capture.id];
+        BOOST_CHECK_EQUAL(capture.error_code, uhd::rx_metadata_t::ERROR_CODE_NONE);
+        BOOST_CHECK_EQUAL(capture.nsamps, request.nsamps);
+        BOOST_CHECK_EQUAL(capture.time.to_ticks(1e6), request.time.to_ticks(1e6));
+        BOOST_CHECK_EQUAL(capture.buffs[0] != NULL, (request.channel_mask & 1) != 0);
+        BOOST_CHECK_EQUAL(capture.buffs[1] != NULL, (request.channel_mask & 2) != 0);
+        scheduler->release(capture);
+        BOOST_CHECK_THROW(scheduler->release(capture), uhd::value_error);
+    }
+    BOOST_CHECK_EQUAL(num_scheduled, requests.size());
+    BOOST_CHECK_EQUAL(scheduler->get_num_in_flight(), size_t(0));
+}
@@ -169,6 +169,70 @@ BOOST_AUTO_TEST_CASE(test_sph_recv_one_channel_normal){
     }
 }
 
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_sph_recv_one_channel_long_capture){
+////////////////////////////////////////////////////////////////////////
+    uhd::convert::id_type id;
+    id.input_format = "sc16_item32_be";
+    id.num_inputs = 1;
+    id.output_format = "fc32";
+    id.num_outputs = 1;
+
+    dummy_recv_xport_class dummy_recv_xport("big");
+    uhd::transport::vrt::if_packet_info_t ifpi;
+    ifpi.packet_type = uhd::transport::vrt::if_packet_info_t::PACKET_TYPE_DATA;
+    ifpi.num_payload_words32 = 0;
+    ifpi.packet_count = 0;
+    ifpi.sob = true;
+    ifpi.eob = false;
+    ifpi.has_sid = false;
+    ifpi.has_cid = false;
+    ifpi.has_tsi = false;
+    ifpi.has_tsf = true;
+    ifpi.tsi = 0;
+    ifpi.has_tlr = false;
+
+    //a capture that has run for 30 days at 200 MHz
+    static const double TICK_RATE = 200e6;
+    static const double SAMP_RATE = 200e6/3;
+    static const boost::uint64_t TICKS_PER_SAMP = 3;
+    static const boost::uint64_t START_TSF = boost::uint64_t(30*24*3600)*200000000;
+    static const size_t NUM_PKTS_TO_TEST = 30;
+    static const size_t SAMPS_PER_PKT = 20;
+    ifpi.tsf = START_TSF;
+
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+        ifpi.num_payload_words32 = SAMPS_PER_PKT;
+        dummy_recv_xport.push_back_packet(ifpi);
+        ifpi.packet_count++;
+        ifpi.tsf += SAMPS_PER_PKT*TICKS_PER_SAMP;
+    }
+
+    uhd::transport::sph::recv_packet_handler handler(1);
+    handler.set_vrt_unpacker(&uhd::transport::vrt::if_hdr_unpack_be);
+    handler.set_tick_rate(TICK_RATE);
+    handler.set_samp_rate(SAMP_RATE);
+    handler.set_xport_chan_get_buff(0, boost::bind(&dummy_recv_xport_class::get_recv_buff, &dummy_recv_xport, _1));
+    handler.set_converter(id);
+
+    //receive in fragments, every timestamp is exact in ticks
+    boost::uint64_t num_accum_samps = 0;
+    std::vector<std::complex<float> > buff(SAMPS_PER_PKT/4);
+    uhd::rx_metadata_t metadata;
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST*4; i++){
+        const size_t num_samps_ret = handler.recv(
+            &buff.front(), buff.size(), metadata, 1.0, true
+        );
+        BOOST_CHECK_EQUAL(metadata.error_code, uhd::rx_metadata_t::ERROR_CODE_NONE);
+        BOOST_CHECK_EQUAL(num_samps_ret, buff.size());
+        BOOST_CHECK_EQUAL(
+            boost::uint64_t(metadata.time_spec.to_ticks(TICK_RATE)),
+            START_TSF + num_accum_samps*TICKS_PER_SAMP
+        );
+        num_accum_samps += num_samps_ret;
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////
 BOOST_AUTO_TEST_CASE(test_sph_recv_one_channel_sequence_error){
 ////////////////////////////////////////////////////////////////////////
@@ -702,3 +766,77 @@ BOOST_AUTO_TEST_CASE(test_sph_recv_multi_channel_fragment){
     }
 
 }
+
+/***********************************************************************
+ * Test the flow control tuner
+ **********************************************************************/
+static void store_window(size_t *window, const size_t new_window){
+    *window = new_window;
+}
+
+BOOST_AUTO_TEST_CASE(test_sph_recv_fc_tuner){
+    size_t window = 256;
+    uhd::transport::sph::rx_fc_tuner tuner(256, 512, 32, boost::bind(&store_window, &window, _1));
+    BOOST_CHECK_EQUAL(tuner.get_update_interval(), size_t(8));
+
+    //an overflow doubles the updates and grows the window
+    tuner.on_overflow();
+    BOOST_CHECK_EQUAL(tuner.update(0.0, 1e-3), size_t(4));
+    BOOST_CHECK_EQUAL(window, size_t(288));
+
+    //a drop halves the window and caps its growth
+    tuner.on_drop();
+    tuner.update(0.0, 1e-3);
+    BOOST_CHECK_EQUAL(window, size_t(144));
+    for (size_t i = 0; i < 500; i++) tuner.update(0.0, 1e-3);
+    BOOST_CHECK_EQUAL(window, size_t(252));
+
+    //a backlog of most of the window asks for more updates
+    const size_t interval = tuner.get_update_interval();
+    tuner.update(0.9*252*1e-3, 1e-3);
+    BOOST_CHECK(tuner.get_update_interval() < interval);
+
+    uhd::stream_stats_t stats;
+    tuner.get_stats(stats);
+    BOOST_CHECK_EQUAL(stats.fc_window, size_t(252));
+    BOOST_CHECK_CLOSE(stats.fc_window_fill, 0.9, 1.0);
+    BOOST_CHECK(stats.fc_adjustments > 0);
+
+    //repeated drops hold the window down, quiet periods lift the cap again
+    for (size_t i = 0; i < 4; i++){
+        tuner.on_drop();
+        for (size_t j = 0; j < 100; j++) tuner.update(0.0, 1e-3);
+    }
+    BOOST_CHECK(window < 128);
+    for (size_t i = 0; i < 20000; i++) tuner.update(0.0, 1e-3);
+    BOOST_CHECK_EQUAL(window, size_t(512));
+
+    //the window never grows past the max window
+    tuner.on_overflow();
+    tuner.update(0.0, 1e-3);
+    BOOST_CHECK_EQUAL(window, size_t(512));
+}
+
+/***********************************************************************
+ * Test the flow control window applier
+ **********************************************************************/
+static void store_window_slowly(uhd::atomic_uint32_t *window, const size_t new_window){
+    boost::this_thread::sleep(boost::posix_time::milliseconds(50)); //a write waiting on timed commands
+    window->write(boost::uint32_t(new_window));
+}
+
+BOOST_AUTO_TEST_CASE(test_sph_recv_fc_window_applier){
+    uhd::atomic_uint32_t window;
+    uhd::transport::sph::rx_fc_window_applier applier(boost::bind(&store_window_slowly, &window, _1));
+
+    //the receiving thread never waits for the write
+    const uhd::time_spec_t start = uhd::time_spec_t::get_system_time();
+    for (size_t i = 1; i <= 10; i++) applier.set_window(100*i);
+    BOOST_CHECK((uhd::time_spec_t::get_system_time() - start).get_real_secs() < 0.04);
+
+    //the latest window is written
+    for (size_t i = 0; i < 100 and window.read() != 1000; i++){
+        boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    }
+    BOOST_CHECK_EQUAL(window.read(), boost::uint32_t(1000));
+}
@@ -0,0 +1,176 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <boost/test/unit_test.hpp>
+#include <uhd/device.hpp>
+#include <uhd/stream.hpp>
+#include <uhd/types/device_addr.hpp>
+#include <uhd/utils/atomic.hpp>
+#include <complex>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#define NUM_WARMUP_PACKETS 1000
+#define NUM_PACKETS 1000
+#define BURST_LEN 10 //packets
+
+/***********************************************************************
+ * Allocation counter:
+ * With glibc, malloc is interposed, which counts the allocations of
+ * every thread and library, operator new included. Elsewhere only
+ * operator new is replaced.
+ **********************************************************************/
+static volatile bool counting = false;
+static uhd::atomic_uint32_t num_allocs;
+
+static inline void count_alloc(void){
+    if (counting) num_allocs.inc();
+}
+
+#ifdef __GLIBC__
+extern "C"{
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t num, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size){
+    count_alloc();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t num, size_t size){
+    count_alloc();
+    return __libc_calloc(num, size);
+}
+
+void *realloc(void *ptr, size_t size){
+    count_alloc();
+    return __libc_realloc(ptr, size);
+}
+} //extern "C"
+
+#else
+
+void *operator new(std::size_t size){
+    count_alloc();
+    void *ptr = std::malloc((size == 0)? 1 : size);
+    if (ptr == NULL) throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](std::size_t size){
+    return operator new(size);
+}
+
+void operator delete(void *ptr) throw(){
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) throw(){
+    std::free(ptr);
+}
+
+#endif /*__GLIBC__*/
+
+static void start_counting(void){
+    num_allocs.write(0);
+    counting = true;
+}
+
+static size_t stop_counting(void){
+    counting = false;
+    return num_allocs.read();
+}
+
+static uhd::device::sptr make_sim(const std::string &args){
+    return uhd::device::make(uhd::device_addr_t("type=sim,paced=0," + args));
+}
+
+/***********************************************************************
+ * Receive packets, count the allocations after warm-up
+ **********************************************************************/
+static size_t count_recv_allocs(const std::string &args, const size_t num_chans){
+    uhd::device::sptr dev = make_sim(args);
+    uhd::stream_args_t stream_args("fc32");
+    for (size_t ch = 0; ch < num_chans; ch++) stream_args.channels.push_back(ch);
+    uhd::rx_streamer::sptr rx_stream = dev->get_rx_stream(stream_args);
+    const size_t spp = rx_stream->get_max_num_samps();
+    std::vector<std::vector<std::complex<float> > > mem(num_chans, std::vector<std::complex<float> >(spp));
+    std::vector<void *> buffs;
+    for (size_t ch = 0; ch < num_chans; ch++) buffs.push_back(&mem[ch].front());
+
+    rx_stream->issue_stream_cmd(uhd::stream_cmd_t(uhd::stream_cmd_t::STREAM_MODE_START_CONTINUOUS));
+    uhd::rx_metadata_t md;
+    size_t num_samps = 0;
+    for (size_t i = 0; i < NUM_WARMUP_PACKETS; i++){
+        num_samps += rx_stream->recv(buffs, spp, md, 1.0);
+    }
+    start_counting();
+    for (size_t i = 0; i < NUM_PACKETS; i++){
+        num_samps += rx_stream->recv(buffs, spp, md, 1.0);
+    }
+    const size_t num = stop_counting();
+    rx_stream->issue_stream_cmd(uhd::stream_cmd_t(uhd::stream_cmd_t::STREAM_MODE_STOP_CONTINUOUS));
+
+    BOOST_CHECK(num_samps > 0);
+    return num;
+}
+
+BOOST_AUTO_TEST_CASE(test_recv_no_allocs){
+    BOOST_CHECK_EQUAL(count_recv_allocs("", 2), size_t(0));
+
+    //sequence errors and their prints do not allocate either
+    BOOST_CHECK_EQUAL(count_recv_allocs("drop_rate=0.01,seed=1", 1), size_t(0));
+}
+
+/***********************************************************************
+ * Send bursts on two channels and read their acknowledgements,
+ * count the allocations after warm-up
+ **********************************************************************/
+static size_t send_bursts(uhd::tx_streamer::sptr tx_stream, const std::vector<const void *> &buffs, const size_t num_packets){
+    const size_t spp = tx_stream->get_max_num_samps();
+    uhd::tx_metadata_t md;
+    uhd::async_metadata_t async_md;
+    size_t num_samps = 0;
+    for (size_t i = 0; i < num_packets; i++){
+        md.start_of_burst = (i % BURST_LEN) == 0;
+        md.end_of_burst = (i % BURST_LEN) == BURST_LEN - 1;
+        num_samps += tx_stream->send(buffs, spp, md, 1.0);
+        if (md.end_of_burst) tx_stream->recv_async_msg(async_md, 0.0);
+    }
+    return num_samps;
+}
+
+BOOST_AUTO_TEST_CASE(test_send_no_allocs){
+    uhd::device::sptr dev = make_sim("");
+    uhd::stream_args_t stream_args("fc32");
+    stream_args.channels.push_back(0);
+    stream_args.channels.push_back(1);
+    uhd::tx_streamer::sptr tx_stream = dev->get_tx_stream(stream_args);
+    const size_t spp = tx_stream->get_max_num_samps();
+    std::vector<std::complex<float> > buff0(spp), buff1(spp);
+    std::vector<const void *> buffs;
+    buffs.push_back(&buff0.front());
+    buffs.push_back(&buff1.front());
+
+    BOOST_CHECK_EQUAL(send_bursts(tx_stream, buffs, NUM_WARMUP_PACKETS), NUM_WARMUP_PACKETS*spp);
+    start_counting();
+    const size_t num_samps = send_bursts(tx_stream, buffs, NUM_PACKETS);
+    BOOST_CHECK_EQUAL(stop_counting(), size_t(0));
+    BOOST_CHECK_EQUAL(num_samps, NUM_PACKETS*spp);
+}
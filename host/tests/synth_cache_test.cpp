@@ -0,0 +1,71 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <boost/test/unit_test.hpp>
+#include "../lib/usrp/common/synth_cache.hpp"
+
+using namespace uhd::usrp;
+
+static synth_solution_t make_solution(const double actual_freq){
+    synth_solution_t solution;
+    solution.actual_freq = actual_freq;
+    solution.regs.push_back(boost::uint32_t(actual_freq/1e6));
+    return solution;
+}
+
+BOOST_AUTO_TEST_CASE(test_synth_cache_lookup){
+    synth_cache cache;
+    synth_solution_t solution;
+    BOOST_CHECK(not cache.lookup(synth_key_t(1e9, 10e6, ""), solution));
+
+    cache.store(synth_key_t(1e9, 10e6, ""), make_solution(1e9 + 1));
+    BOOST_CHECK(cache.lookup(synth_key_t(1e9, 10e6, ""), solution));
+    BOOST_CHECK_EQUAL(solution.actual_freq, 1e9 + 1);
+    BOOST_CHECK_EQUAL(solution.regs.size(), 1u);
+
+    //the reference and the mode are part of the key
+    BOOST_CHECK(not cache.lookup(synth_key_t(1e9, 20e6, ""), solution));
+    BOOST_CHECK(not cache.lookup(synth_key_t(1e9, 10e6, "mode_n=integer"), solution));
+
+    //storing the same key replaces the solution
+    cache.store(synth_key_t(1e9, 10e6, ""), make_solution(1e9 + 2));
+    BOOST_CHECK_EQUAL(cache.size(), 1u);
+    BOOST_CHECK(cache.lookup(synth_key_t(1e9, 10e6, ""), solution));
+    BOOST_CHECK_EQUAL(solution.actual_freq, 1e9 + 2);
+
+    cache.clear();
+    BOOST_CHECK_EQUAL(cache.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_synth_cache_eviction){
+    synth_cache cache(3);
+    synth_solution_t solution;
+    cache.store(synth_key_t(1e9, 10e6, ""), make_solution(1e9));
+    cache.store(synth_key_t(2e9, 10e6, ""), make_solution(2e9));
+    cache.store(synth_key_t(3e9, 10e6, ""), make_solution(3e9));
+
+    //using 1 GHz makes 2 GHz the least recently used
+    BOOST_CHECK(cache.lookup(synth_key_t(1e9, 10e6, ""), solution));
+    cache.store(synth_key_t(4e9, 10e6, ""), make_solution(4e9));
+
+    BOOST_CHECK_EQUAL(cache.size(), 3u);
+    BOOST_CHECK(not cache.lookup(synth_key_t(2e9, 10e6, ""), solution));
+    BOOST_CHECK(cache.lookup(synth_key_t(1e9, 10e6, ""), solution));
+    BOOST_CHECK(cache.lookup(synth_key_t(3e9, 10e6, ""), solution));
+    BOOST_CHECK(cache.lookup(synth_key_t(4e9, 10e6, ""), solution));
+    BOOST_CHECK_EQUAL(solution.actual_freq, 4e9);
+}
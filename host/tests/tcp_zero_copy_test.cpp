@@ -0,0 +1,176 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <boost/test/unit_test.hpp>
+#include <uhd/transport/tcp_zero_copy.hpp>
+#include <uhd/exception.hpp>
+#include <boost/asio.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+#include <vector>
+
+using namespace uhd::transport;
+namespace asio = boost::asio;
+
+/***********************************************************************
+ * A loopback peer: connect the transport to a local acceptor
+ **********************************************************************/
+struct tcp_peer{
+    asio::io_service io_service;
+    asio::ip::tcp::acceptor acceptor;
+    asio::ip::tcp::socket socket;
+    zero_copy_if::sptr xport;
+
+    tcp_peer(const std::string &args = "recv_chunk_size=4096"):
+        acceptor(io_service, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0)),
+        socket(io_service)
+    {
+        const std::string port = boost::lexical_cast<std::string>(acceptor.local_endpoint().port());
+        xport = tcp_zero_copy::make("127.0.0.1", port, uhd::device_addr_t(args));
+        acceptor.accept(socket);
+    }
+};
+
+//! A big endian CHDR frame: header with the length, then a byte ramp
+static std::vector<boost::uint8_t> make_frame(const size_t len, const boost::uint8_t seed){
+    std::vector<boost::uint8_t> frame(len);
+    frame[0] = seed;
+    frame[2] = boost::uint8_t(len >> 8);
+    frame[3] = boost::uint8_t(len >> 0);
+    for (size_t i = 4; i < len; i++) frame[i] = boost::uint8_t(seed + i);
+    return frame;
+}
+
+BOOST_AUTO_TEST_CASE(test_tcp_zero_copy_recv_frames){
+    tcp_peer peer;
+
+    //frames back to back, written in pieces that split headers and payloads
+    std::vector<boost::uint8_t> stream;
+    static const size_t lens[] = {16, 400, 8, 2048, 1000, 12};
+    static const size_t num_frames = sizeof(lens)/sizeof(lens[0]);
+    for (size_t i = 0; i < num_frames; i++){
+        const std::vector<boost::uint8_t> frame = make_frame(lens[i], boost::uint8_t(i));
+        stream.insert(stream.end(), frame.begin(), frame.end());
+    }
+    asio::write(peer.socket, asio::buffer(&stream[0], 3));
+    boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    asio::write(peer.socket, asio::buffer(&stream[3], 500));
+    asio::write(peer.socket, asio::buffer(&stream[503], stream.size() - 503));
+
+    for (size_t i = 0; i < num_frames; i++){
+        managed_recv_buffer::sptr buff = peer.xport->get_recv_buff(1.0);
+        BOOST_REQUIRE(buff.get() != NULL);
+        BOOST_CHECK_EQUAL(buff->size(), lens[i]);
+        const std::vector<boost::uint8_t> frame = make_frame(lens[i], boost::uint8_t(i));
+        BOOST_CHECK(std::equal(frame.begin(), frame.end(), buff->cast<const boost::uint8_t *>()));
+    }
+
+    //no more frames
+    BOOST_CHECK(peer.xport->get_recv_buff(0.01).get() == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(test_tcp_zero_copy_send_frames){
+    tcp_peer peer;
+
+    //send more frames than the transport has buffers
+    std::vector<boost::uint8_t> expected;
+    for (size_t i = 0; i < 100; i++){
+        const std::vector<boost::uint8_t> frame = make_frame(8 + 4*i, boost::uint8_t(i));
+        managed_send_buffer::sptr buff = peer.xport->get_send_buff(1.0);
+        BOOST_REQUIRE(buff.get() != NULL);
+        std::copy(frame.begin(), frame.end(), buff->cast<boost::uint8_t *>());
+        buff->commit(frame.size());
+        buff.reset();
+        expected.insert(expected.end(), frame.begin(), frame.end());
+
+        //read some of it back while sending so the socket never fills
+        if (i % 10 == 9){
+            std::vector<boost::uint8_t> got(expected.size());
+            asio::read(peer.socket, asio::buffer(got));
+            BOOST_CHECK(got == expected);
+            expected.clear();
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_tcp_zero_copy_close_flush){
+    tcp_peer peer;
+
+    //frames committed right before close are still written
+    std::vector<boost::uint8_t> expected;
+    for (size_t i = 0; i < 20; i++){
+        const std::vector<boost::uint8_t> frame = make_frame(64, boost::uint8_t(i));
+        managed_send_buffer::sptr buff = peer.xport->get_send_buff(1.0);
+        BOOST_REQUIRE(buff.get() != NULL);
+        std::copy(frame.begin(), frame.end(), buff->cast<boost::uint8_t *>());
+        buff->commit(frame.size());
+        expected.insert(expected.end(), frame.begin(), frame.end());
+    }
+    peer.xport.reset();
+
+    std::vector<boost::uint8_t> got(expected.size());
+    asio::read(peer.socket, asio::buffer(got));
+    BOOST_CHECK(got == expected);
+}
+
+BOOST_AUTO_TEST_CASE(test_tcp_zero_copy_close_stalled_peer){
+    tcp_peer peer("send_buff_size=65536");
+    peer.socket.set_option(asio::socket_base::receive_buffer_size(65536));
+
+    //the peer never reads: fill the socket until the sender blocks in its write
+    const std::vector<boost::uint8_t> frame = make_frame(2048, 0);
+    bool stalled = false;
+    for (size_t i = 0; i < 100000 and not stalled; i++){
+        managed_send_buffer::sptr buff = peer.xport->get_send_buff(0.1);
+        if (buff.get() == NULL) stalled = true;
+        else{
+            std::copy(frame.begin(), frame.end(), buff->cast<boost::uint8_t *>());
+            buff->commit(frame.size());
+        }
+    }
+    BOOST_REQUIRE(stalled);
+
+    //close gives up on the queued frames after the flush timeout
+    const boost::system_time start = boost::get_system_time();
+    peer.xport.reset();
+    BOOST_CHECK((boost::get_system_time() - start) < boost::posix_time::seconds(3));
+}
+
+BOOST_AUTO_TEST_CASE(test_tcp_zero_copy_send_error){
+    tcp_peer peer;
+    peer.socket.close();
+
+    //a write to the closed peer fails, a later get_send_buff throws
+    const std::vector<boost::uint8_t> frame = make_frame(1024, 0);
+    bool thrown = false;
+    for (size_t i = 0; i < 1000 and not thrown; i++){
+        try{
+            managed_send_buffer::sptr buff = peer.xport->get_send_buff(1.0);
+            BOOST_REQUIRE(buff.get() != NULL);
+            std::copy(frame.begin(), frame.end(), buff->cast<boost::uint8_t *>());
+            buff->commit(frame.size());
+        }
+        catch(const uhd::io_error &){
+            thrown = true;
+        }
+        boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+    }
+    BOOST_CHECK(thrown);
+
+    //the error sticks
+    BOOST_CHECK_THROW(peer.xport->get_send_buff(1.0), uhd::io_error);
+}
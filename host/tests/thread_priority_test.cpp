@@ -0,0 +1,52 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <boost/test/unit_test.hpp>
+#include <uhd/utils/thread_priority.hpp>
+#include <uhd/exception.hpp>
+#include <boost/assign/list_of.hpp>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE(test_parse_cpu_set){
+    const std::vector<size_t> single = uhd::parse_cpu_set("3");
+    BOOST_CHECK(single == std::vector<size_t>(1, 3));
+
+    const std::vector<size_t> expected = boost::assign::list_of(2)(3)(4)(6)(8)(9);
+    BOOST_CHECK(uhd::parse_cpu_set("2-4:6:8-9") == expected);
+
+    //commas, spaces, and newlines separate too, as in a sysfs cpulist
+    BOOST_CHECK(uhd::parse_cpu_set("2-4,6 8-9\n") == expected);
+    BOOST_CHECK(uhd::parse_cpu_set("5-5") == std::vector<size_t>(1, 5));
+}
+
+BOOST_AUTO_TEST_CASE(test_parse_cpu_set_errors){
+    BOOST_CHECK_THROW(uhd::parse_cpu_set(""), uhd::value_error);
+    BOOST_CHECK_THROW(uhd::parse_cpu_set("::"), uhd::value_error);
+    BOOST_CHECK_THROW(uhd::parse_cpu_set("cpu0"), uhd::value_error);
+    BOOST_CHECK_THROW(uhd::parse_cpu_set("2-"), uhd::value_error);
+
+    //a range that ends before it starts
+    BOOST_CHECK_THROW(uhd::parse_cpu_set("5-2"), uhd::value_error);
+
+    //CPUs beyond any CPU set, including negative numbers that wrap around
+    BOOST_CHECK_THROW(uhd::parse_cpu_set("100000"), uhd::value_error);
+    BOOST_CHECK_THROW(uhd::parse_cpu_set("0-100000000"), uhd::value_error);
+    BOOST_CHECK_THROW(uhd::parse_cpu_set("0--1"), uhd::value_error);
+
+    //a NUMA node that does not exist
+    BOOST_CHECK_THROW(uhd::parse_cpu_set("node9999"), uhd::value_error);
+}
@@ -0,0 +1,220 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <boost/test/unit_test.hpp>
+#include "../lib/usrp/common/timed_cmd_scheduler.hpp"
+#include <uhd/property_tree.hpp>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <deque>
+#include <vector>
+
+using namespace uhd::usrp;
+
+/***********************************************************************
+ * A software stand-in for a control port:
+ * the device time is simulated and a timed command stays in the FIFO
+ * (unacknowledged) until the device time reaches the command time.
+ **********************************************************************/
+class sim_cmd_port : public timed_cmd_port{
+public:
+    sim_cmd_port(const size_t capacity):
+        capacity(capacity), num_overflows(0), _cmd_time(0.0){}
+
+    void set_command_time(const uhd::time_spec_t &time){
+        _cmd_time = time;
+    }
+
+    uhd::time_spec_t get_time_now(void){
+        return now;
+    }
+
+    size_t get_queue_depth(void){
+        while (not _fifo.empty() and _fifo.front() <= now) _fifo.pop_front();
+        return _fifo.size();
+    }
+
+    size_t get_queue_capacity(void){
+        return capacity;
+    }
+
+    //! Send one command, an operation calls this once per register write
+    void send_command(const int id){
+        if (this->get_queue_depth() >= capacity) num_overflows++;
+        _fifo.push_back(_cmd_time);
+        issued.push_back(id);
+        issued_times.push_back(_cmd_time);
+    }
+
+    void send_commands(const int id, const size_t num_cmds){
+        for (size_t i = 0; i < num_cmds; i++) this->send_command(id);
+    }
+
+    const size_t capacity;
+    size_t num_overflows;
+    uhd::time_spec_t now;
+    std::vector<int> issued;
+    std::vector<uhd::time_spec_t> issued_times;
+
+private:
+    uhd::time_spec_t _cmd_time;
+    std::deque<uhd::time_spec_t> _fifo;
+};
+
+/***********************************************************************
+ * Tests
+ **********************************************************************/
+BOOST_AUTO_TEST_CASE(test_timed_cmd_scheduler_no_overflow){
+    boost::shared_ptr<sim_cmd_port> port = boost::make_shared<sim_cmd_port>(8);
+    timed_cmd_scheduler scheduler(port, 0.5);
+
+    //a burst of operations, 3 commands each, closer than the fifo can hold
+    for (int i = 0; i < 100; i++){
+        scheduler.schedule(uhd::time_spec_t(1.0 + i*0.01), boost::bind(&sim_cmd_port::send_commands, port.get(), i, 3));
+    }
+    BOOST_CHECK_EQUAL(scheduler.get_num_pending(), 100u);
+
+    //nothing is issued before the lead time
+    port->now = uhd::time_spec_t(0.4);
+    BOOST_CHECK_EQUAL(scheduler.poll(), 0u);
+
+    for (port->now = uhd::time_spec_t(0.5); scheduler.get_num_pending() != 0; port->now += 0.001){
+        scheduler.poll();
+        BOOST_REQUIRE(port->now < uhd::time_spec_t(5.0));
+    }
+
+    BOOST_CHECK_EQUAL(port->num_overflows, 0u);
+    BOOST_REQUIRE_EQUAL(port->issued.size(), 300u);
+    for (size_t i = 0; i < port->issued.size(); i++){
+        BOOST_CHECK_EQUAL(port->issued[i], int(i/3));
+        BOOST_CHECK(port->issued_times[i] == uhd::time_spec_t(1.0 + (i/3)*0.01));
+    }
+
+    const timed_cmd_scheduler::stats_t stats = scheduler.get_stats();
+    BOOST_CHECK_EQUAL(stats.num_scheduled, 100u);
+    BOOST_CHECK_EQUAL(stats.num_issued, 100u);
+    BOOST_CHECK_EQUAL(stats.max_cmds_per_op, 3u);
+    BOOST_CHECK(stats.max_queue_depth <= 8u);
+    BOOST_CHECK(stats.max_queue_depth >= 6u);
+    BOOST_CHECK_EQUAL(stats.num_late, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_timed_cmd_scheduler_lateness){
+    boost::shared_ptr<sim_cmd_port> port = boost::make_shared<sim_cmd_port>(16);
+    timed_cmd_scheduler scheduler(port, 0.1);
+
+    //operations at the same time keep their order
+    scheduler.schedule(uhd::time_spec_t(2.0), boost::bind(&sim_cmd_port::send_command, port.get(), 2));
+    scheduler.schedule(uhd::time_spec_t(1.0), boost::bind(&sim_cmd_port::send_command, port.get(), 0));
+    scheduler.schedule(uhd::time_spec_t(1.0), boost::bind(&sim_cmd_port::send_command, port.get(), 1));
+
+    //the first poll happens after the time of the first two operations
+    port->now = uhd::time_spec_t(1.25);
+    BOOST_CHECK_EQUAL(scheduler.poll(), 2u);
+    port->now = uhd::time_spec_t(1.95);
+    BOOST_CHECK_EQUAL(scheduler.poll(), 1u);
+
+    BOOST_REQUIRE_EQUAL(port->issued.size(), 3u);
+    BOOST_CHECK_EQUAL(port->issued[0], 0);
+    BOOST_CHECK_EQUAL(port->issued[1], 1);
+    BOOST_CHECK_EQUAL(port->issued[2], 2);
+
+    const timed_cmd_scheduler::stats_t stats = scheduler.get_stats();
+    BOOST_CHECK_EQUAL(stats.num_late, 2u);
+    BOOST_CHECK_CLOSE(stats.max_lateness, 0.25, 1e-6);
+    BOOST_CHECK_CLOSE(stats.total_lateness, 0.5, 1e-6);
+    BOOST_CHECK_EQUAL(stats.queue_depth, 1u);
+}
+
+/***********************************************************************
+ * A control core on a property tree, like radio_ctrl_core_3000:
+ * the device runs 100 seconds ahead of the host, and a read of the
+ * device time waits for the acks of all queued commands.
+ **********************************************************************/
+struct tree_ctrl_sim{
+    tree_ctrl_sim(const size_t capacity):
+        capacity(capacity), num_overflows(0), num_waiting_reads(0), num_cmds(0){}
+
+    uhd::time_spec_t device_now(void){
+        return uhd::time_spec_t::get_system_time() + 100.0;
+    }
+
+    size_t get_depth(void){
+        while (not fifo.empty() and fifo.front() <= this->device_now()) fifo.pop_front();
+        return fifo.size();
+    }
+
+    size_t get_capacity(void){
+        return capacity;
+    }
+
+    uhd::time_spec_t get_time_now(void){
+        if (this->get_depth() != 0){
+            num_waiting_reads++;
+            fifo.clear(); //the read returns once every queued command ran
+        }
+        return this->device_now();
+    }
+
+    void set_command_time(const uhd::time_spec_t &time){
+        cmd_time = time;
+    }
+
+    void poke(const int){
+        if (this->get_depth() >= capacity) num_overflows++;
+        fifo.push_back(cmd_time);
+        num_cmds++;
+    }
+
+    const size_t capacity;
+    size_t num_overflows, num_waiting_reads, num_cmds;
+    uhd::time_spec_t cmd_time;
+    std::deque<uhd::time_spec_t> fifo;
+};
+
+static void set_reg(uhd::property_tree::sptr tree, const int value){
+    tree->access<int>("/mboards/0/reg").set(value);
+}
+
+BOOST_AUTO_TEST_CASE(test_timed_cmd_tree_port){
+    tree_ctrl_sim ctrl(4);
+    uhd::property_tree::sptr tree = uhd::property_tree::make();
+    tree->create<uhd::time_spec_t>("/mboards/0/time/cmd")
+        .subscribe(boost::bind(&tree_ctrl_sim::set_command_time, &ctrl, _1));
+    tree->create<uhd::time_spec_t>("/mboards/0/time/now")
+        .publish(boost::bind(&tree_ctrl_sim::get_time_now, &ctrl));
+    tree->create<size_t>("/mboards/0/time/cmd_queue/0/depth")
+        .publish(boost::bind(&tree_ctrl_sim::get_depth, &ctrl));
+    tree->create<size_t>("/mboards/0/time/cmd_queue/0/capacity")
+        .publish(boost::bind(&tree_ctrl_sim::get_capacity, &ctrl));
+    tree->create<int>("/mboards/0/reg")
+        .subscribe(boost::bind(&tree_ctrl_sim::poke, &ctrl, _1));
+
+    timed_cmd_scheduler scheduler(timed_cmd_port::sptr(new timed_cmd_tree_port(tree, "/mboards/0")), 0.1);
+    const uhd::time_spec_t start = ctrl.device_now();
+    for (int i = 0; i < 40; i++){
+        scheduler.schedule(start + 0.2 + i*0.01, boost::bind(&set_reg, tree, i));
+    }
+    BOOST_CHECK(scheduler.run(0.001, 5.0));
+
+    //the commands stay queued in front of the polls, which never wait on them
+    const timed_cmd_scheduler::stats_t stats = scheduler.get_stats();
+    BOOST_CHECK_EQUAL(ctrl.num_cmds, size_t(40));
+    BOOST_CHECK_EQUAL(ctrl.num_waiting_reads, size_t(0));
+    BOOST_CHECK_EQUAL(ctrl.num_overflows, size_t(0));
+    BOOST_CHECK(stats.max_queue_depth >= 2u);
+    BOOST_CHECK(stats.max_queue_depth <= 4u);
+}
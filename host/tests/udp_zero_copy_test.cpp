@@ -0,0 +1,160 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <boost/test/unit_test.hpp>
+#include "../lib/transport/async_reactor.hpp"
+#include <uhd/transport/udp_zero_copy.hpp>
+#include <uhd/utils/atomic.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/asio.hpp>
+#include <boost/lexical_cast.hpp>
+#include <vector>
+
+using namespace uhd::transport;
+namespace asio = boost::asio;
+
+#define NUM_FRAMES 8
+#define NUM_PACKETS 100
+
+static zero_copy_if::sptr make_loopback_xport(const std::string &args, asio::ip::udp::socket &peer){
+    zero_copy_xport_params default_buff_args;
+    default_buff_args.recv_frame_size = 1472;
+    default_buff_args.send_frame_size = 1472;
+    default_buff_args.num_recv_frames = NUM_FRAMES;
+    default_buff_args.num_send_frames = NUM_FRAMES;
+    udp_zero_copy::buff_params buff_params;
+    return udp_zero_copy::make(
+        "127.0.0.1", boost::lexical_cast<std::string>(peer.local_endpoint().port()),
+        default_buff_args, buff_params, uhd::device_addr_t(args)
+    );
+}
+
+/***********************************************************************
+ * Send packets to a local peer and back, with each implementation
+ **********************************************************************/
+static void test_loopback(const std::string &args){
+    asio::io_service io_service;
+    asio::ip::udp::socket peer(io_service, asio::ip::udp::endpoint(asio::ip::address_v4::loopback(), 0));
+    zero_copy_if::sptr xport = make_loopback_xport(args, peer);
+
+    //send more packets than frames, the peer gets them in order
+    asio::ip::udp::endpoint xport_endpoint;
+    for (size_t i = 0; i < NUM_PACKETS; i++){
+        managed_send_buffer::sptr buff = xport->get_send_buff(1.0);
+        BOOST_REQUIRE(buff.get() != NULL);
+        buff->cast<boost::uint32_t *>()[0] = boost::uint32_t(i);
+        buff->commit(sizeof(boost::uint32_t)*(1 + i%16));
+        buff.reset();
+
+        boost::uint32_t got[32];
+        const size_t len = peer.receive_from(asio::buffer(got), xport_endpoint);
+        BOOST_CHECK_EQUAL(len, sizeof(boost::uint32_t)*(1 + i%16));
+        BOOST_CHECK_EQUAL(got[0], i);
+    }
+
+    //the peer sends back, the transport holds some frames while receiving
+    for (size_t i = 0; i < NUM_PACKETS; i++){
+        const boost::uint32_t word = boost::uint32_t(i);
+        peer.send_to(asio::buffer(&word, sizeof(word)), xport_endpoint);
+    }
+    std::vector<managed_recv_buffer::sptr> held;
+    for (size_t i = 0; i < NUM_PACKETS; i++){
+        managed_recv_buffer::sptr buff = xport->get_recv_buff(1.0);
+        BOOST_REQUIRE(buff.get() != NULL);
+        BOOST_CHECK_EQUAL(buff->size(), sizeof(boost::uint32_t));
+        BOOST_CHECK_EQUAL(buff->cast<const boost::uint32_t *>()[0], i);
+        held.push_back(buff);
+        if (held.size() == NUM_FRAMES/2) held.clear();
+    }
+
+    //no more packets
+    BOOST_CHECK(xport->get_recv_buff(0.01).get() == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(test_udp_zero_copy_sockets){
+    test_loopback("");
+}
+
+BOOST_AUTO_TEST_CASE(test_udp_zero_copy_uring){
+    //uses the sockets when io_uring is not available
+    test_loopback("transport=uring");
+    test_loopback("transport=uring,send_sqpoll=1");
+}
+
+/***********************************************************************
+ * Service a transport with the async reactor
+ **********************************************************************/
+static bool count_msgs(zero_copy_if::sptr xport, uhd::atomic_uint32_t *num_msgs, uhd::atomic_uint32_t *num_busy, const double timeout){
+    //pretend another thread holds the transport for the first calls
+    if (num_busy->read() != 0){
+        num_busy->dec();
+        return false;
+    }
+    managed_recv_buffer::sptr buff = xport->get_recv_buff(timeout);
+    if (buff.get() != NULL) num_msgs->inc();
+    return true;
+}
+
+//! Returns true when the reactor polled the transport
+static bool test_reactor(const std::string &args){
+    asio::io_service io_service;
+    asio::ip::udp::socket peer(io_service, asio::ip::udp::endpoint(asio::ip::address_v4::loopback(), 0));
+    zero_copy_if::sptr xport = make_loopback_xport(args, peer);
+
+    //the peer learns the endpoint of the transport
+    managed_send_buffer::sptr send_buff = xport->get_send_buff(1.0);
+    BOOST_REQUIRE(send_buff.get() != NULL);
+    send_buff->commit(sizeof(boost::uint32_t));
+    send_buff.reset();
+    asio::ip::udp::endpoint xport_endpoint;
+    boost::uint32_t word = 0;
+    peer.receive_from(asio::buffer(&word, sizeof(word)), xport_endpoint);
+
+    uhd::atomic_uint32_t num_msgs, num_busy;
+    num_busy.write(3);
+    async_reactor::registration::sptr reg = async_reactor::get()->add(
+        xport, boost::bind(&count_msgs, xport, &num_msgs, &num_busy, _1)
+    );
+    const bool polled = reg->is_polled();
+
+    for (size_t i = 0; i < NUM_PACKETS; i++){
+        peer.send_to(asio::buffer(&word, sizeof(word)), xport_endpoint);
+    }
+    for (size_t i = 0; i < 1000 and num_msgs.read() < NUM_PACKETS; i++){
+        boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+    }
+    BOOST_CHECK_EQUAL(num_msgs.read(), NUM_PACKETS);
+    BOOST_CHECK_EQUAL(num_busy.read(), 0);
+
+    //the handler is not called after the registration is gone
+    reg.reset();
+    peer.send_to(asio::buffer(&word, sizeof(word)), xport_endpoint);
+    boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    BOOST_CHECK_EQUAL(num_msgs.read(), NUM_PACKETS);
+    BOOST_CHECK(xport->get_recv_buff(0.1).get() != NULL);
+    return polled;
+}
+
+BOOST_AUTO_TEST_CASE(test_udp_zero_copy_reactor){
+    const bool polled = test_reactor("");
+    #ifdef UHD_PLATFORM_LINUX
+    BOOST_CHECK(polled);
+    #endif
+    //io_uring transports are not pollable and get a thread
+    test_reactor("transport=uring");
+}
@@ -0,0 +1,70 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <boost/test/unit_test.hpp>
+#include "../lib/transport/usb_xfer_tuner.hpp"
+
+using namespace uhd::transport;
+
+/***********************************************************************
+ * A simulated bus completes one transfer per millisecond.
+ * A host that keeps up resubmits at once, so a transfer waits for all
+ * the others in flight; a host that lags leaves none ahead of it.
+ **********************************************************************/
+static const double INTERVAL = 1e-3;
+
+static double run_bus(usb_xfer_tuner &tuner, double now, const size_t num_xfers, const bool host_keeps_up){
+    for (size_t i = 0; i < num_xfers; i++){
+        now += INTERVAL;
+        const double latency = (host_keeps_up)? tuner.get_num_in_flight()*INTERVAL : INTERVAL;
+        tuner.update(latency, now);
+    }
+    return now;
+}
+
+BOOST_AUTO_TEST_CASE(test_usb_xfer_tuner_shrink_and_grow){
+    usb_xfer_tuner tuner(16);
+    BOOST_CHECK_EQUAL(tuner.get_num_in_flight(), size_t(8));
+
+    //with many transfers always ahead, the count shrinks to a margin of 4
+    double now = run_bus(tuner, 1.0, 5000, true);
+    BOOST_CHECK_CLOSE(tuner.get_interval(), INTERVAL, 1.0);
+    BOOST_CHECK_EQUAL(tuner.get_num_in_flight(), size_t(5));
+
+    //a host that lags grows it to the limit right away
+    now = run_bus(tuner, now, 10, false);
+    BOOST_CHECK_EQUAL(tuner.get_num_in_flight(), size_t(16));
+}
+
+BOOST_AUTO_TEST_CASE(test_usb_xfer_tuner_gaps){
+    usb_xfer_tuner tuner(16);
+    double now = run_bus(tuner, 1.0, 100, true);
+
+    //the first completion after the stream restarts waited a long time,
+    //it is neither an interval nor a sign of a host that keeps up
+    now += 2.0;
+    BOOST_CHECK(not tuner.update(2.0, now));
+    BOOST_CHECK_CLOSE(tuner.get_interval(), INTERVAL, 1.0);
+
+    //a new rate is taken after a few long gaps in a row
+    for (size_t i = 0; i < 8; i++){
+        now += 10*INTERVAL;
+        tuner.update(tuner.get_num_in_flight()*10*INTERVAL, now);
+    }
+    BOOST_CHECK_CLOSE(tuner.get_interval(), 10*INTERVAL, 1.0);
+    BOOST_CHECK_EQUAL(tuner.get_num_in_flight(), size_t(8));
+}
@@ -0,0 +1,140 @@
+//
+// Copyright 2014 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "../lib/transport/packet_trace.hpp"
+#include <uhd/utils/safe_main.hpp>
+#include <uhd/exception.hpp>
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+
+namespace po = boost::program_options;
+using namespace uhd::transport;
+
+/***********************************************************************
+ * Output formats
+ **********************************************************************/
+static void write_csv_header(std::ostream &out){
+    out << "thread,time_us,event,chan,arg0,arg1" << std::endl;
+}
+
+static void write_csv_record(
+    std::ostream &out, const size_t thread, const double time_us, const packet_trace_record_t &record
+){
+    out << boost::format("%u,%.3f,%s,%u,%u,%u")
+        % thread % time_us % packet_trace_event_name(record.event)
+        % record.chan % record.arg0 % record.arg1 << std::endl;
+}
+
+//! Chrome trace: recv and send calls are durations, the other events are instants
+static void write_chrome_record(
+    std::ostream &out, const size_t thread, const double time_us, const packet_trace_record_t &record, bool &first
+){
+    std::string name = packet_trace_event_name(record.event);
+    std::string phase = "i";
+    switch(record.event){
+    case TRACE_RECV_ENTER: name = "recv"; phase = "B"; break;
+    case TRACE_RECV_EXIT:  name = "recv"; phase = "E"; break;
+    case TRACE_SEND_ENTER: name = "send"; phase = "B"; break;
+    case TRACE_SEND_EXIT:  name = "send"; phase = "E"; break;
+    default: break;
+    }
+    out << (first? "\n" : ",\n");
+    first = false;
+    out << boost::format(
+        "{\"name\":\"%s\",\"ph\":\"%s\",%s\"ts\":%.3f,\"pid\":0,\"tid\":%u,"
+        "\"args\":{\"chan\":%u,\"arg0\":%u,\"arg1\":%u}}"
+    ) % name % phase % ((phase == "i")? "\"s\":\"t\"," : "") % time_us % thread
+      % record.chan % record.arg0 % record.arg1;
+}
+
+/***********************************************************************
+ * Main
+ **********************************************************************/
+int UHD_SAFE_MAIN(int argc, char *argv[]){
+    std::string file, format, output;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "help message")
+        ("file", po::value<std::string>(&file), "packet trace file written with UHD_TRACE_FILE")
+        ("format", po::value<std::string>(&format)->default_value("chrome"), "output format: chrome or csv")
+        ("output", po::value<std::string>(&output)->default_value(""), "output file (default stdout)")
+    ;
+    po::positional_options_description pos;
+    pos.add("file", 1);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(pos).run(), vm);
+    po::notify(vm);
+
+    //print the help message
+    if (vm.count("help") or not vm.count("file")){
+        std::cout << boost::format("UHD Trace Dump %s") % desc << std::endl
+            << "Converts a packet trace to a Chrome trace (chrome://tracing) or CSV." << std::endl
+            << "Record a trace with: UHD_TRACE_FILE=trace.bin <application>" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (format != "chrome" and format != "csv") throw uhd::value_error("unknown format " + format);
+
+    std::ifstream in(file.c_str(), std::ios::binary);
+    if (not in) throw uhd::io_error("cannot open " + file);
+    packet_trace_file_header_t header;
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (not in or std::memcmp(header.magic, PACKET_TRACE_MAGIC, sizeof(header.magic)) != 0){
+        throw uhd::value_error(file + " is not a packet trace");
+    }
+    if (header.version != PACKET_TRACE_VERSION){
+        throw uhd::value_error(str(boost::format("%s has trace version %u, expected %u") % file % header.version % PACKET_TRACE_VERSION));
+    }
+
+    std::ofstream out_file;
+    if (not output.empty()){
+        out_file.open(output.c_str());
+        if (not out_file) throw uhd::io_error("cannot open " + output);
+    }
+    std::ostream &out = output.empty()? std::cout : out_file;
+
+    bool first = true;
+    if (format == "csv") write_csv_header(out);
+    else out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+    for (size_t t = 0; t < header.num_threads; t++){
+        packet_trace_thread_header_t thread;
+        in.read(reinterpret_cast<char *>(&thread), sizeof(thread));
+        if (not in) throw uhd::value_error(file + " is truncated");
+        if (thread.num_overwritten != 0) std::cerr << boost::format(
+            "Thread %u: the oldest %u events were overwritten"
+        ) % thread.thread_index % thread.num_overwritten << std::endl;
+
+        for (boost::uint64_t i = 0; i < thread.num_records; i++){
+            packet_trace_record_t record;
+            in.read(reinterpret_cast<char *>(&record), sizeof(record));
+            if (not in) throw uhd::value_error(file + " is truncated");
+            const double time_us = (double(record.ticks) - double(header.start_ticks))/header.ticks_per_sec*1e6;
+            const size_t index = size_t(thread.thread_index);
+            if (format == "csv") write_csv_record(out, index, time_us, record);
+            else write_chrome_record(out, index, time_us, record, first);
+        }
+    }
+
+    if (format == "chrome") out << "\n]}" << std::endl;
+    return EXIT_SUCCESS;
+}